@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "Source/Core/Core.h"
@@ -12,6 +13,16 @@ int main(int argc, char **argv)
 	else { strcpy(program.mesh.path, "Meshes/spot.obj"); }
 	strcpy(program.mesh.name, program.mesh.path);
 
+	#ifdef CT_DEBUG
+	// Engine benchmarks and checks, without opening a window:
+	if (getenv("CT_SELF_TEST"))
+	{
+		if (!ct_program_self_test(&program)) { return 0; }
+		fprintf(stdout, "\nError: %s\n", program.error);
+		return -1;
+	}
+	#endif
+
 	if (ct_program_setup(&program)) { goto error; }
 	if (ct_program_object_setup(&program)) { goto error; }
 
@@ -29,6 +40,12 @@ int main(int argc, char **argv)
 			}
 		}
 
+		if (program.reload_object)
+		{
+			program.reload_object = 0;
+			if (ct_program_object_setup(&program)) { goto error; }
+		}
+
 		ct_program_poll_movement_keys(&program);
 		if (ct_program_start_frame(&program)) { break; }
 		if (ct_program_render(&program)) { break; }
@@ -83,6 +83,7 @@ int ct_program_setup(ct_program_t *program)
 void ct_program_shutdown(ct_program_t *program)
 {
 	ct_program_object_shutdown(program); // Also calls device_wait_idle.
+	ct_tree_cache_free(&(program->tree_cache));
 
 	vka_destroy_descriptor_set(&(program->vulkan), &(program->node_descriptor_set));
 
@@ -110,6 +111,42 @@ void ct_program_shutdown(ct_program_t *program)
 int ct_program_configure(ct_program_t *program)
 {
 	program->scalar_function = ct_tree_scalar_function_y;
+	program->connectivity = CT_GRID_FREUDENTHAL;
+
+	// Merge tree engine:
+	/* The join and split trees are already built at the same time, so the sweep is the
+	 * default. Blocks would each take every thread on top of that, doing 2.5 to 3 times the
+	 * work of one sweep. */
+	char *engine = getenv("CT_MERGE_TREE");
+	program->merge_tree_engine = CT_MERGE_TREE_SWEEP;
+	if (engine && !strcmp(engine, "blocks"))
+	{
+		program->merge_tree_engine = CT_MERGE_TREE_BLOCKS;
+	}
+	else if (engine && !strcmp(engine, "leaves"))
+	{
+		program->merge_tree_engine = CT_MERGE_TREE_LEAVES;
+	}
+	else if (engine && !strcmp(engine, "critical"))
+	{
+		program->merge_tree_engine = CT_MERGE_TREE_CRITICAL;
+	}
+	else if (engine && !strcmp(engine, "edges"))
+	{
+		program->merge_tree_engine = CT_MERGE_TREE_EDGES;
+	}
+	else if (engine && strcmp(engine, "sweep"))
+	{
+		snprintf(program->error, NM_MAX_ERROR_LENGTH, "Unknown merge tree engine \"%s\".",
+										engine);
+		return -1;
+	}
+
+	// Tree cache, also kept on disk if a directory is given:
+	if (ct_tree_cache_init(&(program->tree_cache), getenv("CT_TREE_CACHE"), 0, program->error))
+	{
+		return -1;
+	}
 
 	// Command buffer:
 	strcpy(program->command_buffer.name, "CT command buffer");
@@ -340,47 +377,72 @@ int ct_program_configure(ct_program_t *program)
 
 int ct_program_object_setup(ct_program_t *program)
 {
-	struct timespec time;
-
 	// Destroy all objects first (file dialogue will be possible in the future):
 	ct_program_object_shutdown(program);
 
-	// Load mesh:
-	get_time(&time);
-	if (ct_mesh_load(&(program->mesh), program->error)) { return -1; }
-	fprintf(stdout, "\n");
-	print_time_end(stdout, &time, "(mesh load):\t\t\t\t");
-
-	get_time(&time);
-	if (ct_mesh_calculate_edges(&(program->mesh), program->error)) { return -1; }
-	print_time_end(stdout, &time, "(edge calculation):\t\t\t");
+	/* Each stage runs as soon as the stages it needs have finished, so the join and split
+	 * sweeps overlap with each other and with the GPU mesh setup. Debug builds also classify
+	 * the critical points alongside them, to check the reduced trees against. Release builds
+	 * leave it out: nothing is drawn before the contour tree, and a saddle of the link can
+	 * close a loop rather than join components, so the sweeps can't skip regular vertices on
+	 * the strength of it: */
+	struct
+	{
+		char *name;
+		int (*function)(void *data, char error[NM_MAX_ERROR_LENGTH]);
+		uint32_t num_dependencies;
+		uint32_t dependencies[3];
+	} stages[] =
+	{
+		{ "mesh load",			ct_program_task_load_mesh,	   0, { 0 } },	     // 0
+		{ "edge calculation",		ct_program_task_calculate_edges,   1, { 0 } },	     // 1
+		{ "manifold check",		ct_program_task_check_manifold,    1, { 1 } },	     // 2
+		{ "scalars setup",		ct_program_task_setup_scalars,	   1, { 2 } },	     // 3
+		{ "GPU mesh setup",		ct_program_task_prepare_mesh,	   1, { 3 } },	     // 4
+		{ "join tree",			ct_program_task_join_tree,	   1, { 3 } },	     // 5
+		{ "split tree",			ct_program_task_split_tree,	   1, { 3 } },	     // 6
+		#ifdef CT_DEBUG
+		{ "critical points",		ct_program_task_classify_vertices, 1, { 3 } },	     // 7
+		{ "tree reduction",		ct_program_task_reduce_trees,	   3, { 5, 6, 7 } }, // 8
+		{ "contour tree",		ct_program_task_contour_tree,	   1, { 8 } }	     // 9
+		#else
+		{ "tree reduction",		ct_program_task_reduce_trees,	   2, { 5, 6 } },    // 7
+		{ "contour tree",		ct_program_task_contour_tree,	   1, { 7 } }	     // 8
+		#endif
+	};
+
+	ct_task_graph_t graph = {0};
+	for (uint32_t i = 0; i < (sizeof(stages) / sizeof(stages[0])); i++)
+	{
+		if (ct_task_graph_add(&graph, stages[i].name, stages[i].function, program,
+			stages[i].num_dependencies, stages[i].dependencies, program->error))
+		{
+			return -1;
+		}
+	}
 
-	get_time(&time);
-	if (ct_mesh_check_manifold(&(program->mesh), program->error)) { return -1; }
-	print_time_end(stdout, &time, "(manifold check):\t\t\t");
+	fprintf(stdout, "\n");
+	int status = ct_task_graph_run(&graph, program->error);
+	ct_task_graph_print(stdout, &graph);
+	if (status) { return -1; }
 
 	#ifdef CT_DEBUG
+	fprintf(stdout, "\n");
 	ct_mesh_print_short(stdout, &(program->mesh));
+	fprintf(stdout, "\n");
+	ct_mesh_gpu_ready_print_short(stdout, &(program->gpu_mesh));
 	#endif
 
-	if (!program->mesh.is_manifold)
-	{
-		snprintf(program->error, NM_MAX_ERROR_LENGTH, "Mesh \"%s\" is not manifold.",
-									program->mesh.name);
-		return -1;
-	}
-
-	// Get scalar values:
-	get_time(&time);
-	if (program->scalar_function(&(program->join_tree), &(program->mesh), program->error))
-	{
-		return -1;
-	}
-	if (ct_tree_copy_nodes(&(program->join_tree), &(program->split_tree), program->error))
+	// Keep newly computed trees:
+	char *function_name = ct_tree_scalar_function_name(program->scalar_function);
+	if (!program->trees_cached && function_name && ct_tree_cache_insert(
+		&(program->tree_cache), program->tree_key, program->num_vertices,
+		program->vertex_values, &(program->join_tree), &(program->split_tree),
+		&(program->contour_tree), program->error))
 	{
-		return -1;
+		fprintf(stdout, "Warning: could not cache trees: %s\n", program->error);
+		strcpy(program->error, "");
 	}
-	print_time_end(stdout, &time, "(scalars setup):\t\t\t");
 
 	// Get scalar limits:
 	program->scene_uniform.max_value = program->join_tree.nodes[
@@ -390,30 +452,20 @@ int ct_program_object_setup(ct_program_t *program)
 	program->scene_uniform.highlight_size = (program->scene_uniform.max_value -
 					program->scene_uniform.min_value) * 0.015f;
 
-	// Create temporary GPU-ready mesh:
-	get_time(&time);
-	ct_mesh_gpu_ready_t gpu_mesh = {0};
-	if (ct_program_prepare_mesh(program, &gpu_mesh)) { return -1; }
-	print_time_end(stdout, &time, "(GPU mesh setup):\t\t\t");
-
-	#ifdef CT_DEBUG
-	fprintf(stdout, "\n");
-	ct_mesh_gpu_ready_print_short(stdout, &gpu_mesh);
-	#endif
-
 	// Get mesh sizes for better camera positioning:
+	ct_mesh_gpu_ready_t *gpu_mesh = &(program->gpu_mesh);
 	float limits[6];
-	limits[0] = limits[1] = gpu_mesh.vertices[0].x;
-	limits[2] = limits[3] = gpu_mesh.vertices[0].y;
-	limits[4] = limits[5] = gpu_mesh.vertices[0].z;
-	for (uint32_t i = 0; i < gpu_mesh.num_vertices; i++)
+	limits[0] = limits[1] = gpu_mesh->vertices[0].x;
+	limits[2] = limits[3] = gpu_mesh->vertices[0].y;
+	limits[4] = limits[5] = gpu_mesh->vertices[0].z;
+	for (uint32_t i = 0; i < gpu_mesh->num_vertices; i++)
 	{
-		if (gpu_mesh.vertices[i].x < limits[0]) { limits[0] = gpu_mesh.vertices[i].x; }
-		if (gpu_mesh.vertices[i].x > limits[1]) { limits[1] = gpu_mesh.vertices[i].x; }
-		if (gpu_mesh.vertices[i].y < limits[2]) { limits[2] = gpu_mesh.vertices[i].y; }
-		if (gpu_mesh.vertices[i].y > limits[3]) { limits[3] = gpu_mesh.vertices[i].y; }
-		if (gpu_mesh.vertices[i].z < limits[4]) { limits[4] = gpu_mesh.vertices[i].z; }
-		if (gpu_mesh.vertices[i].z > limits[5]) { limits[5] = gpu_mesh.vertices[i].z; }
+		if (gpu_mesh->vertices[i].x < limits[0]) { limits[0] = gpu_mesh->vertices[i].x; }
+		if (gpu_mesh->vertices[i].x > limits[1]) { limits[1] = gpu_mesh->vertices[i].x; }
+		if (gpu_mesh->vertices[i].y < limits[2]) { limits[2] = gpu_mesh->vertices[i].y; }
+		if (gpu_mesh->vertices[i].y > limits[3]) { limits[3] = gpu_mesh->vertices[i].y; }
+		if (gpu_mesh->vertices[i].z < limits[4]) { limits[4] = gpu_mesh->vertices[i].z; }
+		if (gpu_mesh->vertices[i].z > limits[5]) { limits[5] = gpu_mesh->vertices[i].z; }
 	}
 
 	program->mesh_centre[0] = -(limits[0] + limits[1]) / 2.f;
@@ -425,26 +477,212 @@ int ct_program_object_setup(ct_program_t *program)
 	if (program->translate_speed < 0.f) { program->translate_speed *= -1.f; }
 	if (program->translate_speed == 0.f) { program->translate_speed = 0.01f; }
 
+	glm_mat4_identity(program->scene_uniform.model);
+	glm_mat4_identity(program->scene_uniform.view);
 	glm_translate_z(program->scene_uniform.view, -(2.5f * limits[5]));
 	glm_translate(program->scene_uniform.model, program->mesh_centre);
+	program->update_scene_uniform = 1;
+
+	// Set up object buffers:
+	if (ct_program_create_object_buffers(program, gpu_mesh)) { return -1; }
+	if (ct_program_create_object_allocations(program)) { return -1; }
+	if (ct_program_upload_object_data(program, gpu_mesh)) { return -1; }
+
+	ct_mesh_gpu_ready_free(gpu_mesh);
+	return 0;
+}
+
+#ifdef CT_DEBUG
+int ct_program_self_test(ct_program_t *program)
+{
+	/* Benchmarks and checks of every engine on the program's mesh, with no window. Each one
+	 * compares its trees (or pairs, or sets) with the sweep's and fails on any difference.
+	 * Some rebuild the whole pipeline many times over, so this only runs when asked for (set
+	 * CT_SELF_TEST), never during object setup. */
+	ct_mesh_t *mesh = &(program->mesh);
+	ct_tree_t *tree = &(program->join_tree);
+	char *error = program->error;
+	int status = ct_concurrent_set_test(stdout, 65536, 4, error) ||
+		ct_mesh_load(mesh, error);
+
+	// Voxel grids are swept directly, so only meshes need edges:
+	uint8_t grid = (mesh->volume.scalars && !mesh->num_faces);
+	status = status || (!grid && (ct_program_task_calculate_edges(program, error) ||
+					ct_program_task_check_manifold(program, error)));
+	status = status || (grid ? ct_tree_scalar_function_volume(tree, mesh, error) :
+					ct_tree_scalar_function_y(tree, mesh, error));
 
-	// Construct join and split trees:
-	get_time(&time);
-	if (ct_merge_tree_construct(&(program->join_tree), &(program->mesh),
-			program->join_tree.num_nodes - 1, program->error))
+	fprintf(stdout, "\n");
+	status = status || ct_merge_tree_benchmark(stdout, tree, mesh, error) ||
+		ct_contour_tree_benchmark(stdout, error) ||
+		ct_disjoint_set_benchmark(stdout, tree, mesh, error) ||
+		ct_leaf_growth_benchmark(stdout, tree, mesh, error) ||
+		ct_block_tree_benchmark(stdout, tree, mesh, error) ||
+		ct_merge_tree_critical_benchmark(stdout, tree, mesh, error) ||
+		ct_edge_tree_benchmark(stdout, tree, mesh, error) ||
+		ct_edge_tree_region_benchmark(stdout, mesh, error) ||
+		ct_edge_tree_band_benchmark(stdout, mesh, error) ||
+		ct_persistence_benchmark(stdout, mesh, error) ||
+		ct_concurrent_set_benchmark(stdout, mesh, error);
+
+	ct_tree_free(tree);
+	ct_mesh_free(mesh);
+	if (status) { return -1; }
+
+	fprintf(stdout, "\nSelf test passed.\n");
+	return 0;
+}
+#endif
+
+/* Object setup stages, run by the task graph in ct_program_object_setup. Each takes the program
+ * and writes into its own error buffer, since stages can run at the same time. */
+
+int ct_program_task_load_mesh(void *data, char error[NM_MAX_ERROR_LENGTH])
+{
+	ct_program_t *program = data;
+	ct_mesh_t *mesh = &(program->mesh);
+	if (ct_mesh_load(mesh, error)) { return -1; }
+	program->num_vertices = mesh->num_vertices;
+
+	// Volumes with no faces are swept on the grid, with voxel values as the scalar function:
+	if (mesh->volume.scalars && !mesh->num_faces)
 	{
-		ct_mesh_gpu_ready_free(&gpu_mesh);
+		uint64_t num_voxels = ct_volume_get_num_voxels(&(mesh->volume));
+		if (num_voxels >= UINT32_MAX)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "Volume \"%s\" has too many voxels.",
+									mesh->name);
+			return -1;
+		}
+
+		mesh->volume.connectivity = program->connectivity;
+		program->num_vertices = (uint32_t)num_voxels;
+		program->scalar_function = ct_tree_scalar_function_volume;
+	}
+
+	return 0;
+}
+
+int ct_program_task_calculate_edges(void *data, char error[NM_MAX_ERROR_LENGTH])
+{
+	ct_program_t *program = data;
+
+	// Voxel grids are swept directly, so only meshes need edges:
+	if (program->mesh.volume.scalars && !program->mesh.num_faces) { return 0; }
+	return ct_mesh_calculate_edges(&(program->mesh), error);
+}
+
+int ct_program_task_check_manifold(void *data, char error[NM_MAX_ERROR_LENGTH])
+{
+	ct_program_t *program = data;
+	if (program->mesh.volume.scalars && !program->mesh.num_faces) { return 0; }
+	if (ct_mesh_check_manifold(&(program->mesh), error)) { return -1; }
+	if (!program->mesh.is_manifold)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Mesh \"%s\" is not manifold.",
+								program->mesh.name);
+		return -1;
+	}
+
+	return 0;
+}
+
+int ct_program_task_setup_scalars(void *data, char error[NM_MAX_ERROR_LENGTH])
+{
+	ct_program_t *program = data;
+
+	// Checked before any sweeps, as every load ends with the contour tree:
+	if (ct_mesh_check_contour_tree(&(program->mesh), error)) { return -1; }
+
+	program->vertex_values = malloc(program->num_vertices * sizeof(float));
+	if (!program->vertex_values)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for vertex values of mesh \"%s\".",
+							program->mesh.name);
 		return -1;
 	}
-	print_time_end(stdout, &time, "(join tree):\t\t\t\t");
-	get_time(&time);
-	if (ct_merge_tree_construct(&(program->split_tree), &(program->mesh),
-							0, program->error))
+
+	// Look up trees already computed for this mesh and scalar function:
+	program->trees_cached = 0;
+	char *function_name = ct_tree_scalar_function_name(program->scalar_function);
+	if (function_name)
+	{
+		// Kept for ct_tree_cache_insert, so the mesh is only hashed once per load:
+		program->tree_key = ct_tree_cache_get_key(&(program->mesh), function_name);
+		int cached = ct_tree_cache_find(&(program->tree_cache), program->tree_key,
+			program->num_vertices, program->vertex_values, &(program->join_tree),
+			&(program->split_tree), &(program->contour_tree), error);
+		if (cached < 0) { return -1; }
+		program->trees_cached = cached;
+	}
+	if (program->trees_cached) { return 0; }
+
+	// Get scalar values:
+	if (program->scalar_function(&(program->join_tree), &(program->mesh), error)) { return -1; }
+	if (ct_tree_copy_nodes(&(program->join_tree), &(program->split_tree), error)) { return -1; }
+	ct_tree_get_vertex_values(&(program->join_tree), program->vertex_values);
+
+	return 0;
+}
+
+int ct_program_task_prepare_mesh(void *data, char error[NM_MAX_ERROR_LENGTH])
+{
+	ct_program_t *program = data;
+	if (ct_program_prepare_mesh(program, &(program->gpu_mesh)))
 	{
-		ct_mesh_gpu_ready_free(&gpu_mesh);
+		strcpy(error, program->error);
 		return -1;
 	}
-	print_time_end(stdout, &time, "(split tree):\t\t\t");
+
+	return 0;
+}
+
+#ifdef CT_DEBUG
+int ct_program_task_classify_vertices(void *data, char error[NM_MAX_ERROR_LENGTH])
+{
+	ct_program_t *program = data;
+	program->link_components = malloc(program->num_vertices * 2 * sizeof(uint8_t));
+	if (!program->link_components)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for link components of mesh \"%s\".",
+							program->mesh.name);
+		return -1;
+	}
+
+	if (ct_critical_points_classify(&(program->mesh), program->vertex_values,
+					program->link_components, error))
+	{
+		return -1;
+	}
+	ct_critical_points_print_summary(stdout, program->num_vertices,
+						program->link_components);
+
+	return 0;
+}
+#endif
+
+int ct_program_task_join_tree(void *data, char error[NM_MAX_ERROR_LENGTH])
+{
+	ct_program_t *program = data;
+	if (program->trees_cached) { return 0; }
+	return ct_program_construct_merge_tree(program, &(program->join_tree),
+					program->join_tree.num_nodes - 1, error);
+}
+
+int ct_program_task_split_tree(void *data, char error[NM_MAX_ERROR_LENGTH])
+{
+	ct_program_t *program = data;
+	if (program->trees_cached) { return 0; }
+	return ct_program_construct_merge_tree(program, &(program->split_tree), 0, error);
+}
+
+int ct_program_task_reduce_trees(void *data, char error[NM_MAX_ERROR_LENGTH])
+{
+	ct_program_t *program = data;
+	if (program->trees_cached) { return 0; }
+
 	#ifdef CT_DEBUG
 	fprintf(stdout, "\n*************\n");
 	fprintf(stdout, "* Join tree *\n");
@@ -457,17 +695,15 @@ int ct_program_object_setup(ct_program_t *program)
 	ct_tree_print_short(stdout, &(program->split_tree));
 	#endif
 
-	// Reduce merge trees:
-	get_time(&time);
-	if (ct_merge_trees_reduce_to_critical(&(program->join_tree), &(program->split_tree),
-									program->error))
+	if (ct_program_reduce_merge_trees(program, error)) { return -1; }
+
+	#ifdef CT_DEBUG
+	if (ct_critical_points_check(stdout, &(program->join_tree), &(program->split_tree),
+						program->link_components, error))
 	{
-		ct_mesh_gpu_ready_free(&gpu_mesh);
 		return -1;
 	}
-	print_time_end(stdout, &time, "(tree reduction):\t\t\t");
 
-	#ifdef CT_DEBUG
 	fprintf(stdout, "\n*********************\n");
 	fprintf(stdout, "* Reduced join tree *\n");
 	fprintf(stdout, "*********************\n");
@@ -479,15 +715,18 @@ int ct_program_object_setup(ct_program_t *program)
 	ct_tree_print_short(stdout, &(program->split_tree));
 	#endif
 
-	// Construct contour tree:
-	get_time(&time);
+	return 0;
+}
+
+int ct_program_task_contour_tree(void *data, char error[NM_MAX_ERROR_LENGTH])
+{
+	ct_program_t *program = data;
+	if (program->trees_cached) { return 0; }
 	if (ct_contour_tree_construct(&(program->contour_tree), &(program->join_tree),
-					&(program->split_tree), program->error))
+					&(program->split_tree), error))
 	{
-		ct_mesh_gpu_ready_free(&gpu_mesh);
 		return -1;
 	}
-	print_time_end(stdout, &time, "(contour tree):\t\t\t");
 
 	#ifdef CT_DEBUG
 	fprintf(stdout, "\n****************\n");
@@ -497,59 +736,6 @@ int ct_program_object_setup(ct_program_t *program)
 	fprintf(stdout, "\n");
 	#endif
 
-	// TODO - undo-redo stack, then you can spin these back using that:
-	// Reconstruct join and split trees:
-	ct_tree_free(&(program->join_tree));
-	ct_tree_free(&(program->split_tree));
-	if (program->scalar_function(&(program->join_tree), &(program->mesh), program->error))
-	{
-		ct_mesh_gpu_ready_free(&gpu_mesh);
-		return -1;
-	}
-	if (ct_tree_copy_nodes(&(program->join_tree), &(program->split_tree), program->error))
-	{
-		ct_mesh_gpu_ready_free(&gpu_mesh);
-		return -1;
-	}
-	if (ct_merge_tree_construct(&(program->join_tree), &(program->mesh),
-			program->join_tree.num_nodes - 1, program->error))
-	{
-		ct_mesh_gpu_ready_free(&gpu_mesh);
-		return -1;
-	}
-	if (ct_merge_tree_construct(&(program->split_tree), &(program->mesh),
-							0, program->error))
-	{
-		ct_mesh_gpu_ready_free(&gpu_mesh);
-		return -1;
-	}
-
-	// Reduce merge trees:
-	if (ct_merge_trees_reduce_to_critical(&(program->join_tree), &(program->split_tree),
-									program->error))
-	{
-		ct_mesh_gpu_ready_free(&gpu_mesh);
-		return -1;
-	}
-
-	// Set up object buffers:
-	if (ct_program_create_object_buffers(program, &gpu_mesh))
-	{
-		ct_mesh_gpu_ready_free(&gpu_mesh);
-		return -1;
-	}
-	if (ct_program_create_object_allocations(program))
-	{
-		ct_mesh_gpu_ready_free(&gpu_mesh);
-		return -1;
-	}
-	if (ct_program_upload_object_data(program, &gpu_mesh))
-	{
-		ct_mesh_gpu_ready_free(&gpu_mesh);
-		return -1;
-	}
-
-	ct_mesh_gpu_ready_free(&gpu_mesh);
 	return 0;
 }
 
@@ -579,33 +765,40 @@ void ct_program_object_shutdown(ct_program_t *program)
 	ct_tree_free(&(program->contour_tree));
 	ct_tree_free(&(program->split_tree));
 	ct_tree_free(&(program->join_tree));
+	free(program->arc_maps[0]);
+	free(program->arc_maps[1]);
+	program->arc_maps[0] = NULL;
+	program->arc_maps[1] = NULL;
+	ct_mesh_gpu_ready_free(&(program->gpu_mesh));
 	ct_mesh_free(&(program->mesh));
+	free(program->vertex_values);
+	program->vertex_values = NULL;
+	free(program->link_components);
+	program->link_components = NULL;
 }
 
 int ct_program_prepare_mesh(ct_program_t *program, ct_mesh_gpu_ready_t *gpu_mesh)
 {
-	if (ct_mesh_check_validity(&(program->mesh), program->error)) { return -1; }
-	if (!program->join_tree.nodes)
-	{
-		snprintf(program->error, NM_MAX_ERROR_LENGTH, "Join tree has no nodes.");
-		return -1;
-	}
-	if (program->mesh.num_vertices != program->join_tree.num_nodes)
+	uint8_t grid = (program->mesh.volume.scalars && !program->mesh.num_faces);
+	if (!grid && ct_mesh_check_validity(&(program->mesh), program->error)) { return -1; }
+	if (!program->vertex_values)
 	{
-		snprintf(program->error, NM_MAX_ERROR_LENGTH, "Number of vertices in mesh \"%s\" "
-			"doesn't match number of nodes in join tree.", program->mesh.name);
+		snprintf(program->error, NM_MAX_ERROR_LENGTH, "Mesh \"%s\" has no vertex values.",
+								program->mesh.name);
 		return -1;
 	}
 
 	// Only need a subset of attributes, so allocate here:
 	ct_mesh_gpu_ready_free(gpu_mesh);
 	strcpy(gpu_mesh->name, program->mesh.name);
-	gpu_mesh->num_vertices = program->mesh.num_vertices;
+	gpu_mesh->num_vertices = program->num_vertices;
 	gpu_mesh->num_faces = program->mesh.num_faces;
 	gpu_mesh->vertices = malloc(gpu_mesh->num_vertices * sizeof(ct_vertex_t));
-	gpu_mesh->normals = malloc(gpu_mesh->num_vertices * sizeof(ct_normal_t));
+	gpu_mesh->normals = calloc(gpu_mesh->num_vertices, sizeof(ct_normal_t));
 	gpu_mesh->uvs = malloc(gpu_mesh->num_vertices * sizeof(ct_uv_t));
-	gpu_mesh->faces = malloc(gpu_mesh->num_faces * sizeof(ct_face_gpu_ready_t));
+
+	// Vulkan buffers can't be empty, so volumes keep one unused face:
+	gpu_mesh->faces = calloc(grid ? 1 : gpu_mesh->num_faces, sizeof(ct_face_gpu_ready_t));
 	if (!gpu_mesh->vertices || !gpu_mesh->normals || !gpu_mesh->uvs || !gpu_mesh->faces)
 	{
 		snprintf(program->error, NM_MAX_ERROR_LENGTH,
@@ -614,26 +807,40 @@ int ct_program_prepare_mesh(ct_program_t *program, ct_mesh_gpu_ready_t *gpu_mesh
 		return -1;
 	}
 
-	// Copy vertices and faces directly:
-	memcpy(gpu_mesh->vertices, program->mesh.vertices, gpu_mesh->num_vertices *
-							sizeof(ct_vertex_t));
-
-	for (uint32_t i = 0; i < gpu_mesh->num_faces; i++)
+	// Voxels are only drawn as tree nodes, so they get grid positions and no normals:
+	if (grid)
 	{
-		for (int j = 0; j < 3; j++)
+		for (uint32_t i = 0; i < gpu_mesh->num_vertices; i++)
 		{
-			gpu_mesh->faces[i][j] = program->mesh.faces[i][j].v;
+			float position[3];
+			ct_region_get_position(&(program->mesh), i, position);
+			gpu_mesh->vertices[i].x = position[0];
+			gpu_mesh->vertices[i].y = position[1];
+			gpu_mesh->vertices[i].z = position[2];
 		}
 	}
+	else
+	{
+		// Copy vertices and faces directly:
+		memcpy(gpu_mesh->vertices, program->mesh.vertices, gpu_mesh->num_vertices *
+								sizeof(ct_vertex_t));
+
+		for (uint32_t i = 0; i < gpu_mesh->num_faces; i++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				gpu_mesh->faces[i][j] = program->mesh.faces[i][j].v;
+			}
+		}
 
-	// Get per-vertex normals:
-	if (ct_mesh_gpu_ready_vertex_normals(gpu_mesh, program->error)) { return -1; }
+		// Get per-vertex normals:
+		if (ct_mesh_gpu_ready_vertex_normals(gpu_mesh, program->error)) { return -1; }
+	}
 
 	// Put scalar values into U coordinates:
 	for (uint32_t i = 0; i < gpu_mesh->num_vertices; i++)
 	{
-		gpu_mesh->uvs[i].u = program->join_tree.nodes[
-			program->join_tree.nodes[i].vertex_to_node].value;
+		gpu_mesh->uvs[i].u = program->vertex_values[i];
 	}
 
 	return 0;
@@ -716,7 +923,8 @@ int ct_program_create_object_buffers(ct_program_t *program, ct_mesh_gpu_ready_t
 	}
 
 	// Object mesh buffers:
-	program->mesh_buffer_index.size = gpu_mesh->num_faces * sizeof(ct_face_gpu_ready_t);
+	program->mesh_buffer_index.size = (gpu_mesh->num_faces ? gpu_mesh->num_faces : 1) *
+							sizeof(ct_face_gpu_ready_t);
 	if (vka_create_buffer(&(program->vulkan), &(program->mesh_buffer_index))) { return -1; }
 	if (vka_get_buffer_requirements(&(program->vulkan), &(program->mesh_buffer_index)))
 	{
@@ -1040,6 +1248,59 @@ int ct_program_upload_helper(ct_program_t *program, vka_allocation_t *staging_al
 	return 0;
 }
 
+int ct_program_construct_merge_tree(ct_program_t *program, ct_tree_t *merge_tree,
+				uint32_t start_index, char error[NM_MAX_ERROR_LENGTH])
+{
+	if (program->merge_tree_engine == CT_MERGE_TREE_BLOCKS)
+	{
+		return ct_merge_tree_construct_blocks(merge_tree, &(program->mesh), start_index, 0,
+										error);
+	}
+	else if (program->merge_tree_engine == CT_MERGE_TREE_LEAVES)
+	{
+		return ct_merge_tree_construct_leaves(merge_tree, &(program->mesh), start_index,
+										error);
+	}
+	else if (program->merge_tree_engine == CT_MERGE_TREE_EDGES)
+	{
+		return ct_merge_tree_construct_edges(merge_tree, &(program->mesh), start_index,
+										error);
+	}
+	else if (program->merge_tree_engine == CT_MERGE_TREE_CRITICAL)
+	{
+		// The arc map is kept for ct_program_reduce_merge_trees:
+		uint32_t **arc_map = &(program->arc_maps[start_index == 0]);
+		free(*arc_map);
+		*arc_map = malloc(merge_tree->num_nodes * sizeof(uint32_t));
+		if (!*arc_map)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for arc map.");
+			return -1;
+		}
+		return ct_merge_tree_construct_critical(merge_tree, &(program->mesh), start_index,
+									*arc_map, error);
+	}
+	return ct_merge_tree_construct(merge_tree, &(program->mesh), start_index, error);
+}
+
+int ct_program_reduce_merge_trees(ct_program_t *program, char error[NM_MAX_ERROR_LENGTH])
+{
+	// Critical-only trees just need each other's nodes, which replaces the reduction pass:
+	if (program->merge_tree_engine != CT_MERGE_TREE_CRITICAL)
+	{
+		return ct_merge_trees_reduce_to_critical(&(program->join_tree),
+						&(program->split_tree), error);
+	}
+
+	int status = ct_merge_trees_augment(&(program->join_tree), &(program->split_tree),
+				program->arc_maps[0], program->arc_maps[1], error);
+	free(program->arc_maps[0]);
+	free(program->arc_maps[1]);
+	program->arc_maps[0] = NULL;
+	program->arc_maps[1] = NULL;
+	return status;
+}
+
 void ct_program_process_input(ct_program_t *program, SDL_Event *event)
 {
 	if (event->key.key == SDLK_TAB)
@@ -1050,6 +1311,34 @@ void ct_program_process_input(ct_program_t *program, SDL_Event *event)
 		else if (program->tree_display == 2) { printf("Split tree.\n"); }
 		else { printf("Contour tree.\n"); }
 	}
+	else if ((event->key.key == SDLK_X) || (event->key.key == SDLK_Y) ||
+						(event->key.key == SDLK_Z))
+	{
+		// Volumes with no faces only have their voxel values:
+		if (program->mesh.volume.scalars && !program->mesh.num_faces) { return; }
+
+		// Trees for each function are cached, so switching back is cheap:
+		int (*scalar_function)(ct_tree_t *tree, ct_mesh_t *mesh,
+			char error[NM_MAX_ERROR_LENGTH]) = ct_tree_scalar_function_y;
+		if (event->key.key == SDLK_X) { scalar_function = ct_tree_scalar_function_x; }
+		else if (event->key.key == SDLK_Z) { scalar_function = ct_tree_scalar_function_z; }
+		if (scalar_function != program->scalar_function)
+		{
+			program->scalar_function = scalar_function;
+			program->reload_object = 1;
+			printf("Scalar function: %s.\n", ct_tree_scalar_function_name(scalar_function));
+		}
+	}
+	else if ((event->key.key == SDLK_C) && program->mesh.volume.scalars &&
+							!program->mesh.num_faces)
+	{
+		// Switches between the volume connectivities that have contour trees:
+		program->connectivity = (program->connectivity == CT_GRID_FREUDENTHAL) ?
+						CT_GRID_VERTICES : CT_GRID_FREUDENTHAL;
+		program->reload_object = 1;
+		printf("Connectivity: %s.\n", (program->connectivity == CT_GRID_VERTICES) ?
+					"26 neighbours" : "Freudenthal, 14 neighbours");
+	}
 }
 
 void ct_program_poll_movement_keys(ct_program_t *program)
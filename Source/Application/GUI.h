@@ -14,6 +14,13 @@
 #define CT_CLIP_NEAR	    0.1f
 #define CT_CLIP_FAR	10000.0f
 
+// Merge tree engines, chosen with the CT_MERGE_TREE environment variable:
+#define CT_MERGE_TREE_SWEEP	0 // "sweep", ct_merge_tree_construct (the default).
+#define CT_MERGE_TREE_BLOCKS	1 // "blocks", ct_merge_tree_construct_blocks.
+#define CT_MERGE_TREE_LEAVES	2 // "leaves", ct_merge_tree_construct_leaves.
+#define CT_MERGE_TREE_CRITICAL	3 // "critical", ct_merge_tree_construct_critical.
+#define CT_MERGE_TREE_EDGES	4 // "edges", ct_merge_tree_construct_edges.
+
 typedef struct
 {
 	mat4 model;
@@ -77,10 +84,21 @@ typedef struct
 	vka_buffer_t mesh_buffer_normals;
 
 	int (*scalar_function)(ct_tree_t *tree, ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
+	uint8_t merge_tree_engine; // CT_MERGE_TREE_<X>.
+	uint8_t connectivity; // CT_GRID_<X>, applied to volumes on load.
+	uint32_t *arc_maps[2]; // Join[0], split[1]. Critical engine only, until trees are augmented.
 	ct_mesh_t mesh;
+	uint32_t num_vertices; // Mesh vertices, or voxels of a volume with no faces.
 	ct_tree_t join_tree;
 	ct_tree_t split_tree;
 	ct_tree_t contour_tree;
+	float *vertex_values; // Scalar value per vertex or voxel, for colouring.
+	uint8_t *link_components; // Lower[0], upper[1] link components per vertex. Debug only.
+	ct_mesh_gpu_ready_t gpu_mesh; // Only kept during object setup.
+	ct_tree_cache_t tree_cache;
+	uint64_t tree_key; // Cache key of the mesh and scalar function, from the scalars stage.
+	uint8_t reload_object; // Set when the scalar function changes.
+	uint8_t trees_cached; // Set during object setup if the trees came from the cache.
 
 	int tree_display;
 	float translate_speed;
@@ -103,6 +121,25 @@ int ct_program_create_object_allocations(ct_program_t *program);
 int ct_program_upload_object_data(ct_program_t *program, ct_mesh_gpu_ready_t *gpu_mesh);
 int ct_program_upload_helper(ct_program_t *program, vka_allocation_t *staging_allocation,
 		vka_buffer_t *staging_buffer, vka_buffer_t *destination, uint8_t *data);
+int ct_program_construct_merge_tree(ct_program_t *program, ct_tree_t *merge_tree,
+				uint32_t start_index, char error[NM_MAX_ERROR_LENGTH]);
+int ct_program_reduce_merge_trees(ct_program_t *program, char error[NM_MAX_ERROR_LENGTH]);
+#ifdef CT_DEBUG
+int ct_program_self_test(ct_program_t *program);
+#endif
+
+int ct_program_task_load_mesh(void *data, char error[NM_MAX_ERROR_LENGTH]);
+int ct_program_task_calculate_edges(void *data, char error[NM_MAX_ERROR_LENGTH]);
+int ct_program_task_check_manifold(void *data, char error[NM_MAX_ERROR_LENGTH]);
+int ct_program_task_setup_scalars(void *data, char error[NM_MAX_ERROR_LENGTH]);
+int ct_program_task_prepare_mesh(void *data, char error[NM_MAX_ERROR_LENGTH]);
+int ct_program_task_join_tree(void *data, char error[NM_MAX_ERROR_LENGTH]);
+int ct_program_task_split_tree(void *data, char error[NM_MAX_ERROR_LENGTH]);
+int ct_program_task_reduce_trees(void *data, char error[NM_MAX_ERROR_LENGTH]);
+int ct_program_task_contour_tree(void *data, char error[NM_MAX_ERROR_LENGTH]);
+#ifdef CT_DEBUG
+int ct_program_task_classify_vertices(void *data, char error[NM_MAX_ERROR_LENGTH]);
+#endif
 
 void ct_program_process_input(ct_program_t *program, SDL_Event *event);
 void ct_program_poll_movement_keys(ct_program_t *program);
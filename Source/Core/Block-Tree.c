@@ -0,0 +1,867 @@
+#include "Block-Tree.h"
+
+/****************
+ * Construction *
+ ****************/
+
+/* Merge trees built by domain decomposition. The vertices are split into blocks of consecutive
+ * indices (slabs, for a volume), which are swept independently. Inside a block, only vertices
+ * with a neighbour in another block (cut vertices) and the nodes where they join can affect
+ * the rest of the tree, so each block keeps just that boundary tree. Boundary trees are then
+ * merged pairwise in a reduction tree, joining them across the cut edges between each pair.
+ * Finally each block is swept again together with the merged boundary tree, which places
+ * every node either in a part of the tree that only its block can reach or on one of the
+ * boundary tree arcs, and the arcs from all blocks are merged by sorting.
+ *
+ * The parents found this way are written out by ct_merge_tree_set_arcs (see there for the
+ * arc layout). */
+
+int ct_merge_tree_construct_blocks(ct_tree_t *merge_tree, ct_mesh_t *mesh,
+	uint32_t start_index, uint32_t num_blocks, char error[NM_MAX_ERROR_LENGTH])
+{
+	// 0 blocks picks one per thread, as long as each block has enough nodes to be worthwhile:
+	if (!num_blocks)
+	{
+		num_blocks = omp_get_max_threads();
+		if (num_blocks < CT_BLOCK_TREE_MIN_THREADS) { num_blocks = 1; }
+		if (num_blocks > (merge_tree->num_nodes / CT_PARALLEL_THRESHOLD))
+		{
+			num_blocks = merge_tree->num_nodes / CT_PARALLEL_THRESHOLD;
+		}
+	}
+	if ((num_blocks < 2) || (merge_tree->num_nodes < 2) || !merge_tree->nodes)
+	{
+		return ct_merge_tree_construct(merge_tree, mesh, start_index, error);
+	}
+
+	ct_block_tree_t blocks = {0};
+	if (ct_block_tree_init(&blocks, merge_tree, mesh, (start_index != 0), num_blocks, error))
+	{
+		ct_block_tree_free(&blocks);
+		return -1;
+	}
+
+	// Boundary tree of each block:
+	int failed = 0;
+	#pragma omp parallel for schedule(dynamic, 1) shared(failed)
+	for (uint32_t i = 0; i < blocks.num_blocks; i++)
+	{
+		char block_error[NM_MAX_ERROR_LENGTH];
+		if (!failed && ct_block_tree_sweep_block(&blocks, i, block_error))
+		{
+			#pragma omp critical
+			{
+				failed = 1;
+				strcpy(error, block_error);
+			}
+		}
+	}
+	if (failed)
+	{
+		ct_block_tree_free(&blocks);
+		return -1;
+	}
+
+	blocks.num_boundary_nodes = ct_parallel_prefix_sum(blocks.boundary_start,
+							blocks.num_blocks + 1);
+	blocks.boundary_nodes = malloc((blocks.num_boundary_nodes + 1) * sizeof(uint32_t));
+	blocks.boundary_scratch = malloc((blocks.num_boundary_nodes + 1) * sizeof(uint32_t));
+	blocks.first_child = malloc((blocks.num_boundary_nodes + 1) * sizeof(uint32_t));
+	blocks.next_sibling = malloc((blocks.num_boundary_nodes + 1) * sizeof(uint32_t));
+	if (!blocks.boundary_nodes || !blocks.boundary_scratch || !blocks.first_child ||
+							!blocks.next_sibling)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for block boundary trees.");
+		ct_block_tree_free(&blocks);
+		return -1;
+	}
+
+	// Boundary nodes of each block, in sweep order:
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (uint32_t i = 0; i < blocks.num_blocks; i++)
+	{
+		uint32_t begin = blocks.block_start[i];
+		uint32_t num_nodes = blocks.block_start[i + 1] - begin;
+		uint32_t index = blocks.boundary_start[i];
+		for (uint32_t step = 0; step < num_nodes; step++)
+		{
+			uint32_t node = blocks.block_nodes[begin + (blocks.direction ?
+						(num_nodes - step - 1) : step)];
+			if (!(blocks.flags[node] & CT_BLOCK_TREE_BOUNDARY)) { continue; }
+			blocks.boundary_nodes[index] = node;
+			blocks.position[node] = index;
+			index++;
+		}
+	}
+
+	// Merge boundary trees in pairs, each level reading from one array and writing the other:
+	uint32_t *from = blocks.boundary_nodes;
+	uint32_t *to = blocks.boundary_scratch;
+	for (uint32_t width = 1; width < blocks.num_blocks; width *= 2)
+	{
+		#pragma omp parallel for schedule(dynamic, 1) shared(failed)
+		for (uint32_t i = 0; i < blocks.num_blocks; i += 2 * width)
+		{
+			uint32_t middle = i + width;
+			uint32_t end = i + (2 * width);
+			if (middle > blocks.num_blocks) { middle = blocks.num_blocks; }
+			if (end > blocks.num_blocks) { end = blocks.num_blocks; }
+
+			char block_error[NM_MAX_ERROR_LENGTH];
+			if (!failed && ct_block_tree_merge_boundaries(&blocks, from, to, i, middle,
+									end, block_error))
+			{
+				#pragma omp critical
+				{
+					failed = 1;
+					strcpy(error, block_error);
+				}
+			}
+		}
+		if (failed)
+		{
+			ct_block_tree_free(&blocks);
+			return -1;
+		}
+
+		uint32_t *swap = from;
+		from = to;
+		to = swap;
+	}
+	blocks.boundary_nodes = from;
+	blocks.boundary_scratch = to;
+
+	// Children in the merged boundary tree:
+	for (uint32_t i = 0; i < blocks.num_boundary_nodes; i++)
+	{
+		blocks.first_child[i] = CT_BLOCK_TREE_NONE;
+	}
+	for (uint32_t i = 0; i < blocks.num_boundary_nodes; i++)
+	{
+		uint32_t parent = blocks.parent[blocks.boundary_nodes[i]];
+		if (parent == CT_BLOCK_TREE_NONE) { continue; }
+		blocks.next_sibling[i] = blocks.first_child[blocks.position[parent]];
+		blocks.first_child[blocks.position[parent]] = i;
+	}
+
+	// Place the rest of each block against the boundary tree:
+	#pragma omp parallel for schedule(dynamic, 1) shared(failed)
+	for (uint32_t i = 0; i < blocks.num_blocks; i++)
+	{
+		char block_error[NM_MAX_ERROR_LENGTH];
+		if (!failed && ct_block_tree_place_block(&blocks, i, block_error))
+		{
+			#pragma omp critical
+			{
+				failed = 1;
+				strcpy(error, block_error);
+			}
+		}
+	}
+	// Position is finished with, so it is the scratch for writing arcs:
+	if (failed || ct_block_tree_get_parents(&blocks, error) || ct_merge_tree_set_arcs(
+		merge_tree, blocks.parent, blocks.direction, blocks.position, error))
+	{
+		ct_block_tree_free(&blocks);
+		return -1;
+	}
+
+	ct_block_tree_free(&blocks);
+	return 0;
+}
+
+int ct_block_tree_init(ct_block_tree_t *blocks, ct_tree_t *merge_tree, ct_mesh_t *mesh,
+	uint8_t direction, uint32_t num_blocks, char error[NM_MAX_ERROR_LENGTH])
+{
+	memset(blocks, 0, sizeof(*blocks));
+	blocks->merge_tree = merge_tree;
+	blocks->mesh = mesh;
+	blocks->direction = direction;
+
+	uint32_t num_nodes = merge_tree->num_nodes;
+	blocks->grid = (!mesh->edges && mesh->volume.scalars);
+	if (blocks->grid && (num_nodes != ct_volume_get_num_voxels(&(mesh->volume))))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Merge tree nodes do not match the volume of mesh \"%s\".", mesh->name);
+		return -1;
+	}
+	if (!blocks->grid && (!mesh->edges || (num_nodes != mesh->num_vertices)))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Merge tree nodes do not match the vertices of mesh \"%s\".", mesh->name);
+		return -1;
+	}
+
+	// Blocks are equal ranges of vertices, with none left empty:
+	if (num_blocks > num_nodes) { num_blocks = num_nodes; }
+	blocks->block_size = ((uint64_t)num_nodes + num_blocks - 1) / num_blocks;
+	blocks->num_blocks = ((uint64_t)num_nodes + blocks->block_size - 1) / blocks->block_size;
+	num_blocks = blocks->num_blocks;
+
+	blocks->block_start = malloc((num_blocks + 1) * sizeof(uint32_t));
+	blocks->block_nodes = malloc(num_nodes * sizeof(uint32_t));
+	blocks->boundary_start = malloc((num_blocks + 1) * sizeof(uint32_t));
+	blocks->flags = malloc(num_nodes * sizeof(uint8_t));
+	blocks->position = malloc(num_nodes * sizeof(uint32_t));
+	blocks->parent = malloc(num_nodes * sizeof(uint32_t));
+	blocks->top = malloc(num_nodes * sizeof(uint32_t));
+	blocks->interior_parent = malloc(num_nodes * sizeof(uint32_t));
+	uint32_t *counts = malloc((size_t)num_blocks * num_blocks * sizeof(uint32_t));
+	if (!blocks->block_start || !blocks->block_nodes || !blocks->boundary_start ||
+		!blocks->flags || !blocks->position || !blocks->parent || !blocks->top ||
+		!blocks->interior_parent || !counts)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for block tree.");
+		free(counts);
+		return -1;
+	}
+
+	for (uint32_t i = 0; i <= num_blocks; i++)
+	{
+		uint64_t start = (uint64_t)i * blocks->block_size;
+		blocks->block_start[i] = (start > num_nodes) ? num_nodes : start;
+		blocks->boundary_start[i] = 0;
+	}
+
+	// Nodes are sorted, so splitting them into chunks and counting per block keeps them sorted:
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_blocks; i++)
+	{
+		uint32_t *chunk_counts = &(counts[(size_t)i * num_blocks]);
+		memset(chunk_counts, 0, num_blocks * sizeof(uint32_t));
+		uint32_t begin = ((uint64_t)num_nodes * i) / num_blocks;
+		uint32_t end = ((uint64_t)num_nodes * (i + 1)) / num_blocks;
+		for (uint32_t j = begin; j < end; j++)
+		{
+			chunk_counts[ct_block_tree_get_block(blocks, j)]++;
+		}
+	}
+
+	for (uint32_t i = 0; i < num_blocks; i++)
+	{
+		uint32_t offset = blocks->block_start[i];
+		for (uint32_t j = 0; j < num_blocks; j++)
+		{
+			uint32_t count = counts[((size_t)j * num_blocks) + i];
+			counts[((size_t)j * num_blocks) + i] = offset;
+			offset += count;
+		}
+	}
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_blocks; i++)
+	{
+		uint32_t *chunk_offsets = &(counts[(size_t)i * num_blocks]);
+		uint32_t begin = ((uint64_t)num_nodes * i) / num_blocks;
+		uint32_t end = ((uint64_t)num_nodes * (i + 1)) / num_blocks;
+		for (uint32_t j = begin; j < end; j++)
+		{
+			uint32_t block = ct_block_tree_get_block(blocks, j);
+			blocks->block_nodes[chunk_offsets[block]] = j;
+			blocks->position[j] = chunk_offsets[block] - blocks->block_start[block];
+			chunk_offsets[block]++;
+		}
+	}
+	free(counts);
+
+	// Room for every neighbour of any vertex:
+	if (blocks->grid) { blocks->max_neighbours = CT_GRID_MAX_NEIGHBOURS; }
+	else
+	{
+		uint32_t max_neighbours = 0;
+		#pragma omp parallel for reduction(max: max_neighbours) \
+			if (num_nodes > CT_PARALLEL_THRESHOLD)
+		for (uint32_t i = 0; i < num_nodes; i++)
+		{
+			uint32_t num_neighbours = ct_mesh_get_vertex_neighbours(mesh, i, NULL, 0);
+			if (num_neighbours > max_neighbours) { max_neighbours = num_neighbours; }
+		}
+		blocks->max_neighbours = max_neighbours;
+	}
+
+	return 0;
+}
+
+void ct_block_tree_free(ct_block_tree_t *blocks)
+{
+	free(blocks->block_start);
+	free(blocks->block_nodes);
+	free(blocks->boundary_start);
+	free(blocks->boundary_nodes);
+	free(blocks->boundary_scratch);
+	free(blocks->first_child);
+	free(blocks->next_sibling);
+	free(blocks->flags);
+	free(blocks->position);
+	free(blocks->parent);
+	free(blocks->top);
+	free(blocks->interior_parent);
+	free(blocks->arc_start);
+	free(blocks->arc_nodes);
+	memset(blocks, 0, sizeof(*blocks));
+}
+
+/**********
+ * Stages *
+ **********/
+
+int ct_block_tree_sweep_block(ct_block_tree_t *blocks, uint32_t block,
+					char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Sweeps one block on its own edges. A node is kept in the boundary tree if it is a cut
+	 * vertex or joins two components that each have a kept node, and its parent is then
+	 * set on the last kept node of each component it joins. The number of kept nodes is
+	 * left in boundary_start. */
+	uint32_t *nodes = &(blocks->block_nodes[blocks->block_start[block]]);
+	uint32_t num_nodes = blocks->block_start[block + 1] - blocks->block_start[block];
+
+	ct_disjoint_set_t disjoint_set = {0};
+	disjoint_set.num_elements = num_nodes;
+	if (ct_disjoint_set_allocate(&disjoint_set, error))
+	{
+		ct_disjoint_set_free(&disjoint_set);
+		return -1;
+	}
+
+	uint32_t *last_kept = malloc(num_nodes * sizeof(uint32_t)); // Per component.
+	uint32_t *neighbours = malloc((blocks->max_neighbours + 1) * sizeof(uint32_t));
+	uint32_t *neighbour_blocks = malloc((blocks->max_neighbours + 1) * sizeof(uint32_t));
+	uint32_t *joined = malloc((blocks->max_neighbours + 1) * sizeof(uint32_t));
+	if (!last_kept || !neighbours || !neighbour_blocks || !joined)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for block sweep.");
+		ct_disjoint_set_free(&disjoint_set);
+		free(last_kept);
+		free(neighbours);
+		free(neighbour_blocks);
+		free(joined);
+		return -1;
+	}
+	for (uint32_t i = 0; i < num_nodes; i++) { last_kept[i] = CT_BLOCK_TREE_NONE; }
+
+	uint32_t num_kept = 0;
+	for (uint32_t step = 0; step < num_nodes; step++)
+	{
+		uint32_t i = blocks->direction ? (num_nodes - step - 1) : step;
+		uint32_t node = nodes[i];
+		blocks->flags[node] = 0;
+		blocks->parent[node] = CT_BLOCK_TREE_NONE;
+
+		uint32_t component = i; // Not yet joined to anything.
+		uint32_t num_joined = 0;
+		uint32_t num_neighbours = ct_block_tree_get_neighbours(blocks, node, neighbours,
+								neighbour_blocks);
+		for (uint32_t j = 0; j < num_neighbours; j++)
+		{
+			uint32_t adjacent_node = neighbours[j];
+			if (neighbour_blocks[j] != block)
+			{
+				blocks->flags[node] |= CT_BLOCK_TREE_CUT;
+				continue;
+			}
+
+			uint32_t adjacent = blocks->position[adjacent_node];
+			if (blocks->direction ? (adjacent < i) : (adjacent > i)) { continue; }
+
+			uint32_t adjacent_component = ct_disjoint_set_find(adjacent, &disjoint_set);
+			if (component == adjacent_component) { continue; }
+
+			if (last_kept[adjacent_component] != CT_BLOCK_TREE_NONE)
+			{
+				joined[num_joined] = last_kept[adjacent_component];
+				num_joined++;
+			}
+			component = ct_disjoint_set_link(component, adjacent_component, &disjoint_set);
+			last_kept[component] = CT_BLOCK_TREE_NONE;
+		}
+
+		if ((blocks->flags[node] & CT_BLOCK_TREE_CUT) || (num_joined > 1))
+		{
+			blocks->flags[node] |= CT_BLOCK_TREE_BOUNDARY;
+			for (uint32_t j = 0; j < num_joined; j++) { blocks->parent[joined[j]] = node; }
+			last_kept[component] = node;
+			num_kept++;
+		}
+		else if (num_joined) { last_kept[component] = joined[0]; }
+	}
+	blocks->boundary_start[block] = num_kept;
+
+	ct_disjoint_set_free(&disjoint_set);
+	free(last_kept);
+	free(neighbours);
+	free(neighbour_blocks);
+	free(joined);
+	return 0;
+}
+
+int ct_block_tree_merge_boundaries(ct_block_tree_t *blocks, uint32_t *from, uint32_t *to,
+	uint32_t first_block, uint32_t middle_block, uint32_t end_block,
+	char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Joins the boundary trees of blocks [first, middle) and [middle, end) into one, by
+	 * sweeping their nodes with the arcs of both trees plus the cut edges between them.
+	 * Every node where two boundary nodes meet is already a boundary node in its own block,
+	 * so no nodes are added. */
+	uint32_t begin = blocks->boundary_start[first_block];
+	uint32_t middle = blocks->boundary_start[middle_block];
+	uint32_t end = blocks->boundary_start[end_block];
+	if (middle == end)
+	{
+		memcpy(&(to[begin]), &(from[begin]), (end - begin) * sizeof(uint32_t));
+		return 0;
+	}
+
+	// Both lists are in sweep order already:
+	uint32_t left = begin;
+	uint32_t right = middle;
+	for (uint32_t i = begin; i < end; i++)
+	{
+		if ((right == end) || ((left < middle) &&
+			ct_block_tree_is_before(blocks, from[left], from[right])))
+		{
+			to[i] = from[left];
+			left++;
+		}
+		else
+		{
+			to[i] = from[right];
+			right++;
+		}
+		blocks->position[to[i]] = i;
+		blocks->first_child[i] = CT_BLOCK_TREE_NONE;
+	}
+
+	for (uint32_t i = begin; i < end; i++)
+	{
+		uint32_t parent = blocks->parent[to[i]];
+		if (parent == CT_BLOCK_TREE_NONE) { continue; }
+		blocks->next_sibling[i] = blocks->first_child[blocks->position[parent]];
+		blocks->first_child[blocks->position[parent]] = i;
+	}
+	for (uint32_t i = begin; i < end; i++) { blocks->parent[to[i]] = CT_BLOCK_TREE_NONE; }
+
+	ct_disjoint_set_t disjoint_set = {0};
+	disjoint_set.num_elements = end - begin;
+	uint32_t *neighbours = malloc((blocks->max_neighbours + 1) * sizeof(uint32_t));
+	uint32_t *neighbour_blocks = malloc((blocks->max_neighbours + 1) * sizeof(uint32_t));
+	if (!neighbours || !neighbour_blocks || ct_disjoint_set_allocate(&disjoint_set, error))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for boundary merge.");
+		ct_disjoint_set_free(&disjoint_set);
+		free(neighbours);
+		free(neighbour_blocks);
+		return -1;
+	}
+
+	for (uint32_t i = begin; i < end; i++)
+	{
+		// Arcs of the trees being merged, then cut edges into the other half:
+		uint32_t node = to[i];
+		uint32_t child = blocks->first_child[i];
+		uint32_t num_neighbours = 0;
+		uint32_t neighbour = 0;
+		if (blocks->flags[node] & CT_BLOCK_TREE_CUT)
+		{
+			num_neighbours = ct_block_tree_get_neighbours(blocks, node, neighbours,
+								neighbour_blocks);
+		}
+		uint8_t left_half = (ct_block_tree_get_block(blocks, node) < middle_block);
+		uint32_t component = i - begin; // Not yet joined to anything.
+
+		while (1)
+		{
+			uint32_t adjacent;
+			if (child != CT_BLOCK_TREE_NONE)
+			{
+				adjacent = child;
+				child = blocks->next_sibling[child];
+			}
+			else if (neighbour < num_neighbours)
+			{
+				uint32_t adjacent_node = neighbours[neighbour];
+				uint32_t adjacent_block = neighbour_blocks[neighbour];
+				neighbour++;
+				if ((adjacent_block < first_block) || (adjacent_block >= end_block) ||
+					((adjacent_block < middle_block) == left_half) ||
+					(blocks->position[adjacent_node] >= i))
+				{
+					continue;
+				}
+				adjacent = blocks->position[adjacent_node];
+			}
+			else { break; }
+
+			uint32_t adjacent_component = ct_disjoint_set_find(adjacent - begin,
+									&disjoint_set);
+			if (component == adjacent_component) { continue; }
+
+			blocks->parent[to[disjoint_set.extremum[adjacent_component] + begin]] = node;
+			component = ct_disjoint_set_link(component, adjacent_component, &disjoint_set);
+			disjoint_set.extremum[component] = i - begin;
+		}
+	}
+
+	ct_disjoint_set_free(&disjoint_set);
+	free(neighbours);
+	free(neighbour_blocks);
+	return 0;
+}
+
+int ct_block_tree_place_block(ct_block_tree_t *blocks, uint32_t block,
+					char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Sweeps the block's nodes together with the whole boundary tree, on the block's own
+	 * edges and the boundary tree arcs. That gives each node outside the boundary tree the
+	 * next node below it (in sweep order) among the block and boundary nodes, and the last
+	 * boundary node swept in its component. Nodes in the block come first in the disjoint
+	 * set, then the boundary nodes. */
+	uint32_t *nodes = &(blocks->block_nodes[blocks->block_start[block]]);
+	uint32_t num_nodes = blocks->block_start[block + 1] - blocks->block_start[block];
+	uint32_t num_boundary_nodes = blocks->num_boundary_nodes;
+
+	ct_disjoint_set_t disjoint_set = {0};
+	disjoint_set.num_elements = num_nodes + num_boundary_nodes;
+	if (ct_disjoint_set_allocate(&disjoint_set, error))
+	{
+		ct_disjoint_set_free(&disjoint_set);
+		return -1;
+	}
+
+	uint32_t *last_kept = malloc(disjoint_set.num_elements * sizeof(uint32_t));
+	uint32_t *neighbours = malloc((blocks->max_neighbours + 1) * sizeof(uint32_t));
+	uint32_t *neighbour_blocks = malloc((blocks->max_neighbours + 1) * sizeof(uint32_t));
+	if (!last_kept || !neighbours || !neighbour_blocks)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for block placement.");
+		ct_disjoint_set_free(&disjoint_set);
+		free(last_kept);
+		free(neighbours);
+		free(neighbour_blocks);
+		return -1;
+	}
+	for (uint32_t i = 0; i < disjoint_set.num_elements; i++)
+	{
+		last_kept[i] = CT_BLOCK_TREE_NONE;
+	}
+
+	uint32_t step = 0;
+	uint32_t boundary = 0;
+	while (1)
+	{
+		// Next block node not in the boundary tree:
+		uint32_t node = CT_BLOCK_TREE_NONE;
+		while (step < num_nodes)
+		{
+			node = nodes[blocks->direction ? (num_nodes - step - 1) : step];
+			if (!(blocks->flags[node] & CT_BLOCK_TREE_BOUNDARY)) { break; }
+			node = CT_BLOCK_TREE_NONE;
+			step++;
+		}
+
+		uint32_t current;
+		if ((node != CT_BLOCK_TREE_NONE) && ((boundary == num_boundary_nodes) ||
+			ct_block_tree_is_before(blocks, node, blocks->boundary_nodes[boundary])))
+		{
+			current = blocks->position[node];
+			blocks->interior_parent[node] = CT_BLOCK_TREE_NONE;
+			step++;
+		}
+		else if (boundary < num_boundary_nodes)
+		{
+			node = blocks->boundary_nodes[boundary];
+			current = num_nodes + boundary;
+			boundary++;
+		}
+		else { break; }
+
+		uint8_t kept = (blocks->flags[node] & CT_BLOCK_TREE_BOUNDARY);
+		uint32_t component = current; // Not yet joined to anything.
+		uint32_t child = kept ? blocks->first_child[current - num_nodes] : CT_BLOCK_TREE_NONE;
+		uint32_t num_neighbours = 0;
+		uint32_t neighbour = 0;
+		if (!kept || (ct_block_tree_get_block(blocks, node) == block))
+		{
+			num_neighbours = ct_block_tree_get_neighbours(blocks, node, neighbours,
+								neighbour_blocks);
+		}
+
+		while (1)
+		{
+			uint32_t adjacent;
+			if (child != CT_BLOCK_TREE_NONE)
+			{
+				adjacent = num_nodes + child;
+				child = blocks->next_sibling[child];
+			}
+			else if (neighbour < num_neighbours)
+			{
+				uint32_t adjacent_node = neighbours[neighbour];
+				uint32_t adjacent_block = neighbour_blocks[neighbour];
+				neighbour++;
+				if ((adjacent_block != block) ||
+					!ct_block_tree_is_before(blocks, adjacent_node, node))
+				{
+					continue;
+				}
+				adjacent = blocks->position[adjacent_node];
+				if (blocks->flags[adjacent_node] & CT_BLOCK_TREE_BOUNDARY)
+				{
+					adjacent += num_nodes;
+				}
+			}
+			else { break; }
+
+			uint32_t adjacent_component = ct_disjoint_set_find(adjacent, &disjoint_set);
+			if (component == adjacent_component) { continue; }
+
+			// Boundary nodes already have parents from the boundary tree:
+			uint32_t extremum = disjoint_set.extremum[adjacent_component];
+			if (extremum < num_nodes) { blocks->interior_parent[nodes[extremum]] = node; }
+
+			uint32_t last = last_kept[component];
+			if ((last == CT_BLOCK_TREE_NONE) || ((last_kept[adjacent_component] !=
+				CT_BLOCK_TREE_NONE) && ct_block_tree_is_before(blocks, last,
+				last_kept[adjacent_component])))
+			{
+				last = last_kept[adjacent_component];
+			}
+
+			component = ct_disjoint_set_link(component, adjacent_component, &disjoint_set);
+			disjoint_set.extremum[component] = current;
+			last_kept[component] = last;
+		}
+
+		if (kept) { last_kept[component] = node; }
+		else { blocks->top[node] = last_kept[component]; }
+	}
+
+	ct_disjoint_set_free(&disjoint_set);
+	free(last_kept);
+	free(neighbours);
+	free(neighbour_blocks);
+	return 0;
+}
+
+int ct_block_tree_get_parents(ct_block_tree_t *blocks, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* A node whose component contains a boundary node lies on the boundary tree arc below
+	 * the last one swept (its top). Those nodes are gathered per arc and sorted, which gives
+	 * the full chain of each arc. Any other node's parent is its interior parent. */
+	uint32_t num_nodes = blocks->merge_tree->num_nodes;
+	uint32_t num_boundary_nodes = blocks->num_boundary_nodes;
+	blocks->arc_start = malloc((num_boundary_nodes + 1) * sizeof(uint32_t));
+	if (!blocks->arc_start)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for boundary arcs.");
+		return -1;
+	}
+	memset(blocks->arc_start, 0, (num_boundary_nodes + 1) * sizeof(uint32_t));
+
+	#pragma omp parallel for if (num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < num_nodes; i++)
+	{
+		if ((blocks->flags[i] & CT_BLOCK_TREE_BOUNDARY) ||
+			(blocks->top[i] == CT_BLOCK_TREE_NONE))
+		{
+			continue;
+		}
+		#pragma omp atomic
+		blocks->arc_start[blocks->position[blocks->top[i]]]++;
+	}
+
+	uint32_t num_arc_nodes = ct_parallel_prefix_sum(blocks->arc_start,
+							num_boundary_nodes + 1);
+	blocks->arc_nodes = malloc((num_arc_nodes + 1) * sizeof(uint32_t));
+	if (!blocks->arc_nodes)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for boundary arcs.");
+		return -1;
+	}
+
+	// Child lists are finished with, so first_child counts the nodes placed on each arc:
+	memset(blocks->first_child, 0, num_boundary_nodes * sizeof(uint32_t));
+	#pragma omp parallel for if (num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < num_nodes; i++)
+	{
+		if ((blocks->flags[i] & CT_BLOCK_TREE_BOUNDARY) ||
+			(blocks->top[i] == CT_BLOCK_TREE_NONE))
+		{
+			continue;
+		}
+
+		uint32_t arc = blocks->position[blocks->top[i]];
+		uint32_t index;
+		#pragma omp atomic capture
+		index = blocks->first_child[arc]++;
+		blocks->arc_nodes[blocks->arc_start[arc] + index] = i;
+	}
+
+	#pragma omp parallel for schedule(dynamic, 64)
+	for (uint32_t i = 0; i < num_boundary_nodes; i++)
+	{
+		qsort(&(blocks->arc_nodes[blocks->arc_start[i]]), blocks->arc_start[i + 1] -
+			blocks->arc_start[i], sizeof(uint32_t), ct_block_tree_qsort_compare);
+	}
+
+	// Parents of nodes off the boundary tree, which reads the boundary tree parents:
+	#pragma omp parallel for if (num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < num_nodes; i++)
+	{
+		if (blocks->flags[i] & CT_BLOCK_TREE_BOUNDARY) { continue; }
+
+		uint32_t top = blocks->top[i];
+		if (top != CT_BLOCK_TREE_NONE)
+		{
+			// Next node down the arc, or the end of the arc:
+			uint32_t arc = blocks->position[top];
+			uint32_t index = ct_block_tree_find_arc_node(blocks, arc, i);
+			if (blocks->direction)
+			{
+				blocks->parent[i] = (index > blocks->arc_start[arc]) ?
+					blocks->arc_nodes[index - 1] : blocks->parent[top];
+			}
+			else
+			{
+				blocks->parent[i] = ((index + 1) < blocks->arc_start[arc + 1]) ?
+					blocks->arc_nodes[index + 1] : blocks->parent[top];
+			}
+			continue;
+		}
+
+		/* Otherwise nothing in the node's component reaches another block, so no node of
+		 * another block can come between it and its interior parent: */
+		blocks->parent[i] = blocks->interior_parent[i];
+	}
+
+	// Then the boundary nodes, whose parent is the first node on the arc below:
+	#pragma omp parallel for if (num_boundary_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < num_boundary_nodes; i++)
+	{
+		if (blocks->arc_start[i] == blocks->arc_start[i + 1]) { continue; }
+		blocks->parent[blocks->boundary_nodes[i]] = blocks->arc_nodes[blocks->direction ?
+				(blocks->arc_start[i + 1] - 1) : blocks->arc_start[i]];
+	}
+
+	return 0;
+}
+
+/***********
+ * Helpers *
+ ***********/
+
+uint32_t ct_block_tree_get_block(ct_block_tree_t *blocks, uint32_t node)
+{
+	return blocks->merge_tree->nodes[node].node_to_vertex / blocks->block_size;
+}
+
+uint32_t ct_block_tree_get_neighbours(ct_block_tree_t *blocks, uint32_t node,
+				uint32_t *neighbours, uint32_t *neighbour_blocks)
+{
+	/* Neighbouring nodes, from the grid or the mesh edges, and their blocks (taken from the
+	 * vertices here to save looking each node up again): */
+	uint32_t vertex = blocks->merge_tree->nodes[node].node_to_vertex;
+	uint32_t num_neighbours;
+	if (blocks->grid)
+	{
+		num_neighbours = ct_volume_get_neighbours(&(blocks->mesh->volume), vertex,
+									neighbours);
+	}
+	else
+	{
+		num_neighbours = ct_mesh_get_vertex_neighbours(blocks->mesh, vertex, neighbours,
+								blocks->max_neighbours);
+	}
+
+	for (uint32_t i = 0; i < num_neighbours; i++)
+	{
+		neighbour_blocks[i] = neighbours[i] / blocks->block_size;
+		neighbours[i] = blocks->merge_tree->nodes[neighbours[i]].vertex_to_node;
+	}
+	return num_neighbours;
+}
+
+int ct_block_tree_is_before(ct_block_tree_t *blocks, uint32_t node, uint32_t other_node)
+{
+	// Whether node is swept before other_node:
+	return blocks->direction ? (node > other_node) : (node < other_node);
+}
+
+uint32_t ct_block_tree_find_arc_node(ct_block_tree_t *blocks, uint32_t arc, uint32_t node)
+{
+	// Index of the first node on the arc that is not lower than the given node:
+	uint32_t low = blocks->arc_start[arc];
+	uint32_t high = blocks->arc_start[arc + 1];
+	while (low < high)
+	{
+		uint32_t middle = low + ((high - low) / 2);
+		if (blocks->arc_nodes[middle] < node) { low = middle + 1; }
+		else { high = middle; }
+	}
+	return low;
+}
+
+int ct_block_tree_qsort_compare(const void *a, const void *b)
+{
+	uint32_t left = *(uint32_t *)a;
+	uint32_t right = *(uint32_t *)b;
+	return (left > right) - (left < right);
+}
+
+#ifdef CT_DEBUG
+int ct_block_tree_benchmark(FILE *file, ct_tree_t *tree, ct_mesh_t *mesh,
+					char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Times the blocks against the sweep on fresh copies of the sorted nodes, and compares.
+	 * There are always enough blocks to decompose, so the blocks are checked even where
+	 * there are too few threads (or nodes) for the engine to choose them by itself: */
+	char *directions[2] = { "split", "join" };
+	uint32_t num_blocks = omp_get_max_threads();
+	if (num_blocks < CT_BLOCK_TREE_MIN_THREADS) { num_blocks = CT_BLOCK_TREE_MIN_THREADS; }
+	for (int direction = 0; direction < 2; direction++)
+	{
+		ct_tree_t sweep_tree = {0};
+		ct_tree_t block_tree = {0};
+		uint32_t start_index = direction ? (tree->num_nodes - 1) : 0;
+		if (ct_tree_copy_nodes(tree, &sweep_tree, error) ||
+			ct_tree_copy_nodes(tree, &block_tree, error))
+		{
+			ct_tree_free(&sweep_tree);
+			ct_tree_free(&block_tree);
+			return -1;
+		}
+
+		double sweep_time = omp_get_wtime();
+		if (ct_merge_tree_construct(&sweep_tree, mesh, start_index, error))
+		{
+			ct_tree_free(&sweep_tree);
+			ct_tree_free(&block_tree);
+			return -1;
+		}
+		sweep_time = omp_get_wtime() - sweep_time;
+
+		double block_time = omp_get_wtime();
+		if (ct_merge_tree_construct_blocks(&block_tree, mesh, start_index, num_blocks, error))
+		{
+			ct_tree_free(&sweep_tree);
+			ct_tree_free(&block_tree);
+			return -1;
+		}
+		block_time = omp_get_wtime() - block_time;
+
+		int differ = ct_merge_tree_compare(&sweep_tree, &block_tree, direction, error);
+
+		fprintf(file, "%s blocks: %.3f ms, %u blocks on %d threads (sweep %.3f ms), %s.\n",
+			directions[direction], block_time * 1000.0, num_blocks,
+			omp_get_max_threads(), sweep_time * 1000.0,
+			differ ? "trees differ" : "trees match");
+
+		ct_tree_free(&sweep_tree);
+		ct_tree_free(&block_tree);
+		if (differ) { return -1; }
+	}
+
+	return 0;
+}
+#endif
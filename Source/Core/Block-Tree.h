@@ -0,0 +1,91 @@
+#ifndef CT_BLOCK_TREE_H
+#define CT_BLOCK_TREE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <omp.h>
+
+#include <NM-Config/Config.h>
+
+#include "Contour-Tree.h"
+#include "Mesh.h"
+#include "Parallel.h"
+
+#define CT_BLOCK_TREE_NONE	UINT32_MAX
+
+// Each block is swept twice, so fewer threads than this are slower than one sweep:
+#define CT_BLOCK_TREE_MIN_THREADS	4
+
+// Node flags:
+#define CT_BLOCK_TREE_CUT	1	// Vertex has a neighbour in another block.
+#define CT_BLOCK_TREE_BOUNDARY	2	// Node is kept in the boundary tree.
+
+typedef struct
+{
+	ct_tree_t *merge_tree;
+	ct_mesh_t *mesh;
+	uint8_t direction;		// 1 to sweep high to low (join tree), 0 for low to high.
+	uint8_t grid;
+	uint32_t max_neighbours;
+
+	// Blocks are ranges of vertex indices:
+	uint32_t num_blocks;
+	uint32_t block_size;
+	uint32_t *block_start;		// Num blocks + 1, into block_nodes.
+	uint32_t *block_nodes;		// Nodes of each block, in ascending order.
+
+	/* Cut vertices and the nodes where they join, per block at first and then merged into
+	 * one tree, in sweep order: */
+	uint32_t num_boundary_nodes;
+	uint32_t *boundary_start;	// Num blocks + 1, into boundary_nodes.
+	uint32_t *boundary_nodes;
+	uint32_t *boundary_scratch;
+	uint32_t *first_child;		// Per boundary node, as boundary_nodes indices.
+	uint32_t *next_sibling;
+
+	// Per node:
+	uint8_t *flags;			// CT_BLOCK_TREE_<X>.
+	uint32_t *position;		// In block_nodes for a block, or in boundary_nodes.
+	uint32_t *parent;		// Next node along the sweep in the same component.
+	uint32_t *top;			// Last boundary node swept in the node's component.
+	uint32_t *interior_parent;	// Next node in the block or the boundary tree.
+
+	// Nodes that fall on each boundary tree arc, in ascending order:
+	uint32_t *arc_start;		// Num boundary nodes + 1, into arc_nodes.
+	uint32_t *arc_nodes;
+} ct_block_tree_t;
+
+// Construction:
+int ct_merge_tree_construct_blocks(ct_tree_t *merge_tree, ct_mesh_t *mesh,
+	uint32_t start_index, uint32_t num_blocks, char error[NM_MAX_ERROR_LENGTH]);
+int ct_block_tree_init(ct_block_tree_t *blocks, ct_tree_t *merge_tree, ct_mesh_t *mesh,
+	uint8_t direction, uint32_t num_blocks, char error[NM_MAX_ERROR_LENGTH]);
+void ct_block_tree_free(ct_block_tree_t *blocks);
+
+// Stages:
+int ct_block_tree_sweep_block(ct_block_tree_t *blocks, uint32_t block,
+					char error[NM_MAX_ERROR_LENGTH]);
+int ct_block_tree_merge_boundaries(ct_block_tree_t *blocks, uint32_t *from, uint32_t *to,
+	uint32_t first_block, uint32_t middle_block, uint32_t end_block,
+	char error[NM_MAX_ERROR_LENGTH]);
+int ct_block_tree_place_block(ct_block_tree_t *blocks, uint32_t block,
+					char error[NM_MAX_ERROR_LENGTH]);
+int ct_block_tree_get_parents(ct_block_tree_t *blocks, char error[NM_MAX_ERROR_LENGTH]);
+
+// Helpers:
+uint32_t ct_block_tree_get_block(ct_block_tree_t *blocks, uint32_t node);
+uint32_t ct_block_tree_get_neighbours(ct_block_tree_t *blocks, uint32_t node,
+				uint32_t *neighbours, uint32_t *neighbour_blocks);
+int ct_block_tree_is_before(ct_block_tree_t *blocks, uint32_t node, uint32_t other_node);
+uint32_t ct_block_tree_find_arc_node(ct_block_tree_t *blocks, uint32_t arc, uint32_t node);
+int ct_block_tree_qsort_compare(const void *a, const void *b);
+
+#ifdef CT_DEBUG
+int ct_block_tree_benchmark(FILE *file, ct_tree_t *tree, ct_mesh_t *mesh,
+					char error[NM_MAX_ERROR_LENGTH]);
+#endif
+
+#endif
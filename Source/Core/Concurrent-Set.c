@@ -0,0 +1,354 @@
+#include "Concurrent-Set.h"
+
+/*******************
+ * Concurrent sets *
+ *******************/
+
+/* Union-find for parallel kernels. Finds use path halving, where each step tries to point the
+ * element at its grandparent with a compare and swap and simply moves on if another thread got
+ * there first, so a find never waits on anyone. Unions link the root with the lower priority
+ * under the other, again by compare and swap, and retry from the new roots if either has been
+ * linked in the meantime. Priority is the element index scrambled by a multiplicative hash:
+ * that needs no rank storage, and unlike the plain index it does not build long chains when
+ * elements are unioned in sorted order, as sweeps do. */
+
+int ct_concurrent_set_allocate(ct_concurrent_set_t *set, char error[NM_MAX_ERROR_LENGTH])
+{
+	set->parent = malloc(set->num_elements * sizeof(uint32_t));
+	set->extremum = malloc(set->num_elements * sizeof(uint32_t));
+	if (!set->parent || !set->extremum)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for concurrent set.");
+		return -1;
+	}
+
+	#pragma omp parallel for if (set->num_elements > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < set->num_elements; i++)
+	{
+		set->parent[i] = i;
+		set->extremum[i] = i;
+	}
+
+	return 0;
+}
+
+void ct_concurrent_set_free(ct_concurrent_set_t *set)
+{
+	free(set->parent);
+	free(set->extremum);
+	set->parent = NULL;
+	set->extremum = NULL;
+}
+
+uint32_t ct_concurrent_set_find(ct_concurrent_set_t *set, uint32_t element)
+{
+	uint32_t parent;
+	#pragma omp atomic read
+	parent = set->parent[element];
+	while (parent != element)
+	{
+		uint32_t grandparent;
+		#pragma omp atomic read
+		grandparent = set->parent[parent];
+		if (grandparent == parent) { return parent; }
+
+		// Halve the path. If this fails, someone else has already moved the element up:
+		__sync_bool_compare_and_swap(&(set->parent[element]), parent, grandparent);
+		element = grandparent;
+		#pragma omp atomic read
+		parent = set->parent[element];
+	}
+
+	return element;
+}
+
+int ct_concurrent_set_union(ct_concurrent_set_t *set, uint32_t element, uint32_t other_element)
+{
+	// Returns 1 if this call joined two sets, or 0 if they were already the same:
+	while (1)
+	{
+		uint32_t root = ct_concurrent_set_find(set, element);
+		uint32_t other_root = ct_concurrent_set_find(set, other_element);
+		if (root == other_root) { return 0; }
+
+		if (ct_disjoint_set_has_priority(root, other_root))
+		{
+			uint32_t swap = root;
+			root = other_root;
+			other_root = swap;
+		}
+
+		if (__sync_bool_compare_and_swap(&(set->parent[root]), root, other_root))
+		{
+			uint32_t extremum;
+			#pragma omp atomic read
+			extremum = set->extremum[root];
+			ct_concurrent_set_update_extremum(set, other_root, extremum);
+			return 1;
+		}
+
+		// The root was linked by another thread first:
+		element = root;
+		other_element = other_root;
+	}
+}
+
+int ct_concurrent_set_same(ct_concurrent_set_t *set, uint32_t element, uint32_t other_element)
+{
+	// Different roots only mean different sets if the first is still a root afterwards:
+	while (1)
+	{
+		uint32_t root = ct_concurrent_set_find(set, element);
+		uint32_t other_root = ct_concurrent_set_find(set, other_element);
+		if (root == other_root) { return 1; }
+
+		uint32_t parent;
+		#pragma omp atomic read
+		parent = set->parent[root];
+		if (parent == root) { return 0; }
+	}
+}
+
+void ct_concurrent_set_update_extremum(ct_concurrent_set_t *set, uint32_t element,
+								uint32_t value)
+{
+	/* Moves the extremum of the element's set to the value if it is lower (or higher, for
+	 * a split tree). The root it is written to may be linked under another at the same
+	 * time, in which case the value is carried on to the new root. Whichever thread links
+	 * a root reads its extremum afterwards, so between them nothing is lost. */
+	while (1)
+	{
+		uint32_t root = ct_concurrent_set_find(set, element);
+		uint32_t extremum;
+		#pragma omp atomic read
+		extremum = set->extremum[root];
+		while (set->direction ? (value < extremum) : (value > extremum))
+		{
+			if (__sync_bool_compare_and_swap(&(set->extremum[root]), extremum, value))
+			{
+				break;
+			}
+			#pragma omp atomic read
+			extremum = set->extremum[root];
+		}
+
+		__sync_synchronize();
+		uint32_t parent;
+		#pragma omp atomic read
+		parent = set->parent[root];
+		if (parent == root) { return; }
+		element = root;
+	}
+}
+
+uint32_t ct_concurrent_set_get_extremum(ct_concurrent_set_t *set, uint32_t element)
+{
+	// Only final once no other thread is changing the set:
+	uint32_t extremum;
+	#pragma omp atomic read
+	extremum = set->extremum[ct_concurrent_set_find(set, element)];
+	return extremum;
+}
+
+#ifdef CT_DEBUG
+int ct_concurrent_set_test(FILE *file, uint32_t num_elements, uint32_t num_rounds,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Unions random pairs on up to twice as many threads as there are cores, then checks
+	 * the sets, the number of unions that joined sets and the extrema against the sequential
+	 * disjoint set. Half the pairs join neighbouring indices, to build long chains. */
+	if (num_elements < 2)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Concurrent set test needs two elements.");
+		return -1;
+	}
+
+	uint32_t max_threads = 2 * omp_get_max_threads();
+	if (max_threads < 4) { max_threads = 4; }
+
+	uint32_t *pairs = malloc(num_elements * 2 * sizeof(uint32_t));
+	uint32_t *bounds = malloc(num_elements * 2 * sizeof(uint32_t)); // Minimum, maximum.
+	uint32_t *roots = malloc(num_elements * sizeof(uint32_t));
+	ct_disjoint_set_t reference = {0};
+	reference.num_elements = num_elements;
+	if (!pairs || !bounds || !roots || ct_disjoint_set_allocate(&reference, error))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for concurrent set test.");
+		free(pairs);
+		free(bounds);
+		free(roots);
+		ct_disjoint_set_free(&reference);
+		return -1;
+	}
+
+	int failed = 0;
+	for (uint32_t round = 0; (round < num_rounds) && !failed; round++)
+	{
+		for (uint32_t i = 0; i < num_elements; i++)
+		{
+			uint64_t hash = ct_hash_round(round + 1, i);
+			pairs[2 * i] = hash % num_elements;
+			pairs[(2 * i) + 1] = (i % 2) ? ((hash >> 32) % num_elements) :
+						((pairs[2 * i] + 1) % num_elements);
+		}
+
+		// Reference sets, and the bounds of each:
+		for (uint32_t i = 0; i < num_elements; i++)
+		{
+			reference.parent[i] = i;
+			reference.extremum[i] = i;
+			bounds[2 * i] = i;
+			bounds[(2 * i) + 1] = i;
+		}
+		uint32_t num_joins = 0;
+		for (uint32_t i = 0; i < num_elements; i++)
+		{
+			if (ct_disjoint_set_find(pairs[2 * i], &reference) ==
+				ct_disjoint_set_find(pairs[(2 * i) + 1], &reference))
+			{
+				continue;
+			}
+			ct_disjoint_set_union(pairs[2 * i], pairs[(2 * i) + 1], &reference);
+			num_joins++;
+		}
+		for (uint32_t i = 0; i < num_elements; i++)
+		{
+			uint32_t root = ct_disjoint_set_find(i, &reference);
+			if (i < bounds[2 * root]) { bounds[2 * root] = i; }
+			if (i > bounds[(2 * root) + 1]) { bounds[(2 * root) + 1] = i; }
+		}
+
+		for (uint32_t threads = 1; (threads <= max_threads) && !failed; threads *= 2)
+		{
+			ct_concurrent_set_t set = {0};
+			set.num_elements = num_elements;
+			set.direction = round % 2;
+			if (ct_concurrent_set_allocate(&set, error))
+			{
+				failed = 1;
+				ct_concurrent_set_free(&set);
+				break;
+			}
+
+			uint32_t num_set_joins = 0;
+			uint32_t num_apart = 0;
+			#pragma omp parallel for num_threads(threads) schedule(dynamic, 64) \
+				reduction(+: num_set_joins, num_apart)
+			for (uint32_t i = 0; i < num_elements; i++)
+			{
+				num_set_joins += ct_concurrent_set_union(&set, pairs[2 * i],
+								pairs[(2 * i) + 1]);
+				num_apart += !ct_concurrent_set_same(&set, pairs[2 * i],
+								pairs[(2 * i) + 1]);
+			}
+
+			// Each reference set has to map to exactly one concurrent set, and back:
+			for (uint32_t i = 0; i < num_elements; i++) { roots[i] = UINT32_MAX; }
+			uint32_t num_wrong = 0;
+			for (uint32_t i = 0; i < num_elements; i++)
+			{
+				uint32_t root = ct_disjoint_set_find(i, &reference);
+				uint32_t set_root = ct_concurrent_set_find(&set, i);
+				if (roots[root] == UINT32_MAX) { roots[root] = set_root; }
+				if ((roots[root] != set_root) || (ct_concurrent_set_get_extremum(&set, i) !=
+					bounds[(2 * root) + !set.direction]))
+				{
+					num_wrong++;
+				}
+			}
+
+			if (num_apart || num_wrong || (num_set_joins != num_joins))
+			{
+				snprintf(error, NM_MAX_ERROR_LENGTH, "Concurrent set test failed on %u "
+					"threads: %u joins (expected %u), %u pairs apart, %u elements "
+					"wrong.", threads, num_set_joins, num_joins, num_apart, num_wrong);
+				failed = 1;
+			}
+			ct_concurrent_set_free(&set);
+		}
+	}
+
+	free(pairs);
+	free(bounds);
+	free(roots);
+	ct_disjoint_set_free(&reference);
+	if (failed) { return -1; }
+
+	fprintf(file, "Concurrent set test: %u elements, %u rounds, up to %u threads, passed.\n",
+						num_elements, num_rounds, max_threads);
+	return 0;
+}
+
+int ct_concurrent_set_benchmark(FILE *file, ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Labels the connected components of the mesh edges (or voxel grid) at each thread count.
+	 * Every count has to find as many components as one thread does: */
+	uint8_t grid = (!mesh->edges && mesh->volume.scalars);
+	uint32_t num_elements = grid ? ct_volume_get_num_voxels(&(mesh->volume)) :
+								mesh->num_vertices;
+	uint32_t max_threads = omp_get_max_threads();
+	uint32_t num_components = 0;
+	for (uint32_t threads = 1; ; threads = ((threads * 2) < max_threads) ? (threads * 2) :
+										max_threads)
+	{
+		ct_concurrent_set_t set = {0};
+		set.num_elements = num_elements;
+		set.direction = 1;
+		if (ct_concurrent_set_allocate(&set, error))
+		{
+			ct_concurrent_set_free(&set);
+			return -1;
+		}
+
+		uint64_t num_unions = 0;
+		uint32_t num_joins = 0;
+		double time = omp_get_wtime();
+		if (grid)
+		{
+			#pragma omp parallel for num_threads(threads) reduction(+: num_unions, num_joins)
+			for (uint32_t i = 0; i < num_elements; i++)
+			{
+				uint32_t neighbours[CT_GRID_MAX_NEIGHBOURS];
+				uint32_t num_neighbours = ct_volume_get_neighbours(&(mesh->volume), i,
+										neighbours);
+				for (uint32_t j = 0; j < num_neighbours; j++)
+				{
+					if (neighbours[j] < i) { continue; }
+					num_joins += ct_concurrent_set_union(&set, i, neighbours[j]);
+					num_unions++;
+				}
+			}
+		}
+		else
+		{
+			#pragma omp parallel for num_threads(threads) reduction(+: num_unions, num_joins)
+			for (uint32_t i = 0; i < mesh->num_edges; i++)
+			{
+				num_joins += ct_concurrent_set_union(&set, mesh->edges[i].from,
+									mesh->edges[i].to);
+				num_unions++;
+			}
+		}
+		time = omp_get_wtime() - time;
+
+		fprintf(file, "Concurrent set, %u threads: %llu unions in %.3f ms (%.1f million "
+			"per second), %u components.\n", threads, (unsigned long long)num_unions,
+			time * 1000.0, time ? ((num_unions / time) / 1e6) : 0.0,
+			num_elements - num_joins);
+
+		ct_concurrent_set_free(&set);
+		if (threads == 1) { num_components = num_elements - num_joins; }
+		else if ((num_elements - num_joins) != num_components)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "Concurrent set found %u components on %u "
+				"threads, but %u on one.", num_elements - num_joins, threads,
+								num_components);
+			return -1;
+		}
+		if (threads == max_threads) { break; }
+	}
+
+	return 0;
+}
+#endif
@@ -0,0 +1,42 @@
+#ifndef CT_CONCURRENT_SET_H
+#define CT_CONCURRENT_SET_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <omp.h>
+
+#include <NM-Config/Config.h>
+
+#include "Contour-Tree.h"
+#include "Mesh.h"
+#include "Parallel.h"
+
+// Disjoint sets that any number of threads can find, union and update at once:
+typedef struct
+{
+	uint32_t num_elements;
+	uint8_t direction;	// 1 keeps the lowest element as the extremum (join tree), 0 the highest.
+	uint32_t *parent;	// Roots point to themselves. Only changed by compare and swap.
+	uint32_t *extremum;	// Per root.
+} ct_concurrent_set_t;
+
+// Concurrent sets:
+int ct_concurrent_set_allocate(ct_concurrent_set_t *set, char error[NM_MAX_ERROR_LENGTH]);
+void ct_concurrent_set_free(ct_concurrent_set_t *set);
+uint32_t ct_concurrent_set_find(ct_concurrent_set_t *set, uint32_t element);
+int ct_concurrent_set_union(ct_concurrent_set_t *set, uint32_t element, uint32_t other_element);
+int ct_concurrent_set_same(ct_concurrent_set_t *set, uint32_t element, uint32_t other_element);
+void ct_concurrent_set_update_extremum(ct_concurrent_set_t *set, uint32_t element,
+								uint32_t value);
+uint32_t ct_concurrent_set_get_extremum(ct_concurrent_set_t *set, uint32_t element);
+
+#ifdef CT_DEBUG
+int ct_concurrent_set_test(FILE *file, uint32_t num_elements, uint32_t num_rounds,
+						char error[NM_MAX_ERROR_LENGTH]);
+int ct_concurrent_set_benchmark(FILE *file, ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
+#endif
+
+#endif
@@ -6,15 +6,28 @@
 
 void ct_tree_free(ct_tree_t *tree)
 {
-	if (tree->nodes) { free(tree->nodes); }
-	if (tree->arcs) { free(tree->arcs); }
-	if (tree->roots) { free(tree->roots); }
+	if (tree->nodes && !ct_tree_is_mapped(tree, tree->nodes)) { free(tree->nodes); }
+	if (tree->arcs && !ct_tree_is_mapped(tree, tree->arcs)) { free(tree->arcs); }
+	if (tree->roots && !ct_tree_is_mapped(tree, tree->roots)) { free(tree->roots); }
+	if (tree->vertex_map && !ct_tree_is_mapped(tree, tree->vertex_map))
+	{
+		free(tree->vertex_map);
+	}
+	if (tree->mapping) { munmap(tree->mapping, tree->mapping_size); }
 	memset(tree, 0, sizeof(*tree));
 }
 
+int ct_tree_is_mapped(ct_tree_t *tree, void *pointer)
+{
+	// Construction may replace arrays of a loaded tree, so each one is checked:
+	uint8_t *begin = tree->mapping;
+	uint8_t *position = pointer;
+	return (begin && (position >= begin) && (position < (begin + tree->mapping_size)));
+}
+
 int8_t ct_tree_get_node_type(ct_tree_node_t *node)
 {
-	if (!node->degree[0] && !node->degree[1]) { return CT_NODE_TYPE_DELETED; }
+	// A node with no arcs is a component of its own (a region vertex cut off by the mask):
 	if (!node->degree[1]) { return CT_NODE_TYPE_MINIMUM; }
 	if (!node->degree[0]) { return CT_NODE_TYPE_MAXIMUM; }
 	if ((node->degree[0] > 1) || (node->degree[1] > 1)) { return CT_NODE_TYPE_SADDLE; }
@@ -23,9 +36,7 @@ int8_t ct_tree_get_node_type(ct_tree_node_t *node)
 
 int ct_tree_node_is_critical(ct_tree_node_t *node)
 {
-	int8_t type = ct_tree_get_node_type(node);
-	if ((type != CT_NODE_TYPE_DELETED) && (type != CT_NODE_TYPE_REGULAR)) { return 1; }
-	return 0;
+	return (ct_tree_get_node_type(node) != CT_NODE_TYPE_REGULAR);
 }
 
 int ct_tree_copy_nodes(ct_tree_t *from, ct_tree_t *to, char error[NM_MAX_ERROR_LENGTH])
@@ -43,6 +54,82 @@ int ct_tree_copy_nodes(ct_tree_t *from, ct_tree_t *to, char error[NM_MAX_ERROR_L
 	return 0;
 }
 
+uint32_t ct_tree_get_num_arc_slots(ct_tree_t *tree)
+{
+	/* Length of the arc array that is in use. Merge trees leave a gap when they have more
+	 * than one root, and ct_merge_trees_reduce_to_critical reads up to twice the number of
+	 * arcs, so at least that much is kept. */
+	if (!tree->arcs) { return 0; }
+
+	uint64_t num_arc_slots = (uint64_t)tree->num_arcs * 2;
+	#pragma omp parallel for reduction(max: num_arc_slots) \
+		if (tree->num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < tree->num_nodes; i++)
+	{
+		for (int direction = 0; direction < 2; direction++)
+		{
+			uint64_t end = (uint64_t)tree->nodes[i].first_arc[direction] +
+						tree->nodes[i].degree[direction];
+			if (tree->nodes[i].degree[direction] && (end > num_arc_slots))
+			{
+				num_arc_slots = end;
+			}
+		}
+	}
+
+	return (num_arc_slots > UINT32_MAX) ? UINT32_MAX : num_arc_slots;
+}
+
+int ct_tree_copy(ct_tree_t *from, ct_tree_t *to, char error[NM_MAX_ERROR_LENGTH])
+{
+	// Deep copy, into memory even if the source is mapped:
+	if (ct_tree_copy_nodes(from, to, error)) { return -1; }
+
+	uint32_t num_arc_slots = ct_tree_get_num_arc_slots(from);
+	if (num_arc_slots)
+	{
+		to->arcs = malloc((size_t)num_arc_slots * sizeof(uint32_t));
+		if (!to->arcs)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for tree arcs.");
+			ct_tree_free(to);
+			return -1;
+		}
+		memcpy(to->arcs, from->arcs, (size_t)num_arc_slots * sizeof(uint32_t));
+	}
+	to->num_arcs = from->num_arcs;
+
+	if (from->num_roots)
+	{
+		to->roots = malloc(from->num_roots * sizeof(uint32_t));
+		if (!to->roots)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for tree roots.");
+			ct_tree_free(to);
+			return -1;
+		}
+		memcpy(to->roots, from->roots, from->num_roots * sizeof(uint32_t));
+	}
+	to->num_roots = from->num_roots;
+
+	if (from->vertex_map)
+	{
+		to->vertex_map = malloc((size_t)from->num_vertices * sizeof(uint32_t));
+		if (!to->vertex_map)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH,
+				"Could not allocate memory for tree vertex map.");
+			ct_tree_free(to);
+			return -1;
+		}
+		memcpy(to->vertex_map, from->vertex_map,
+				(size_t)from->num_vertices * sizeof(uint32_t));
+		to->num_vertices = from->num_vertices;
+	}
+
+	return 0;
+}
+
 int ct_tree_nodes_qsort_compare(const void *a, const void *b)
 {
 	ct_tree_node_t left = *(ct_tree_node_t *)a;
@@ -52,6 +139,13 @@ int ct_tree_nodes_qsort_compare(const void *a, const void *b)
 	return ((left.node_to_vertex > right.node_to_vertex) * 2) - 1;
 }
 
+int ct_tree_arcs_qsort_compare(const void *a, const void *b)
+{
+	uint32_t left = *(uint32_t *)a;
+	uint32_t right = *(uint32_t *)b;
+	return (left > right) - (left < right);
+}
+
 /*********************
  * Tree construction *
  *********************/
@@ -65,6 +159,15 @@ int ct_merge_tree_construct(ct_tree_t *merge_tree, ct_mesh_t *mesh,
 		return -1;
 	}
 
+	// Voxel inputs have no edges, so neighbours are taken from the grid instead:
+	uint8_t grid = (!mesh->edges && mesh->volume.scalars);
+	if (grid && (merge_tree->num_nodes != ct_volume_get_num_voxels(&(mesh->volume))))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Merge tree nodes do not match the volume of mesh \"%s\".", mesh->name);
+		return -1;
+	}
+
 	ct_disjoint_set_t disjoint_set = {0};
 	disjoint_set.num_elements = merge_tree->num_nodes;
 	if (ct_disjoint_set_allocate(&disjoint_set, error)) { return -1; }
@@ -79,87 +182,18 @@ int ct_merge_tree_construct(ct_tree_t *merge_tree, ct_mesh_t *mesh,
 	}
 	memset(merge_tree->arcs, 0, merge_tree->num_nodes * 2 * sizeof(uint32_t));
 
-	uint32_t i = start_index;
-	uint32_t index_limit;
-	uint8_t direction;
-	int (*index_compare)(uint32_t left, uint32_t right);
-	int (*index_increment)(uint32_t *index, uint32_t limit);
-
-	if (i == 0)
+	// Each kernel has its direction and neighbour source fixed at compile time:
+	if (start_index == 0)
 	{
 		// Sweep low to high (split tree):
-		direction = 0;
-		index_limit = merge_tree->num_nodes;
-		index_compare = ct_index_compare_split;
-		index_increment = ct_index_increment_split;
+		if (grid) { ct_merge_tree_sweep_split_grid(merge_tree, mesh, &disjoint_set); }
+		else { ct_merge_tree_sweep_split_mesh(merge_tree, mesh, &disjoint_set); }
 	}
 	else
 	{
 		// Sweep high to low (join tree):
-		direction = 1;
-		index_limit = 0;
-		index_compare = ct_index_compare_join;
-		index_increment = ct_index_increment_join;
-	}
-
-	uint32_t current_arc[2] = { 0, merge_tree->num_nodes - 1 }; // Up[0], down[1].
-	uint32_t current_edge;
-	uint32_t current_vertex;
-	uint32_t current_component;
-	uint32_t adjacent_vertex;
-	uint32_t adjacent_node;
-	uint32_t adjacent_component;
-	uint32_t previous_adjacent_vertex;
-	while (1)
-	{
-		merge_tree->nodes[i].first_arc[!direction] = current_arc[!direction];
-		current_vertex = merge_tree->nodes[i].node_to_vertex;
-		current_edge = mesh->first_edge[current_vertex];
-		adjacent_vertex = current_vertex;
-		while (1)
-		{
-			previous_adjacent_vertex = adjacent_vertex;
-			if (mesh->edges[current_edge].from == current_vertex)
-			{
-				adjacent_vertex = mesh->edges[current_edge].to;
-			}
-			else { adjacent_vertex = mesh->edges[current_edge].from; }
-
-			adjacent_node = merge_tree->nodes[adjacent_vertex].vertex_to_node;
-			current_component = ct_disjoint_set_find(i, &disjoint_set);
-			adjacent_component = ct_disjoint_set_find(adjacent_node, &disjoint_set);
-			if ((adjacent_vertex != previous_adjacent_vertex) &&
-				index_compare(adjacent_node, i) &&
-				(current_component != adjacent_component))
-			{
-				ct_disjoint_set_union(current_component, adjacent_component,
-									&disjoint_set);
-
-				adjacent_node = disjoint_set.extremum[adjacent_component];
-				merge_tree->arcs[current_arc[!direction]] = adjacent_node;
-				merge_tree->arcs[current_arc[direction]] = i;
-				merge_tree->nodes[adjacent_node].first_arc[direction] =
-								current_arc[direction];
-				current_arc[0]++;
-				current_arc[1]++;
-				merge_tree->num_arcs++;
-				merge_tree->nodes[i].degree[!direction]++;
-				merge_tree->nodes[adjacent_node].degree[direction]++;
-
-				adjacent_component = ct_disjoint_set_find(adjacent_node,
-									&disjoint_set);
-				disjoint_set.extremum[adjacent_component] = i;
-			}
-
-			current_edge = ct_mesh_get_next_vertex_edge(mesh, current_vertex,
-									current_edge);
-			if ((current_edge == UINT32_MAX) || (mesh->edges[current_edge].other_half ==
-								mesh->first_edge[current_vertex]))
-			{
-				break;
-			}
-		}
-		if (!index_increment(&i, index_limit)) { break; }
+		if (grid) { ct_merge_tree_sweep_join_grid(merge_tree, mesh, &disjoint_set); }
+		else { ct_merge_tree_sweep_join_mesh(merge_tree, mesh, &disjoint_set); }
 	}
 
 	// Get root information:
@@ -171,11 +205,12 @@ int ct_merge_tree_construct(ct_tree_t *merge_tree, ct_mesh_t *mesh,
 		return -1;
 	}
 
+	// Which element ends up as a set's root depends on linking, so roots go in node order:
 	for (uint32_t j = 0; j < disjoint_set.num_elements; j++)
 	{
-		if (disjoint_set.parent[j] == j)
+		if (disjoint_set.extremum[ct_disjoint_set_find(j, &disjoint_set)] == j)
 		{
-			merge_tree->roots[merge_tree->num_roots] = disjoint_set.extremum[j];
+			merge_tree->roots[merge_tree->num_roots] = j;
 			merge_tree->num_roots++;
 		}
 	}
@@ -192,206 +227,584 @@ int ct_merge_tree_construct(ct_tree_t *merge_tree, ct_mesh_t *mesh,
 	return 0;
 }
 
-int ct_merge_trees_reduce_to_critical(ct_tree_t *join_tree, ct_tree_t *split_tree,
-						char error[NM_MAX_ERROR_LENGTH])
+uint32_t ct_merge_tree_add_arc(ct_tree_t *merge_tree, ct_disjoint_set_t *disjoint_set,
+	uint32_t node, uint32_t component, uint32_t adjacent_node, uint32_t current_arc[2],
+							uint8_t direction)
 {
-	// TODO - you can parallelise this.
+	/* Merges in the component of an already swept neighbour, with an arc to its extremum.
+	 * Only this changes the node's component, so the sweep passes its root back in rather
+	 * than finding it again for every neighbour: */
+	uint32_t adjacent_component = ct_disjoint_set_find(adjacent_node, disjoint_set);
+	if (component == adjacent_component) { return component; }
+
+	adjacent_node = disjoint_set->extremum[adjacent_component];
+	merge_tree->arcs[current_arc[!direction]] = adjacent_node;
+	merge_tree->arcs[current_arc[direction]] = node;
+	merge_tree->nodes[adjacent_node].first_arc[direction] = current_arc[direction];
+	current_arc[0]++;
+	current_arc[1]++;
+	merge_tree->num_arcs++;
+	merge_tree->nodes[node].degree[!direction]++;
+	merge_tree->nodes[adjacent_node].degree[direction]++;
+
+	component = ct_disjoint_set_link(component, adjacent_component, disjoint_set);
+	disjoint_set->extremum[component] = node;
+	return component;
+}
 
-	ct_disjoint_set_t disjoint_set_join = {0};
-	disjoint_set_join.num_elements = join_tree->num_nodes;
-	if (ct_disjoint_set_allocate(&disjoint_set_join, error)) { return -1; }
+int ct_merge_tree_set_arcs(ct_tree_t *merge_tree, uint32_t *parent, uint8_t direction,
+				uint32_t *scratch, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Writes the arcs of an augmented merge tree given the parent of each node (the next
+	 * node swept in its component, or CT_TREE_NO_NODE for roots). The layout matches
+	 * ct_merge_tree_construct: each node's arcs to the nodes it absorbs take consecutive
+	 * slots from the start of the array, in sweep order, and the matching arcs back sit
+	 * num_nodes - 1 slots later. Children are in sweep order and roots in node order.
+	 * Scratch needs room for num_nodes values. An empty tree still gets (unused) arrays, as
+	 * malloc(0) may give NULL: */
+	uint32_t num_nodes = merge_tree->num_nodes;
+	uint32_t base[2] = { 0, num_nodes - 1 };
+	uint32_t capacity = num_nodes ? num_nodes : 1;
+
+	merge_tree->arcs = malloc(capacity * 2 * sizeof(uint32_t));
+	merge_tree->roots = malloc(capacity * sizeof(uint32_t));
+	if (!merge_tree->arcs || !merge_tree->roots)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for merge tree.");
+		return -1;
+	}
+	memset(merge_tree->arcs, 0, capacity * 2 * sizeof(uint32_t));
+
+	#pragma omp parallel for if (num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < num_nodes; i++)
+	{
+		merge_tree->nodes[i].degree[0] = 0;
+		merge_tree->nodes[i].degree[1] = 0;
+	}
+
+	#pragma omp parallel for if (num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < num_nodes; i++)
+	{
+		if (parent[i] == CT_TREE_NO_NODE) { continue; }
+		merge_tree->nodes[i].degree[direction] = 1;
+		#pragma omp atomic
+		merge_tree->nodes[parent[i]].degree[!direction]++;
+	}
+
+	// Slots in sweep order:
+	#pragma omp parallel for if (num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t step = 0; step < num_nodes; step++)
+	{
+		scratch[step] = merge_tree->nodes[direction ? (num_nodes - step - 1) :
+							step].degree[!direction];
+	}
+	merge_tree->num_arcs = ct_parallel_prefix_sum(scratch, num_nodes);
+
+	#pragma omp parallel for if (num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t step = 0; step < num_nodes; step++)
+	{
+		uint32_t i = direction ? (num_nodes - step - 1) : step;
+		merge_tree->nodes[i].first_arc[!direction] = base[!direction] + scratch[step];
+	}
+
+	// Scratch now counts the arcs filled so far:
+	memset(scratch, 0, num_nodes * sizeof(uint32_t));
+	#pragma omp parallel for if (num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < num_nodes; i++)
+	{
+		if (parent[i] == CT_TREE_NO_NODE) { continue; }
+
+		uint32_t index;
+		#pragma omp atomic capture
+		index = scratch[parent[i]]++;
+		merge_tree->arcs[merge_tree->nodes[parent[i]].first_arc[!direction] + index] = i;
+	}
+
+	/* Children in sweep order, then the arcs back. Most nodes have few, so an insertion sort
+	 * does, but saddles in noisy fields can have thousands and are sorted properly: */
+	#pragma omp parallel for schedule(dynamic, 1024) if (num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < num_nodes; i++)
+	{
+		uint32_t *children = &(merge_tree->arcs[merge_tree->nodes[i].first_arc[!direction]]);
+		uint32_t num_children = merge_tree->nodes[i].degree[!direction];
+		if (num_children > CT_TREE_INSERTION_SORT_MAX)
+		{
+			qsort(children, num_children, sizeof(uint32_t), ct_tree_arcs_qsort_compare);
+			for (uint32_t j = 0; direction && (j < (num_children / 2)); j++)
+			{
+				uint32_t swap = children[j];
+				children[j] = children[num_children - j - 1];
+				children[num_children - j - 1] = swap;
+			}
+		}
+		else
+		{
+			for (uint32_t j = 1; j < num_children; j++)
+			{
+				uint32_t child = children[j];
+				uint32_t k = j;
+				for (; (k > 0) && (direction ? (child > children[k - 1]) :
+							(child < children[k - 1])); k--)
+				{
+					children[k] = children[k - 1];
+				}
+				children[k] = child;
+			}
+		}
+
+		for (uint32_t j = 0; j < num_children; j++)
+		{
+			uint32_t slot = merge_tree->nodes[i].first_arc[!direction] + j -
+						base[!direction] + base[direction];
+			merge_tree->arcs[slot] = i;
+			merge_tree->nodes[children[j]].first_arc[direction] = slot;
+		}
+	}
+
+	merge_tree->num_roots = 0;
+	for (uint32_t i = 0; i < num_nodes; i++)
+	{
+		if (parent[i] != CT_TREE_NO_NODE) { continue; }
+		merge_tree->roots[merge_tree->num_roots] = i;
+		merge_tree->num_roots++;
+	}
 
-	ct_disjoint_set_t disjoint_set_split = {0};
-	disjoint_set_split.num_elements = split_tree->num_nodes;
-	if (ct_disjoint_set_allocate(&disjoint_set_split, error))
+	uint32_t *roots = realloc(merge_tree->roots, (merge_tree->num_roots ?
+					merge_tree->num_roots : 1) * sizeof(uint32_t));
+	if (!roots)
 	{
-		ct_disjoint_set_free(&disjoint_set_join);
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not reallocate memory for tree roots.");
+		return -1;
+	}
+	merge_tree->roots = roots;
+
+	return 0;
+}
+
+int ct_merge_tree_construct_critical(ct_tree_t *merge_tree, ct_mesh_t *mesh,
+	uint32_t start_index, uint32_t *arc_map, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Sweeps as ct_merge_tree_construct does, but only keeps the nodes that are critical in
+	 * this tree (leaves and nodes that join components), and those with no neighbours later
+	 * in the sweep. The last are leaves of the other merge tree and include this one's roots,
+	 * so each component keeps its root. Arcs join each kept node to the last node kept in the
+	 * components it absorbs, and the sorted nodes are compacted to the kept ones. If arc_map
+	 * is given (one value per vertex), it gets the node at the start of the arc each vertex
+	 * lies on, in sweep order: itself if kept. ct_merge_trees_augment uses it to add nodes. */
+	if (!merge_tree->num_nodes || !merge_tree->nodes)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Merge tree has no nodes.");
 		return -1;
 	}
 
-	uint8_t *critical = malloc(join_tree->num_nodes * sizeof(uint8_t));
-	if (!critical)
+	uint8_t grid = (!mesh->edges && mesh->volume.scalars);
+	if (grid && (merge_tree->num_nodes != ct_volume_get_num_voxels(&(mesh->volume))))
 	{
 		snprintf(error, NM_MAX_ERROR_LENGTH,
-			"Could not allocate memory for critical node map.");
-		ct_disjoint_set_free(&disjoint_set_split);
-		ct_disjoint_set_free(&disjoint_set_join);
+			"Merge tree nodes do not match the volume of mesh \"%s\".", mesh->name);
 		return -1;
 	}
-	memset(critical, 0, join_tree->num_nodes * sizeof(uint8_t));
 
-	uint32_t critical_count = 0;
-	for (uint32_t i = 0; i < join_tree->num_nodes; i++)
+	uint32_t num_nodes = merge_tree->num_nodes;
+	uint8_t direction = (start_index != 0);
+	uint32_t max_neighbours = CT_GRID_MAX_NEIGHBOURS;
+	if (!grid)
 	{
-		if (ct_tree_node_is_critical(&(join_tree->nodes[i])) ||
-			ct_tree_node_is_critical(&(split_tree->nodes[i])))
+		max_neighbours = 0;
+		#pragma omp parallel for reduction(max: max_neighbours) \
+			if (num_nodes > CT_PARALLEL_THRESHOLD)
+		for (uint32_t i = 0; i < num_nodes; i++)
 		{
-			critical[i] = 1;
-			critical_count++;
+			uint32_t num_neighbours = ct_mesh_get_vertex_neighbours(mesh, i, NULL, 0);
+			if (num_neighbours > max_neighbours) { max_neighbours = num_neighbours; }
 		}
 	}
 
-	uint32_t index_split;
-	uint32_t node_split = 0;
-	uint32_t arc_split[2] = { 0, split_tree->num_arcs };
-
-	uint32_t index_join;
-	uint32_t node_join_final = critical_count - 1;
-	uint32_t node_join = join_tree->num_nodes - 1;
-	uint32_t arc_join[2] = { 0, join_tree->num_arcs };
+	/* Kept nodes in sweep order, as pairs of the node and the position of its parent in the
+	 * same list. Set extrema hold the position of the last node kept in the component: */
+	ct_disjoint_set_t disjoint_set = {0};
+	disjoint_set.num_elements = num_nodes;
+	uint32_t num_kept = 0;
+	uint32_t kept_capacity = 1024;
+	uint32_t *kept = malloc(kept_capacity * 2 * sizeof(uint32_t));
+	uint32_t *neighbours = malloc((max_neighbours + 1) * sizeof(uint32_t));
+	uint32_t *joined = malloc((max_neighbours + 1) * sizeof(uint32_t));
+	if (!kept || !neighbours || !joined || ct_disjoint_set_allocate(&disjoint_set, error))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for critical sweep.");
+		ct_disjoint_set_free(&disjoint_set);
+		free(kept);
+		free(neighbours);
+		free(joined);
+		return -1;
+	}
 
-	uint32_t component;
-	uint32_t extremum;
-	for (uint32_t i = 0; i < join_tree->num_nodes; i++)
+	for (uint32_t step = 0; step < num_nodes; step++)
 	{
-		/*-----------*
-		 - Join tree -
-		 *-----------*/
-		index_join = join_tree->num_nodes - i - 1;
+		uint32_t i = direction ? (num_nodes - step - 1) : step;
+		uint32_t vertex = merge_tree->nodes[i].node_to_vertex;
+		uint32_t num_neighbours;
+		if (grid)
+		{
+			num_neighbours = ct_volume_get_neighbours(&(mesh->volume), vertex, neighbours);
+		}
+		else
+		{
+			num_neighbours = ct_mesh_get_vertex_neighbours(mesh, vertex, neighbours,
+									max_neighbours);
+		}
+
+		uint32_t component = i; // Not yet joined to anything.
+		uint32_t num_joined = 0;
+		uint8_t last = 1;
+		for (uint32_t j = 0; j < num_neighbours; j++)
+		{
+			uint32_t adjacent_node = merge_tree->nodes[neighbours[j]].vertex_to_node;
+			if (direction ? (adjacent_node < i) : (adjacent_node > i))
+			{
+				last = 0;
+				continue;
+			}
 
-		// Copy critical node info to appropriate space:
-		if (critical[index_join])
+			uint32_t adjacent_component = ct_disjoint_set_find(adjacent_node, &disjoint_set);
+			if (component == adjacent_component) { continue; }
+
+			joined[num_joined] = disjoint_set.extremum[adjacent_component];
+			num_joined++;
+			component = ct_disjoint_set_link(component, adjacent_component, &disjoint_set);
+		}
+
+		if ((num_joined == 1) && !last)
 		{
-			join_tree->nodes[node_join].value = join_tree->nodes[index_join].value;
-			join_tree->nodes[node_join].node_to_vertex =
-				join_tree->nodes[index_join].node_to_vertex;
-			join_tree->nodes[node_join].vertex_to_node =
-				join_tree->nodes[index_join].vertex_to_node;
-			join_tree->nodes[node_join].degree[0] =
-				join_tree->nodes[index_join].degree[0];
-			join_tree->nodes[node_join].degree[1] =
-				join_tree->nodes[index_join].degree[1];
+			disjoint_set.extremum[component] = joined[0];
+			if (arc_map) { arc_map[vertex] = joined[0]; }
+			continue;
 		}
 
-		// Iterate through up arcs and keep track of components:
-		for (uint32_t j = join_tree->nodes[index_join].first_arc[0];
-			j < (join_tree->nodes[index_join].first_arc[0] +
-			join_tree->nodes[index_join].degree[0]); j++)
+		if (num_kept == kept_capacity)
 		{
-			extremum = disjoint_set_join.extremum[ct_disjoint_set_find(
-					join_tree->arcs[j], &disjoint_set_join)];
-			ct_disjoint_set_union(index_join, join_tree->arcs[j], &disjoint_set_join);
-			component = ct_disjoint_set_find(join_tree->arcs[j], &disjoint_set_join);
-			disjoint_set_join.extremum[component] = extremum;
-			if (critical[index_join])
+			uint32_t *larger = realloc(kept, kept_capacity * 4 * sizeof(uint32_t));
+			if (!larger)
 			{
-				// Found superarc:
-				join_tree->arcs[join_tree->nodes[extremum].first_arc[1]] =
-									node_join_final;
-				join_tree->arcs[arc_join[0]] = extremum - (join_tree->num_nodes - critical_count);
-				arc_join[0]++;
+				snprintf(error, NM_MAX_ERROR_LENGTH,
+					"Could not allocate memory for critical sweep.");
+				ct_disjoint_set_free(&disjoint_set);
+				free(kept);
+				free(neighbours);
+				free(joined);
+				return -1;
 			}
+			kept = larger;
+			kept_capacity *= 2;
+		}
+
+		kept[2 * num_kept] = i;
+		kept[(2 * num_kept) + 1] = CT_TREE_NO_NODE;
+		for (uint32_t j = 0; j < num_joined; j++) { kept[(2 * joined[j]) + 1] = num_kept; }
+		disjoint_set.extremum[component] = num_kept;
+		if (arc_map) { arc_map[vertex] = num_kept; }
+		num_kept++;
+	}
+
+	ct_disjoint_set_free(&disjoint_set);
+	free(neighbours);
+	free(joined);
+
+	/* Sweep positions become node indices, which run the other way in the join tree. Nodes
+	 * move down in increasing order, so none is overwritten before it has moved: */
+	for (uint32_t k = 0; k < num_kept; k++)
+	{
+		uint32_t position = direction ? (num_kept - k - 1) : k;
+		merge_tree->nodes[k] = merge_tree->nodes[kept[2 * position]];
+	}
+	uint32_t *parent = kept;
+	for (uint32_t k = 0; k < num_kept; k++)
+	{
+		uint32_t position = kept[(2 * k) + 1];
+		if (position == CT_TREE_NO_NODE) { parent[k] = CT_TREE_NO_NODE; }
+		else { parent[k] = direction ? (num_kept - position - 1) : position; }
+	}
+	if (direction)
+	{
+		for (uint32_t k = 0; k < (num_kept / 2); k++)
+		{
+			uint32_t swap = parent[k];
+			parent[k] = parent[num_kept - k - 1];
+			parent[num_kept - k - 1] = swap;
 		}
+		if (arc_map)
+		{
+			#pragma omp parallel for if (num_nodes > CT_PARALLEL_THRESHOLD)
+			for (uint32_t i = 0; i < num_nodes; i++) { arc_map[i] = num_kept - arc_map[i] - 1; }
+		}
+	}
 
-		// Finalise critical node info:
-		if (critical[index_join])
+	ct_tree_node_t *nodes = realloc(merge_tree->nodes, num_kept * sizeof(ct_tree_node_t));
+	if (!nodes)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not reallocate memory for tree nodes.");
+		free(kept);
+		return -1;
+	}
+	merge_tree->nodes = nodes;
+	merge_tree->num_nodes = num_kept;
+
+	// The second half of the kept list is free by now:
+	if (ct_merge_tree_set_arcs(merge_tree, parent, direction, &(kept[num_kept]), error))
+	{
+		free(kept);
+		return -1;
+	}
+
+	free(kept);
+	return 0;
+}
+
+int ct_merge_trees_augment(ct_tree_t *join_tree, ct_tree_t *split_tree, uint32_t *join_map,
+				uint32_t *split_map, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Brings trees from ct_merge_tree_construct_critical to the same nodes, as
+	 * ct_merge_trees_reduce_to_critical does for augmented trees: each gets the nodes kept
+	 * only by the other, placed on the arcs their vertices were mapped to. Only kept nodes
+	 * are visited. The merged node list is sorted, as both inputs are: */
+	uint32_t num_nodes = 0;
+	uint32_t *sources = malloc((join_tree->num_nodes + split_tree->num_nodes) * 2 *
+							sizeof(uint32_t));
+	ct_tree_node_t *nodes = malloc((join_tree->num_nodes + split_tree->num_nodes) *
+							sizeof(ct_tree_node_t));
+	if (!sources || !nodes)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for augmentation.");
+		free(sources);
+		free(nodes);
+		return -1;
+	}
+
+	uint32_t next[2] = { 0, 0 }; // Join[0], split[1].
+	while ((next[0] < join_tree->num_nodes) || (next[1] < split_tree->num_nodes))
+	{
+		int order = 0;
+		if (next[0] == join_tree->num_nodes) { order = 1; }
+		else if (next[1] == split_tree->num_nodes) { order = -1; }
+		else if (join_tree->nodes[next[0]].node_to_vertex !=
+				split_tree->nodes[next[1]].node_to_vertex)
 		{
-			join_tree->nodes[node_join].first_arc[0] = arc_join[0] -
-					join_tree->nodes[index_join].degree[0];
-			join_tree->nodes[node_join].first_arc[1] = arc_join[1];
-
-			component = ct_disjoint_set_find(index_join, &disjoint_set_join);
-			disjoint_set_join.extremum[component] = node_join;
-			arc_join[1] += join_tree->nodes[node_join].degree[1];
-			node_join--;
-			node_join_final--;
+			order = ct_tree_nodes_qsort_compare(&(join_tree->nodes[next[0]]),
+							&(split_tree->nodes[next[1]]));
 		}
 
-		/*------------*
-		 - Split tree -
-		 *------------*/
-		index_split = i;
+		nodes[num_nodes] = (order <= 0) ? join_tree->nodes[next[0]] :
+						split_tree->nodes[next[1]];
+		sources[2 * num_nodes] = (order <= 0) ? next[0] : CT_TREE_NO_NODE;
+		sources[(2 * num_nodes) + 1] = (order >= 0) ? next[1] : CT_TREE_NO_NODE;
+		if (order <= 0) { next[0]++; }
+		if (order >= 0) { next[1]++; }
+		num_nodes++;
+	}
 
-		// Copy critical node info to appropriate space:
-		if (critical[index_split])
+	for (uint8_t direction = 0; direction < 2; direction++)
+	{
+		// Split tree first, swept low to high:
+		ct_tree_t *tree = direction ? join_tree : split_tree;
+		uint32_t *map = direction ? join_map : split_map;
+		uint32_t source = !direction;
+
+		/* Nodes on an arc are chained from its start in sweep order, and the last one takes
+		 * the arc's end as its parent: */
+		uint32_t *parent = malloc(num_nodes * sizeof(uint32_t));
+		uint32_t *scratch = malloc(num_nodes * sizeof(uint32_t));
+		uint32_t *last = malloc(tree->num_nodes * 2 * sizeof(uint32_t));
+		if (!parent || !scratch || !last)
 		{
-			split_tree->nodes[node_split].value = split_tree->nodes[index_split].value;
-			split_tree->nodes[node_split].node_to_vertex =
-				split_tree->nodes[index_split].node_to_vertex;
-			split_tree->nodes[node_split].vertex_to_node =
-				split_tree->nodes[index_split].vertex_to_node;
-			split_tree->nodes[node_split].degree[0] =
-				split_tree->nodes[index_split].degree[0];
-			split_tree->nodes[node_split].degree[1] =
-				split_tree->nodes[index_split].degree[1];
-
-			component = ct_disjoint_set_find(index_split, &disjoint_set_split);
-			disjoint_set_split.extremum[component] = node_split;
+			snprintf(error, NM_MAX_ERROR_LENGTH,
+				"Could not allocate memory for augmentation.");
+			free(sources);
+			free(nodes);
+			free(parent);
+			free(scratch);
+			free(last);
+			return -1;
+		}
+		uint32_t *position = &(last[tree->num_nodes]); // Old node to new.
+
+		for (uint32_t step = 0; step < num_nodes; step++)
+		{
+			uint32_t i = direction ? (num_nodes - step - 1) : step;
+			uint32_t old = sources[(2 * i) + source];
+			if (old != CT_TREE_NO_NODE)
+			{
+				position[old] = i;
+				last[old] = i;
+				continue;
+			}
+
+			uint32_t start = map[nodes[i].node_to_vertex];
+			parent[last[start]] = i;
+			last[start] = i;
 		}
 
-		// Iterate through down arcs and keep track of components:
-		for (uint32_t j = split_tree->nodes[index_split].first_arc[1];
-			j < (split_tree->nodes[index_split].first_arc[1] +
-			split_tree->nodes[index_split].degree[1]); j++)
+		for (uint32_t j = 0; j < tree->num_nodes; j++)
 		{
-			extremum = disjoint_set_split.extremum[ct_disjoint_set_find(
-					split_tree->arcs[j], &disjoint_set_split)];
-			ct_disjoint_set_union(index_split, split_tree->arcs[j],
-							&disjoint_set_split);
-			component = ct_disjoint_set_find(split_tree->arcs[j], &disjoint_set_split);
-			disjoint_set_split.extremum[component] = extremum;
-			if (critical[index_split])
+			parent[last[j]] = CT_TREE_NO_NODE;
+			if (tree->nodes[j].degree[direction])
 			{
-				// Found superarc:
-				split_tree->arcs[split_tree->nodes[extremum].first_arc[0]] =
-										node_split;
-				split_tree->arcs[arc_split[1]] = extremum;
-				arc_split[1]++;
+				parent[last[j]] = position[tree->arcs[tree->nodes[j].first_arc[direction]]];
 			}
 		}
+		free(last);
+
+		ct_tree_node_t *tree_nodes = malloc(num_nodes * sizeof(ct_tree_node_t));
+		if (!tree_nodes)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH,
+				"Could not allocate memory for augmentation.");
+			free(sources);
+			free(nodes);
+			free(parent);
+			free(scratch);
+			return -1;
+		}
+		memcpy(tree_nodes, nodes, num_nodes * sizeof(ct_tree_node_t));
 
-		// Finalise critical node info:
-		if (critical[index_split])
+		ct_tree_free(tree);
+		tree->nodes = tree_nodes;
+		tree->num_nodes = num_nodes;
+		if (ct_merge_tree_set_arcs(tree, parent, direction, scratch, error))
 		{
-			split_tree->nodes[node_split].first_arc[1] = arc_split[1] -
-					split_tree->nodes[index_split].degree[1];
-			split_tree->nodes[node_split].first_arc[0] = arc_split[0];
-
-			component = ct_disjoint_set_find(index_split, &disjoint_set_split);
-			disjoint_set_split.extremum[component] = node_split;
-			arc_split[0] += split_tree->nodes[node_split].degree[0];
-			node_split++;
+			free(sources);
+			free(nodes);
+			free(parent);
+			free(scratch);
+			return -1;
 		}
+		free(parent);
+		free(scratch);
 	}
 
-	free(critical);
+	free(sources);
+	free(nodes);
+	return 0;
+}
 
-	// Finalise new join tree information:
-	join_tree->num_nodes = critical_count;
-	if (!memmove(join_tree->nodes, &(join_tree->nodes[node_join + 1]), critical_count *
-							sizeof(join_tree->nodes[0])))
+int ct_merge_trees_reduce_to_critical(ct_tree_t *join_tree, ct_tree_t *split_tree,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Keeps the nodes that are critical in either tree. They are found in one parallel pass,
+	 * and a prefix sum over them gives their new indices in both trees. The trees share
+	 * nothing else, so each is then compacted on its own thread: */
+	if (join_tree->num_nodes != split_tree->num_nodes)
 	{
-		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not move join tree node memory.");
-		ct_disjoint_set_free(&disjoint_set_split);
-		ct_disjoint_set_free(&disjoint_set_join);
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Join and split trees have different nodes.");
 		return -1;
 	}
-	if (!memmove(&(join_tree->arcs[arc_join[0]]), &(join_tree->arcs[join_tree->num_arcs]),
-		(join_tree->num_nodes - join_tree->num_roots) * sizeof(join_tree->arcs[0])))
+
+	uint32_t num_nodes = join_tree->num_nodes;
+	uint8_t *critical = malloc(num_nodes * sizeof(uint8_t));
+	uint32_t *new_index = malloc(num_nodes * sizeof(uint32_t));
+	if (!critical || !new_index)
 	{
-		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not move join tree arc memory.");
-		ct_disjoint_set_free(&disjoint_set_split);
-		ct_disjoint_set_free(&disjoint_set_join);
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for critical node map.");
+		free(critical);
+		free(new_index);
 		return -1;
 	}
-	join_tree->num_arcs = join_tree->num_nodes - join_tree->num_roots;
 
-	// Finalise new split tree information:
-	split_tree->num_nodes = critical_count;
-	if (!memmove(&(split_tree->arcs[arc_split[0]]), &(split_tree->arcs[split_tree->num_arcs]),
-		(split_tree->num_nodes - split_tree->num_roots) * sizeof(split_tree->arcs[0])))
+	#pragma omp parallel for if (num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < num_nodes; i++)
 	{
-		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not move split tree arc memory.");
-		ct_disjoint_set_free(&disjoint_set_split);
-		ct_disjoint_set_free(&disjoint_set_join);
+		critical[i] = (ct_tree_node_is_critical(&(join_tree->nodes[i])) ||
+				ct_tree_node_is_critical(&(split_tree->nodes[i])));
+		new_index[i] = critical[i];
+	}
+	uint32_t num_critical = ct_parallel_prefix_sum(new_index, num_nodes);
+
+	int status[2] = { 0, 0 };
+	char split_error[NM_MAX_ERROR_LENGTH] = "";
+	#pragma omp parallel sections num_threads(2) if (num_nodes > CT_PARALLEL_THRESHOLD)
+	{
+		#pragma omp section
+		status[0] = ct_merge_tree_compact(join_tree, critical, new_index, num_critical, 1,
+										error);
+		#pragma omp section
+		status[1] = ct_merge_tree_compact(split_tree, critical, new_index, num_critical, 0,
+									split_error);
+	}
+
+	free(critical);
+	free(new_index);
+	if (!status[0] && status[1]) { strcpy(error, split_error); }
+	return (status[0] || status[1]) ? -1 : 0;
+}
+
+int ct_merge_tree_compact(ct_tree_t *merge_tree, uint8_t *critical, uint32_t *new_index,
+		uint32_t num_critical, uint8_t direction, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Reduces an augmented merge tree to its critical nodes, given their new indices. Nodes
+	 * are visited parents first, each noting the nearest critical node at or after it along
+	 * the sweep, so a critical node's new parent is the one noted at its old parent. That
+	 * reads the nodes in order, where following parents from each critical node would jump
+	 * around memory. The arcs are then laid out again for the remaining nodes, and memory
+	 * for the removed ones is given back. Arrays keep room for one node, as for an empty
+	 * tree malloc(0) may give NULL: */
+	uint32_t num_nodes = merge_tree->num_nodes;
+	uint32_t capacity = num_critical ? num_critical : 1;
+	uint32_t *nearest = malloc((num_nodes ? num_nodes : 1) * sizeof(uint32_t));
+	uint32_t *parent = malloc(capacity * 2 * sizeof(uint32_t)); // Then scratch.
+	if (!nearest || !parent)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for reduction.");
+		free(nearest);
+		free(parent);
 		return -1;
 	}
-	split_tree->num_arcs = split_tree->num_nodes - split_tree->num_roots;
 
-	// TODO realloc to smaller sizes.
+	for (uint32_t step = 0; step < num_nodes; step++)
+	{
+		uint32_t i = direction ? step : (num_nodes - step - 1);
+		uint32_t old_parent = CT_TREE_NO_NODE;
+		if (merge_tree->nodes[i].degree[direction])
+		{
+			old_parent = merge_tree->arcs[merge_tree->nodes[i].first_arc[direction]];
+		}
+
+		uint32_t new_parent = (old_parent == CT_TREE_NO_NODE) ? CT_TREE_NO_NODE :
+									nearest[old_parent];
+		if (critical[i])
+		{
+			parent[new_index[i]] = new_parent;
+			nearest[i] = new_index[i];
+		}
+		else { nearest[i] = new_parent; }
+	}
+	free(nearest);
+
+	// New indices only move nodes down, so none is overwritten before it has moved:
+	for (uint32_t i = 0; i < num_nodes; i++)
+	{
+		if (critical[i]) { merge_tree->nodes[new_index[i]] = merge_tree->nodes[i]; }
+	}
+
+	free(merge_tree->arcs);
+	free(merge_tree->roots);
+	merge_tree->arcs = NULL;
+	merge_tree->roots = NULL;
+	merge_tree->num_nodes = num_critical;
+	if (ct_merge_tree_set_arcs(merge_tree, parent, direction, &(parent[num_critical]), error))
+	{
+		free(parent);
+		return -1;
+	}
+	free(parent);
+
+	ct_tree_node_t *nodes = realloc(merge_tree->nodes, capacity * sizeof(ct_tree_node_t));
+	if (!nodes)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not reallocate memory for tree nodes.");
+		return -1;
+	}
+	merge_tree->nodes = nodes;
 
-	ct_disjoint_set_free(&disjoint_set_split);
-	ct_disjoint_set_free(&disjoint_set_join);
 	return 0;
 }
 
@@ -469,7 +882,8 @@ int ct_contour_tree_construct(ct_tree_t *contour_tree, ct_tree_t *join_tree,
 	 * Contour tree arc and root setup *
 	 ***********************************/
 
-	contour_tree->num_arcs = join_tree->num_arcs;
+	// Isolated nodes leave no arcs at all, and malloc(0) may give NULL:
+	contour_tree->num_arcs = join_tree->num_arcs ? join_tree->num_arcs : 1;
 	contour_tree->arcs = malloc(contour_tree->num_arcs * 2 * sizeof(uint32_t));
 	if (!contour_tree->arcs)
 	{
@@ -494,18 +908,44 @@ int ct_contour_tree_construct(ct_tree_t *contour_tree, ct_tree_t *join_tree,
 	 * Contour tree construction *
 	 *****************************/
 
-	// Create leaf queue:
-	uint32_t num_leaves = 0;
-	uint32_t first_leaf = 0;
-	uint32_t *leaf_queue = malloc(contour_tree->num_nodes * sizeof(uint32_t));
-	if (!leaf_queue)
+	/* Leaves are peeled off working copies of the merge trees, so the trees themselves are
+	 * left as they were. Each node keeps its parent (down in the join tree, up in the split
+	 * tree) and the number of its children. Removing a node only marks it, and finding a
+	 * parent skips marked nodes, shortening the path as it goes. A removed leaf takes one
+	 * child from its parent, and a removed regular node hands its child straight on: */
+	uint32_t num_nodes = contour_tree->num_nodes;
+	uint32_t *parents = malloc(num_nodes * 5 * sizeof(uint32_t));
+	uint8_t *removed = malloc(num_nodes * sizeof(uint8_t));
+	if (!parents || !removed)
 	{
-		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for leaf queue.");
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for contour tree construction.");
+		free(parents);
+		free(removed);
 		return -1;
 	}
-	for (uint32_t i = 0; i < contour_tree->num_nodes; i++)
+	uint32_t *parent[2] = { parents, &(parents[num_nodes]) }; // Join[0], split[1].
+	uint32_t *num_children[2] = { &(parents[num_nodes * 2]), &(parents[num_nodes * 3]) };
+	uint32_t *leaf_queue = &(parents[num_nodes * 4]);
+
+	#pragma omp parallel for if (num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < num_nodes; i++)
 	{
-		if ((join_tree->nodes[i].degree[0] + split_tree->nodes[i].degree[1]) == 1)
+		parent[0][i] = join_tree->nodes[i].degree[1] ?
+			join_tree->arcs[join_tree->nodes[i].first_arc[1]] : CT_TREE_NO_NODE;
+		parent[1][i] = split_tree->nodes[i].degree[0] ?
+			split_tree->arcs[split_tree->nodes[i].first_arc[0]] : CT_TREE_NO_NODE;
+		num_children[0][i] = join_tree->nodes[i].degree[0];
+		num_children[1][i] = split_tree->nodes[i].degree[1];
+		removed[i] = 0;
+	}
+
+	// Create leaf queue:
+	uint32_t num_leaves = 0;
+	uint32_t first_leaf = 0;
+	for (uint32_t i = 0; i < num_nodes; i++)
+	{
+		if ((num_children[0][i] + num_children[1][i]) == 1)
 		{
 			leaf_queue[num_leaves] = i;
 			num_leaves++;
@@ -522,15 +962,12 @@ int ct_contour_tree_construct(ct_tree_t *contour_tree, ct_tree_t *join_tree,
 		num_leaves--;
 
 		// Meshes with multiple disconnected components need this:
-		if (!join_tree->nodes[leaf].degree[0] && !split_tree->nodes[leaf].degree[1])
-		{
-			continue;
-		}
+		if (!num_children[0][leaf] && !num_children[1][leaf]) { continue; }
 
 		// Add arc to contour tree:
-		if (!join_tree->nodes[leaf].degree[0]) // Upper leaf.
+		if (!num_children[0][leaf]) // Upper leaf.
 		{
-			node = join_tree->arcs[join_tree->nodes[leaf].first_arc[1]];
+			node = ct_contour_tree_find_parent(parent[0], removed, leaf);
 
 			contour_tree->arcs[contour_tree->nodes[leaf].first_arc[1] +
 				contour_tree->nodes[leaf].degree[1]] = node;
@@ -544,7 +981,7 @@ int ct_contour_tree_construct(ct_tree_t *contour_tree, ct_tree_t *join_tree,
 		}
 		else // Lower leaf.
 		{
-			node = split_tree->arcs[split_tree->nodes[leaf].first_arc[0]];
+			node = ct_contour_tree_find_parent(parent[1], removed, leaf);
 
 			contour_tree->arcs[contour_tree->nodes[leaf].first_arc[0] +
 				contour_tree->nodes[leaf].degree[0]] = node;
@@ -558,18 +995,24 @@ int ct_contour_tree_construct(ct_tree_t *contour_tree, ct_tree_t *join_tree,
 		}
 
 		// Remove leaf from both trees:
-		ct_tree_remove_node(join_tree, leaf);
-		ct_tree_remove_node(split_tree, leaf);
+		for (uint8_t t = 0; t < 2; t++)
+		{
+			if (num_children[t][leaf]) { continue; }
+			uint32_t other = ct_contour_tree_find_parent(parent[t], removed, leaf);
+			if (other != CT_TREE_NO_NODE) { num_children[t][other]--; }
+		}
+		removed[leaf] = 1;
 
 		// Check if connected node is now a leaf:
-		if ((join_tree->nodes[node].degree[0] + split_tree->nodes[node].degree[1]) == 1)
+		if ((num_children[0][node] + num_children[1][node]) == 1)
 		{
 			leaf_queue[first_leaf + num_leaves] = node;
 			num_leaves++;
 		}
 	}
 
-	free(leaf_queue);
+	free(parents);
+	free(removed);
 
 	if (contour_tree->num_arcs != join_tree->num_arcs)
 	{
@@ -582,133 +1025,42 @@ int ct_contour_tree_construct(ct_tree_t *contour_tree, ct_tree_t *join_tree,
 	return 0;
 }
 
-void ct_tree_remove_node(ct_tree_t *tree, uint32_t node)
-{
-	if ((tree->nodes[node].degree[0] > 1) ||
-		(tree->nodes[node].degree[1] > 1))
-	{
-		#ifdef CT_DEBUG
-		printf("Trying to remove a saddle: %u\n", node);
-		#endif
-		return;
-	}
-	if (!tree->nodes[node].degree[0] && !tree->nodes[node].degree[1])
-	{
-		#ifdef CT_DEBUG
-		printf("Trying to remove a null node: %u\n", node);
-		#endif
-		return;
-	}
-
-	int direction = -1;
-	if (!tree->nodes[node].degree[1])
-	{
-		// Lower leaf:
-		direction = 0;
-	}
-	else if (!tree->nodes[node].degree[0])
-	{
-		// Upper leaf:
-		direction = 1;
-	}
-
-	if (direction != -1)
-	{
-		// Process leaf node:
-		uint32_t other = tree->arcs[tree->nodes[node].first_arc[direction]];
-		int found = 0;
-		for (uint32_t i = 0; i < tree->nodes[other].degree[!direction]; i++)
-		{
-			if (tree->arcs[tree->nodes[other].first_arc[!direction] + i] == node)
-			{
-				// Swap arc with last one:
-				found = 1;
-				uint32_t arc = tree->arcs[tree->nodes[other].first_arc[!direction] +
-							tree->nodes[other].degree[!direction] - 1];
-				tree->arcs[tree->nodes[other].first_arc[!direction] +
-					tree->nodes[other].degree[!direction] - 1] = node;
-				tree->arcs[tree->nodes[other].first_arc[!direction] + i] = arc;
-				tree->nodes[other].degree[!direction]--;
-				break;
-			}
-		}
-		tree->nodes[node].degree[direction]--;
-		if (!found)
-		{
-			#ifdef CT_DEBUG
-			printf("\nLeaf not attached to anything: %u\n", node);
-			printf("Node:\t%u,\tDegree: (%u, %u)\n", node,
-				tree->nodes[node].degree[0], tree->nodes[node].degree[1]);
-			printf("Other:\t%u,\tDegree: (%u, %u)\n", other,
-				tree->nodes[other].degree[0], tree->nodes[other].degree[1]);
-			#endif
-			return;
-		}
-	}
-	else
-	{
-		// Process regular node:
-		uint32_t others[4]; // Higher node + arc, lower node + arc.
-		for (int direction = 0; direction < 2; direction++)
-		{
-			uint32_t other = tree->arcs[tree->nodes[node].first_arc[direction]];
-			uint32_t arc;
-			others[direction * 2] = other;
-			int found = 0;
-			for (uint32_t i = 0; i < tree->nodes[other].degree[!direction]; i++)
-			{
-				if (tree->arcs[tree->nodes[other].first_arc[!direction] + i] == node)
-				{
-					found = 1;
-					arc = tree->nodes[other].first_arc[!direction] + i;
-					break;
-				}
-			}
-			if (!found)
-			{
-				#ifdef CT_DEBUG
-				printf("\nNode not attached to anything: %u\n", node);
-				printf("Node:\t%u,\tDegree: (%u, %u)\n", node,
-					tree->nodes[node].degree[0], tree->nodes[node].degree[1]);
-				printf("Other:\t%u,\tDegree: (%u, %u)\n", other,
-					tree->nodes[other].degree[0], tree->nodes[other].degree[1]);
-				#endif
-				return;
-			}
-			others[(direction * 2) + 1] = arc;
-		}
-		// Connect lower and higher nodes:
-		tree->arcs[others[1]] = others[2];
-		tree->arcs[others[3]] = others[0];
-		tree->nodes[node].degree[0]--;
-		tree->nodes[node].degree[1]--;
-	}
-}
-
-int ct_index_compare_join(uint32_t left, uint32_t right)
-{
-	return (left > right);
-}
-
-int ct_index_compare_split(uint32_t left, uint32_t right)
-{
-	return (left < right);
-}
-
-int ct_index_increment_join(uint32_t *index, uint32_t limit)
-{
-	if (*index == limit) { return 0; }
-	*index -= 1;
-	return 1;
-}
-
-int ct_index_increment_split(uint32_t *index, uint32_t limit)
+uint32_t ct_contour_tree_find_parent(uint32_t *parent, uint8_t *removed, uint32_t node)
 {
-	*index += 1;
-	if (*index == limit) { return 0; }
-	return 1;
+	// Nearest parent not yet removed, or CT_TREE_NO_NODE. Skipped nodes are split off:
+	while (1)
+	{
+		uint32_t next = parent[node];
+		if ((next == CT_TREE_NO_NODE) || !removed[next]) { return next; }
+		parent[node] = parent[next];
+		node = next;
+	}
 }
 
+/*****************
+ * Sweep kernels *
+ *****************/
+
+#define CT_SWEEP_NAME ct_merge_tree_sweep_join_mesh
+#define CT_SWEEP_DIRECTION 1
+#define CT_SWEEP_GRID 0
+#include "Merge-Tree-Sweep.h"
+
+#define CT_SWEEP_NAME ct_merge_tree_sweep_split_mesh
+#define CT_SWEEP_DIRECTION 0
+#define CT_SWEEP_GRID 0
+#include "Merge-Tree-Sweep.h"
+
+#define CT_SWEEP_NAME ct_merge_tree_sweep_join_grid
+#define CT_SWEEP_DIRECTION 1
+#define CT_SWEEP_GRID 1
+#include "Merge-Tree-Sweep.h"
+
+#define CT_SWEEP_NAME ct_merge_tree_sweep_split_grid
+#define CT_SWEEP_DIRECTION 0
+#define CT_SWEEP_GRID 1
+#include "Merge-Tree-Sweep.h"
+
 /********************
  * Scalar functions *
  ********************/
@@ -806,25 +1158,89 @@ int ct_tree_scalar_function_z(ct_tree_t *tree, ct_mesh_t *mesh, char error[NM_MA
 	return 0;
 }
 
+int ct_tree_scalar_function_volume(ct_tree_t *tree, ct_mesh_t *mesh,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	// Voxel values, with voxel indices (see ct_get_voxel_index) as the vertices:
+	uint64_t num_voxels = ct_volume_get_num_voxels(&(mesh->volume));
+	if (!mesh->volume.scalars || !num_voxels)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Mesh \"%s\" has no volume.", mesh->name);
+		return -1;
+	}
+	if (num_voxels >= UINT32_MAX)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Volume for mesh \"%s\" has too many voxels for a tree.", mesh->name);
+		return -1;
+	}
+
+	ct_tree_free(tree);
+	tree->num_nodes = num_voxels;
+	tree->nodes = malloc(tree->num_nodes * sizeof(ct_tree_node_t));
+	if (!tree->nodes)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for tree nodes.");
+		return -1;
+	}
+	memset(tree->nodes, 0, tree->num_nodes * sizeof(ct_tree_node_t));
+
+	#pragma omp parallel for if (tree->num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < tree->num_nodes; i++)
+	{
+		tree->nodes[i].node_to_vertex = i;
+		tree->nodes[i].value = ct_volume_get_value(&(mesh->volume), i);
+	}
+
+	qsort(tree->nodes, tree->num_nodes, sizeof(tree->nodes[0]), ct_tree_nodes_qsort_compare);
+
+	// Create 2-way mapping between vertices and nodes:
+	for (uint32_t i = 0; i < tree->num_nodes; i++)
+	{
+		tree->nodes[tree->nodes[i].node_to_vertex].vertex_to_node = i;
+	}
+
+	return 0;
+}
+
+char *ct_tree_scalar_function_name(int (*scalar_function)(ct_tree_t *tree, ct_mesh_t *mesh,
+						char error[NM_MAX_ERROR_LENGTH]))
+{
+	// Stable identity for caching, as function addresses change between runs:
+	if (scalar_function == ct_tree_scalar_function_x) { return "x"; }
+	if (scalar_function == ct_tree_scalar_function_y) { return "y"; }
+	if (scalar_function == ct_tree_scalar_function_z) { return "z"; }
+	if (scalar_function == ct_tree_scalar_function_volume) { return "volume"; }
+	return NULL;
+}
+
+void ct_tree_get_vertex_values(ct_tree_t *tree, float *values)
+{
+	// Needs the full node set from ct_tree_scalar_function_<X>, as reduction drops vertices:
+	#pragma omp parallel for if (tree->num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < tree->num_nodes; i++)
+	{
+		values[i] = tree->nodes[tree->nodes[i].vertex_to_node].value;
+	}
+}
+
 /*****************
  * Disjoint sets *
  *****************/
 
 int ct_disjoint_set_allocate(ct_disjoint_set_t *disjoint_set, char error[NM_MAX_ERROR_LENGTH])
 {
-	disjoint_set->parent = malloc(disjoint_set->num_elements * sizeof(uint32_t));
-	disjoint_set->rank = malloc(disjoint_set->num_elements * sizeof(uint32_t));
-	disjoint_set->extremum = malloc(disjoint_set->num_elements * sizeof(uint32_t));
-	if (!disjoint_set->parent || !disjoint_set->rank || !disjoint_set->extremum)
+	disjoint_set->parent = malloc(disjoint_set->num_elements * 2 * sizeof(uint32_t));
+	if (!disjoint_set->parent)
 	{
 		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for disjoint set.");
 		return -1;
 	}
+	disjoint_set->extremum = &(disjoint_set->parent[disjoint_set->num_elements]);
 
 	for (uint32_t i = 0; i < disjoint_set->num_elements; i++)
 	{
 		disjoint_set->parent[i] = i;
-		disjoint_set->rank[i] = 0;
 		disjoint_set->extremum[i] = i;
 	}
 
@@ -837,51 +1253,49 @@ void ct_disjoint_set_free(ct_disjoint_set_t *disjoint_set)
 	{
 		free(disjoint_set->parent);
 		disjoint_set->parent = NULL;
-	}
-
-	if (disjoint_set->rank)
-	{
-		free(disjoint_set->rank);
-		disjoint_set->rank = NULL;
-	}
-
-	if (disjoint_set->extremum)
-	{
-		free(disjoint_set->extremum);
 		disjoint_set->extremum = NULL;
 	}
 }
 
-void ct_disjoint_set_union(uint32_t v1, uint32_t v2, ct_disjoint_set_t *disjoint_set)
+uint32_t ct_disjoint_set_union(uint32_t v1, uint32_t v2, ct_disjoint_set_t *disjoint_set)
 {
 	uint32_t v1_root = ct_disjoint_set_find(v1, disjoint_set);
 	uint32_t v2_root = ct_disjoint_set_find(v2, disjoint_set);
 
-	if (v1_root == v2_root) { return; }
+	if (v1_root == v2_root) { return v1_root; }
+	return ct_disjoint_set_link(v1_root, v2_root, disjoint_set);
+}
 
-	if (disjoint_set->rank[v1_root] < disjoint_set->rank[v2_root])
-	{
-		disjoint_set->parent[v1_root] = v2_root;
-	}
-	else if (disjoint_set->rank[v1_root] > disjoint_set->rank[v2_root])
-	{
-		disjoint_set->parent[v2_root] = v1_root;
-	}
-	else
+uint32_t ct_disjoint_set_link(uint32_t root, uint32_t other_root, ct_disjoint_set_t *disjoint_set)
+{
+	/* Linking by a scrambled index stands in for rank, so no rank array is needed and trees
+	 * stay shallow in expectation whatever order the sweep visits them in. Returns the root
+	 * of the joined set: */
+	if (ct_disjoint_set_has_priority(root, other_root))
 	{
-		disjoint_set->parent[v2_root] = v1_root;
-		disjoint_set->rank[v1_root]++;
+		disjoint_set->parent[other_root] = root;
+		return root;
 	}
+	disjoint_set->parent[root] = other_root;
+	return other_root;
 }
 
 uint32_t ct_disjoint_set_find(uint32_t v, ct_disjoint_set_t *disjoint_set)
 {
-	uint32_t root = disjoint_set->parent[v];
-	if (disjoint_set->parent[root] != root)
+	// Path halving, which needs no recursion or second pass:
+	uint32_t *parent = disjoint_set->parent;
+	while (parent[v] != v)
 	{
-		return disjoint_set->parent[v] = ct_disjoint_set_find(root, disjoint_set);
+		parent[v] = parent[parent[v]];
+		v = parent[v];
 	}
-	return root;
+	return v;
+}
+
+int ct_disjoint_set_has_priority(uint32_t v1, uint32_t v2)
+{
+	// Whether v1 stays the root when linked with v2:
+	return (uint32_t)(v1 * CT_DISJOINT_SET_PRIORITY) < (uint32_t)(v2 * CT_DISJOINT_SET_PRIORITY);
 }
 
 #ifdef CT_DEBUG
@@ -1085,4 +1499,515 @@ void ct_tree_print_test_case(FILE *file, ct_tree_t *tree)
 	}
 	if (tree->num_roots) { fprintf(file, "\n"); }
 }
+
+int ct_merge_tree_compare(ct_tree_t *reference, ct_tree_t *other, uint8_t direction,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Trees on the same nodes, which for reduced trees have to be checked too. Each node has
+	 * at most one arc towards the roots, so comparing those is enough: */
+	if (reference->num_nodes != other->num_nodes)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Merge trees have %u and %u nodes.",
+						reference->num_nodes, other->num_nodes);
+		return -1;
+	}
+
+	uint32_t num_different = (reference->num_roots != other->num_roots);
+	for (uint32_t i = 0; i < reference->num_nodes; i++)
+	{
+		ct_tree_node_t *reference_node = &(reference->nodes[i]);
+		ct_tree_node_t *other_node = &(other->nodes[i]);
+		if ((reference_node->node_to_vertex != other_node->node_to_vertex) ||
+			(reference_node->degree[0] != other_node->degree[0]) ||
+			(reference_node->degree[1] != other_node->degree[1]) ||
+			(reference_node->degree[direction] && (reference->arcs[reference_node->
+			first_arc[direction]] != other->arcs[other_node->first_arc[direction]])))
+		{
+			num_different++;
+		}
+	}
+
+	if (num_different)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "%s trees differ at %u nodes.",
+				direction ? "Join" : "Split", num_different);
+		return -1;
+	}
+	return 0;
+}
+
+int ct_merge_tree_benchmark(FILE *file, ct_tree_t *tree, ct_mesh_t *mesh,
+					char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Times both specialised sweep kernels for this mesh against the generic reference
+	 * kernel, each on a fresh copy of the sorted nodes, and checks they build the same tree: */
+	uint8_t grid = (!mesh->edges && mesh->volume.scalars);
+	char *directions[2] = { "split", "join" };
+	for (int direction = 0; direction < 2; direction++)
+	{
+		ct_tree_t copies[2] = { {0}, {0} }; // Specialised, then reference.
+		uint64_t num_visits[2] = { 0, 0 };
+		double times[2] = { 0.0, 0.0 };
+		int status = ct_merge_tree_benchmark_kernel(tree, &(copies[0]), mesh, direction, 0,
+							&(num_visits[0]), &(times[0]), error) ||
+			ct_merge_tree_benchmark_kernel(tree, &(copies[1]), mesh, direction, 1,
+							&(num_visits[1]), &(times[1]), error);
+		if (status)
+		{
+			ct_tree_free(&(copies[0]));
+			ct_tree_free(&(copies[1]));
+			return -1;
+		}
+
+		int differ = ct_merge_tree_compare(&(copies[1]), &(copies[0]), direction, error);
+		if (!differ && (num_visits[0] != num_visits[1]))
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "Sweep kernels visited %llu and %llu "
+				"neighbours.", (unsigned long long)num_visits[0],
+						(unsigned long long)num_visits[1]);
+			differ = 1;
+		}
+
+		fprintf(file, "%s %s sweep: %llu neighbours in %.3f ms (%.2f ns per neighbour), "
+			"reference %.3f ms (%.2f ns per neighbour), %s.\n", directions[direction],
+			grid ? "grid" : "mesh", (unsigned long long)num_visits[0], times[0] * 1000.0,
+			num_visits[0] ? ((times[0] * 1e9) / num_visits[0]) : 0.0, times[1] * 1000.0,
+			num_visits[1] ? ((times[1] * 1e9) / num_visits[1]) : 0.0,
+			differ ? "trees differ" : "trees match");
+
+		ct_tree_free(&(copies[0]));
+		ct_tree_free(&(copies[1]));
+		if (differ) { return -1; }
+	}
+
+	return 0;
+}
+
+int ct_merge_tree_critical_benchmark(FILE *file, ct_tree_t *tree, ct_mesh_t *mesh,
+					char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Times the critical-only sweeps and their augmentation against the full sweeps and
+	 * their reduction, on fresh copies of the sorted nodes. Both give the trees the contour
+	 * tree is built from, so those have to match: */
+	ct_tree_t trees[4] = { {0}, {0}, {0}, {0} }; // Join and split swept, then critical.
+	uint32_t *arc_maps[2] = { NULL, NULL };
+	int status = 0;
+	for (int i = 0; (i < 4) && !status; i++)
+	{
+		status = ct_tree_copy_nodes(tree, &(trees[i]), error);
+	}
+	for (int i = 0; (i < 2) && !status; i++)
+	{
+		arc_maps[i] = malloc(tree->num_nodes * sizeof(uint32_t));
+		if (!arc_maps[i])
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate benchmark memory.");
+			status = -1;
+		}
+	}
+
+	double sweep_time = omp_get_wtime();
+	status = status || ct_merge_tree_construct(&(trees[0]), mesh, tree->num_nodes - 1, error) ||
+		ct_merge_tree_construct(&(trees[1]), mesh, 0, error) ||
+		ct_merge_trees_reduce_to_critical(&(trees[0]), &(trees[1]), error);
+	sweep_time = omp_get_wtime() - sweep_time;
+
+	double critical_time = omp_get_wtime();
+	status = status || ct_merge_tree_construct_critical(&(trees[2]), mesh,
+					tree->num_nodes - 1, arc_maps[0], error) ||
+		ct_merge_tree_construct_critical(&(trees[3]), mesh, 0, arc_maps[1], error) ||
+		ct_merge_trees_augment(&(trees[2]), &(trees[3]), arc_maps[0], arc_maps[1], error);
+	critical_time = omp_get_wtime() - critical_time;
+
+	int differ = 0;
+	if (!status)
+	{
+		differ = ct_merge_tree_compare(&(trees[0]), &(trees[2]), 1, error) ||
+			ct_merge_tree_compare(&(trees[1]), &(trees[3]), 0, error);
+		fprintf(file, "Critical-only sweeps: %u of %u nodes in %.3f ms with augmentation "
+			"(full sweeps and reduction %.3f ms), %s.\n", trees[2].num_nodes,
+			tree->num_nodes, critical_time * 1000.0, sweep_time * 1000.0,
+			differ ? "trees differ" : "trees match");
+	}
+
+	for (int i = 0; i < 4; i++) { ct_tree_free(&(trees[i])); }
+	free(arc_maps[0]);
+	free(arc_maps[1]);
+	return (status || differ) ? -1 : 0;
+}
+
+int ct_merge_tree_benchmark_kernel(ct_tree_t *tree, ct_tree_t *copy, ct_mesh_t *mesh,
+	uint8_t direction, uint8_t reference, uint64_t *num_visits, double *time,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	// One sweep kernel on a fresh copy of the sorted nodes, which keeps its arcs:
+	uint8_t grid = (!mesh->edges && mesh->volume.scalars);
+	if (ct_tree_copy_nodes(tree, copy, error)) { return -1; }
+	for (uint32_t i = 0; i < copy->num_nodes; i++)
+	{
+		memset(copy->nodes[i].degree, 0, sizeof(copy->nodes[i].degree));
+		memset(copy->nodes[i].first_arc, 0, sizeof(copy->nodes[i].first_arc));
+	}
+
+	ct_disjoint_set_t disjoint_set = {0};
+	disjoint_set.num_elements = copy->num_nodes;
+	copy->arcs = malloc(copy->num_nodes * 2 * sizeof(uint32_t));
+	if (!copy->arcs || ct_disjoint_set_allocate(&disjoint_set, error))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate benchmark memory.");
+		ct_disjoint_set_free(&disjoint_set);
+		return -1;
+	}
+
+	*time = omp_get_wtime();
+	if (reference)
+	{
+		*num_visits = ct_merge_tree_sweep_reference(copy, mesh, &disjoint_set, direction);
+	}
+	else if (direction && grid)
+	{
+		*num_visits = ct_merge_tree_sweep_join_grid(copy, mesh, &disjoint_set);
+	}
+	else if (direction)
+	{
+		*num_visits = ct_merge_tree_sweep_join_mesh(copy, mesh, &disjoint_set);
+	}
+	else if (grid)
+	{
+		*num_visits = ct_merge_tree_sweep_split_grid(copy, mesh, &disjoint_set);
+	}
+	else { *num_visits = ct_merge_tree_sweep_split_mesh(copy, mesh, &disjoint_set); }
+	*time = omp_get_wtime() - *time;
+
+	ct_disjoint_set_free(&disjoint_set);
+	return 0;
+}
+
+uint64_t ct_merge_tree_sweep_reference(ct_tree_t *merge_tree, ct_mesh_t *mesh,
+				ct_disjoint_set_t *disjoint_set, uint8_t direction)
+{
+	/* The sweep as it was before the kernels were specialised: one loop for both directions
+	 * and neighbour sources, stepping and comparing nodes through function pointers. It is
+	 * kept to check the kernels against and to time what specialising them saves: */
+	uint8_t grid = (!mesh->edges && mesh->volume.scalars);
+	uint32_t i = direction ? (merge_tree->num_nodes - 1) : 0;
+	uint32_t index_limit = direction ? 0 : merge_tree->num_nodes;
+	int (*index_compare)(uint32_t left, uint32_t right) = direction ?
+				ct_index_compare_join : ct_index_compare_split;
+	int (*index_increment)(uint32_t *index, uint32_t limit) = direction ?
+				ct_index_increment_join : ct_index_increment_split;
+
+	uint32_t current_arc[2] = { 0, merge_tree->num_nodes - 1 }; // Up[0], down[1].
+	uint32_t current_edge;
+	uint32_t current_vertex;
+	uint32_t adjacent_vertex;
+	uint32_t adjacent_node;
+	uint32_t previous_adjacent_vertex;
+	uint32_t component;
+	uint32_t num_neighbours;
+	uint32_t neighbours[CT_GRID_MAX_NEIGHBOURS];
+	uint64_t num_visits = 0;
+	while (1)
+	{
+		merge_tree->nodes[i].first_arc[!direction] = current_arc[!direction];
+		current_vertex = merge_tree->nodes[i].node_to_vertex;
+		component = i;
+		if (grid)
+		{
+			num_neighbours = ct_volume_get_neighbours(&(mesh->volume), current_vertex,
+									neighbours);
+			num_visits += num_neighbours;
+			for (uint32_t j = 0; j < num_neighbours; j++)
+			{
+				adjacent_node = merge_tree->nodes[neighbours[j]].vertex_to_node;
+				if (index_compare(adjacent_node, i))
+				{
+					component = ct_merge_tree_add_arc(merge_tree, disjoint_set, i,
+						component, adjacent_node, current_arc, direction);
+				}
+			}
+		}
+		else
+		{
+			current_edge = mesh->first_edge[current_vertex];
+			adjacent_vertex = current_vertex;
+			while (1)
+			{
+				previous_adjacent_vertex = adjacent_vertex;
+				if (mesh->edges[current_edge].from == current_vertex)
+				{
+					adjacent_vertex = mesh->edges[current_edge].to;
+				}
+				else { adjacent_vertex = mesh->edges[current_edge].from; }
+				num_visits++;
+
+				adjacent_node = merge_tree->nodes[adjacent_vertex].vertex_to_node;
+				if ((adjacent_vertex != previous_adjacent_vertex) &&
+					index_compare(adjacent_node, i))
+				{
+					component = ct_merge_tree_add_arc(merge_tree, disjoint_set, i,
+						component, adjacent_node, current_arc, direction);
+				}
+
+				current_edge = ct_mesh_get_next_vertex_edge(mesh, current_vertex,
+										current_edge);
+				if ((current_edge == UINT32_MAX) ||
+					(mesh->edges[current_edge].other_half ==
+					mesh->first_edge[current_vertex]))
+				{
+					break;
+				}
+			}
+		}
+		if (!index_increment(&i, index_limit)) { break; }
+	}
+
+	return num_visits;
+}
+
+int ct_index_compare_join(uint32_t left, uint32_t right)
+{
+	return (left > right);
+}
+
+int ct_index_compare_split(uint32_t left, uint32_t right)
+{
+	return (left < right);
+}
+
+int ct_index_increment_join(uint32_t *index, uint32_t limit)
+{
+	if (*index == limit) { return 0; }
+	*index -= 1;
+	return 1;
+}
+
+int ct_index_increment_split(uint32_t *index, uint32_t limit)
+{
+	*index += 1;
+	if (*index == limit) { return 0; }
+	return 1;
+}
+
+int ct_contour_tree_benchmark(FILE *file, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Times contour tree construction on a star: one saddle with as many minima below it as
+	 * maxima above, as noisy fields give. Each tree then has a saddle of that degree, which
+	 * made peeling quadratic while removing a leaf meant searching the saddle's arcs. Time
+	 * per node should stay flat as the degree grows: */
+	for (uint32_t degree = 1024; degree <= 1048576; degree *= 4)
+	{
+		uint32_t num_nodes = (degree * 2) + 1;
+		ct_tree_t join_tree = {0};
+		ct_tree_t split_tree = {0};
+		ct_tree_t contour_tree = {0};
+		join_tree.num_nodes = split_tree.num_nodes = num_nodes;
+		join_tree.nodes = malloc(num_nodes * sizeof(ct_tree_node_t));
+		split_tree.nodes = malloc(num_nodes * sizeof(ct_tree_node_t));
+		uint32_t *parent = malloc(num_nodes * 2 * sizeof(uint32_t));
+		if (!join_tree.nodes || !split_tree.nodes || !parent)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate benchmark memory.");
+			ct_tree_free(&join_tree);
+			ct_tree_free(&split_tree);
+			free(parent);
+			return -1;
+		}
+
+		for (uint32_t i = 0; i < num_nodes; i++)
+		{
+			join_tree.nodes[i].value = (float)i;
+			join_tree.nodes[i].node_to_vertex = i;
+			join_tree.nodes[i].vertex_to_node = i;
+			split_tree.nodes[i] = join_tree.nodes[i];
+		}
+
+		// Extrema on the far side of the saddle are reached one by one, in a chain:
+		for (uint32_t i = 0; i < num_nodes; i++)
+		{
+			if (i > degree) { parent[i] = degree; }
+			else { parent[i] = i ? (i - 1) : CT_TREE_NO_NODE; }
+		}
+		int status = ct_merge_tree_set_arcs(&join_tree, parent, 1, &(parent[num_nodes]),
+										error);
+		for (uint32_t i = 0; (i < num_nodes) && !status; i++)
+		{
+			if (i < degree) { parent[i] = degree; }
+			else { parent[i] = (i < (num_nodes - 1)) ? (i + 1) : CT_TREE_NO_NODE; }
+		}
+		if (!status)
+		{
+			status = ct_merge_tree_set_arcs(&split_tree, parent, 0,
+							&(parent[num_nodes]), error);
+		}
+		free(parent);
+
+		double time = omp_get_wtime();
+		if (!status)
+		{
+			status = ct_contour_tree_construct(&contour_tree, &join_tree, &split_tree,
+										error);
+		}
+		time = omp_get_wtime() - time;
+		if (!status && (contour_tree.nodes[degree].degree[0] != degree))
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "Contour tree benchmark saddle has %u arcs "
+				"up, expected %u.", contour_tree.nodes[degree].degree[0], degree);
+			status = -1;
+		}
+
+		ct_tree_free(&contour_tree);
+		ct_tree_free(&split_tree);
+		ct_tree_free(&join_tree);
+		if (status) { return -1; }
+
+		fprintf(file, "Contour tree, saddle degree %u: %u nodes in %.3f ms (%.1f ns per "
+			"node).\n", degree, num_nodes, time * 1000.0, (time * 1e9) / num_nodes);
+	}
+
+	return 0;
+}
+
+uint32_t ct_disjoint_set_find_recursive(uint32_t v, uint32_t *parent)
+{
+	// The original find, with full path compression by recursion:
+	uint32_t root = parent[v];
+	if (parent[root] != root) { return parent[v] = ct_disjoint_set_find_recursive(root, parent); }
+	return root;
+}
+
+#define CT_REPLAY_NAME ct_disjoint_set_replay_baseline
+#define CT_REPLAY_FIND 0
+#define CT_REPLAY_LINK 0
+#define CT_REPLAY_INTERLEAVED 0
+#define CT_REPLAY_CACHE 0
+#include "Disjoint-Set-Replay.h"
+
+#define CT_REPLAY_NAME ct_disjoint_set_replay_halving_rank
+#define CT_REPLAY_FIND 1
+#define CT_REPLAY_LINK 0
+#define CT_REPLAY_INTERLEAVED 0
+#define CT_REPLAY_CACHE 1
+#include "Disjoint-Set-Replay.h"
+
+#define CT_REPLAY_NAME ct_disjoint_set_replay_halving_priority
+#define CT_REPLAY_FIND 1
+#define CT_REPLAY_LINK 1
+#define CT_REPLAY_INTERLEAVED 0
+#define CT_REPLAY_CACHE 1
+#include "Disjoint-Set-Replay.h"
+
+#define CT_REPLAY_NAME ct_disjoint_set_replay_halving_index
+#define CT_REPLAY_FIND 1
+#define CT_REPLAY_LINK 2
+#define CT_REPLAY_INTERLEAVED 0
+#define CT_REPLAY_CACHE 1
+#include "Disjoint-Set-Replay.h"
+
+#define CT_REPLAY_NAME ct_disjoint_set_replay_splitting_priority
+#define CT_REPLAY_FIND 2
+#define CT_REPLAY_LINK 1
+#define CT_REPLAY_INTERLEAVED 0
+#define CT_REPLAY_CACHE 1
+#include "Disjoint-Set-Replay.h"
+
+#define CT_REPLAY_NAME ct_disjoint_set_replay_interleaved
+#define CT_REPLAY_FIND 1
+#define CT_REPLAY_LINK 1
+#define CT_REPLAY_INTERLEAVED 1
+#define CT_REPLAY_CACHE 1
+#include "Disjoint-Set-Replay.h"
+
+#define CT_REPLAY_NAME ct_disjoint_set_replay_uncached
+#define CT_REPLAY_FIND 1
+#define CT_REPLAY_LINK 1
+#define CT_REPLAY_INTERLEAVED 0
+#define CT_REPLAY_CACHE 0
+#include "Disjoint-Set-Replay.h"
+
+int ct_disjoint_set_benchmark(FILE *file, ct_tree_t *tree, ct_mesh_t *mesh,
+					char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Records the (node, earlier neighbour) pairs of a join sweep over this mesh, then replays
+	 * them against each disjoint set strategy. Every strategy must add the same arcs: */
+	uint8_t grid = (!mesh->edges && mesh->volume.scalars);
+	uint32_t max_neighbours = CT_GRID_MAX_NEIGHBOURS;
+	uint32_t grid_neighbours[CT_GRID_MAX_NEIGHBOURS];
+	uint64_t num_neighbours = 0;
+	for (uint32_t i = 0; i < tree->num_nodes; i++)
+	{
+		uint32_t vertex = tree->nodes[i].node_to_vertex;
+		uint32_t count;
+		if (grid) { count = ct_volume_get_neighbours(&(mesh->volume), vertex, grid_neighbours); }
+		else { count = ct_mesh_get_vertex_neighbours(mesh, vertex, NULL, 0); }
+		if (count > max_neighbours) { max_neighbours = count; }
+		num_neighbours += count;
+	}
+
+	uint32_t *neighbours = malloc(max_neighbours * sizeof(uint32_t));
+	uint32_t *trace = malloc(num_neighbours * 2 * sizeof(uint32_t));
+	uint32_t *memory = malloc(tree->num_nodes * 3 * sizeof(uint32_t));
+	if (!neighbours || !trace || !memory)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate benchmark memory.");
+		free(neighbours);
+		free(trace);
+		free(memory);
+		return -1;
+	}
+
+	uint64_t num_pairs = 0;
+	for (uint32_t step = 0; step < tree->num_nodes; step++)
+	{
+		uint32_t i = tree->num_nodes - step - 1;
+		uint32_t vertex = tree->nodes[i].node_to_vertex;
+		uint32_t count;
+		if (grid) { count = ct_volume_get_neighbours(&(mesh->volume), vertex, neighbours); }
+		else { count = ct_mesh_get_vertex_neighbours(mesh, vertex, neighbours, max_neighbours); }
+		for (uint32_t j = 0; j < count; j++)
+		{
+			uint32_t adjacent_node = tree->nodes[neighbours[j]].vertex_to_node;
+			if (adjacent_node <= i) { continue; }
+			trace[2 * num_pairs] = i;
+			trace[(2 * num_pairs) + 1] = adjacent_node;
+			num_pairs++;
+		}
+	}
+
+	char *names[7] = { "recursive, rank, no caching", "halving, rank", "halving, priority",
+		"halving, index", "splitting, priority", "halving, priority, interleaved",
+		"halving, priority, no caching" };
+	uint64_t (*replays[7])(uint32_t num_elements, uint32_t *trace, uint64_t num_pairs,
+		uint32_t *memory) = { ct_disjoint_set_replay_baseline,
+		ct_disjoint_set_replay_halving_rank, ct_disjoint_set_replay_halving_priority,
+		ct_disjoint_set_replay_halving_index, ct_disjoint_set_replay_splitting_priority,
+		ct_disjoint_set_replay_interleaved, ct_disjoint_set_replay_uncached };
+
+	fprintf(file, "Disjoint set strategies, %llu join sweep pairs over %u nodes:\n",
+				(unsigned long long)num_pairs, tree->num_nodes);
+	uint64_t expected = replays[0](tree->num_nodes, trace, num_pairs, memory); // Warm up.
+	for (int i = 0; i < 7; i++)
+	{
+		double time = omp_get_wtime();
+		uint64_t checksum = replays[i](tree->num_nodes, trace, num_pairs, memory);
+		time = omp_get_wtime() - time;
+		if (checksum != expected)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH,
+				"Disjoint set strategy \"%s\" added different arcs.", names[i]);
+			free(neighbours);
+			free(trace);
+			free(memory);
+			return -1;
+		}
+
+		fprintf(file, "\t%s: %.3f ms (%.2f ns per pair).\n", names[i], time * 1000.0,
+				num_pairs ? ((time * 1e9) / num_pairs) : 0.0);
+	}
+
+	free(neighbours);
+	free(trace);
+	free(memory);
+	return 0;
+}
 #endif
@@ -6,15 +6,22 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <sys/mman.h>
+
 #include <NM-Config/Config.h>
 
 #include "Mesh.h"
+#include "Parallel.h"
+
+#define CT_NODE_TYPE_REGULAR	0
+#define CT_NODE_TYPE_MINIMUM	1
+#define CT_NODE_TYPE_MAXIMUM	2
+#define CT_NODE_TYPE_SADDLE	3
+
+#define CT_TREE_NO_NODE UINT32_MAX
+#define CT_TREE_INSERTION_SORT_MAX 32 // Longer arc lists are sorted with qsort.
 
-#define CT_NODE_TYPE_DELETED	-1
-#define CT_NODE_TYPE_REGULAR	 0
-#define CT_NODE_TYPE_MINIMUM	 1
-#define CT_NODE_TYPE_MAXIMUM	 2
-#define CT_NODE_TYPE_SADDLE	 3
+#define CT_DISJOINT_SET_PRIORITY 2654435761u // Odd, so scrambling indices is a bijection.
 
 typedef struct
 {
@@ -35,47 +42,79 @@ typedef struct
 
 	uint32_t num_roots;	// One tree per disconnected component in the mesh.
 	uint32_t *roots;	// Allocated during tree construction. Low in join, high in split.
+
+	uint32_t num_vertices;
+	uint32_t *vertex_map;	// Optional, from ct_tree_load. Vertex to node, or CT_TREE_NO_NODE.
+
+	void *mapping;		// Loaded trees may point into a file mapping instead.
+	size_t mapping_size;
 } ct_tree_t;
 
 typedef struct
 {
 	uint32_t num_elements;
-	uint32_t *parent;
-	uint32_t *rank;
-	uint32_t *extremum;	// Lowest in join tree, highest in split tree.
+	uint32_t *parent;	// Roots point to themselves. Owns the allocation.
+	uint32_t *extremum;	// Lowest in join tree, highest in split tree. Follows parent.
 } ct_disjoint_set_t;
 
 // Tree management:
 void ct_tree_free(ct_tree_t *tree);
+int ct_tree_is_mapped(ct_tree_t *tree, void *pointer);
 int8_t ct_tree_get_node_type(ct_tree_node_t *node);
 int ct_tree_node_is_critical(ct_tree_node_t *node);
+uint32_t ct_tree_get_num_arc_slots(ct_tree_t *tree);
 int ct_tree_copy_nodes(ct_tree_t *from, ct_tree_t *to, char error[NM_MAX_ERROR_LENGTH]);
+int ct_tree_copy(ct_tree_t *from, ct_tree_t *to, char error[NM_MAX_ERROR_LENGTH]);
 int ct_tree_nodes_qsort_compare(const void *a, const void *b);
+int ct_tree_arcs_qsort_compare(const void *a, const void *b);
 
 // Tree construction:
 int ct_merge_tree_construct(ct_tree_t *merge_tree, ct_mesh_t *mesh,
 	uint32_t start_index, char error[NM_MAX_ERROR_LENGTH]);
+uint32_t ct_merge_tree_add_arc(ct_tree_t *merge_tree, ct_disjoint_set_t *disjoint_set,
+	uint32_t node, uint32_t component, uint32_t adjacent_node, uint32_t current_arc[2],
+							uint8_t direction);
+int ct_merge_tree_set_arcs(ct_tree_t *merge_tree, uint32_t *parent, uint8_t direction,
+				uint32_t *scratch, char error[NM_MAX_ERROR_LENGTH]);
+int ct_merge_tree_construct_critical(ct_tree_t *merge_tree, ct_mesh_t *mesh,
+	uint32_t start_index, uint32_t *arc_map, char error[NM_MAX_ERROR_LENGTH]);
+int ct_merge_trees_augment(ct_tree_t *join_tree, ct_tree_t *split_tree, uint32_t *join_map,
+				uint32_t *split_map, char error[NM_MAX_ERROR_LENGTH]);
 int ct_merge_trees_reduce_to_critical(ct_tree_t *join_tree, ct_tree_t *split_tree,
 						char error[NM_MAX_ERROR_LENGTH]);
+int ct_merge_tree_compact(ct_tree_t *merge_tree, uint8_t *critical, uint32_t *new_index,
+		uint32_t num_critical, uint8_t direction, char error[NM_MAX_ERROR_LENGTH]);
 int ct_contour_tree_construct(ct_tree_t *contour_tree, ct_tree_t *join_tree,
 	ct_tree_t *split_tree, char error[NM_MAX_ERROR_LENGTH]);
-void ct_tree_remove_node(ct_tree_t *tree, uint32_t node);
-
-int ct_index_compare_join(uint32_t left, uint32_t right);
-int ct_index_compare_split(uint32_t left, uint32_t right);
-int ct_index_increment_join(uint32_t *index, uint32_t limit);
-int ct_index_increment_split(uint32_t *index, uint32_t limit);
+uint32_t ct_contour_tree_find_parent(uint32_t *parent, uint8_t *removed, uint32_t node);
+
+// Sweep kernels (instantiated from Merge-Tree-Sweep.h):
+uint64_t ct_merge_tree_sweep_join_mesh(ct_tree_t *merge_tree, ct_mesh_t *mesh,
+						ct_disjoint_set_t *disjoint_set);
+uint64_t ct_merge_tree_sweep_split_mesh(ct_tree_t *merge_tree, ct_mesh_t *mesh,
+						ct_disjoint_set_t *disjoint_set);
+uint64_t ct_merge_tree_sweep_join_grid(ct_tree_t *merge_tree, ct_mesh_t *mesh,
+						ct_disjoint_set_t *disjoint_set);
+uint64_t ct_merge_tree_sweep_split_grid(ct_tree_t *merge_tree, ct_mesh_t *mesh,
+						ct_disjoint_set_t *disjoint_set);
 
 // Scalar functions:
 int ct_tree_scalar_function_x(ct_tree_t *tree, ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
 int ct_tree_scalar_function_y(ct_tree_t *tree, ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
 int ct_tree_scalar_function_z(ct_tree_t *tree, ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
+int ct_tree_scalar_function_volume(ct_tree_t *tree, ct_mesh_t *mesh,
+						char error[NM_MAX_ERROR_LENGTH]);
+char *ct_tree_scalar_function_name(int (*scalar_function)(ct_tree_t *tree, ct_mesh_t *mesh,
+						char error[NM_MAX_ERROR_LENGTH]));
+void ct_tree_get_vertex_values(ct_tree_t *tree, float *values);
 
 // Disjoint sets:
 int ct_disjoint_set_allocate(ct_disjoint_set_t *disjoint_set, char error[NM_MAX_ERROR_LENGTH]);
 void ct_disjoint_set_free(ct_disjoint_set_t *disjoint_set);
-void ct_disjoint_set_union(uint32_t v1, uint32_t v2, ct_disjoint_set_t *disjoint_set);
+uint32_t ct_disjoint_set_union(uint32_t v1, uint32_t v2, ct_disjoint_set_t *disjoint_set);
+uint32_t ct_disjoint_set_link(uint32_t root, uint32_t other_root, ct_disjoint_set_t *disjoint_set);
 uint32_t ct_disjoint_set_find(uint32_t v, ct_disjoint_set_t *disjoint_set);
+int ct_disjoint_set_has_priority(uint32_t v1, uint32_t v2);
 
 #ifdef CT_DEBUG
 void ct_tree_print_short(FILE *file, ct_tree_t *tree);
@@ -83,6 +122,41 @@ void ct_tree_print(FILE *file, ct_tree_t *tree);
 int ct_tree_build_test_case(ct_tree_t *join_tree, ct_tree_t *split_tree,
 				char error[NM_MAX_ERROR_LENGTH]);
 void ct_tree_print_test_case(FILE *file, ct_tree_t *tree);
+int ct_merge_tree_compare(ct_tree_t *reference, ct_tree_t *other, uint8_t direction,
+						char error[NM_MAX_ERROR_LENGTH]);
+int ct_merge_tree_benchmark(FILE *file, ct_tree_t *tree, ct_mesh_t *mesh,
+					char error[NM_MAX_ERROR_LENGTH]);
+int ct_merge_tree_critical_benchmark(FILE *file, ct_tree_t *tree, ct_mesh_t *mesh,
+					char error[NM_MAX_ERROR_LENGTH]);
+int ct_merge_tree_benchmark_kernel(ct_tree_t *tree, ct_tree_t *copy, ct_mesh_t *mesh,
+	uint8_t direction, uint8_t reference, uint64_t *num_visits, double *time,
+						char error[NM_MAX_ERROR_LENGTH]);
+uint64_t ct_merge_tree_sweep_reference(ct_tree_t *merge_tree, ct_mesh_t *mesh,
+				ct_disjoint_set_t *disjoint_set, uint8_t direction);
+int ct_index_compare_join(uint32_t left, uint32_t right);
+int ct_index_compare_split(uint32_t left, uint32_t right);
+int ct_index_increment_join(uint32_t *index, uint32_t limit);
+int ct_index_increment_split(uint32_t *index, uint32_t limit);
+int ct_contour_tree_benchmark(FILE *file, char error[NM_MAX_ERROR_LENGTH]);
+
+// Disjoint set strategies (instantiated from Disjoint-Set-Replay.h):
+uint32_t ct_disjoint_set_find_recursive(uint32_t v, uint32_t *parent);
+uint64_t ct_disjoint_set_replay_baseline(uint32_t num_elements, uint32_t *trace,
+					uint64_t num_pairs, uint32_t *memory);
+uint64_t ct_disjoint_set_replay_halving_rank(uint32_t num_elements, uint32_t *trace,
+					uint64_t num_pairs, uint32_t *memory);
+uint64_t ct_disjoint_set_replay_halving_priority(uint32_t num_elements, uint32_t *trace,
+					uint64_t num_pairs, uint32_t *memory);
+uint64_t ct_disjoint_set_replay_halving_index(uint32_t num_elements, uint32_t *trace,
+					uint64_t num_pairs, uint32_t *memory);
+uint64_t ct_disjoint_set_replay_splitting_priority(uint32_t num_elements, uint32_t *trace,
+					uint64_t num_pairs, uint32_t *memory);
+uint64_t ct_disjoint_set_replay_interleaved(uint32_t num_elements, uint32_t *trace,
+					uint64_t num_pairs, uint32_t *memory);
+uint64_t ct_disjoint_set_replay_uncached(uint32_t num_elements, uint32_t *trace,
+					uint64_t num_pairs, uint32_t *memory);
+int ct_disjoint_set_benchmark(FILE *file, ct_tree_t *tree, ct_mesh_t *mesh,
+					char error[NM_MAX_ERROR_LENGTH]);
 #endif
 
 #endif
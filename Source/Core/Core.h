@@ -1,8 +1,21 @@
 #ifndef CT_CORE_H
 #define CT_CORE_H
 
+#include "Block-Tree.h"
+#include "Concurrent-Set.h"
 #include "Contour-Tree.h"
+#include "Critical-Points.h"
+#include "Edge-Tree.h"
+#include "Leaf-Growth.h"
 #include "Mesh.h"
 #include "Mesh-Loader.h"
+#include "Parallel.h"
+#include "Persistence.h"
+#include "Region.h"
+#include "Stream.h"
+#include "Streaming-Tree.h"
+#include "Task-Graph.h"
+#include "Tree-Cache.h"
+#include "Tree-File.h"
 
 #endif
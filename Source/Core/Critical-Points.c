@@ -0,0 +1,277 @@
+#include "Critical-Points.h"
+
+/*******************
+ * Critical points *
+ *******************/
+
+/* Classifies every vertex on its own from its link, so needs no sweep and runs in parallel.
+ * The lower link is the part of the link before the vertex in the order the trees use (value,
+ * then vertex index, as ct_tree_nodes_qsort_compare), and the upper link the rest. A vertex
+ * with an empty lower link is a minimum, one with an empty upper link a maximum, and one with
+ * a single component in each is regular. Anything else is a saddle. Upper components meet in the
+ * join tree and lower ones in the split tree, so a saddle has a multiplicity for each (one less
+ * than the components on that side). Link components are kept per vertex as lower[0] and
+ * upper[1]. */
+
+int ct_critical_points_classify(ct_mesh_t *mesh, float *values, uint8_t *link_components,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	uint8_t grid = (!mesh->edges && mesh->volume.scalars);
+	if (!grid && (!mesh->edges || !mesh->is_manifold))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Mesh \"%s\" needs manifold edges to classify critical points.", mesh->name);
+		return -1;
+	}
+
+	uint64_t num_vertices = grid ? ct_volume_get_num_voxels(&(mesh->volume)) :
+								mesh->num_vertices;
+	if (num_vertices >= UINT32_MAX)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Mesh \"%s\" has too many vertices to classify.", mesh->name);
+		return -1;
+	}
+
+	uint32_t adjacency[CT_CRITICAL_POINTS_NUM_OFFSETS];
+	if (grid) { ct_critical_points_get_adjacency(&(mesh->volume), adjacency); }
+
+	#pragma omp parallel for schedule(dynamic, 4096) if (num_vertices > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < num_vertices; i++)
+	{
+		if (grid)
+		{
+			ct_critical_points_classify_voxel(&(mesh->volume), values, i, adjacency,
+								&(link_components[2 * i]));
+		}
+		else
+		{
+			ct_critical_points_classify_vertex(mesh, values, i,
+							&(link_components[2 * i]));
+		}
+	}
+
+	return 0;
+}
+
+void ct_critical_points_classify_vertex(ct_mesh_t *mesh, float *values, uint32_t vertex,
+							uint8_t link_components[2])
+{
+	/* Walks the neighbours in order around the vertex, as ct_mesh_get_vertex_neighbours does,
+	 * so neighbours next to each other share a triangle and each run of lower (or upper)
+	 * neighbours is one link component. Around an interior vertex the walk comes back to
+	 * where it started, and the first and last runs are the same one: */
+	uint32_t num_runs[2] = { 0, 0 };
+	uint8_t first_side = 2;
+	uint8_t side = 2;
+	uint8_t closed = 0;
+	uint32_t current_edge = mesh->first_edge[vertex];
+	uint32_t adjacent_vertex = vertex;
+	uint32_t previous_adjacent_vertex;
+	while (1)
+	{
+		previous_adjacent_vertex = adjacent_vertex;
+		if (mesh->edges[current_edge].from == vertex)
+		{
+			adjacent_vertex = mesh->edges[current_edge].to;
+		}
+		else { adjacent_vertex = mesh->edges[current_edge].from; }
+
+		if (adjacent_vertex != previous_adjacent_vertex)
+		{
+			uint8_t adjacent_side = !ct_critical_points_is_lower(values, vertex,
+									adjacent_vertex);
+			if (adjacent_side != side) { num_runs[adjacent_side]++; }
+			if (first_side == 2) { first_side = adjacent_side; }
+			side = adjacent_side;
+		}
+
+		current_edge = ct_mesh_get_next_vertex_edge(mesh, vertex, current_edge);
+		if (current_edge == UINT32_MAX) { break; }
+		if (mesh->edges[current_edge].other_half == mesh->first_edge[vertex])
+		{
+			closed = 1;
+			break;
+		}
+	}
+
+	if (closed && (side == first_side) && (num_runs[side] > 1)) { num_runs[side]--; }
+	for (int i = 0; i < 2; i++)
+	{
+		link_components[i] = (num_runs[i] > CT_CRITICAL_POINTS_MAX_COMPONENTS) ?
+					CT_CRITICAL_POINTS_MAX_COMPONENTS : num_runs[i];
+	}
+}
+
+void ct_critical_points_classify_voxel(ct_volume_t *volume, float *values, uint32_t voxel,
+				uint32_t *adjacency, uint8_t link_components[2])
+{
+	/* Two neighbours are joined in the link if they are neighbours of each other. Under the
+	 * Freudenthal triangulation that gives the simplicial link. Under 6 connectivity no two
+	 * neighbours are joined, so every neighbour is a component of its own and only extrema
+	 * are classified exactly. Neighbours are kept as bits by offset, as in the adjacency from
+	 * ct_critical_points_get_adjacency, and each side is flood filled a component at a time: */
+	int64_t coordinates[3];
+	int64_t slice_size = (int64_t)volume->dimensions[0] * volume->dimensions[1];
+	coordinates[0] = voxel % volume->dimensions[0];
+	coordinates[1] = (voxel / volume->dimensions[0]) % volume->dimensions[1];
+	coordinates[2] = voxel / slice_size;
+
+	uint32_t sides[2] = { 0, 0 };
+	for (uint32_t i = 0; i < CT_CRITICAL_POINTS_NUM_OFFSETS; i++)
+	{
+		if (!(adjacency[CT_CRITICAL_POINTS_CENTRE] & (1u << i))) { continue; }
+
+		int64_t offset[3] = { (int64_t)(i % 3) - 1, (int64_t)((i / 3) % 3) - 1,
+								(int64_t)(i / 9) - 1 };
+		uint8_t outside = 0;
+		for (int j = 0; j < 3; j++)
+		{
+			int64_t coordinate = coordinates[j] + offset[j];
+			if ((coordinate < 0) || (coordinate >= volume->dimensions[j])) { outside = 1; }
+		}
+		if (outside) { continue; }
+
+		uint32_t neighbour = (uint32_t)(voxel + offset[0] +
+			(offset[1] * (int64_t)volume->dimensions[0]) + (offset[2] * slice_size));
+		sides[!ct_critical_points_is_lower(values, voxel, neighbour)] |= (1u << i);
+	}
+
+	for (int side = 0; side < 2; side++)
+	{
+		uint32_t num_components = 0;
+		uint32_t remaining = sides[side];
+		while (remaining)
+		{
+			uint32_t frontier = remaining & (~remaining + 1);
+			while (frontier)
+			{
+				uint32_t bit = __builtin_ctz(frontier);
+				remaining &= ~(1u << bit);
+				frontier &= ~(1u << bit);
+				frontier |= adjacency[bit] & remaining;
+			}
+			num_components++;
+		}
+		link_components[side] = num_components;
+	}
+}
+
+void ct_critical_points_get_adjacency(ct_volume_t *volume,
+				uint32_t adjacency[CT_CRITICAL_POINTS_NUM_OFFSETS])
+{
+	/* For each offset in {-1, 0, 1}^3 (x fastest), the offsets that are its neighbours under
+	 * the volume's connectivity, as bits. The centre's are the neighbours of a voxel: */
+	for (uint32_t i = 0; i < CT_CRITICAL_POINTS_NUM_OFFSETS; i++)
+	{
+		adjacency[i] = 0;
+		for (uint32_t j = 0; j < CT_CRITICAL_POINTS_NUM_OFFSETS; j++)
+		{
+			int64_t offset[3] = { (int64_t)(j % 3) - (int64_t)(i % 3),
+				(int64_t)((j / 3) % 3) - (int64_t)((i / 3) % 3),
+				(int64_t)(j / 9) - (int64_t)(i / 9) };
+			if (ct_volume_is_neighbour_offset(volume, offset)) { adjacency[i] |= (1u << j); }
+		}
+	}
+}
+
+int ct_critical_points_is_lower(float *values, uint32_t vertex, uint32_t other_vertex)
+{
+	// Whether the other vertex comes first in the sweep order, with ties broken by index:
+	if (values[other_vertex] != values[vertex]) { return (values[other_vertex] < values[vertex]); }
+	return (other_vertex < vertex);
+}
+
+int8_t ct_critical_points_get_type(uint8_t link_components[2])
+{
+	// As ct_tree_get_node_type would give for the vertex in either merge tree:
+	if (!link_components[0]) { return CT_NODE_TYPE_MINIMUM; }
+	if (!link_components[1]) { return CT_NODE_TYPE_MAXIMUM; }
+	if ((link_components[0] > 1) || (link_components[1] > 1)) { return CT_NODE_TYPE_SADDLE; }
+	return CT_NODE_TYPE_REGULAR;
+}
+
+uint32_t ct_critical_points_get_multiplicity(uint8_t link_components[2], uint8_t side)
+{
+	// Lower side[0] for the split tree, upper side[1] for the join tree:
+	return (link_components[side] > 1) ? (link_components[side] - 1) : 0;
+}
+
+void ct_critical_points_print_summary(FILE *file, uint32_t num_vertices,
+						uint8_t *link_components)
+{
+	uint32_t num_minima = 0;
+	uint32_t num_maxima = 0;
+	uint32_t num_saddles = 0;
+	uint64_t num_joins = 0;
+	uint64_t num_splits = 0;
+	#pragma omp parallel for if (num_vertices > CT_PARALLEL_THRESHOLD) \
+		reduction(+: num_minima, num_maxima, num_saddles, num_joins, num_splits)
+	for (uint32_t i = 0; i < num_vertices; i++)
+	{
+		int8_t type = ct_critical_points_get_type(&(link_components[2 * i]));
+		num_minima += (type == CT_NODE_TYPE_MINIMUM);
+		num_maxima += (type == CT_NODE_TYPE_MAXIMUM);
+		num_saddles += (type == CT_NODE_TYPE_SADDLE);
+		num_splits += ct_critical_points_get_multiplicity(&(link_components[2 * i]), 0);
+		num_joins += ct_critical_points_get_multiplicity(&(link_components[2 * i]), 1);
+	}
+
+	fprintf(file, "Critical points: %u minima, %u maxima, %u saddles (%llu joins and %llu "
+		"splits, counting multiplicity), %u regular.\n", num_minima, num_maxima,
+		num_saddles, (unsigned long long)num_joins, (unsigned long long)num_splits,
+		num_vertices - num_minima - num_maxima - num_saddles);
+}
+
+#ifdef CT_DEBUG
+int ct_critical_points_check(FILE *file, ct_tree_t *join_tree, ct_tree_t *split_tree,
+			uint8_t *link_components, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Cross-checks the link against the merge trees, augmented or reduced, as long as both
+	 * have the same nodes. Each upper link component reaches one branch of the join tree at
+	 * most, so the join tree has no more arcs up than there are upper components, and none
+	 * exactly when there are none (likewise for the split tree, lower components and arcs
+	 * down). A saddle with fewer arcs than components on both sides joins nothing in
+	 * either tree, so its branches meet again and close a loop (around a handle, or on the
+	 * boundary where the link is not closed): */
+	if (join_tree->num_nodes != split_tree->num_nodes)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Join and split trees have different nodes.");
+		return -1;
+	}
+
+	uint32_t num_wrong = 0;
+	uint32_t num_loops = 0;
+	#pragma omp parallel for reduction(+: num_wrong, num_loops) \
+		if (join_tree->num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < join_tree->num_nodes; i++)
+	{
+		uint8_t *components = &(link_components[2 * join_tree->nodes[i].node_to_vertex]);
+		uint32_t degrees[2] = { split_tree->nodes[i].degree[1], join_tree->nodes[i].degree[0] };
+		uint8_t wrong = 0;
+		uint8_t loop = 1;
+		for (int side = 0; side < 2; side++)
+		{
+			if ((!degrees[side] != !components[side]) || ((degrees[side] > components[side]) &&
+				(components[side] < CT_CRITICAL_POINTS_MAX_COMPONENTS)))
+			{
+				wrong = 1;
+			}
+			if (degrees[side] >= components[side]) { loop = 0; }
+		}
+		num_wrong += wrong;
+		num_loops += loop;
+	}
+
+	if (num_wrong)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Critical point check failed: %u of %u nodes "
+			"disagree with the merge trees.", num_wrong, join_tree->num_nodes);
+		return -1;
+	}
+
+	fprintf(file, "Critical point check: %u nodes agree with the merge trees, %u saddles "
+		"close loops.\n", join_tree->num_nodes, num_loops);
+	return 0;
+}
+#endif
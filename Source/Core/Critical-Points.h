@@ -0,0 +1,43 @@
+#ifndef CT_CRITICAL_POINTS_H
+#define CT_CRITICAL_POINTS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <omp.h>
+
+#include <NM-Config/Config.h>
+
+#include "Contour-Tree.h"
+#include "Mesh.h"
+#include "Parallel.h"
+
+#define CT_CRITICAL_POINTS_MAX_COMPONENTS UINT8_MAX // Link component counts saturate here.
+#define CT_CRITICAL_POINTS_NUM_OFFSETS 27 // Voxel offsets in {-1, 0, 1}^3, x fastest.
+#define CT_CRITICAL_POINTS_CENTRE 13 // Offset (0, 0, 0).
+
+// Classification:
+int ct_critical_points_classify(ct_mesh_t *mesh, float *values, uint8_t *link_components,
+						char error[NM_MAX_ERROR_LENGTH]);
+void ct_critical_points_classify_vertex(ct_mesh_t *mesh, float *values, uint32_t vertex,
+							uint8_t link_components[2]);
+void ct_critical_points_classify_voxel(ct_volume_t *volume, float *values, uint32_t voxel,
+				uint32_t *adjacency, uint8_t link_components[2]);
+void ct_critical_points_get_adjacency(ct_volume_t *volume,
+				uint32_t adjacency[CT_CRITICAL_POINTS_NUM_OFFSETS]);
+int ct_critical_points_is_lower(float *values, uint32_t vertex, uint32_t other_vertex);
+
+// Types:
+int8_t ct_critical_points_get_type(uint8_t link_components[2]);
+uint32_t ct_critical_points_get_multiplicity(uint8_t link_components[2], uint8_t side);
+void ct_critical_points_print_summary(FILE *file, uint32_t num_vertices,
+						uint8_t *link_components);
+
+#ifdef CT_DEBUG
+int ct_critical_points_check(FILE *file, ct_tree_t *join_tree, ct_tree_t *split_tree,
+			uint8_t *link_components, char error[NM_MAX_ERROR_LENGTH]);
+#endif
+
+#endif
@@ -0,0 +1,97 @@
+/* Disjoint set strategy kernel, included by Contour-Tree.c once per strategy for
+ * ct_disjoint_set_benchmark (there is no include guard for this reason). Before each inclusion,
+ * define:
+ *	CT_REPLAY_NAME		- name of the kernel function.
+ *	CT_REPLAY_FIND		- 0 for recursive path compression, 1 for path halving, 2 for path
+ *				  splitting.
+ *	CT_REPLAY_LINK		- 0 to link by rank, 1 by scrambled index priority, 2 by index.
+ *	CT_REPLAY_INTERLEAVED	- 1 to keep parent and extremum side by side, 0 for separate arrays.
+ *	CT_REPLAY_CACHE		- 1 to keep the root of the node being swept between neighbours.
+ * The trace holds (node, earlier neighbour) pairs in sweep order, and memory has room for
+ * three words per element. The kernel returns a checksum of the arcs it would add. */
+
+uint64_t CT_REPLAY_NAME(uint32_t num_elements, uint32_t *trace, uint64_t num_pairs,
+								uint32_t *memory)
+{
+	#if CT_REPLAY_INTERLEAVED
+	#define CT_REPLAY_PARENT(v) memory[2 * (v)]
+	#define CT_REPLAY_EXTREMUM(v) memory[(2 * (v)) + 1]
+	uint8_t *rank = (uint8_t *)&(memory[2 * num_elements]);
+	#else
+	#define CT_REPLAY_PARENT(v) memory[v]
+	#define CT_REPLAY_EXTREMUM(v) memory[(2 * num_elements) + (v)]
+	uint32_t *rank = &(memory[num_elements]);
+	#endif
+
+	for (uint32_t i = 0; i < num_elements; i++)
+	{
+		CT_REPLAY_PARENT(i) = i;
+		CT_REPLAY_EXTREMUM(i) = i;
+		rank[i] = 0;
+	}
+
+	// Replaces v with its root:
+	#if CT_REPLAY_FIND == 0
+	#define CT_REPLAY_FIND_ROOT(v) v = ct_disjoint_set_find_recursive(v, memory)
+	#elif CT_REPLAY_FIND == 1
+	#define CT_REPLAY_FIND_ROOT(v) while (CT_REPLAY_PARENT(v) != v) \
+	{ \
+		CT_REPLAY_PARENT(v) = CT_REPLAY_PARENT(CT_REPLAY_PARENT(v)); \
+		v = CT_REPLAY_PARENT(v); \
+	}
+	#else
+	#define CT_REPLAY_FIND_ROOT(v) while (CT_REPLAY_PARENT(v) != v) \
+	{ \
+		uint32_t next = CT_REPLAY_PARENT(v); \
+		CT_REPLAY_PARENT(v) = CT_REPLAY_PARENT(next); \
+		v = next; \
+	}
+	#endif
+
+	uint64_t checksum = 0;
+	uint32_t node = UINT32_MAX;
+	uint32_t root = UINT32_MAX;
+	for (uint64_t i = 0; i < num_pairs; i++)
+	{
+		if (!CT_REPLAY_CACHE || (trace[2 * i] != node))
+		{
+			root = trace[2 * i];
+			CT_REPLAY_FIND_ROOT(root);
+		}
+		node = trace[2 * i];
+		uint32_t other_root = trace[(2 * i) + 1];
+		CT_REPLAY_FIND_ROOT(other_root);
+		if (root == other_root) { continue; }
+		checksum += ((uint64_t)node * num_elements) + CT_REPLAY_EXTREMUM(other_root);
+
+		// Link, keeping the surviving root in root:
+		#if CT_REPLAY_LINK == 0
+		uint8_t swap = (rank[root] < rank[other_root]);
+		if (rank[root] == rank[other_root]) { rank[root]++; }
+		#elif CT_REPLAY_LINK == 1
+		uint8_t swap = !ct_disjoint_set_has_priority(root, other_root);
+		#else
+		uint8_t swap = (root < other_root);
+		#endif
+		if (swap)
+		{
+			uint32_t temporary = root;
+			root = other_root;
+			other_root = temporary;
+		}
+		CT_REPLAY_PARENT(other_root) = root;
+		CT_REPLAY_EXTREMUM(root) = node;
+	}
+
+	return checksum;
+
+	#undef CT_REPLAY_PARENT
+	#undef CT_REPLAY_EXTREMUM
+	#undef CT_REPLAY_FIND_ROOT
+}
+
+#undef CT_REPLAY_NAME
+#undef CT_REPLAY_FIND
+#undef CT_REPLAY_LINK
+#undef CT_REPLAY_INTERLEAVED
+#undef CT_REPLAY_CACHE
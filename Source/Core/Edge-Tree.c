@@ -0,0 +1,625 @@
+#include "Edge-Tree.h"
+
+/****************
+ * Construction *
+ ****************/
+
+/* Merge trees built Kruskal-style from the edges, as an alternative to the vertex sweep. Each
+ * undirected edge is weighted by its end that comes later in the sweep (the lower end for the
+ * join tree, the higher for the split tree), and the edges are sorted by that weight with the
+ * parallel radix sort. Taking them in order then adds each node's edges to already swept nodes
+ * together, so a single pass of the disjoint set over the sorted edges gives each component's
+ * extremum the next node in its component as parent, just as the sweep would. Gathering and
+ * sorting run in parallel and the pass streams through the edges in order, but every edge
+ * takes a 16 byte sort pair, and the pass itself is still sequential.
+ *
+ * Arcs are written from the parents by ct_merge_tree_set_arcs, as for the other engines. */
+
+int ct_merge_tree_construct_edges(ct_tree_t *merge_tree, ct_mesh_t *mesh,
+	uint32_t start_index, char error[NM_MAX_ERROR_LENGTH])
+{
+	return ct_merge_tree_construct_region(merge_tree, mesh, NULL, start_index, error);
+}
+
+int ct_merge_tree_construct_region(ct_tree_t *merge_tree, ct_mesh_t *mesh, ct_region_t *region,
+				uint32_t start_index, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* The merge tree of the region alone, for nodes from ct_region_scalar_function, or of the
+	 * whole mesh if there is no region. Only the region's vertices and pseudo-nodes are
+	 * visited, so the cost is the region's size and not the mesh's: */
+	if (!merge_tree->num_nodes || !merge_tree->nodes)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Merge tree has no nodes.");
+		return -1;
+	}
+
+	ct_edge_tree_t edge_tree;
+	if (ct_edge_tree_init(&edge_tree, merge_tree, mesh, region, (start_index != 0), error) ||
+		ct_edge_tree_gather(&edge_tree, error) || ct_edge_tree_sort(&edge_tree, error) ||
+		ct_edge_tree_join(&edge_tree, error))
+	{
+		ct_edge_tree_free(&edge_tree);
+		return -1;
+	}
+
+	ct_edge_tree_free(&edge_tree);
+	return 0;
+}
+
+int ct_edge_tree_init(ct_edge_tree_t *edge_tree, ct_tree_t *merge_tree, ct_mesh_t *mesh,
+		ct_region_t *region, uint8_t direction, char error[NM_MAX_ERROR_LENGTH])
+{
+	memset(edge_tree, 0, sizeof(*edge_tree));
+	edge_tree->merge_tree = merge_tree;
+	edge_tree->mesh = mesh;
+	edge_tree->region = region;
+	edge_tree->direction = direction;
+
+	uint32_t num_nodes = merge_tree->num_nodes;
+	edge_tree->grid = (!mesh->edges && mesh->volume.scalars);
+	if (region && (num_nodes != (region->num_vertices + region->num_pseudo_nodes)))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Merge tree nodes do not match the region of mesh \"%s\".", mesh->name);
+		return -1;
+	}
+	if (!region && edge_tree->grid && (num_nodes != ct_volume_get_num_voxels(&(mesh->volume))))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Merge tree nodes do not match the volume of mesh \"%s\".", mesh->name);
+		return -1;
+	}
+	if (!edge_tree->grid && (!mesh->edges || (!region && (num_nodes != mesh->num_vertices))))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Merge tree nodes do not match the vertices of mesh \"%s\".", mesh->name);
+		return -1;
+	}
+
+	// Sources are voxels, single half-edges, or region nodes with all their neighbours:
+	edge_tree->max_neighbours = edge_tree->grid ? CT_GRID_MAX_NEIGHBOURS : 1;
+	if (region) { edge_tree->max_neighbours = ct_region_get_max_neighbours(region, mesh); }
+
+	// Radix passes are only needed for the digits sweep positions can use:
+	edge_tree->key_bits = 8;
+	while ((edge_tree->key_bits < 32) && ((num_nodes - 1) >> edge_tree->key_bits))
+	{
+		edge_tree->key_bits += 8;
+	}
+
+	edge_tree->parent = malloc(num_nodes * sizeof(uint32_t));
+	if (!edge_tree->parent)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for edge tree.");
+		return -1;
+	}
+
+	#pragma omp parallel for if (num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < num_nodes; i++) { edge_tree->parent[i] = CT_TREE_NO_NODE; }
+
+	return 0;
+}
+
+void ct_edge_tree_free(ct_edge_tree_t *edge_tree)
+{
+	free(edge_tree->edges);
+	free(edge_tree->parent);
+	edge_tree->edges = NULL;
+	edge_tree->parent = NULL;
+}
+
+/*********
+ * Edges *
+ *********/
+
+int ct_edge_tree_gather(ct_edge_tree_t *edge_tree, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Edges come from sources, which are half-edges of a mesh, voxels of a grid or vertices
+	 * of a region. Each source is counted first, so the edges can then be written in parallel
+	 * at their prefix sums: */
+	ct_mesh_t *mesh = edge_tree->mesh;
+	uint32_t num_sources = (edge_tree->grid || edge_tree->region) ?
+					edge_tree->merge_tree->num_nodes : mesh->num_edges;
+	uint32_t num_threads = omp_get_max_threads();
+	uint32_t *offsets = malloc(num_sources * sizeof(uint32_t));
+	uint32_t *neighbours = malloc(num_threads * (edge_tree->max_neighbours + 1) *
+							sizeof(uint32_t));
+	if (!offsets || !neighbours)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for edge offsets.");
+		free(offsets);
+		free(neighbours);
+		return -1;
+	}
+
+	uint64_t num_edges = 0;
+	#pragma omp parallel for num_threads(num_threads) reduction(+: num_edges) \
+		if (num_sources > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < num_sources; i++)
+	{
+		uint32_t vertex;
+		offsets[i] = ct_edge_tree_get_source_edges(edge_tree, i, &vertex,
+			&(neighbours[omp_get_thread_num() * edge_tree->max_neighbours]));
+		num_edges += offsets[i];
+	}
+	if (num_edges >= UINT32_MAX)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Mesh \"%s\" has too many edges to sort.",
+										mesh->name);
+		free(offsets);
+		free(neighbours);
+		return -1;
+	}
+
+	edge_tree->num_edges = ct_parallel_prefix_sum(offsets, num_sources);
+	edge_tree->edges = malloc(((size_t)edge_tree->num_edges + 1) * sizeof(ct_sort_pair_t));
+	if (!edge_tree->edges)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for edges.");
+		free(offsets);
+		free(neighbours);
+		return -1;
+	}
+
+	#pragma omp parallel for num_threads(num_threads) if (num_sources > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < num_sources; i++)
+	{
+		uint32_t vertex;
+		uint32_t *thread_neighbours = &(neighbours[omp_get_thread_num() *
+							edge_tree->max_neighbours]);
+		uint32_t num_neighbours = ct_edge_tree_get_source_edges(edge_tree, i, &vertex,
+									thread_neighbours);
+		for (uint32_t j = 0; j < num_neighbours; j++)
+		{
+			ct_edge_tree_set_edge(edge_tree, &(edge_tree->edges[offsets[i] + j]), vertex,
+									thread_neighbours[j]);
+		}
+	}
+
+	free(offsets);
+	free(neighbours);
+	return 0;
+}
+
+int ct_edge_tree_sort(ct_edge_tree_t *edge_tree, char error[NM_MAX_ERROR_LENGTH])
+{
+	// The sort is stable, but order among a node's edges makes no difference to the tree:
+	return ct_parallel_sort_pairs(edge_tree->edges, edge_tree->num_edges, edge_tree->key_bits,
+										error);
+}
+
+uint32_t ct_edge_tree_get_source_edges(ct_edge_tree_t *edge_tree, uint32_t source,
+						uint32_t *vertex, uint32_t *neighbours)
+{
+	/* Each undirected edge once. A voxel or region vertex gives the edges to its neighbours
+	 * with higher indices, and a half-edge gives its own edge unless its other half comes
+	 * first. Neighbours needs room for max_neighbours: */
+	ct_mesh_t *mesh = edge_tree->mesh;
+	if (edge_tree->region)
+	{
+		uint32_t num_neighbours = ct_region_get_neighbours(edge_tree->region, mesh, source,
+						neighbours, edge_tree->max_neighbours, 1);
+		*vertex = source;
+		return num_neighbours;
+	}
+	if (edge_tree->grid)
+	{
+		uint32_t grid_neighbours[CT_GRID_MAX_NEIGHBOURS];
+		uint32_t num_grid_neighbours = ct_volume_get_neighbours(&(mesh->volume), source,
+									grid_neighbours);
+		uint32_t num_neighbours = 0;
+		for (uint32_t i = 0; i < num_grid_neighbours; i++)
+		{
+			if (grid_neighbours[i] > source)
+			{
+				neighbours[num_neighbours] = grid_neighbours[i];
+				num_neighbours++;
+			}
+		}
+		*vertex = source;
+		return num_neighbours;
+	}
+
+	ct_edge_t *edge = &(mesh->edges[source]);
+	if ((edge->from == edge->to) || ((edge->other_half != UINT32_MAX) &&
+						(edge->other_half < source)))
+	{
+		return 0;
+	}
+	*vertex = edge->from;
+	neighbours[0] = edge->to;
+	return 1;
+}
+
+void ct_edge_tree_set_edge(ct_edge_tree_t *edge_tree, ct_sort_pair_t *edge, uint32_t vertex,
+							uint32_t neighbour)
+{
+	// Join trees sweep from the highest node, so their sweep positions count down from there:
+	ct_tree_t *merge_tree = edge_tree->merge_tree;
+	uint32_t node = merge_tree->nodes[vertex].vertex_to_node;
+	uint32_t other_node = merge_tree->nodes[neighbour].vertex_to_node;
+	uint8_t later = edge_tree->direction ? (other_node < node) : (other_node > node);
+	uint32_t later_node = later ? other_node : node;
+	edge->key = edge_tree->direction ? (merge_tree->num_nodes - 1 - later_node) : later_node;
+	edge->value = later ? node : other_node;
+}
+
+/*********
+ * Union *
+ *********/
+
+int ct_edge_tree_join(ct_edge_tree_t *edge_tree, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* A node's own set is untouched until its edges come up, since every union before then is
+	 * between nodes swept earlier. Its root is kept across its edges, as in the sweep: */
+	ct_tree_t *merge_tree = edge_tree->merge_tree;
+	uint32_t num_nodes = merge_tree->num_nodes;
+	ct_disjoint_set_t disjoint_set = {0};
+	disjoint_set.num_elements = num_nodes;
+	if (ct_disjoint_set_allocate(&disjoint_set, error)) { return -1; }
+
+	uint32_t node = CT_TREE_NO_NODE;
+	uint32_t component = CT_TREE_NO_NODE;
+	for (uint32_t i = 0; i < edge_tree->num_edges; i++)
+	{
+		uint32_t position = (uint32_t)edge_tree->edges[i].key;
+		uint32_t later_node = edge_tree->direction ? (num_nodes - 1 - position) : position;
+		if (later_node != node)
+		{
+			node = later_node;
+			component = node;
+		}
+
+		uint32_t adjacent_component = ct_disjoint_set_find(edge_tree->edges[i].value,
+									&disjoint_set);
+		if (adjacent_component == component) { continue; }
+
+		edge_tree->parent[disjoint_set.extremum[adjacent_component]] = node;
+		component = ct_disjoint_set_link(component, adjacent_component, &disjoint_set);
+		disjoint_set.extremum[component] = node;
+	}
+
+	// The disjoint set is finished with, so it is the scratch for writing arcs:
+	int status = ct_merge_tree_set_arcs(merge_tree, edge_tree->parent, edge_tree->direction,
+								disjoint_set.parent, error);
+	ct_disjoint_set_free(&disjoint_set);
+	return status;
+}
+
+/***********
+ * Regions *
+ ***********/
+
+int ct_region_contour_tree(ct_tree_t *contour_tree, ct_mesh_t *mesh, ct_region_t *region,
+					uint8_t axis, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* From scalar values to the contour tree, for the region or (without one) the whole mesh.
+	 * The coordinate along the axis is the function on meshes, as in ct_region_scalar_function.
+	 * Regions that are not simply connected are refused, as their contour tree would be wrong.
+	 * On failure the contour tree is freed: */
+	int (*scalar_functions[3])(ct_tree_t *tree, ct_mesh_t *mesh,
+		char error[NM_MAX_ERROR_LENGTH]) = { ct_tree_scalar_function_x,
+			ct_tree_scalar_function_y, ct_tree_scalar_function_z };
+	uint8_t grid = (!mesh->edges && mesh->volume.scalars);
+	if (ct_mesh_check_contour_tree(mesh, error)) { return -1; }
+	if (!grid && (axis > 2))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Mesh \"%s\" has no axis %u.", mesh->name, axis);
+		return -1;
+	}
+
+	ct_tree_t join_tree = {0};
+	ct_tree_t split_tree = {0};
+	int status;
+	if (region)
+	{
+		status = ct_region_scalar_function(&join_tree, mesh, region, axis, error) ||
+			ct_tree_copy_nodes(&join_tree, &split_tree, error) ||
+			ct_merge_tree_construct_region(&join_tree, mesh, region,
+						join_tree.num_nodes - 1, error) ||
+			ct_region_check_simply_connected(region, mesh, &join_tree, error) ||
+			ct_merge_tree_construct_region(&split_tree, mesh, region, 0, error);
+	}
+	else
+	{
+		status = (grid ? ct_tree_scalar_function_volume(&join_tree, mesh, error) :
+				scalar_functions[axis](&join_tree, mesh, error)) ||
+			ct_tree_copy_nodes(&join_tree, &split_tree, error) ||
+			ct_merge_tree_construct(&join_tree, mesh, join_tree.num_nodes - 1, error) ||
+			ct_merge_tree_construct(&split_tree, mesh, 0, error);
+	}
+	status = status || ct_merge_trees_reduce_to_critical(&join_tree, &split_tree, error) ||
+		ct_contour_tree_construct(contour_tree, &join_tree, &split_tree, error);
+
+	ct_tree_free(&join_tree);
+	ct_tree_free(&split_tree);
+	if (status) { ct_tree_free(contour_tree); }
+	return status ? -1 : 0;
+}
+
+#ifdef CT_DEBUG
+int ct_edge_tree_benchmark(FILE *file, ct_tree_t *tree, ct_mesh_t *mesh,
+					char error[NM_MAX_ERROR_LENGTH])
+{
+	// Times each phase against the sweep on fresh copies of the sorted nodes, and compares:
+	char *directions[2] = { "split", "join" };
+	for (int direction = 0; direction < 2; direction++)
+	{
+		ct_tree_t sweep_tree = {0};
+		ct_tree_t edge_tree = {0};
+		ct_edge_tree_t edges;
+		memset(&edges, 0, sizeof(edges));
+		uint32_t start_index = direction ? (tree->num_nodes - 1) : 0;
+		if (ct_tree_copy_nodes(tree, &sweep_tree, error) ||
+			ct_tree_copy_nodes(tree, &edge_tree, error))
+		{
+			ct_tree_free(&sweep_tree);
+			ct_tree_free(&edge_tree);
+			return -1;
+		}
+
+		double sweep_time = omp_get_wtime();
+		if (ct_merge_tree_construct(&sweep_tree, mesh, start_index, error))
+		{
+			ct_tree_free(&sweep_tree);
+			ct_tree_free(&edge_tree);
+			return -1;
+		}
+		sweep_time = omp_get_wtime() - sweep_time;
+
+		double times[4];
+		times[0] = omp_get_wtime();
+		int status = ct_edge_tree_init(&edges, &edge_tree, mesh, NULL, direction, error) ||
+						ct_edge_tree_gather(&edges, error);
+		times[1] = omp_get_wtime();
+		status = status || ct_edge_tree_sort(&edges, error);
+		times[2] = omp_get_wtime();
+		status = status || ct_edge_tree_join(&edges, error);
+		times[3] = omp_get_wtime();
+		if (status)
+		{
+			ct_edge_tree_free(&edges);
+			ct_tree_free(&sweep_tree);
+			ct_tree_free(&edge_tree);
+			return -1;
+		}
+
+		int differ = ct_merge_tree_compare(&sweep_tree, &edge_tree, direction, error);
+
+		fprintf(file, "%s edge sort: %.3f ms (%u edges gathered in %.3f ms, sorted in %.3f "
+			"ms, joined in %.3f ms), %d threads (sweep %.3f ms), %s.\n",
+			directions[direction], (times[3] - times[0]) * 1000.0, edges.num_edges,
+			(times[1] - times[0]) * 1000.0, (times[2] - times[1]) * 1000.0,
+			(times[3] - times[2]) * 1000.0, omp_get_max_threads(), sweep_time * 1000.0,
+			differ ? "trees differ" : "trees match");
+
+		ct_edge_tree_free(&edges);
+		ct_tree_free(&sweep_tree);
+		ct_tree_free(&edge_tree);
+		if (differ) { return -1; }
+	}
+
+	return 0;
+}
+
+int ct_edge_tree_region_benchmark(FILE *file, ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Builds contour trees for boxes around the middle of the mesh, a quarter, half and all
+	 * of its extent on each side, and times them against the whole mesh. The last box holds
+	 * every vertex, so its contour tree has to match. Meshes use the y coordinate, and their
+	 * boxes keep its full extent: cutting a surface at a height can leave holes around the
+	 * peaks, and the contour tree of a region with holes is not defined. Sides can still cut
+	 * a band around a closed surface, so smaller boxes that fail are reported and skipped. */
+	uint8_t grid = (!mesh->edges && mesh->volume.scalars);
+	uint32_t num_mesh_vertices = grid ? ct_volume_get_num_voxels(&(mesh->volume)) :
+								mesh->num_vertices;
+	float low[3];
+	float high[3];
+	ct_region_get_position(mesh, 0, low);
+	ct_region_get_position(mesh, num_mesh_vertices - 1, high);
+	for (uint32_t i = 0; (i < num_mesh_vertices) && !grid; i++)
+	{
+		float position[3];
+		ct_region_get_position(mesh, i, position);
+		for (int j = 0; j < 3; j++)
+		{
+			if (position[j] < low[j]) { low[j] = position[j]; }
+			if (position[j] > high[j]) { high[j] = position[j]; }
+		}
+	}
+
+	ct_tree_t whole_tree = {0};
+	double whole_time = omp_get_wtime();
+	if (ct_region_contour_tree(&whole_tree, mesh, NULL, 1, error)) { return -1; }
+	whole_time = omp_get_wtime() - whole_time;
+
+	for (int fraction = 4; fraction >= 1; fraction /= 2)
+	{
+		float box_low[3];
+		float box_high[3];
+		for (int i = 0; i < 3; i++)
+		{
+			float middle = (low[i] + high[i]) / 2.0f;
+			float half_width = (high[i] - low[i]) / (2.0f * fraction);
+			uint8_t whole = ((fraction == 1) || (!grid && (i == 1)));
+			box_low[i] = whole ? low[i] : (middle - half_width);
+			box_high[i] = whole ? high[i] : (middle + half_width);
+		}
+
+		ct_region_t region = {0};
+		ct_tree_t region_tree = {0};
+		double mask_time = omp_get_wtime();
+		if (ct_region_from_box(&region, mesh, box_low, box_high, error))
+		{
+			ct_tree_free(&whole_tree);
+			return -1;
+		}
+		mask_time = omp_get_wtime() - mask_time;
+		if (!region.num_vertices)
+		{
+			fprintf(file, "Region box 1/%d of each side: no vertices.\n", fraction);
+			ct_region_free(&region);
+			continue;
+		}
+
+		double time = omp_get_wtime();
+		if (ct_region_contour_tree(&region_tree, mesh, &region, 1, error))
+		{
+			ct_region_free(&region);
+			if (fraction != 1)
+			{
+				fprintf(file, "Region box 1/%d of each side: %s\n", fraction, error);
+				continue;
+			}
+			ct_tree_free(&whole_tree);
+			return -1;
+		}
+		time = omp_get_wtime() - time;
+
+		char *match = "";
+		uint8_t differ = 0;
+		if (fraction == 1)
+		{
+			differ = (ct_edge_tree_region_hash(&region_tree) !=
+					ct_edge_tree_region_hash(&whole_tree));
+			match = differ ? ", contour trees differ" : ", contour trees match";
+		}
+		fprintf(file, "Region box 1/%d of each side: %u of %u vertices, %u contour arcs in "
+			"%.3f ms (mask %.3f ms), whole mesh %.3f ms%s.\n", fraction,
+			region.num_vertices, num_mesh_vertices, region_tree.num_arcs, time * 1000.0,
+			mask_time * 1000.0, whole_time * 1000.0, match);
+
+		ct_region_free(&region);
+		ct_tree_free(&region_tree);
+		if (differ)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH,
+				"Contour tree of the whole mesh as a region differs from the mesh's.");
+			ct_tree_free(&whole_tree);
+			return -1;
+		}
+	}
+
+	ct_tree_free(&whole_tree);
+	return 0;
+}
+
+uint64_t ct_edge_tree_region_hash(ct_tree_t *tree)
+{
+	// Arcs by the vertices at their ends, whatever order they are stored in:
+	uint64_t hash = tree->num_nodes;
+	for (uint32_t i = 0; i < tree->num_nodes; i++)
+	{
+		ct_tree_node_t *node = &(tree->nodes[i]);
+		for (uint32_t j = 0; j < node->degree[0]; j++)
+		{
+			hash += ct_hash_round(node->node_to_vertex,
+				tree->nodes[tree->arcs[node->first_arc[0] + j]].node_to_vertex);
+		}
+	}
+	return hash;
+}
+
+int ct_edge_tree_band_benchmark(FILE *file, ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Builds contour trees for bands around the middle value, a quarter, half and all of the
+	 * range wide, and times them against the whole mesh. Critical nodes strictly inside a
+	 * band have to match the whole contour tree's. Meshes use the y coordinate, as for
+	 * regions: */
+	ct_tree_t whole_tree = {0};
+	double whole_time = omp_get_wtime();
+	if (ct_region_contour_tree(&whole_tree, mesh, NULL, 1, error)) { return -1; }
+	whole_time = omp_get_wtime() - whole_time;
+	float low = whole_tree.nodes[0].value;
+	float high = whole_tree.nodes[whole_tree.num_nodes - 1].value;
+
+	for (int fraction = 4; fraction >= 1; fraction /= 2)
+	{
+		float middle = (low + high) / 2.0f;
+		float half_width = (high - low) / (2.0f * fraction);
+		float band_low = (fraction == 1) ? low : (middle - half_width);
+		float band_high = (fraction == 1) ? high : (middle + half_width);
+
+		ct_region_t band = {0};
+		ct_tree_t band_tree = {0};
+		uint32_t num_differences = 0;
+		// The band's total time includes partitioning the mesh, which is a pass over all of it:
+		double time = omp_get_wtime();
+		int status = ct_region_from_band(&band, mesh, 1, band_low, band_high, error);
+		double partition_time = omp_get_wtime() - time;
+		status = status || ct_region_contour_tree(&band_tree, mesh, &band, 1, error);
+		time = omp_get_wtime() - time;
+		status = status || ct_edge_tree_band_check(&band_tree, &whole_tree, &band, band_low,
+							band_high, &num_differences, error);
+		if (status)
+		{
+			ct_region_free(&band);
+			ct_tree_free(&band_tree);
+			ct_tree_free(&whole_tree);
+			return -1;
+		}
+
+		fprintf(file, "Band 1/%d of the range: %u vertices and %u pseudo-nodes of %u, %u contour "
+			"arcs in %.3f ms (partition %.3f ms of it), whole mesh %.3f ms, %u degrees "
+			"differ.\n", fraction, band.num_vertices, band.num_pseudo_nodes, whole_tree.num_nodes,
+			band_tree.num_arcs, time * 1000.0, partition_time * 1000.0,
+			whole_time * 1000.0, num_differences);
+		ct_region_free(&band);
+		ct_tree_free(&band_tree);
+		if (num_differences)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "Band 1/%d of the range differs from the "
+				"whole contour tree at %u critical nodes.", fraction, num_differences);
+			ct_tree_free(&whole_tree);
+			return -1;
+		}
+	}
+
+	ct_tree_free(&whole_tree);
+	return 0;
+}
+
+int ct_edge_tree_band_check(ct_tree_t *band_tree, ct_tree_t *whole_tree, ct_region_t *band,
+	float low, float high, uint32_t *num_differences, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Both trees are reduced to critical nodes, which must be the same vertices with the same
+	 * degrees strictly inside the band. Contour trees only keep node to vertex, so the band
+	 * tree's nodes are mapped first: */
+	uint32_t num_band_nodes = band->num_vertices + band->num_pseudo_nodes;
+	uint32_t *band_nodes = malloc(num_band_nodes * sizeof(uint32_t));
+	if (!band_nodes)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for band check.");
+		return -1;
+	}
+	for (uint32_t i = 0; i < num_band_nodes; i++) { band_nodes[i] = CT_TREE_NO_NODE; }
+
+	uint32_t num_inside = 0;
+	for (uint32_t i = 0; i < band_tree->num_nodes; i++)
+	{
+		ct_tree_node_t *band_node = &(band_tree->nodes[i]);
+		band_nodes[band_node->node_to_vertex] = i;
+		num_inside += ((band_node->value > low) && (band_node->value < high));
+	}
+
+	*num_differences = 0;
+	for (uint32_t i = 0; i < whole_tree->num_nodes; i++)
+	{
+		ct_tree_node_t *whole_node = &(whole_tree->nodes[i]);
+		if ((whole_node->value <= low) || (whole_node->value >= high)) { continue; }
+		num_inside--;
+
+		uint32_t node = band_nodes[band->vertex_to_node[whole_node->node_to_vertex]];
+		if ((node == CT_TREE_NO_NODE) ||
+			(band_tree->nodes[node].degree[0] != whole_node->degree[0]) ||
+			(band_tree->nodes[node].degree[1] != whole_node->degree[1]))
+		{
+			(*num_differences)++;
+		}
+	}
+	*num_differences += num_inside;
+
+	free(band_nodes);
+	return 0;
+}
+#endif
@@ -0,0 +1,70 @@
+#ifndef CT_EDGE_TREE_H
+#define CT_EDGE_TREE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <omp.h>
+
+#include <NM-Config/Config.h>
+
+#include "Contour-Tree.h"
+#include "Mesh.h"
+#include "Parallel.h"
+#include "Region.h"
+
+typedef struct
+{
+	ct_tree_t *merge_tree;
+	ct_mesh_t *mesh;
+	ct_region_t *region;	// Optional. Nodes are then its vertices, and edges stay inside it.
+	uint8_t direction;	// 1 to take edges high to low (join tree), 0 for low to high.
+	uint8_t grid;
+	uint8_t key_bits;	// Enough for any sweep position.
+	uint32_t max_neighbours;	// Per source, before those outside the region are dropped.
+
+	// One per undirected edge. Key is the sweep position of the later end, value the earlier:
+	uint32_t num_edges;
+	ct_sort_pair_t *edges;
+
+	// Per node:
+	uint32_t *parent;	// Next node along the sweep in the same component.
+} ct_edge_tree_t;
+
+// Construction:
+int ct_merge_tree_construct_edges(ct_tree_t *merge_tree, ct_mesh_t *mesh,
+	uint32_t start_index, char error[NM_MAX_ERROR_LENGTH]);
+int ct_merge_tree_construct_region(ct_tree_t *merge_tree, ct_mesh_t *mesh, ct_region_t *region,
+				uint32_t start_index, char error[NM_MAX_ERROR_LENGTH]);
+int ct_edge_tree_init(ct_edge_tree_t *edge_tree, ct_tree_t *merge_tree, ct_mesh_t *mesh,
+		ct_region_t *region, uint8_t direction, char error[NM_MAX_ERROR_LENGTH]);
+void ct_edge_tree_free(ct_edge_tree_t *edge_tree);
+
+// Edges:
+int ct_edge_tree_gather(ct_edge_tree_t *edge_tree, char error[NM_MAX_ERROR_LENGTH]);
+int ct_edge_tree_sort(ct_edge_tree_t *edge_tree, char error[NM_MAX_ERROR_LENGTH]);
+uint32_t ct_edge_tree_get_source_edges(ct_edge_tree_t *edge_tree, uint32_t source,
+						uint32_t *vertex, uint32_t *neighbours);
+void ct_edge_tree_set_edge(ct_edge_tree_t *edge_tree, ct_sort_pair_t *edge, uint32_t vertex,
+							uint32_t neighbour);
+
+// Union:
+int ct_edge_tree_join(ct_edge_tree_t *edge_tree, char error[NM_MAX_ERROR_LENGTH]);
+
+// Regions:
+int ct_region_contour_tree(ct_tree_t *contour_tree, ct_mesh_t *mesh, ct_region_t *region,
+					uint8_t axis, char error[NM_MAX_ERROR_LENGTH]);
+
+#ifdef CT_DEBUG
+int ct_edge_tree_benchmark(FILE *file, ct_tree_t *tree, ct_mesh_t *mesh,
+					char error[NM_MAX_ERROR_LENGTH]);
+int ct_edge_tree_region_benchmark(FILE *file, ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
+uint64_t ct_edge_tree_region_hash(ct_tree_t *tree);
+int ct_edge_tree_band_benchmark(FILE *file, ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
+int ct_edge_tree_band_check(ct_tree_t *band_tree, ct_tree_t *whole_tree, ct_region_t *band,
+	float low, float high, uint32_t *num_differences, char error[NM_MAX_ERROR_LENGTH]);
+#endif
+
+#endif
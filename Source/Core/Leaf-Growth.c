@@ -0,0 +1,500 @@
+#include "Leaf-Growth.h"
+
+/****************
+ * Construction *
+ ****************/
+
+/* Merge trees grown from the leaves, as an alternative to the single sweep. Every leaf (a node
+ * with no neighbour swept before it) starts a task that grows a region, always adding the
+ * first node in sweep order from a heap of the nodes bordering the region. The region is then
+ * exactly the component of that node's superlevel (join) or sublevel (split) set, so the
+ * node's parent is the next one added. A node where the number of arcs arriving from the
+ * region is less than its number of earlier neighbours is a saddle: each region that reaches
+ * it adds its arcs to a shared count under a lock and stops, and the one that completes the
+ * count takes over the others' heaps (merging the smaller into the larger) and carries on.
+ * Leaves are split between one deque per thread, and threads that run out steal from the others.
+ *
+ * Each node ends up with a parent, and ct_merge_tree_set_arcs writes the arcs from those. */
+
+int ct_merge_tree_construct_leaves(ct_tree_t *merge_tree, ct_mesh_t *mesh,
+	uint32_t start_index, char error[NM_MAX_ERROR_LENGTH])
+{
+	if (!merge_tree->num_nodes || !merge_tree->nodes)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Merge tree has no nodes.");
+		return -1;
+	}
+
+	// Arrival counts are finished with after growth, so they are the scratch for writing arcs:
+	ct_leaf_growth_t growth;
+	if (ct_leaf_growth_init(&growth, merge_tree, mesh, (start_index != 0), error) ||
+		ct_leaf_growth_run(&growth, error) || ct_merge_tree_set_arcs(merge_tree,
+			growth.parent, growth.direction, growth.num_arrived, error))
+	{
+		ct_leaf_growth_free(&growth);
+		return -1;
+	}
+
+	ct_leaf_growth_free(&growth);
+	return 0;
+}
+
+int ct_leaf_growth_init(ct_leaf_growth_t *growth, ct_tree_t *merge_tree, ct_mesh_t *mesh,
+				uint8_t direction, char error[NM_MAX_ERROR_LENGTH])
+{
+	memset(growth, 0, sizeof(*growth));
+	for (uint32_t i = 0; i < CT_LEAF_GROWTH_NUM_LOCKS; i++)
+	{
+		omp_init_lock(&(growth->locks[i]));
+	}
+	growth->merge_tree = merge_tree;
+	growth->mesh = mesh;
+	growth->direction = direction;
+
+	uint32_t num_nodes = merge_tree->num_nodes;
+	growth->grid = (!mesh->edges && mesh->volume.scalars);
+	if (growth->grid && (num_nodes != ct_volume_get_num_voxels(&(mesh->volume))))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Merge tree nodes do not match the volume of mesh \"%s\".", mesh->name);
+		return -1;
+	}
+	if (!growth->grid && (!mesh->edges || (num_nodes != mesh->num_vertices)))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Merge tree nodes do not match the vertices of mesh \"%s\".", mesh->name);
+		return -1;
+	}
+
+	// Room for every neighbour of any vertex:
+	if (growth->grid) { growth->max_neighbours = CT_GRID_MAX_NEIGHBOURS; }
+	else
+	{
+		uint32_t max_neighbours = 0;
+		#pragma omp parallel for reduction(max: max_neighbours) \
+			if (num_nodes > CT_PARALLEL_THRESHOLD)
+		for (uint32_t i = 0; i < num_nodes; i++)
+		{
+			uint32_t num_neighbours = ct_mesh_get_vertex_neighbours(mesh, i, NULL, 0);
+			if (num_neighbours > max_neighbours) { max_neighbours = num_neighbours; }
+		}
+		growth->max_neighbours = max_neighbours;
+	}
+
+	uint32_t num_threads = omp_get_max_threads();
+	growth->num_before = malloc(num_nodes * sizeof(uint32_t));
+	growth->num_arrived = malloc(num_nodes * sizeof(uint32_t));
+	growth->waiting = malloc(num_nodes * sizeof(uint32_t));
+	growth->parent = malloc(num_nodes * sizeof(uint32_t));
+	uint32_t *neighbours = malloc(num_threads * (growth->max_neighbours + 1) *
+							sizeof(uint32_t));
+	if (!growth->num_before || !growth->num_arrived || !growth->waiting || !growth->parent ||
+										!neighbours)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for leaf growth.");
+		free(neighbours);
+		return -1;
+	}
+
+	// Neighbours swept before each node are the arcs it waits for:
+	#pragma omp parallel for num_threads(num_threads) if (num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < num_nodes; i++)
+	{
+		uint32_t *thread_neighbours = &(neighbours[omp_get_thread_num() *
+						(growth->max_neighbours + 1)]);
+		uint32_t num_neighbours = ct_leaf_growth_get_neighbours(growth, i,
+								thread_neighbours);
+		growth->num_before[i] = 0;
+		for (uint32_t j = 0; j < num_neighbours; j++)
+		{
+			if (ct_leaf_growth_is_before(growth, thread_neighbours[j], i))
+			{
+				growth->num_before[i]++;
+			}
+		}
+		growth->num_arrived[i] = 0;
+		growth->waiting[i] = CT_LEAF_GROWTH_NONE;
+		growth->parent[i] = CT_LEAF_GROWTH_NONE;
+	}
+	free(neighbours);
+
+	for (uint32_t i = 0; i < num_nodes; i++)
+	{
+		if (!growth->num_before[i]) { growth->num_tasks++; }
+	}
+	growth->tasks = calloc(growth->num_tasks, sizeof(ct_leaf_growth_task_t));
+	growth->deques = malloc(num_threads * sizeof(ct_leaf_growth_deque_t));
+	if (!growth->tasks || !growth->deques)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for leaf growth.");
+		return -1;
+	}
+
+	// Leaves in sweep order, so each deque starts with a run of nearby values:
+	uint32_t task = 0;
+	for (uint32_t step = 0; step < num_nodes; step++)
+	{
+		uint32_t i = direction ? (num_nodes - step - 1) : step;
+		if (growth->num_before[i]) { continue; }
+		growth->tasks[task].node = i;
+		growth->tasks[task].extremum = CT_LEAF_GROWTH_NONE;
+		growth->tasks[task].next_waiting = CT_LEAF_GROWTH_NONE;
+		task++;
+	}
+
+	for (uint32_t i = 0; i < num_threads; i++)
+	{
+		omp_init_lock(&(growth->deques[i].lock));
+		growth->deques[i].top = ((uint64_t)growth->num_tasks * i) / num_threads;
+		growth->deques[i].bottom = ((uint64_t)growth->num_tasks * (i + 1)) / num_threads;
+	}
+	growth->num_deques = num_threads;
+
+	return 0;
+}
+
+void ct_leaf_growth_free(ct_leaf_growth_t *growth)
+{
+	for (uint32_t i = 0; i < CT_LEAF_GROWTH_NUM_LOCKS; i++)
+	{
+		omp_destroy_lock(&(growth->locks[i]));
+	}
+	for (uint32_t i = 0; i < growth->num_deques; i++)
+	{
+		omp_destroy_lock(&(growth->deques[i].lock));
+	}
+
+	for (uint32_t i = 0; growth->tasks && (i < growth->num_tasks); i++)
+	{
+		free(growth->tasks[i].heap);
+	}
+
+	free(growth->num_before);
+	free(growth->num_arrived);
+	free(growth->waiting);
+	free(growth->parent);
+	free(growth->tasks);
+	free(growth->deques);
+	memset(growth, 0, sizeof(*growth));
+}
+
+/**********
+ * Growth *
+ **********/
+
+int ct_leaf_growth_run(ct_leaf_growth_t *growth, char error[NM_MAX_ERROR_LENGTH])
+{
+	uint32_t *neighbours = malloc(growth->num_deques * (growth->max_neighbours + 1) *
+							sizeof(uint32_t));
+	if (!neighbours)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for leaf growth.");
+		return -1;
+	}
+
+	/* No tasks are added once growth starts (the last region to reach a saddle carries on
+	 * in the same task), so a thread is done as soon as every deque is empty. */
+	int failed = 0;
+	#pragma omp parallel num_threads(growth->num_deques) shared(failed)
+	{
+		uint32_t thread = omp_get_thread_num();
+		uint32_t *thread_neighbours = &(neighbours[thread * (growth->max_neighbours + 1)]);
+		char task_error[NM_MAX_ERROR_LENGTH];
+		while (1)
+		{
+			uint32_t task = ct_leaf_growth_take_task(growth, thread, 0);
+			for (uint32_t i = 1; (task == CT_LEAF_GROWTH_NONE) && (i < growth->num_deques);
+											i++)
+			{
+				task = ct_leaf_growth_take_task(growth, (thread + i) % growth->num_deques,
+											1);
+			}
+			if ((task == CT_LEAF_GROWTH_NONE) || failed) { break; }
+
+			if (ct_leaf_growth_grow(growth, task, thread_neighbours, task_error))
+			{
+				#pragma omp critical
+				{
+					failed = 1;
+					strcpy(error, task_error);
+				}
+			}
+		}
+	}
+
+	free(neighbours);
+	return failed ? -1 : 0;
+}
+
+int ct_leaf_growth_grow(ct_leaf_growth_t *growth, uint32_t task, uint32_t *neighbours,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	ct_leaf_growth_task_t *current = &(growth->tasks[task]);
+	uint32_t node = current->node;
+	while (1)
+	{
+		// Add the node to the region, and its neighbours swept after it to the heap:
+		current->extremum = node;
+		uint32_t num_neighbours = ct_leaf_growth_get_neighbours(growth, node, neighbours);
+		for (uint32_t i = 0; i < num_neighbours; i++)
+		{
+			if (ct_leaf_growth_is_before(growth, node, neighbours[i]) &&
+				ct_leaf_growth_heap_push(growth, current, neighbours[i], error))
+			{
+				return -1;
+			}
+		}
+
+		// Nothing left bordering the region, so the node is a root:
+		if (!current->heap_size) { return 0; }
+
+		// Next node, with one heap entry for each arc from the region that reaches it:
+		node = current->heap[0];
+		uint32_t num_arcs = 0;
+		while (current->heap_size && (current->heap[0] == node))
+		{
+			ct_leaf_growth_heap_pop(growth, current);
+			num_arcs++;
+		}
+
+		if (num_arcs == growth->num_before[node])
+		{
+			growth->parent[current->extremum] = node;
+			continue;
+		}
+
+		// Saddle, where every region but the last to arrive stops:
+		omp_lock_t *lock = &(growth->locks[node % CT_LEAF_GROWTH_NUM_LOCKS]);
+		omp_set_lock(lock);
+		current->next_waiting = growth->waiting[node];
+		growth->waiting[node] = task;
+		growth->num_arrived[node] += num_arcs;
+		uint32_t waiting = CT_LEAF_GROWTH_NONE;
+		if (growth->num_arrived[node] == growth->num_before[node])
+		{
+			waiting = growth->waiting[node];
+			growth->waiting[node] = CT_LEAF_GROWTH_NONE;
+		}
+		omp_unset_lock(lock);
+		if (waiting == CT_LEAF_GROWTH_NONE) { return 0; }
+
+		// Last to arrive, so take over the regions stopped here (this one included):
+		for (; waiting != CT_LEAF_GROWTH_NONE; waiting = growth->tasks[waiting].next_waiting)
+		{
+			growth->parent[growth->tasks[waiting].extremum] = node;
+			if ((waiting != task) && ct_leaf_growth_heap_merge(growth, current,
+							&(growth->tasks[waiting]), error))
+			{
+				return -1;
+			}
+		}
+	}
+}
+
+uint32_t ct_leaf_growth_take_task(ct_leaf_growth_t *growth, uint32_t deque, uint8_t steal)
+{
+	// The owner takes from the bottom of its deque, and thieves from the top:
+	ct_leaf_growth_deque_t *tasks = &(growth->deques[deque]);
+	uint32_t task = CT_LEAF_GROWTH_NONE;
+	omp_set_lock(&(tasks->lock));
+	if (tasks->top < tasks->bottom)
+	{
+		if (steal)
+		{
+			task = tasks->top;
+			tasks->top++;
+		}
+		else
+		{
+			tasks->bottom--;
+			task = tasks->bottom;
+		}
+	}
+	omp_unset_lock(&(tasks->lock));
+	return task;
+}
+
+/*********
+ * Heaps *
+ *********/
+
+int ct_leaf_growth_heap_push(ct_leaf_growth_t *growth, ct_leaf_growth_task_t *task,
+				uint32_t node, char error[NM_MAX_ERROR_LENGTH])
+{
+	if (task->heap_size == task->heap_capacity)
+	{
+		uint32_t capacity = task->heap_capacity ? (task->heap_capacity * 2) : 64;
+		uint32_t *heap = realloc(task->heap, capacity * sizeof(uint32_t));
+		if (!heap)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for leaf heap.");
+			return -1;
+		}
+		task->heap = heap;
+		task->heap_capacity = capacity;
+	}
+
+	// The first node in sweep order is at the top:
+	uint32_t i = task->heap_size;
+	task->heap_size++;
+	while (i > 0)
+	{
+		uint32_t parent = (i - 1) / 2;
+		if (!ct_leaf_growth_is_before(growth, node, task->heap[parent])) { break; }
+		task->heap[i] = task->heap[parent];
+		i = parent;
+	}
+	task->heap[i] = node;
+
+	return 0;
+}
+
+uint32_t ct_leaf_growth_heap_pop(ct_leaf_growth_t *growth, ct_leaf_growth_task_t *task)
+{
+	uint32_t top = task->heap[0];
+	task->heap_size--;
+	uint32_t node = task->heap[task->heap_size];
+	uint32_t i = 0;
+	while (1)
+	{
+		uint32_t child = (2 * i) + 1;
+		if (child >= task->heap_size) { break; }
+		if (((child + 1) < task->heap_size) && ct_leaf_growth_is_before(growth,
+						task->heap[child + 1], task->heap[child]))
+		{
+			child++;
+		}
+		if (!ct_leaf_growth_is_before(growth, task->heap[child], node)) { break; }
+		task->heap[i] = task->heap[child];
+		i = child;
+	}
+	task->heap[i] = node;
+
+	return top;
+}
+
+int ct_leaf_growth_heap_merge(ct_leaf_growth_t *growth, ct_leaf_growth_task_t *task,
+		ct_leaf_growth_task_t *other_task, char error[NM_MAX_ERROR_LENGTH])
+{
+	// The smaller heap is pushed into the larger, so each node moves O(log n) times at most:
+	if (other_task->heap_size > task->heap_size)
+	{
+		uint32_t *heap = task->heap;
+		uint32_t heap_size = task->heap_size;
+		uint32_t heap_capacity = task->heap_capacity;
+		task->heap = other_task->heap;
+		task->heap_size = other_task->heap_size;
+		task->heap_capacity = other_task->heap_capacity;
+		other_task->heap = heap;
+		other_task->heap_size = heap_size;
+		other_task->heap_capacity = heap_capacity;
+	}
+
+	for (uint32_t i = 0; i < other_task->heap_size; i++)
+	{
+		if (ct_leaf_growth_heap_push(growth, task, other_task->heap[i], error)) { return -1; }
+	}
+
+	free(other_task->heap);
+	other_task->heap = NULL;
+	other_task->heap_size = 0;
+	other_task->heap_capacity = 0;
+	return 0;
+}
+
+/***********
+ * Helpers *
+ ***********/
+
+uint32_t ct_leaf_growth_get_neighbours(ct_leaf_growth_t *growth, uint32_t node,
+							uint32_t *neighbours)
+{
+	/* Neighbouring nodes, from the grid or the mesh edges. Arcs are counted per neighbour,
+	 * so a vertex that the edge walk reaches twice is only kept once: */
+	ct_tree_t *merge_tree = growth->merge_tree;
+	uint32_t vertex = merge_tree->nodes[node].node_to_vertex;
+	uint32_t num_neighbours;
+	if (growth->grid)
+	{
+		num_neighbours = ct_volume_get_neighbours(&(growth->mesh->volume), vertex,
+									neighbours);
+	}
+	else
+	{
+		uint32_t num_edges = ct_mesh_get_vertex_neighbours(growth->mesh, vertex, neighbours,
+								growth->max_neighbours);
+		num_neighbours = 0;
+		for (uint32_t i = 0; i < num_edges; i++)
+		{
+			uint32_t j = 0;
+			while ((j < num_neighbours) && (neighbours[j] != neighbours[i])) { j++; }
+			if (j < num_neighbours) { continue; }
+			neighbours[num_neighbours] = neighbours[i];
+			num_neighbours++;
+		}
+	}
+
+	for (uint32_t i = 0; i < num_neighbours; i++)
+	{
+		neighbours[i] = merge_tree->nodes[neighbours[i]].vertex_to_node;
+	}
+	return num_neighbours;
+}
+
+int ct_leaf_growth_is_before(ct_leaf_growth_t *growth, uint32_t node, uint32_t other_node)
+{
+	// Whether node is swept before other_node:
+	return growth->direction ? (node > other_node) : (node < other_node);
+}
+
+#ifdef CT_DEBUG
+int ct_leaf_growth_benchmark(FILE *file, ct_tree_t *tree, ct_mesh_t *mesh,
+					char error[NM_MAX_ERROR_LENGTH])
+{
+	// Times leaf growth against the sweep on fresh copies of the sorted nodes, and compares:
+	char *directions[2] = { "split", "join" };
+	for (int direction = 0; direction < 2; direction++)
+	{
+		ct_tree_t sweep_tree = {0};
+		ct_tree_t leaf_tree = {0};
+		uint32_t start_index = direction ? (tree->num_nodes - 1) : 0;
+		if (ct_tree_copy_nodes(tree, &sweep_tree, error) ||
+			ct_tree_copy_nodes(tree, &leaf_tree, error))
+		{
+			ct_tree_free(&sweep_tree);
+			ct_tree_free(&leaf_tree);
+			return -1;
+		}
+
+		double sweep_time = omp_get_wtime();
+		if (ct_merge_tree_construct(&sweep_tree, mesh, start_index, error))
+		{
+			ct_tree_free(&sweep_tree);
+			ct_tree_free(&leaf_tree);
+			return -1;
+		}
+		sweep_time = omp_get_wtime() - sweep_time;
+
+		double leaf_time = omp_get_wtime();
+		if (ct_merge_tree_construct_leaves(&leaf_tree, mesh, start_index, error))
+		{
+			ct_tree_free(&sweep_tree);
+			ct_tree_free(&leaf_tree);
+			return -1;
+		}
+		leaf_time = omp_get_wtime() - leaf_time;
+
+		int differ = ct_merge_tree_compare(&sweep_tree, &leaf_tree, direction, error);
+
+		fprintf(file, "%s leaf growth: %.3f ms, %d threads (sweep %.3f ms), %s.\n",
+			directions[direction], leaf_time * 1000.0, omp_get_max_threads(),
+			sweep_time * 1000.0, differ ? "trees differ" : "trees match");
+
+		ct_tree_free(&sweep_tree);
+		ct_tree_free(&leaf_tree);
+		if (differ) { return -1; }
+	}
+
+	return 0;
+}
+#endif
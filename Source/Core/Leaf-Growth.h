@@ -0,0 +1,91 @@
+#ifndef CT_LEAF_GROWTH_H
+#define CT_LEAF_GROWTH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <omp.h>
+
+#include <NM-Config/Config.h>
+
+#include "Contour-Tree.h"
+#include "Mesh.h"
+#include "Parallel.h"
+
+#define CT_LEAF_GROWTH_NONE		UINT32_MAX
+#define CT_LEAF_GROWTH_NUM_LOCKS	1024 // Saddles are locked by node index modulo this.
+
+typedef struct
+{
+	uint32_t node;		// Next node to add to the region, the leaf to begin with.
+	uint32_t extremum;	// Last node added to the region.
+	uint32_t next_waiting;	// Next task stopped at the same saddle.
+
+	// Binary heap of nodes bordering the region, once for each arc into the region:
+	uint32_t heap_size;
+	uint32_t heap_capacity;
+	uint32_t *heap;
+} ct_leaf_growth_task_t;
+
+typedef struct
+{
+	omp_lock_t lock;
+	uint32_t top;		// Other threads steal tasks from here.
+	uint32_t bottom;	// The owning thread takes tasks from here.
+} ct_leaf_growth_deque_t;
+
+typedef struct
+{
+	ct_tree_t *merge_tree;
+	ct_mesh_t *mesh;
+	uint8_t direction;		// 1 to sweep high to low (join tree), 0 for low to high.
+	uint8_t grid;
+	uint32_t max_neighbours;
+
+	// Per node:
+	uint32_t *num_before;		// Neighbours swept before the node.
+	uint32_t *num_arrived;		// Arcs from those neighbours that have reached it.
+	uint32_t *waiting;		// First task stopped at the node, while it is a saddle.
+	uint32_t *parent;		// Next node along the sweep in the same component.
+
+	// One task per leaf, split evenly between the deques to begin with:
+	uint32_t num_tasks;
+	ct_leaf_growth_task_t *tasks;
+	uint32_t num_deques;
+	ct_leaf_growth_deque_t *deques;
+	omp_lock_t locks[CT_LEAF_GROWTH_NUM_LOCKS];
+} ct_leaf_growth_t;
+
+// Construction:
+int ct_merge_tree_construct_leaves(ct_tree_t *merge_tree, ct_mesh_t *mesh,
+	uint32_t start_index, char error[NM_MAX_ERROR_LENGTH]);
+int ct_leaf_growth_init(ct_leaf_growth_t *growth, ct_tree_t *merge_tree, ct_mesh_t *mesh,
+				uint8_t direction, char error[NM_MAX_ERROR_LENGTH]);
+void ct_leaf_growth_free(ct_leaf_growth_t *growth);
+
+// Growth:
+int ct_leaf_growth_run(ct_leaf_growth_t *growth, char error[NM_MAX_ERROR_LENGTH]);
+int ct_leaf_growth_grow(ct_leaf_growth_t *growth, uint32_t task, uint32_t *neighbours,
+						char error[NM_MAX_ERROR_LENGTH]);
+uint32_t ct_leaf_growth_take_task(ct_leaf_growth_t *growth, uint32_t deque, uint8_t steal);
+
+// Heaps:
+int ct_leaf_growth_heap_push(ct_leaf_growth_t *growth, ct_leaf_growth_task_t *task,
+				uint32_t node, char error[NM_MAX_ERROR_LENGTH]);
+uint32_t ct_leaf_growth_heap_pop(ct_leaf_growth_t *growth, ct_leaf_growth_task_t *task);
+int ct_leaf_growth_heap_merge(ct_leaf_growth_t *growth, ct_leaf_growth_task_t *task,
+		ct_leaf_growth_task_t *other_task, char error[NM_MAX_ERROR_LENGTH]);
+
+// Helpers:
+uint32_t ct_leaf_growth_get_neighbours(ct_leaf_growth_t *growth, uint32_t node,
+							uint32_t *neighbours);
+int ct_leaf_growth_is_before(ct_leaf_growth_t *growth, uint32_t node, uint32_t other_node);
+
+#ifdef CT_DEBUG
+int ct_leaf_growth_benchmark(FILE *file, ct_tree_t *tree, ct_mesh_t *mesh,
+					char error[NM_MAX_ERROR_LENGTH]);
+#endif
+
+#endif
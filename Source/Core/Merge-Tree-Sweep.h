@@ -0,0 +1,90 @@
+/* Merge tree sweep kernel, included by Contour-Tree.c once per sweep direction and neighbour
+ * source so that both are compile-time constants (there is no include guard for this reason).
+ * Before each inclusion, define:
+ *	CT_SWEEP_NAME		- name of the kernel function.
+ *	CT_SWEEP_DIRECTION	- 1 to sweep high to low (join tree), 0 for low to high (split tree).
+ *	CT_SWEEP_GRID		- 1 to take neighbours from the volume grid, 0 to walk mesh edges.
+ * The kernel returns the number of neighbours visited, for benchmarking. */
+
+uint64_t CT_SWEEP_NAME(ct_tree_t *merge_tree, ct_mesh_t *mesh, ct_disjoint_set_t *disjoint_set)
+{
+	uint32_t current_arc[2] = { 0, merge_tree->num_nodes - 1 }; // Up[0], down[1].
+	uint32_t current_vertex;
+	uint32_t adjacent_node;
+	uint32_t component;
+	uint64_t num_visits = 0;
+	#if CT_SWEEP_GRID
+	uint32_t num_neighbours;
+	uint32_t neighbours[CT_GRID_MAX_NEIGHBOURS];
+	#else
+	uint32_t current_edge;
+	uint32_t adjacent_vertex;
+	uint32_t previous_adjacent_vertex;
+	#endif
+
+	for (uint32_t step = 0; step < merge_tree->num_nodes; step++)
+	{
+		#if CT_SWEEP_DIRECTION
+		uint32_t i = merge_tree->num_nodes - step - 1;
+		#else
+		uint32_t i = step;
+		#endif
+
+		merge_tree->nodes[i].first_arc[!CT_SWEEP_DIRECTION] =
+					current_arc[!CT_SWEEP_DIRECTION];
+		current_vertex = merge_tree->nodes[i].node_to_vertex;
+		component = i; // Not yet joined to anything.
+
+		#if CT_SWEEP_GRID
+		num_neighbours = ct_volume_get_neighbours(&(mesh->volume), current_vertex,
+									neighbours);
+		num_visits += num_neighbours;
+		for (uint32_t j = 0; j < num_neighbours; j++)
+		{
+			// Only neighbours already swept past are merged:
+			adjacent_node = merge_tree->nodes[neighbours[j]].vertex_to_node;
+			if (CT_SWEEP_DIRECTION ? (adjacent_node > i) : (adjacent_node < i))
+			{
+				component = ct_merge_tree_add_arc(merge_tree, disjoint_set, i,
+					component, adjacent_node, current_arc, CT_SWEEP_DIRECTION);
+			}
+		}
+		#else
+		current_edge = mesh->first_edge[current_vertex];
+		adjacent_vertex = current_vertex;
+		while (1)
+		{
+			previous_adjacent_vertex = adjacent_vertex;
+			if (mesh->edges[current_edge].from == current_vertex)
+			{
+				adjacent_vertex = mesh->edges[current_edge].to;
+			}
+			else { adjacent_vertex = mesh->edges[current_edge].from; }
+			num_visits++;
+
+			// Only neighbours already swept past are merged:
+			adjacent_node = merge_tree->nodes[adjacent_vertex].vertex_to_node;
+			if ((adjacent_vertex != previous_adjacent_vertex) && (CT_SWEEP_DIRECTION ?
+				(adjacent_node > i) : (adjacent_node < i)))
+			{
+				component = ct_merge_tree_add_arc(merge_tree, disjoint_set, i,
+					component, adjacent_node, current_arc, CT_SWEEP_DIRECTION);
+			}
+
+			current_edge = ct_mesh_get_next_vertex_edge(mesh, current_vertex,
+									current_edge);
+			if ((current_edge == UINT32_MAX) || (mesh->edges[current_edge].other_half ==
+								mesh->first_edge[current_vertex]))
+			{
+				break;
+			}
+		}
+		#endif
+	}
+
+	return num_visits;
+}
+
+#undef CT_SWEEP_NAME
+#undef CT_SWEEP_DIRECTION
+#undef CT_SWEEP_GRID
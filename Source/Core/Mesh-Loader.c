@@ -2,10 +2,13 @@
 
 int ct_mesh_load(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
 {
-	// Get extension:
+	// Get extension (of the inner file, for compressed files):
 	char extension[NM_MAX_PATH_LENGTH];
-	int current_position = strlen(mesh->path) - 1;
-	while (1)
+	int path_length = strlen(mesh->path);
+	uint8_t compressed = ct_path_is_compressed(mesh->path);
+	if (compressed) { path_length -= 3; }
+	int current_position = path_length - 1;
+	while (current_position >= 0)
 	{
 		if (mesh->path[current_position] == '.') { break; }
 		if (current_position == 0)
@@ -16,7 +19,9 @@ int ct_mesh_load(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
 		}
 		current_position--;
 	}
-	strcpy(extension, &(mesh->path[current_position]));
+	if (current_position < 0) { current_position = 0; }
+	memcpy(extension, &(mesh->path[current_position]), path_length - current_position);
+	extension[path_length - current_position] = '\0';
 	current_position = 0;
 	while (extension[current_position] != '\0')
 	{
@@ -28,10 +33,18 @@ int ct_mesh_load(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
 	{
 		if (ct_mesh_load_obj(mesh, error)) { return -1; }
 	}
+	else if (!strcmp(extension, ".stl") && !compressed)
+	{
+		if (ct_mesh_load_stl(mesh, error)) { return -1; }
+	}
 	else if (!strcmp(extension, ".txt"))
 	{
 		if (ct_mesh_load_voxels(mesh, error)) { return -1; }
 	}
+	else if (!strcmp(extension, ".vol"))
+	{
+		if (ct_mesh_load_volume(mesh, error)) { return -1; }
+	}
 	else
 	{
 		snprintf(error, NM_MAX_ERROR_LENGTH,
@@ -49,6 +62,44 @@ int ct_mesh_load(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
 	return 0;
 }
 
+void *ct_file_map(char *path, size_t *size, uint8_t writable,
+					char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Private mapping of a whole file. Pages are only read in when touched. If writable,
+	 * written pages are copied on write, so the file itself is never changed. */
+	int descriptor = open(path, O_RDONLY);
+	if (descriptor < 0)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not open file \"%s\".", path);
+		return NULL;
+	}
+
+	struct stat status;
+	if (fstat(descriptor, &status) || (status.st_size <= 0))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not get size of file \"%s\".", path);
+		close(descriptor);
+		return NULL;
+	}
+	*size = status.st_size;
+
+	void *data = mmap(NULL, *size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+							MAP_PRIVATE, descriptor, 0);
+	close(descriptor);
+	if (data == MAP_FAILED)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not map file \"%s\".", path);
+		return NULL;
+	}
+
+	return data;
+}
+
+void ct_file_unmap(void *data, size_t size)
+{
+	if (data) { munmap(data, size); }
+}
+
 /**************
  * OBJ meshes *
  **************/
@@ -152,48 +203,150 @@ int ct_mesh_load_obj(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
 
 int ct_mesh_write_obj(FILE *file, ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
 {
+	/* Each section is formatted in rounds. In a round, every thread formats a chunk of
+	 * lines into its own part of one buffer, then the chunks are written out in order.
+	 * Floats are written with the fewest digits that read back to the same value. */
+
 	if (ct_mesh_check_validity(mesh, error)) { return -1; }
 
 	fprintf(file, "#\n# Generated by https://github.com/Nell-Mills/Mesh-Processing\n");
 	fprintf(file, "# (For testing purposes)\n#\n");
 
-	for (uint32_t i = 0; i < mesh->num_vertices; i++)
+	int max_threads = omp_get_max_threads();
+	char *buffer = malloc((size_t)max_threads * CT_OBJ_WRITE_CHUNK * CT_OBJ_MAX_LINE_LENGTH);
+	if (!buffer)
 	{
-		fprintf(file, "v %f %f %f\n", mesh->vertices[i].x,
-			mesh->vertices[i].y, mesh->vertices[i].z);
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Could not allocate write memory for mesh \"%s\".", mesh->name);
+		return -1;
 	}
 
-	for (uint32_t i = 0; i < mesh->num_normals; i++)
+	if (ct_obj_write_section(file, mesh, mesh->num_vertices, ct_obj_format_vertex, buffer,
+									error) ||
+		ct_obj_write_section(file, mesh, mesh->num_normals, ct_obj_format_normal,
+									buffer, error) ||
+		ct_obj_write_section(file, mesh, mesh->num_uvs, ct_obj_format_uv, buffer,
+									error) ||
+		ct_obj_write_section(file, mesh, mesh->num_faces, ct_obj_format_face, buffer,
+									error))
 	{
-		fprintf(file, "vn %f %f %f\n", (mesh->normals[i].x * 1.f) / 127.5f,
-						(mesh->normals[i].y * 1.f) / 127.5f,
-						(mesh->normals[i].z * 1.f) / 127.5f);
+		free(buffer);
+		return -1;
 	}
 
-	for (uint32_t i = 0; i < mesh->num_uvs; i++)
-	{
-		fprintf(file, "vt %f %f\n", mesh->uvs[i].u, mesh->uvs[i].v);
-	}
+	free(buffer);
+	return 0;
+}
 
-	for (uint32_t i = 0; i < mesh->num_faces; i++)
+int ct_obj_write_section(FILE *file, ct_mesh_t *mesh, uint32_t num_lines,
+		ct_obj_formatter_t format, char *buffer, char error[NM_MAX_ERROR_LENGTH])
+{
+	int max_threads = omp_get_max_threads();
+	size_t chunk_lengths[max_threads];
+	uint64_t round_size = (uint64_t)max_threads * CT_OBJ_WRITE_CHUNK;
+	for (uint64_t round_start = 0; round_start < num_lines; round_start += round_size)
 	{
-		fprintf(file, "f");
-		for (int j = 0; j < 3; j++)
+		int num_chunks = ((num_lines - round_start) + CT_OBJ_WRITE_CHUNK - 1) /
+								CT_OBJ_WRITE_CHUNK;
+		if (num_chunks > max_threads) { num_chunks = max_threads; }
+
+		#pragma omp parallel for if (num_chunks > 1)
+		for (int i = 0; i < num_chunks; i++)
 		{
-			fprintf(file, " %u/%u/%u", mesh->faces[i][j].v + 1,
-						mesh->faces[i][j].u + 1,
-						mesh->faces[i][j].n + 1);
+			char *chunk_start = &(buffer[(size_t)i * CT_OBJ_WRITE_CHUNK *
+							CT_OBJ_MAX_LINE_LENGTH]);
+			char *position = chunk_start;
+			uint64_t begin = round_start + ((uint64_t)i * CT_OBJ_WRITE_CHUNK);
+			uint64_t end = begin + CT_OBJ_WRITE_CHUNK;
+			if (end > num_lines) { end = num_lines; }
+			for (uint64_t j = begin; j < end; j++) { position = format(position, mesh, j); }
+			chunk_lengths[i] = position - chunk_start;
+		}
+
+		for (int i = 0; i < num_chunks; i++)
+		{
+			if (fwrite(&(buffer[(size_t)i * CT_OBJ_WRITE_CHUNK * CT_OBJ_MAX_LINE_LENGTH]),
+				1, chunk_lengths[i], file) != chunk_lengths[i])
+			{
+				snprintf(error, NM_MAX_ERROR_LENGTH,
+					"Could not write mesh \"%s\" to file.", mesh->name);
+				return -1;
+			}
 		}
-		fprintf(file, "\n");
 	}
 
 	return 0;
 }
 
+char *ct_obj_format_vertex(char *position, ct_mesh_t *mesh, uint32_t index)
+{
+	*(position++) = 'v';
+	*(position++) = ' ';
+	position = ct_format_float(position, mesh->vertices[index].x);
+	*(position++) = ' ';
+	position = ct_format_float(position, mesh->vertices[index].y);
+	*(position++) = ' ';
+	position = ct_format_float(position, mesh->vertices[index].z);
+	*(position++) = '\n';
+	return position;
+}
+
+char *ct_obj_format_normal(char *position, ct_mesh_t *mesh, uint32_t index)
+{
+	*(position++) = 'v';
+	*(position++) = 'n';
+	*(position++) = ' ';
+	position = ct_format_float(position, (mesh->normals[index].x * 1.f) / 127.5f);
+	*(position++) = ' ';
+	position = ct_format_float(position, (mesh->normals[index].y * 1.f) / 127.5f);
+	*(position++) = ' ';
+	position = ct_format_float(position, (mesh->normals[index].z * 1.f) / 127.5f);
+	*(position++) = '\n';
+	return position;
+}
+
+char *ct_obj_format_uv(char *position, ct_mesh_t *mesh, uint32_t index)
+{
+	*(position++) = 'v';
+	*(position++) = 't';
+	*(position++) = ' ';
+	position = ct_format_float(position, mesh->uvs[index].u);
+	*(position++) = ' ';
+	position = ct_format_float(position, mesh->uvs[index].v);
+	*(position++) = '\n';
+	return position;
+}
+
+char *ct_obj_format_face(char *position, ct_mesh_t *mesh, uint32_t index)
+{
+	*(position++) = 'f';
+	for (int j = 0; j < 3; j++)
+	{
+		*(position++) = ' ';
+		position = ct_format_uint(position, mesh->faces[index][j].v + 1);
+		*(position++) = '/';
+		position = ct_format_uint(position, mesh->faces[index][j].u + 1);
+		*(position++) = '/';
+		position = ct_format_uint(position, mesh->faces[index][j].n + 1);
+	}
+	*(position++) = '\n';
+	return position;
+}
+
 void tinyobj_file_reader_callback(void *ctx, const char *filename, const int is_mtl,
 				const char *obj_filename, char **data, size_t *len)
 {
-	*data = SDL_LoadFile(filename, len);
+	if (ct_path_is_compressed(filename))
+	{
+		// TinyOBJLoader-C parses from one buffer, so decompress it all:
+		char error[NM_MAX_ERROR_LENGTH];
+		if (ct_stream_read_all((char *)filename, data, len, error))
+		{
+			*data = NULL;
+			*len = 0;
+		}
+	}
+	else { *data = SDL_LoadFile(filename, len); }
 }
 
 void tinyobj_free(tinyobj_attrib_t *attrib, size_t num_shapes, tinyobj_shape_t *shapes,
@@ -204,6 +357,335 @@ void tinyobj_free(tinyobj_attrib_t *attrib, size_t num_shapes, tinyobj_shape_t *
 	tinyobj_materials_free(materials, num_materials);
 }
 
+/**************
+ * STL meshes *
+ **************/
+
+int ct_mesh_load_stl(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Binary STL: 80 byte header, triangle count, then 50 bytes per triangle (normal,
+	 * three positions, attribute count). Every triangle stores its own corners, so the
+	 * corners are welded into shared vertices before the mesh can be used for edges. */
+
+	size_t data_size;
+	uint8_t *data = ct_file_map(mesh->path, &data_size, 0, error);
+	if (!data) { return -1; }
+
+	uint32_t num_triangles = 0;
+	if (data_size >= 84) { memcpy(&num_triangles, &(data[80]), sizeof(uint32_t)); }
+	if ((data_size < 84) || (data_size != (84 + ((uint64_t)num_triangles * 50))))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "File for mesh \"%s\" is not a binary STL "
+			"(ASCII STL is not supported).", mesh->name);
+		ct_file_unmap(data, data_size);
+		return -1;
+	}
+	if (!num_triangles)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Mesh \"%s\" has no faces.", mesh->name);
+		ct_file_unmap(data, data_size);
+		return -1;
+	}
+	if (((uint64_t)num_triangles * 3) >= UINT32_MAX)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Mesh \"%s\" is too large.", mesh->name);
+		ct_file_unmap(data, data_size);
+		return -1;
+	}
+
+	// Unpack corner positions (triangle records are not 4-byte aligned):
+	uint32_t num_corners = num_triangles * 3;
+	ct_vertex_t *corners = malloc(num_corners * sizeof(ct_vertex_t));
+	uint32_t *remap = malloc(num_corners * sizeof(uint32_t));
+	uint32_t *vertex_ids = malloc(num_corners * sizeof(uint32_t));
+	uint32_t *face_ids = malloc(num_triangles * sizeof(uint32_t));
+	if (!corners || !remap || !vertex_ids || !face_ids)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Could not allocate corner memory for mesh \"%s\".", mesh->name);
+		goto error;
+	}
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_triangles; i++)
+	{
+		memcpy(&(corners[i * 3]), &(data[84 + ((size_t)i * 50) + 12]),
+						3 * sizeof(ct_vertex_t));
+	}
+
+	if (ct_mesh_weld_positions(corners, num_corners, mesh->weld_epsilon, remap, error))
+	{
+		goto error;
+	}
+
+	// Number the surviving vertices and faces (welding can collapse triangles):
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_corners; i++) { vertex_ids[i] = (remap[i] == i); }
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_triangles; i++)
+	{
+		face_ids[i] = ((remap[i * 3] != remap[(i * 3) + 1]) &&
+				(remap[(i * 3) + 1] != remap[(i * 3) + 2]) &&
+				(remap[(i * 3) + 2] != remap[i * 3]));
+	}
+
+	mesh->num_vertices = ct_parallel_prefix_sum(vertex_ids, num_corners);
+	mesh->num_faces = ct_parallel_prefix_sum(face_ids, num_triangles);
+	mesh->num_normals = mesh->num_faces;
+	mesh->num_colours = 1;
+	mesh->num_uvs = 1;
+	mesh->num_edges = mesh->num_faces * 3;
+
+	if (!mesh->num_faces)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Mesh \"%s\" has no faces after welding.", mesh->name);
+		goto error;
+	}
+
+	if (ct_mesh_allocate(mesh, error)) { goto error; }
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_corners; i++)
+	{
+		if (remap[i] == i) { mesh->vertices[vertex_ids[i]] = corners[i]; }
+	}
+
+	// Faces use the facet normal from the file:
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_triangles; i++)
+	{
+		if ((remap[i * 3] == remap[(i * 3) + 1]) ||
+			(remap[(i * 3) + 1] == remap[(i * 3) + 2]) ||
+			(remap[(i * 3) + 2] == remap[i * 3])) { continue; }
+
+		uint32_t face = face_ids[i];
+
+		float normal[3];
+		memcpy(normal, &(data[84 + ((size_t)i * 50)]), 3 * sizeof(float));
+		mesh->normals[face].x = normal[0] * 127.5f;
+		mesh->normals[face].y = normal[1] * 127.5f;
+		mesh->normals[face].z = normal[2] * 127.5f;
+
+		for (int j = 0; j < 3; j++)
+		{
+			mesh->faces[face][j].v = vertex_ids[remap[(i * 3) + j]];
+			mesh->faces[face][j].n = face;
+			mesh->faces[face][j].c = 0;
+			mesh->faces[face][j].u = 0;
+		}
+	}
+
+	mesh->colours[0].r = mesh->colours[0].g = mesh->colours[0].b = mesh->colours[0].a = 255;
+
+	free(face_ids);
+	free(vertex_ids);
+	free(remap);
+	free(corners);
+	ct_file_unmap(data, data_size);
+	return 0;
+
+	error:
+	if (face_ids) { free(face_ids); }
+	if (vertex_ids) { free(vertex_ids); }
+	if (remap) { free(remap); }
+	if (corners) { free(corners); }
+	ct_file_unmap(data, data_size);
+	return -1;
+}
+
+int ct_mesh_weld_positions(ct_vertex_t *positions, uint32_t num_positions, float epsilon,
+				uint32_t *remap, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Spatial hash weld. Positions are bucketed by grid cell (cell size epsilon, or the
+	 * exact bit pattern when epsilon is 0), buckets are formed with a parallel radix sort
+	 * and found through an open-addressed table. Each position then picks the lowest
+	 * indexed position within epsilon in its own and neighbouring cells, and chains are
+	 * followed to their end. On return, remap holds the index of the position each one was
+	 * merged into (itself for the first of each vertex), independent of thread count. */
+
+	uint8_t exact = !(epsilon > 0.f);
+	uint32_t *run_starts = NULL;
+	uint32_t *table = NULL;
+	ct_sort_pair_t *pairs = malloc(num_positions * sizeof(ct_sort_pair_t));
+	uint32_t *nearest = malloc(num_positions * sizeof(uint32_t));
+	if (!pairs || !nearest)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for welding.");
+		goto error;
+	}
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_positions; i++)
+	{
+		// Treat -0 and +0 as the same coordinate:
+		if (positions[i].x == 0.f) { positions[i].x = 0.f; }
+		if (positions[i].y == 0.f) { positions[i].y = 0.f; }
+		if (positions[i].z == 0.f) { positions[i].z = 0.f; }
+
+		if (exact)
+		{
+			uint32_t bits[3];
+			memcpy(bits, &(positions[i]), sizeof(bits));
+			pairs[i].key = ct_mesh_weld_key(bits[0], bits[1], bits[2]);
+		}
+		else
+		{
+			pairs[i].key = ct_mesh_weld_key(floorf(positions[i].x / epsilon),
+							floorf(positions[i].y / epsilon),
+							floorf(positions[i].z / epsilon));
+		}
+		pairs[i].value = i;
+	}
+
+	// Stable, so each bucket is in index order:
+	if (ct_parallel_sort_pairs(pairs, num_positions, 64, error)) { goto error; }
+
+	if (exact)
+	{
+		// Only the position's own bucket needs searching:
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < num_positions; i++)
+		{
+			uint32_t start = i;
+			while ((start > 0) && (pairs[start - 1].key == pairs[i].key)) { start--; }
+
+			ct_vertex_t *position = &(positions[pairs[i].value]);
+			for (uint32_t j = start; j <= i; j++)
+			{
+				ct_vertex_t *other = &(positions[pairs[j].value]);
+				if ((other->x == position->x) && (other->y == position->y) &&
+					(other->z == position->z))
+				{
+					nearest[pairs[i].value] = pairs[j].value;
+					break;
+				}
+			}
+		}
+	}
+	else
+	{
+		// Find runs of equal keys (one per occupied cell, barring hash collisions):
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < num_positions; i++)
+		{
+			nearest[i] = ((i == 0) || (pairs[i].key != pairs[i - 1].key));
+		}
+		uint32_t num_runs = ct_parallel_prefix_sum(nearest, num_positions);
+
+		uint32_t table_size = 1;
+		while (table_size < (num_runs * 2)) { table_size *= 2; }
+		run_starts = malloc((num_runs + 1) * sizeof(uint32_t));
+		table = malloc(table_size * sizeof(uint32_t));
+		if (!run_starts || !table)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH,
+				"Could not allocate memory for welding hash table.");
+			goto error;
+		}
+		memset(table, 0, table_size * sizeof(uint32_t));
+
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < num_positions; i++)
+		{
+			if ((i == 0) || (pairs[i].key != pairs[i - 1].key))
+			{
+				run_starts[nearest[i]] = i;
+			}
+		}
+		run_starts[num_runs] = num_positions;
+
+		// Keys are unique per run, so insertion only has to claim an empty slot:
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < num_runs; i++)
+		{
+			uint32_t slot = pairs[run_starts[i]].key & (table_size - 1);
+			while (!__sync_bool_compare_and_swap(&(table[slot]), 0, i + 1))
+			{
+				slot = (slot + 1) & (table_size - 1);
+			}
+		}
+
+		float epsilon_squared = epsilon * epsilon;
+
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < num_positions; i++)
+		{
+			ct_vertex_t *position = &(positions[i]);
+			int64_t cell[3] = { floorf(position->x / epsilon),
+					floorf(position->y / epsilon),
+					floorf(position->z / epsilon) };
+			uint32_t best = i;
+			for (int j = 0; j < 27; j++)
+			{
+				uint64_t key = ct_mesh_weld_key(cell[0] + (j % 3) - 1,
+							cell[1] + ((j / 3) % 3) - 1,
+							cell[2] + (j / 9) - 1);
+				uint32_t slot = key & (table_size - 1);
+				while (table[slot] && (pairs[run_starts[table[slot] - 1]].key != key))
+				{
+					slot = (slot + 1) & (table_size - 1);
+				}
+				if (!table[slot]) { continue; }
+
+				// Runs are in index order, so stop once past the best so far:
+				uint32_t run = table[slot] - 1;
+				for (uint32_t k = run_starts[run]; k < run_starts[run + 1]; k++)
+				{
+					uint32_t other = pairs[k].value;
+					if (other >= best) { break; }
+					float x = positions[other].x - position->x;
+					float y = positions[other].y - position->y;
+					float z = positions[other].z - position->z;
+					if (((x * x) + (y * y) + (z * z)) <= epsilon_squared)
+					{
+						best = other;
+						break;
+					}
+				}
+			}
+			remap[i] = best;
+		}
+
+		memcpy(nearest, remap, num_positions * sizeof(uint32_t));
+	}
+
+	// Follow chains to the position each one ends up merged into:
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_positions; i++)
+	{
+		uint32_t root = nearest[i];
+		while (nearest[root] != root) { root = nearest[root]; }
+		remap[i] = root;
+	}
+
+	if (table) { free(table); }
+	if (run_starts) { free(run_starts); }
+	free(nearest);
+	free(pairs);
+	return 0;
+
+	error:
+	if (table) { free(table); }
+	if (run_starts) { free(run_starts); }
+	if (nearest) { free(nearest); }
+	if (pairs) { free(pairs); }
+	return -1;
+}
+
+uint64_t ct_mesh_weld_key(int64_t x, int64_t y, int64_t z)
+{
+	// Mix three (wrapped) 32-bit cell coordinates into a 64-bit key:
+	uint64_t key = ((uint64_t)(uint32_t)x * 0x9E3779B97F4A7C15ULL) ^
+			((uint64_t)(uint32_t)y * 0xC2B2AE3D27D4EB4FULL) ^
+			((uint64_t)(uint32_t)z * 0x165667B19E3779F9ULL);
+	key ^= key >> 29;
+	key *= 0xBF58476D1CE4E5B9ULL;
+	key ^= key >> 32;
+	return key;
+}
+
 /****************
  * Voxel meshes *
  ****************/
@@ -221,60 +703,180 @@ int ct_mesh_load_voxels(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
 	 * f . f
 	 *
 	 * Where X Y and Z are the number of voxels in each dimension, and are
-	 * followed by the data in matrix form (Z slices, 1 float per voxel). */
+	 * followed by the data in matrix form (Z slices, 1 float per voxel).
+	 *
+	 * The values are parsed in parallel, see ct_parse_floats. */
+
+	if (ct_path_is_compressed(mesh->path)) { return ct_mesh_load_voxels_stream(mesh, error); }
 
-	FILE *file = fopen(mesh->path, "r");
-	if (!file)
+	size_t data_size;
+	char *data = ct_file_map(mesh->path, &data_size, 0, error);
+	if (!data) { return -1; }
+
+	char *end = data + data_size;
+	uint32_t dimensions[3];
+	char *position = ct_parse_voxel_dimensions(data, end, dimensions);
+	if (!dimensions[0] || !dimensions[1] || !dimensions[2])
 	{
 		snprintf(error, NM_MAX_ERROR_LENGTH,
-			"Could not open file \"%s\" for mesh \"%s\".", mesh->path, mesh->name);
+			"Voxel X, Y or Z dimension is 0 for mesh \"%s\".", mesh->name);
+		ct_file_unmap(data, data_size);
 		return -1;
 	}
 
-	if (fseek(file, 0, SEEK_END))
+	uint64_t num_voxels = (uint64_t)dimensions[0] * dimensions[1] * dimensions[2];
+	float *voxels = malloc(num_voxels * sizeof(float));
+	if (!voxels)
 	{
 		snprintf(error, NM_MAX_ERROR_LENGTH,
-			"Could not navigate file \"%s\" for mesh \"%s\".", mesh->path, mesh->name);
-		fclose(file);
+			"Could not allocate voxel memory for mesh \"%s\".", mesh->name);
+		ct_file_unmap(data, data_size);
 		return -1;
 	}
-	size_t data_size = ftell(file);
-	if (data_size == (size_t)(-1))
+
+	uint64_t num_values;
+	int result = ct_parse_floats(position, end, voxels, num_voxels, &num_values,
+								mesh->name, error);
+	ct_file_unmap(data, data_size);
+	if (!result && (num_values < num_voxels))
 	{
+		// Prematurely ran out of values:
 		snprintf(error, NM_MAX_ERROR_LENGTH,
-			"Could not get position in file \"%s\" for mesh \"%s\".",
-			mesh->path, mesh->name);
-		fclose(file);
+			"Not enough voxel values in file for mesh \"%s\".", mesh->name);
+		result = -1;
+	}
+	if (result)
+	{
+		free(voxels);
 		return -1;
 	}
-	rewind(file);
 
-	char *data = malloc(data_size + 1);
-	if (!data)
+	ct_volume_free(&(mesh->volume));
+	memcpy(mesh->volume.dimensions, dimensions, sizeof(dimensions));
+	mesh->volume.spacing[0] = mesh->volume.spacing[1] = mesh->volume.spacing[2] = 1.f;
+	mesh->volume.scalar_type = CT_VOLUME_TYPE_FLOAT32;
+	mesh->volume.scalars = voxels;
+
+	return 0;
+}
+
+int ct_mesh_load_voxels_stream(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Same format, compressed. Each decompressed block is parsed (in parallel) while the
+	 * next one is being decompressed. A value split across blocks is carried over to the
+	 * front of the next, so only about a block is ever held as text. */
+
+	ct_stream_t stream;
+	if (ct_stream_open(&stream, mesh->path, error)) { return -1; }
+
+	uint32_t dimensions[3] = { 0, 0, 0 };
+	uint64_t num_voxels = 0;
+	uint64_t num_values = 0;
+	float *voxels = NULL;
+	size_t carry_size = 0;
+	char *text = malloc(2 * CT_STREAM_BLOCK_SIZE);
+	if (!text)
 	{
 		snprintf(error, NM_MAX_ERROR_LENGTH,
-			"Could not allocate data buffer memory for mesh \"%s\".", mesh->name);
-		fclose(file);
-		return -1;
+			"Could not allocate text memory for mesh \"%s\".", mesh->name);
+		goto error;
+	}
+
+	uint8_t *block;
+	size_t block_size;
+	while (1)
+	{
+		if (ct_stream_next_block(&stream, &block, &block_size, error)) { goto error; }
+		if (block_size) { memcpy(&(text[carry_size]), block, block_size); }
+		char *position = text;
+		char *end = &(text[carry_size + block_size]);
+
+		// Hold back a value that might continue in the next block:
+		char *parse_end = end;
+		if (block_size)
+		{
+			while ((parse_end > text) && !isspace(parse_end[-1])) { parse_end--; }
+		}
+
+		if (!voxels)
+		{
+			position = ct_parse_voxel_dimensions(position, parse_end, dimensions);
+			if (!dimensions[0] || !dimensions[1] || !dimensions[2])
+			{
+				if (block_size && ((end - text) < CT_STREAM_BLOCK_SIZE))
+				{
+					// The dimensions continue in the next block:
+					carry_size = end - text;
+					continue;
+				}
+				snprintf(error, NM_MAX_ERROR_LENGTH,
+					"Voxel X, Y or Z dimension is 0 for mesh \"%s\".", mesh->name);
+				goto error;
+			}
+
+			num_voxels = (uint64_t)dimensions[0] * dimensions[1] * dimensions[2];
+			voxels = malloc(num_voxels * sizeof(float));
+			if (!voxels)
+			{
+				snprintf(error, NM_MAX_ERROR_LENGTH,
+					"Could not allocate voxel memory for mesh \"%s\".", mesh->name);
+				goto error;
+			}
+		}
+
+		if (position < parse_end)
+		{
+			uint64_t num_parsed;
+			if (ct_parse_floats(position, parse_end, &(voxels[num_values]),
+				num_voxels - num_values, &num_parsed, mesh->name, error))
+			{
+				goto error;
+			}
+			num_values += num_parsed;
+		}
+		if (!block_size || (num_values == num_voxels)) { break; }
+
+		carry_size = end - parse_end;
+		if (carry_size > CT_VOXEL_MAX_VALUE_LENGTH)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH,
+				"Invalid voxel value in file for mesh \"%s\".", mesh->name);
+			goto error;
+		}
+		memmove(text, parse_end, carry_size);
 	}
-	if (fread(data, data_size, 1, file) != data_size)
+
+	if (num_values < num_voxels)
 	{
 		snprintf(error, NM_MAX_ERROR_LENGTH,
-			"Could not read data from file \"%s\" for mesh \"%s\".",
-			mesh->path, mesh->name);
-		free(data);
-		fclose(file);
-		return -1;
+			"Not enough voxel values in file for mesh \"%s\".", mesh->name);
+		goto error;
 	}
-	fclose(file);
 
-	char *position = data;
-	char *end = data + data_size;
+	free(text);
+	ct_stream_close(&stream);
 
-	// Parse voxel dimensions:
-	uint32_t dimensions[3] = { 0, 0, 0 };
+	ct_volume_free(&(mesh->volume));
+	memcpy(mesh->volume.dimensions, dimensions, sizeof(dimensions));
+	mesh->volume.spacing[0] = mesh->volume.spacing[1] = mesh->volume.spacing[2] = 1.f;
+	mesh->volume.scalar_type = CT_VOLUME_TYPE_FLOAT32;
+	mesh->volume.scalars = voxels;
+
+	return 0;
+
+	error:
+	if (voxels) { free(voxels); }
+	if (text) { free(text); }
+	ct_stream_close(&stream);
+	return -1;
+}
+
+char *ct_parse_voxel_dimensions(char *position, char *end, uint32_t dimensions[3])
+{
+	// Returns the position after the dimensions. Missing dimensions are left at 0.
 	for (int i = 0; i < 3; i++)
 	{
+		dimensions[i] = 0;
 		while ((position < end) && isspace(*position)) { position++; }
 		while ((position < end) && (*position >= '0') && (*position <= '9'))
 		{
@@ -283,68 +885,368 @@ int ct_mesh_load_voxels(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
 		}
 	}
 
-	if (!dimensions[0] || !dimensions[1] || !dimensions[2])
+	return position;
+}
+
+int ct_parse_floats(char *start, char *end, float *values, uint64_t max_values,
+		uint64_t *num_values, char *name, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Parses whitespace separated values in parallel. The text is split into chunks, each
+	 * owning the values that start inside it, a counting pass and prefix sum give each
+	 * chunk its output offset, and then each chunk converts its own values. Values past
+	 * max_values are ignored, and num_values is set to the number stored. */
+
+	size_t text_size = end - start;
+	uint32_t num_chunks = omp_get_max_threads() * 4; // Evens out differing value lengths.
+	if (text_size < CT_PARALLEL_THRESHOLD) { num_chunks = 1; }
+	uint64_t *chunk_offsets = malloc((num_chunks + 1) * sizeof(uint64_t));
+	if (!chunk_offsets)
 	{
-		snprintf(error, NM_MAX_ERROR_LENGTH,
-			"Voxel X, Y or Z dimension is 0 for mesh \"%s\".", mesh->name);
-		free(data);
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for parsing.");
 		return -1;
 	}
 
-	// Parse voxel data:
-	uint32_t num_voxels = dimensions[0] * dimensions[1] * dimensions[2];
-	float *voxels = malloc(num_voxels * sizeof(float));
-	if (!voxels)
+	// Count the values starting in each chunk:
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (uint32_t i = 0; i < num_chunks; i++)
 	{
-		snprintf(error, NM_MAX_ERROR_LENGTH,
-			"Could not allocate voxel memory for mesh \"%s\".", mesh->name);
-		free(data);
-		return -1;
+		char *current = start + ((text_size * i) / num_chunks);
+		char *chunk_end = start + ((text_size * (i + 1)) / num_chunks);
+		uint64_t count = 0;
+		uint8_t in_value = ((current > start) && !isspace(current[-1]));
+		for (; current < chunk_end; current++)
+		{
+			if (isspace(*current)) { in_value = 0; }
+			else if (!in_value)
+			{
+				in_value = 1;
+				count++;
+			}
+		}
+		chunk_offsets[i + 1] = count;
 	}
-	memset(voxels, 0, num_voxels * sizeof(float));
 
-	for (uint32_t i = 0; i < num_voxels; i++)
+	chunk_offsets[0] = 0;
+	for (uint32_t i = 0; i < num_chunks; i++) { chunk_offsets[i + 1] += chunk_offsets[i]; }
+	*num_values = chunk_offsets[num_chunks];
+
+	// Convert values:
+	int invalid = 0;
+	#pragma omp parallel for schedule(dynamic, 1) shared(invalid)
+	for (uint32_t i = 0; i < num_chunks; i++)
 	{
-		if (position == end)
+		if (invalid || (chunk_offsets[i] >= max_values)) { continue; }
+
+		char *current = start + ((text_size * i) / num_chunks);
+		char *chunk_end = start + ((text_size * (i + 1)) / num_chunks);
+		uint64_t index = chunk_offsets[i];
+
+		// Skip the tail of a value owned by the previous chunk:
+		if (current > start)
 		{
-			// Prematurely ran out of values:
-			snprintf(error, NM_MAX_ERROR_LENGTH,
-				"Not enough voxel values in file for mesh \"%s\".\n", mesh->name);
-			free(voxels);
-			free(data);
-			return -1;
+			while ((current < chunk_end) && !isspace(current[-1])) { current++; }
 		}
 
-		float negative = 1.f;
-		while ((position < end) && isspace(*position)) { position++; }
-		if ((position < end) && (*position == '-'))
+		while (index < max_values)
 		{
-			negative = -1.f;
+			while ((current < chunk_end) && isspace(*current)) { current++; }
+			if (current >= chunk_end) { break; }
+
+			current = ct_parse_float(current, end, &(values[index]));
+			if (!current)
+			{
+				invalid = 1;
+				break;
+			}
+			index++;
 		}
+	}
+
+	free(chunk_offsets);
+
+	if (invalid)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Invalid voxel value in file for mesh \"%s\".", name);
+		return -1;
+	}
+	if (*num_values > max_values) { *num_values = max_values; }
+
+	return 0;
+}
+
+char *ct_parse_float(char *position, char *end, float *value)
+{
+	/* Parses [+-]digits[.digits][(e|E)[+-]digits], stopping at whitespace. Returns the
+	 * position after the value, or NULL if it is not a number or is longer than
+	 * CT_VOXEL_MAX_VALUE_LENGTH, rather than cutting it short. Results are correctly
+	 * rounded: values with at most 7 significant digits and a small exponent are exact in
+	 * float arithmetic (both the mantissa and the power of ten are representable, so one
+	 * rounding happens), and everything else is handed to strtof. */
+
+	static const float powers_of_ten[11] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+						1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+	char *start = position;
+	uint8_t negative = 0;
+	if ((position < end) && ((*position == '-') || (*position == '+')))
+	{
+		negative = (*position == '-');
+		position++;
+	}
+
+	uint64_t mantissa = 0;
+	int digits = 0;			// Significant digits in the mantissa.
+	int exponent = 0;
+	int num_digits = 0;		// All digits seen, for validation.
+	while ((position < end) && (*position >= '0') && (*position <= '9'))
+	{
+		if (digits < 19)
+		{
+			mantissa = (mantissa * 10) + (*position - '0');
+			if (mantissa) { digits++; }
+		}
+		else { exponent++; digits++; }
+		num_digits++;
+		position++;
+	}
+	if ((position < end) && (*position == '.'))
+	{
+		position++;
 		while ((position < end) && (*position >= '0') && (*position <= '9'))
 		{
-			voxels[i] = (voxels[i] * 10.f) + ((*position - '0') * 1.f);
+			if (digits < 19)
+			{
+				mantissa = (mantissa * 10) + (*position - '0');
+				if (mantissa) { digits++; }
+				exponent--;
+			}
+			else { digits++; }
+			num_digits++;
 			position++;
 		}
-		if ((position < end) && (*position == '.'))
+	}
+	if (!num_digits) { return NULL; }
+
+	if ((position < end) && ((*position == 'e') || (*position == 'E')))
+	{
+		position++;
+		int exponent_sign = 1;
+		int explicit_exponent = 0;
+		int exponent_digits = 0;
+		if ((position < end) && ((*position == '-') || (*position == '+')))
 		{
+			if (*position == '-') { exponent_sign = -1; }
 			position++;
-			float decimal = 0.f;
-			float multiplier = 1.f;
-			while ((position < end) && (*position >= '0') && (*position <= '9'))
+		}
+		while ((position < end) && (*position >= '0') && (*position <= '9'))
+		{
+			if (explicit_exponent < 100000)
 			{
-				decimal = (decimal * 10.f) + ((*position - '0') * 1.f);
-				multiplier *= 10.f;
-				position++;
+				explicit_exponent = (explicit_exponent * 10) + (*position - '0');
 			}
-			voxels[i] += decimal / multiplier;
+			exponent_digits++;
+			position++;
 		}
-		voxels[i] *= negative;
+		if (!exponent_digits) { return NULL; }
+		exponent += exponent_sign * explicit_exponent;
 	}
+	if ((position < end) && !isspace(*position)) { return NULL; }
 
-	free(voxels);
-	free(data);
-	return 0;
+	if ((digits <= 7) && (exponent >= -10) && (exponent <= 10))
+	{
+		*value = mantissa;
+		if (exponent < 0) { *value /= powers_of_ten[-exponent]; }
+		else { *value *= powers_of_ten[exponent]; }
+	}
+	else
+	{
+		// Slow path, on a terminated copy:
+		char copy[CT_VOXEL_MAX_VALUE_LENGTH + 1];
+		size_t length = position - start;
+		if (length > CT_VOXEL_MAX_VALUE_LENGTH) { return NULL; }
+		memcpy(copy, start, length);
+		copy[length] = '\0';
+		*value = strtof(copy, NULL);
+		return position;
+	}
+
+	if (negative) { *value = -*value; }
+	return position;
+}
+
+char *ct_format_float(char *position, float value)
+{
+	/* Writes the shortest decimal that reads back as the same float (at most 9 significant
+	 * digits, as in "%.9g"), returning the position after it. Candidates are rounded to
+	 * 1, 2, ... digits in double precision and checked by converting back. The check is
+	 * exact: a double landing exactly halfway between two floats (the only case where
+	 * rounding twice can differ), a power of ten that isn't exact in double, or a tiny
+	 * value is checked with strtof instead. */
+
+	static const double powers_of_ten[23] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+		1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	if (value != value)
+	{
+		memcpy(position, "nan", 3);
+		return position + 3;
+	}
+	if (signbit(value)) { *(position++) = '-'; }
+	float magnitude = fabsf(value);
+	if (isinf(magnitude))
+	{
+		memcpy(position, "inf", 3);
+		return position + 3;
+	}
+	if (magnitude == 0.f)
+	{
+		*(position++) = '0';
+		return position;
+	}
+
+	// Scale to [1, 10) (approximately, as candidates are checked anyway):
+	int exponent = (int)floor(log10(magnitude)); // Of the leading digit.
+	double normalised = magnitude;
+	for (int remaining = exponent; remaining > 0; remaining -= 22)
+	{
+		normalised /= powers_of_ten[(remaining > 22) ? 22 : remaining];
+	}
+	for (int remaining = -exponent; remaining > 0; remaining -= 22)
+	{
+		normalised *= powers_of_ten[(remaining > 22) ? 22 : remaining];
+	}
+	if (normalised >= 10.)
+	{
+		normalised /= 10.;
+		exponent++;
+	}
+	else if (normalised < 1.)
+	{
+		normalised *= 10.;
+		exponent--;
+	}
+
+	uint32_t mantissa = 0;
+	int digits;
+	for (digits = 1; digits <= 9; digits++)
+	{
+		int scale = digits - 1 - exponent;
+		mantissa = (uint32_t)((normalised * powers_of_ten[digits - 1]) + 0.5);
+		if (mantissa >= powers_of_ten[digits])
+		{
+			// Rounded up to the next power of ten:
+			mantissa /= 10;
+			scale--;
+		}
+
+		float result = 0.f;
+		uint8_t exact_check = (scale < -22) || (scale > 22) || (magnitude < 1e-37f);
+		if (!exact_check)
+		{
+			double exact = mantissa;
+			if (scale > 0) { exact /= powers_of_ten[scale]; }
+			else { exact *= powers_of_ten[-scale]; }
+			result = (float)exact;
+
+			// Double rounding can only go wrong on a boundary between two floats:
+			uint64_t bits;
+			memcpy(&bits, &exact, sizeof(bits));
+			exact_check = ((bits & 0x1FFFFFFF) == 0x10000000);
+		}
+		if (exact_check)
+		{
+			char copy[32];
+			snprintf(copy, sizeof(copy), "%ue%d", mantissa, -scale);
+			result = strtof(copy, NULL);
+		}
+
+		if (result == magnitude)
+		{
+			exponent = digits - 1 - scale;
+			break;
+		}
+	}
+	if (digits > 9) { return position + sprintf(position, "%.9g", magnitude); }
+
+	// Drop trailing zeros:
+	while ((digits > 1) && !(mantissa % 10))
+	{
+		mantissa /= 10;
+		digits--;
+	}
+	char mantissa_digits[10];
+	ct_format_uint(mantissa_digits, mantissa);
+
+	if ((exponent >= 0) && (exponent < 9))
+	{
+		// Plain, with as many zeros as needed before the point:
+		for (int i = 0; i <= exponent; i++)
+		{
+			*(position++) = (i < digits) ? mantissa_digits[i] : '0';
+		}
+		if (digits > (exponent + 1))
+		{
+			*(position++) = '.';
+			memcpy(position, &(mantissa_digits[exponent + 1]), digits - exponent - 1);
+			position += digits - exponent - 1;
+		}
+	}
+	else if ((exponent < 0) && (exponent >= -5))
+	{
+		*(position++) = '0';
+		*(position++) = '.';
+		for (int i = -1; i > exponent; i--) { *(position++) = '0'; }
+		memcpy(position, mantissa_digits, digits);
+		position += digits;
+	}
+	else
+	{
+		*(position++) = mantissa_digits[0];
+		if (digits > 1)
+		{
+			*(position++) = '.';
+			memcpy(position, &(mantissa_digits[1]), digits - 1);
+			position += digits - 1;
+		}
+		*(position++) = 'e';
+		if (exponent < 0)
+		{
+			*(position++) = '-';
+			exponent = -exponent;
+		}
+		position = ct_format_uint(position, exponent);
+	}
+
+	return position;
+}
+
+char *ct_format_uint(char *position, uint32_t value)
+{
+	// Returns the position after the digits (not terminated). Two digits at a time:
+	static const char pairs[201] =
+		"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+		"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+		"8081828384858687888990919293949596979899";
+
+	char digits[10];
+	int start = 10;
+	while (value >= 100)
+	{
+		uint32_t pair = (value % 100) * 2;
+		value /= 100;
+		digits[--start] = pairs[pair + 1];
+		digits[--start] = pairs[pair];
+	}
+	if (value >= 10)
+	{
+		digits[--start] = pairs[(value * 2) + 1];
+		digits[--start] = pairs[value * 2];
+	}
+	else { digits[--start] = '0' + value; }
+
+	memcpy(position, &(digits[start]), 10 - start);
+	return position + (10 - start);
 }
 
 uint32_t ct_get_voxel_index(uint32_t coordinates[3], uint32_t dimensions[3])
@@ -354,6 +1256,290 @@ uint32_t ct_get_voxel_index(uint32_t coordinates[3], uint32_t dimensions[3])
 		(dimensions[0] * coordinates[1]) + coordinates[0]);
 }
 
+/******************
+ * Binary volumes *
+ ******************/
+
+int ct_mesh_load_volume(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Header (64 bytes, little-endian):
+	 * 0	"CTV1"
+	 * 4	uint32 X, Y, Z dimensions
+	 * 16	uint32 scalar type (CT_VOLUME_TYPE_<X>)
+	 * 20	uint32 scalar byte order (0 little-endian, 1 big-endian)
+	 * 24	float32 X, Y, Z spacing
+	 * 36	uint32 offset of the scalars (at least 64, a multiple of the scalar size)
+	 * 40	reserved
+	 *
+	 * Scalars are stored X fastest, then Y, then Z, as in ct_get_voxel_index. When their
+	 * byte order matches the host, the mapping is used as the scalar field directly, so
+	 * nothing is parsed or copied and pages are only read in as they are touched. */
+
+	if (ct_path_is_compressed(mesh->path)) { return ct_mesh_load_volume_stream(mesh, error); }
+
+	size_t data_size;
+	uint8_t *data = ct_file_map(mesh->path, &data_size, 0, error);
+	if (!data) { return -1; }
+
+	ct_volume_t volume;
+	uint8_t big_endian;
+	uint32_t data_offset;
+	if (ct_volume_parse_header(data, data_size, &volume, &big_endian, &data_offset,
+						mesh->name, error))
+	{
+		ct_file_unmap(data, data_size);
+		return -1;
+	}
+
+	// Checked by division, so a crafted header cannot wrap the size around:
+	uint8_t scalar_size = ct_volume_get_scalar_size(volume.scalar_type);
+	uint64_t num_voxels = ct_volume_get_num_voxels(&volume);
+	if ((data_offset > data_size) || (num_voxels > ((data_size - data_offset) / scalar_size)))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Not enough voxel values in file for mesh \"%s\".", mesh->name);
+		ct_file_unmap(data, data_size);
+		return -1;
+	}
+
+	if ((scalar_size == 1) || (big_endian == ct_host_is_big_endian()))
+	{
+		// Use in place:
+		volume.mapping = data;
+		volume.mapping_size = data_size;
+		volume.scalars = &(data[data_offset]);
+	}
+	else
+	{
+		// Byte order differs, so this is the one case that needs a private copy:
+		volume.scalars = malloc(num_voxels * scalar_size);
+		if (!volume.scalars)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH,
+				"Could not allocate voxel memory for mesh \"%s\".", mesh->name);
+			ct_file_unmap(data, data_size);
+			return -1;
+		}
+
+		ct_swap_byte_order(volume.scalars, &(data[data_offset]), num_voxels, scalar_size);
+		ct_file_unmap(data, data_size);
+	}
+
+	ct_volume_free(&(mesh->volume));
+	mesh->volume = volume;
+	return 0;
+}
+
+int ct_mesh_load_volume_stream(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Compressed volume. The scalars are copied out of each decompressed block while the
+	 * next one is being decompressed, so the only full copy is the scalar field itself. */
+
+	ct_stream_t stream;
+	if (ct_stream_open(&stream, mesh->path, error)) { return -1; }
+
+	uint8_t header[CT_VOLUME_HEADER_SIZE];
+	size_t size_read;
+	if (ct_stream_read(&stream, header, CT_VOLUME_HEADER_SIZE, &size_read, error))
+	{
+		ct_stream_close(&stream);
+		return -1;
+	}
+
+	ct_volume_t volume;
+	uint8_t big_endian;
+	uint32_t data_offset;
+	if (ct_volume_parse_header(header, size_read, &volume, &big_endian, &data_offset,
+						mesh->name, error))
+	{
+		ct_stream_close(&stream);
+		return -1;
+	}
+
+	uint8_t scalar_size = ct_volume_get_scalar_size(volume.scalar_type);
+	uint64_t num_voxels = ct_volume_get_num_voxels(&volume);
+	volume.scalars = malloc(num_voxels * scalar_size);
+	if (!volume.scalars)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Could not allocate voxel memory for mesh \"%s\".", mesh->name);
+		ct_stream_close(&stream);
+		return -1;
+	}
+
+	size_t skip_size = data_offset - CT_VOLUME_HEADER_SIZE;
+	size_t scalars_size = num_voxels * scalar_size;
+	if (ct_stream_read(&stream, NULL, skip_size, &size_read, error) ||
+		((size_read == skip_size) &&
+		ct_stream_read(&stream, volume.scalars, scalars_size, &size_read, error)))
+	{
+		free(volume.scalars);
+		ct_stream_close(&stream);
+		return -1;
+	}
+	ct_stream_close(&stream);
+
+	if (size_read != scalars_size)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Not enough voxel values in file for mesh \"%s\".", mesh->name);
+		free(volume.scalars);
+		return -1;
+	}
+
+	if ((scalar_size > 1) && (big_endian != ct_host_is_big_endian()))
+	{
+		ct_swap_byte_order(volume.scalars, volume.scalars, num_voxels, scalar_size);
+	}
+
+	ct_volume_free(&(mesh->volume));
+	mesh->volume = volume;
+	return 0;
+}
+
+int ct_volume_parse_header(uint8_t *header, size_t size, ct_volume_t *volume,
+				uint8_t *big_endian, uint32_t *data_offset, char *name,
+				char error[NM_MAX_ERROR_LENGTH])
+{
+	// Fills in the volume description (but not the scalars), checking it makes sense.
+	if ((size < CT_VOLUME_HEADER_SIZE) || memcmp(header, CT_VOLUME_MAGIC, 4))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"File for mesh \"%s\" is not a binary volume.", name);
+		return -1;
+	}
+
+	memset(volume, 0, sizeof(*volume));
+	for (int i = 0; i < 3; i++)
+	{
+		uint32_t spacing = ct_read_u32_le(&(header[24 + (i * 4)]));
+		volume->dimensions[i] = ct_read_u32_le(&(header[4 + (i * 4)]));
+		memcpy(&(volume->spacing[i]), &spacing, sizeof(float));
+	}
+	uint32_t scalar_type = ct_read_u32_le(&(header[16]));
+	*big_endian = (ct_read_u32_le(&(header[20])) != 0);
+	*data_offset = ct_read_u32_le(&(header[36]));
+
+	uint8_t scalar_size = 0;
+	if (scalar_type <= CT_VOLUME_TYPE_FLOAT64)
+	{
+		volume->scalar_type = scalar_type;
+		scalar_size = ct_volume_get_scalar_size(volume->scalar_type);
+	}
+	if (!scalar_size)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Unknown scalar type %u in volume for mesh \"%s\".", scalar_type, name);
+		return -1;
+	}
+
+	if (!ct_volume_get_num_voxels(volume))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Voxel X, Y or Z dimension is 0 for mesh \"%s\".", name);
+		return -1;
+	}
+
+	// Voxels are tree nodes, indexed by uint32_t with CT_TREE_NO_NODE kept free:
+	uint64_t num_xy = (uint64_t)volume->dimensions[0] * volume->dimensions[1];
+	if ((num_xy >= UINT32_MAX) || ((num_xy * volume->dimensions[2]) >= UINT32_MAX))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Volume for mesh \"%s\" has too many voxels.", name);
+		return -1;
+	}
+	if ((*data_offset < CT_VOLUME_HEADER_SIZE) || (*data_offset % scalar_size))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Invalid scalar offset in volume for mesh \"%s\".", name);
+		return -1;
+	}
+
+	return 0;
+}
+
+void ct_swap_byte_order(void *destination, void *source, uint64_t num_values,
+							uint8_t value_size)
+{
+	// Reverses the bytes of each value. Source and destination may be the same.
+	uint8_t *from = source;
+	uint8_t *to = destination;
+	#pragma omp parallel for if ((num_values * value_size) > CT_PARALLEL_THRESHOLD)
+	for (uint64_t i = 0; i < num_values; i++)
+	{
+		uint8_t value[8];
+		memcpy(value, &(from[i * value_size]), value_size);
+		for (uint8_t j = 0; j < value_size; j++)
+		{
+			to[(i * value_size) + j] = value[value_size - j - 1];
+		}
+	}
+}
+
+int ct_mesh_write_volume(FILE *file, ct_volume_t *volume, char error[NM_MAX_ERROR_LENGTH])
+{
+	uint8_t scalar_size = ct_volume_get_scalar_size(volume->scalar_type);
+	uint64_t num_voxels = ct_volume_get_num_voxels(volume);
+	if (!volume->scalars || !scalar_size || !num_voxels)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Volume has no scalars to write.");
+		return -1;
+	}
+
+	uint8_t header[CT_VOLUME_HEADER_SIZE] = {0};
+	memcpy(header, CT_VOLUME_MAGIC, 4);
+	for (int i = 0; i < 3; i++)
+	{
+		uint32_t spacing;
+		memcpy(&spacing, &(volume->spacing[i]), sizeof(float));
+		ct_write_u32_le(&(header[4 + (i * 4)]), volume->dimensions[i]);
+		ct_write_u32_le(&(header[24 + (i * 4)]), spacing);
+	}
+	ct_write_u32_le(&(header[16]), volume->scalar_type);
+	ct_write_u32_le(&(header[20]), ct_host_is_big_endian());
+	ct_write_u32_le(&(header[36]), CT_VOLUME_HEADER_SIZE);
+
+	if ((fwrite(header, 1, CT_VOLUME_HEADER_SIZE, file) != CT_VOLUME_HEADER_SIZE) ||
+		(fwrite(volume->scalars, scalar_size, num_voxels, file) != num_voxels))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not write volume to file.");
+		return -1;
+	}
+
+	return 0;
+}
+
+uint8_t ct_host_is_big_endian(void)
+{
+	uint16_t probe = 1;
+	return !(*(uint8_t *)&probe);
+}
+
+uint32_t ct_read_u32_le(uint8_t *data)
+{
+	return ((uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+		((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24));
+}
+
+void ct_write_u32_le(uint8_t *data, uint32_t value)
+{
+	data[0] = value & 0xFF;
+	data[1] = (value >> 8) & 0xFF;
+	data[2] = (value >> 16) & 0xFF;
+	data[3] = (value >> 24) & 0xFF;
+}
+
+uint64_t ct_read_u64_le(uint8_t *data)
+{
+	return ((uint64_t)ct_read_u32_le(data) | ((uint64_t)ct_read_u32_le(&(data[4])) << 32));
+}
+
+void ct_write_u64_le(uint8_t *data, uint64_t value)
+{
+	ct_write_u32_le(data, value & 0xFFFFFFFF);
+	ct_write_u32_le(&(data[4]), value >> 32);
+}
+
 #ifdef CT_DEBUG
 void ct_voxels_print(FILE *file, uint32_t dimensions[3], float *voxels)
 {
@@ -2,31 +2,85 @@
 #define CT_MESH_LOADER_H
 
 #include <ctype.h>
+#include <math.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <NM-Config/Config.h>
 #include <TinyOBJLoaderC/tinyobj_loader_c.h>
 #include <SDL3/SDL_iostream.h>
 
 #include "Mesh.h"
+#include "Parallel.h"
+#include "Stream.h"
+
+#define CT_VOLUME_MAGIC		"CTV1"
+#define CT_VOLUME_HEADER_SIZE	64
+#define CT_OBJ_WRITE_CHUNK	16384	// Lines formatted by each thread per round.
+#define CT_OBJ_MAX_LINE_LENGTH	128	// Longest line the OBJ writer can produce, rounded up.
+#define CT_VOXEL_MAX_VALUE_LENGTH	128 // Longest value that may be split across blocks.
+
+// Writes one line for element index, returning the position after it:
+typedef char *(*ct_obj_formatter_t)(char *position, ct_mesh_t *mesh, uint32_t index);
 
 int ct_mesh_load(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
+void *ct_file_map(char *path, size_t *size, uint8_t writable,
+					char error[NM_MAX_ERROR_LENGTH]);
+void ct_file_unmap(void *data, size_t size);
 
 // OBJ meshes:
 int ct_mesh_load_obj(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
 int ct_mesh_write_obj(FILE *file, ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
+int ct_obj_write_section(FILE *file, ct_mesh_t *mesh, uint32_t num_lines,
+		ct_obj_formatter_t format, char *buffer, char error[NM_MAX_ERROR_LENGTH]);
+char *ct_obj_format_vertex(char *position, ct_mesh_t *mesh, uint32_t index);
+char *ct_obj_format_normal(char *position, ct_mesh_t *mesh, uint32_t index);
+char *ct_obj_format_uv(char *position, ct_mesh_t *mesh, uint32_t index);
+char *ct_obj_format_face(char *position, ct_mesh_t *mesh, uint32_t index);
 void tinyobj_file_reader_callback(void *ctx, const char *filename, const int is_mtl,
 				const char *obj_filename, char **data, size_t *len);
 void tinyobj_free(tinyobj_attrib_t *attrib, size_t num_shapes, tinyobj_shape_t *shapes,
 				size_t num_materials, tinyobj_material_t *materials);
 
+// STL meshes:
+int ct_mesh_load_stl(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
+int ct_mesh_weld_positions(ct_vertex_t *positions, uint32_t num_positions, float epsilon,
+				uint32_t *remap, char error[NM_MAX_ERROR_LENGTH]);
+uint64_t ct_mesh_weld_key(int64_t x, int64_t y, int64_t z);
+
 // Voxel meshes:
 int ct_mesh_load_voxels(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
+int ct_mesh_load_voxels_stream(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
+char *ct_parse_voxel_dimensions(char *position, char *end, uint32_t dimensions[3]);
+int ct_parse_floats(char *start, char *end, float *values, uint64_t max_values,
+		uint64_t *num_values, char *name, char error[NM_MAX_ERROR_LENGTH]);
+char *ct_parse_float(char *position, char *end, float *value);
+char *ct_format_float(char *position, float value);
+char *ct_format_uint(char *position, uint32_t value);
 uint32_t ct_get_voxel_index(uint32_t coordinates[3], uint32_t dimensions[3]);
 
+// Binary volumes:
+int ct_mesh_load_volume(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
+int ct_mesh_load_volume_stream(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
+int ct_volume_parse_header(uint8_t *header, size_t size, ct_volume_t *volume,
+				uint8_t *big_endian, uint32_t *data_offset, char *name,
+				char error[NM_MAX_ERROR_LENGTH]);
+void ct_swap_byte_order(void *destination, void *source, uint64_t num_values,
+							uint8_t value_size);
+int ct_mesh_write_volume(FILE *file, ct_volume_t *volume, char error[NM_MAX_ERROR_LENGTH]);
+uint8_t ct_host_is_big_endian(void);
+uint32_t ct_read_u32_le(uint8_t *data);
+void ct_write_u32_le(uint8_t *data, uint32_t value);
+uint64_t ct_read_u64_le(uint8_t *data);
+void ct_write_u64_le(uint8_t *data, uint64_t value);
+
 #ifdef CT_DEBUG
 void ct_voxels_print(FILE *file, uint32_t dimensions[3], float *voxels);
 #endif
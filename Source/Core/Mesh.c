@@ -87,6 +87,8 @@ void ct_mesh_free(ct_mesh_t *mesh)
 		free(mesh->faces);
 		mesh->faces = NULL;
 	}
+
+	ct_volume_free(&(mesh->volume));
 }
 
 int ct_mesh_check_validity(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
@@ -312,6 +314,22 @@ int ct_mesh_check_manifold(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
 	return 0;
 }
 
+int ct_mesh_check_contour_tree(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Contour trees are built from the join and split trees of the same complex, which only
+	 * works if its loops are filled by triangles (as in a simply connected mesh, the
+	 * Freudenthal triangulation or 26 connectivity). 6 connectivity has no triangles, so the
+	 * square around each grid face is a loop, and only merge trees can be built on it. */
+	if (mesh->edges || !mesh->volume.scalars || (mesh->volume.connectivity != CT_GRID_FACES))
+	{
+		return 0;
+	}
+
+	snprintf(error, NM_MAX_ERROR_LENGTH, "Volume \"%s\" uses 6 connectivity, which has no "
+		"contour tree. Use the Freudenthal triangulation or 26 connectivity.", mesh->name);
+	return -1;
+}
+
 uint32_t ct_mesh_triangle_fan_check(ct_mesh_t *mesh, uint32_t vertex, uint32_t vertex_degree)
 {
 	uint32_t triangles_left = vertex_degree - 1; // Account for first triangle.
@@ -397,6 +415,160 @@ uint32_t ct_mesh_get_previous_vertex_edge(ct_mesh_t *mesh, uint32_t vertex, uint
 	return previous_edge;
 }
 
+uint32_t ct_mesh_get_vertex_neighbours(ct_mesh_t *mesh, uint32_t vertex, uint32_t *neighbours,
+							uint32_t max_neighbours)
+{
+	/* Walks the edges around a vertex as the merge tree sweep does. Returns the number of
+	 * neighbours, of which at most max_neighbours are written (pass 0 to just count). */
+	uint32_t num_neighbours = 0;
+	uint32_t current_edge = mesh->first_edge[vertex];
+	uint32_t adjacent_vertex = vertex;
+	uint32_t previous_adjacent_vertex;
+	while (1)
+	{
+		previous_adjacent_vertex = adjacent_vertex;
+		if (mesh->edges[current_edge].from == vertex)
+		{
+			adjacent_vertex = mesh->edges[current_edge].to;
+		}
+		else { adjacent_vertex = mesh->edges[current_edge].from; }
+
+		if (adjacent_vertex != previous_adjacent_vertex)
+		{
+			if (num_neighbours < max_neighbours) { neighbours[num_neighbours] = adjacent_vertex; }
+			num_neighbours++;
+		}
+
+		current_edge = ct_mesh_get_next_vertex_edge(mesh, vertex, current_edge);
+		if ((current_edge == UINT32_MAX) || (mesh->edges[current_edge].other_half ==
+							mesh->first_edge[vertex]))
+		{
+			break;
+		}
+	}
+
+	return num_neighbours;
+}
+
+/***********
+ * Volumes *
+ ***********/
+
+void ct_volume_free(ct_volume_t *volume)
+{
+	if (volume->mapping) { munmap(volume->mapping, volume->mapping_size); }
+	else if (volume->scalars) { free(volume->scalars); }
+	memset(volume, 0, sizeof(*volume));
+}
+
+uint64_t ct_volume_get_num_voxels(ct_volume_t *volume)
+{
+	return ((uint64_t)volume->dimensions[0] * volume->dimensions[1] * volume->dimensions[2]);
+}
+
+uint8_t ct_volume_get_scalar_size(uint8_t scalar_type)
+{
+	switch (scalar_type)
+	{
+		case CT_VOLUME_TYPE_UINT8:
+		case CT_VOLUME_TYPE_INT8:
+			return 1;
+		case CT_VOLUME_TYPE_UINT16:
+		case CT_VOLUME_TYPE_INT16:
+			return 2;
+		case CT_VOLUME_TYPE_UINT32:
+		case CT_VOLUME_TYPE_INT32:
+		case CT_VOLUME_TYPE_FLOAT32:
+			return 4;
+		case CT_VOLUME_TYPE_FLOAT64:
+			return 8;
+	}
+	return 0;
+}
+
+float ct_volume_get_value(ct_volume_t *volume, uint64_t index)
+{
+	switch (volume->scalar_type)
+	{
+		case CT_VOLUME_TYPE_UINT8:	return ((uint8_t *)volume->scalars)[index];
+		case CT_VOLUME_TYPE_INT8:	return ((int8_t *)volume->scalars)[index];
+		case CT_VOLUME_TYPE_UINT16:	return ((uint16_t *)volume->scalars)[index];
+		case CT_VOLUME_TYPE_INT16:	return ((int16_t *)volume->scalars)[index];
+		case CT_VOLUME_TYPE_UINT32:	return ((uint32_t *)volume->scalars)[index];
+		case CT_VOLUME_TYPE_INT32:	return ((int32_t *)volume->scalars)[index];
+		case CT_VOLUME_TYPE_FLOAT32:	return ((float *)volume->scalars)[index];
+		case CT_VOLUME_TYPE_FLOAT64:	return ((double *)volume->scalars)[index];
+	}
+	return 0.f;
+}
+
+uint32_t ct_volume_get_neighbours(ct_volume_t *volume, uint32_t voxel,
+				uint32_t neighbours[CT_GRID_MAX_NEIGHBOURS])
+{
+	/* Neighbours are worked out from the voxel coordinates, so no edges are stored. Each
+	 * connectivity uses the start of the offset table: the 6 face neighbours, then the 8 that
+	 * complete the Freudenthal triangulation (every cube split along its (1, 1, 1) diagonal,
+	 * as the heightmap triangulation is in 2D), then the remaining 12 of the 26. */
+	static const int8_t offsets[CT_GRID_MAX_NEIGHBOURS][3] = {
+		{ -1,  0,  0 }, {  1,  0,  0 }, {  0, -1,  0 },
+		{  0,  1,  0 }, {  0,  0, -1 }, {  0,  0,  1 },
+		{ -1, -1,  0 }, {  1,  1,  0 }, { -1,  0, -1 }, {  1,  0,  1 },
+		{  0, -1, -1 }, {  0,  1,  1 }, { -1, -1, -1 }, {  1,  1,  1 },
+		{ -1,  1,  0 }, {  1, -1,  0 }, { -1,  0,  1 }, {  1,  0, -1 },
+		{  0, -1,  1 }, {  0,  1, -1 }, { -1, -1,  1 }, { -1,  1, -1 },
+		{ -1,  1,  1 }, {  1, -1, -1 }, {  1, -1,  1 }, {  1,  1, -1 }
+	};
+
+	uint32_t num_offsets = 14;
+	if (volume->connectivity == CT_GRID_FACES) { num_offsets = 6; }
+	else if (volume->connectivity == CT_GRID_VERTICES) { num_offsets = 26; }
+
+	int64_t coordinates[3];
+	int64_t slice_size = (int64_t)volume->dimensions[0] * volume->dimensions[1];
+	coordinates[0] = voxel % volume->dimensions[0];
+	coordinates[1] = (voxel / volume->dimensions[0]) % volume->dimensions[1];
+	coordinates[2] = voxel / slice_size;
+
+	uint32_t num_neighbours = 0;
+	for (uint32_t i = 0; i < num_offsets; i++)
+	{
+		int64_t x = coordinates[0] + offsets[i][0];
+		int64_t y = coordinates[1] + offsets[i][1];
+		int64_t z = coordinates[2] + offsets[i][2];
+		if ((x < 0) || (y < 0) || (z < 0) || (x >= volume->dimensions[0]) ||
+			(y >= volume->dimensions[1]) || (z >= volume->dimensions[2]))
+		{
+			continue;
+		}
+		neighbours[num_neighbours] = (uint32_t)(voxel + offsets[i][0] +
+			(offsets[i][1] * (int64_t)volume->dimensions[0]) + (offsets[i][2] * slice_size));
+		num_neighbours++;
+	}
+
+	return num_neighbours;
+}
+
+int ct_volume_is_neighbour_offset(ct_volume_t *volume, int64_t offset[3])
+{
+	// Whether voxels this far apart are neighbours, matching ct_volume_get_neighbours:
+	uint32_t num_nonzero = 0;
+	int64_t sign = 0;
+	uint8_t mixed = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		if ((offset[i] < -1) || (offset[i] > 1)) { return 0; }
+		if (!offset[i]) { continue; }
+		if (sign && (offset[i] != sign)) { mixed = 1; }
+		sign = offset[i];
+		num_nonzero++;
+	}
+
+	if (!num_nonzero) { return 0; }
+	if (volume->connectivity == CT_GRID_FACES) { return (num_nonzero == 1); }
+	if (volume->connectivity == CT_GRID_VERTICES) { return 1; }
+	return !mixed;
+}
+
 /********************
  * GPU-ready meshes *
  ********************/
@@ -7,8 +7,24 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <sys/mman.h>
+
 #include <NM-Config/Config.h>
 
+#define CT_VOLUME_TYPE_UINT8	0
+#define CT_VOLUME_TYPE_INT8	1
+#define CT_VOLUME_TYPE_UINT16	2
+#define CT_VOLUME_TYPE_INT16	3
+#define CT_VOLUME_TYPE_UINT32	4
+#define CT_VOLUME_TYPE_INT32	5
+#define CT_VOLUME_TYPE_FLOAT32	6
+#define CT_VOLUME_TYPE_FLOAT64	7
+
+#define CT_GRID_FREUDENTHAL	0	// 14 neighbours, splitting each cube into 6 tetrahedra.
+#define CT_GRID_FACES		1	// 6 neighbours. Merge trees only (ct_mesh_check_contour_tree).
+#define CT_GRID_VERTICES	2	// 26 neighbours.
+#define CT_GRID_MAX_NEIGHBOURS	26
+
 typedef struct
 {
 	float x;
@@ -56,12 +72,25 @@ typedef struct
 typedef ct_face_vertex_t ct_face_t[3];
 typedef uint32_t ct_face_gpu_ready_t[3];
 
+typedef struct
+{
+	uint32_t dimensions[3];	// X (fastest), Y, Z.
+	float spacing[3];
+	uint8_t scalar_type;	// CT_VOLUME_TYPE_<X>.
+	uint8_t connectivity;	// CT_GRID_<X>, for trees built on the grid. Set after loading.
+
+	void *scalars;		// Points into the mapping when the file is used in place.
+	void *mapping;
+	size_t mapping_size;
+} ct_volume_t;
+
 typedef struct
 {
 	char name[NM_MAX_NAME_LENGTH];
 	char path[NM_MAX_PATH_LENGTH];
 
 	uint8_t is_manifold;
+	float weld_epsilon;	// Distance within which loaded STL positions are merged.
 
 	uint32_t num_vertices;
 	ct_vertex_t *vertices;
@@ -81,6 +110,8 @@ typedef struct
 
 	uint32_t num_faces;
 	ct_face_t *faces;
+
+	ct_volume_t volume;	// Scalar field for voxel inputs, which have no faces.
 } ct_mesh_t;
 
 typedef struct
@@ -103,10 +134,22 @@ void ct_mesh_free(ct_mesh_t *mesh);
 int ct_mesh_check_validity(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
 int ct_mesh_calculate_edges(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
 int ct_mesh_check_manifold(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
+int ct_mesh_check_contour_tree(ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
 uint32_t ct_mesh_triangle_fan_check(ct_mesh_t *mesh, uint32_t vertex, uint32_t vertex_degree);
 uint32_t ct_mesh_get_edge_index(ct_edge_t *edge);
 uint32_t ct_mesh_get_next_vertex_edge(ct_mesh_t *mesh, uint32_t vertex, uint32_t edge);
 uint32_t ct_mesh_get_previous_vertex_edge(ct_mesh_t *mesh, uint32_t vertex, uint32_t edge);
+uint32_t ct_mesh_get_vertex_neighbours(ct_mesh_t *mesh, uint32_t vertex, uint32_t *neighbours,
+							uint32_t max_neighbours);
+
+// Volumes:
+void ct_volume_free(ct_volume_t *volume);
+uint64_t ct_volume_get_num_voxels(ct_volume_t *volume);
+uint8_t ct_volume_get_scalar_size(uint8_t scalar_type);
+float ct_volume_get_value(ct_volume_t *volume, uint64_t index);
+uint32_t ct_volume_get_neighbours(ct_volume_t *volume, uint32_t voxel,
+				uint32_t neighbours[CT_GRID_MAX_NEIGHBOURS]);
+int ct_volume_is_neighbour_offset(ct_volume_t *volume, int64_t offset[3]);
 
 // GPU-ready meshes:
 int ct_mesh_gpu_ready_allocate(ct_mesh_gpu_ready_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
@@ -0,0 +1,214 @@
+#include "Parallel.h"
+
+/***********
+ * Sorting *
+ ***********/
+
+int ct_parallel_sort_pairs(ct_sort_pair_t *pairs, size_t num_pairs, uint8_t key_bits,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Stable LSD radix sort, 8 bits per pass. Each thread histograms and scatters its own
+	 * contiguous chunk, and offsets are ordered by (digit, thread) so the result doesn't
+	 * depend on the number of threads. Passes where every key has the same digit are
+	 * skipped, so sorting small keys stored in 64 bits costs only the passes needed. */
+
+	if (num_pairs < 2) { return 0; }
+
+	int max_threads = omp_get_max_threads();
+	ct_sort_pair_t *buffer = malloc(num_pairs * sizeof(ct_sort_pair_t));
+	size_t *histograms = malloc(max_threads * 256 * sizeof(size_t));
+	if (!buffer || !histograms)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for sorting.");
+		if (buffer) { free(buffer); }
+		if (histograms) { free(histograms); }
+		return -1;
+	}
+
+	ct_sort_pair_t *source = pairs;
+	ct_sort_pair_t *destination = buffer;
+	ct_sort_pair_t *swap;
+	for (uint8_t shift = 0; shift < key_bits; shift += 8)
+	{
+		int skip = 0;
+
+		#pragma omp parallel if (num_pairs > CT_PARALLEL_THRESHOLD)
+		{
+			int num_threads = omp_get_num_threads();
+			int thread = omp_get_thread_num();
+			size_t begin = (num_pairs * thread) / num_threads;
+			size_t end = (num_pairs * (thread + 1)) / num_threads;
+			size_t *histogram = &(histograms[thread * 256]);
+
+			memset(histogram, 0, 256 * sizeof(size_t));
+			for (size_t i = begin; i < end; i++)
+			{
+				histogram[(source[i].key >> shift) & 0xFF]++;
+			}
+
+			#pragma omp barrier
+			#pragma omp single
+			{
+				size_t total = 0;
+				for (int digit = 0; digit < 256; digit++)
+				{
+					size_t digit_total = 0;
+					for (int j = 0; j < num_threads; j++)
+					{
+						size_t count = histograms[(j * 256) + digit];
+						histograms[(j * 256) + digit] = total;
+						total += count;
+						digit_total += count;
+					}
+					if (digit_total == num_pairs) { skip = 1; }
+				}
+			}
+
+			if (!skip)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					destination[histogram[(source[i].key >> shift) & 0xFF]++] =
+										source[i];
+				}
+			}
+		}
+
+		if (!skip)
+		{
+			swap = source;
+			source = destination;
+			destination = swap;
+		}
+	}
+
+	if (source != pairs) { memcpy(pairs, source, num_pairs * sizeof(ct_sort_pair_t)); }
+
+	free(histograms);
+	free(buffer);
+	return 0;
+}
+
+/*********
+ * Scans *
+ *********/
+
+uint32_t ct_parallel_prefix_sum(uint32_t *values, uint32_t num_values)
+{
+	// Exclusive scan in place. Returns the total.
+	int max_threads = omp_get_max_threads();
+	uint32_t partial_sums[max_threads + 1];
+	uint32_t total = 0;
+
+	#pragma omp parallel if (num_values > CT_PARALLEL_THRESHOLD)
+	{
+		int num_threads = omp_get_num_threads();
+		int thread = omp_get_thread_num();
+		uint32_t begin = ((uint64_t)num_values * thread) / num_threads;
+		uint32_t end = ((uint64_t)num_values * (thread + 1)) / num_threads;
+
+		uint32_t sum = 0;
+		for (uint32_t i = begin; i < end; i++) { sum += values[i]; }
+		partial_sums[thread + 1] = sum;
+
+		#pragma omp barrier
+		#pragma omp single
+		{
+			partial_sums[0] = 0;
+			for (int j = 0; j < num_threads; j++)
+			{
+				partial_sums[j + 1] += partial_sums[j];
+			}
+			total = partial_sums[num_threads];
+		}
+
+		uint32_t running = partial_sums[thread];
+		uint32_t value;
+		for (uint32_t i = begin; i < end; i++)
+		{
+			value = values[i];
+			values[i] = running;
+			running += value;
+		}
+	}
+
+	return total;
+}
+
+/***********
+ * Hashing *
+ ***********/
+
+uint64_t ct_parallel_hash(void *data, size_t size, uint64_t seed)
+{
+	/* Fixed-size chunks are hashed independently, then their hashes are hashed in order,
+	 * so the result depends only on the data and seed, not on the number of threads. */
+	if (size <= CT_HASH_CHUNK_SIZE) { return ct_hash_bytes(data, size, seed); }
+
+	size_t num_chunks = (size / CT_HASH_CHUNK_SIZE) + ((size % CT_HASH_CHUNK_SIZE) != 0);
+	uint64_t *chunk_hashes = malloc(num_chunks * sizeof(uint64_t));
+	if (!chunk_hashes) { return ct_hash_bytes(data, size, seed); }
+
+	uint8_t *bytes = data;
+	#pragma omp parallel for
+	for (size_t i = 0; i < num_chunks; i++)
+	{
+		size_t begin = i * CT_HASH_CHUNK_SIZE;
+		size_t chunk_size = ((size - begin) < CT_HASH_CHUNK_SIZE) ?
+					(size - begin) : CT_HASH_CHUNK_SIZE;
+		chunk_hashes[i] = ct_hash_bytes(&(bytes[begin]), chunk_size, seed);
+	}
+
+	uint64_t hash = ct_hash_bytes(chunk_hashes, num_chunks * sizeof(uint64_t), seed ^ size);
+	free(chunk_hashes);
+	return hash;
+}
+
+uint64_t ct_hash_bytes(void *data, size_t size, uint64_t seed)
+{
+	// Multiply-rotate rounds over four lanes (after xxHash64). Not for cryptographic use.
+	uint8_t *position = data;
+	uint8_t *end = &(position[size]);
+	uint64_t lanes[4] = { seed + 0x9E3779B185EBCA87ull + 0xC2B2AE3D27D4EB4Full,
+				seed + 0xC2B2AE3D27D4EB4Full, seed, seed - 0x9E3779B185EBCA87ull };
+	uint64_t value;
+	while ((end - position) >= 32)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			memcpy(&value, &(position[i * 8]), sizeof(value));
+			lanes[i] = ct_hash_round(lanes[i], value);
+		}
+		position += 32;
+	}
+
+	uint64_t hash = seed + size;
+	for (int i = 0; i < 4; i++) { hash = ct_hash_round(hash, lanes[i]); }
+	while ((end - position) >= 8)
+	{
+		memcpy(&value, position, sizeof(value));
+		hash = ct_hash_round(hash, value);
+		position += 8;
+	}
+	value = 0;
+	if (position < end)
+	{
+		memcpy(&value, position, end - position);
+		hash = ct_hash_round(hash, value);
+	}
+
+	// Final avalanche, so every input bit affects every output bit:
+	hash ^= hash >> 33;
+	hash *= 0xC2B2AE3D27D4EB4Full;
+	hash ^= hash >> 29;
+	hash *= 0x165667B19E3779F9ull;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+uint64_t ct_hash_round(uint64_t hash, uint64_t value)
+{
+	hash += value * 0xC2B2AE3D27D4EB4Full;
+	hash = (hash << 31) | (hash >> 33);
+	return hash * 0x9E3779B185EBCA87ull;
+}
@@ -0,0 +1,34 @@
+#ifndef CT_PARALLEL_H
+#define CT_PARALLEL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <omp.h>
+
+#include <NM-Config/Config.h>
+
+#define CT_PARALLEL_THRESHOLD 65536 // Below this, parallel loops run on one thread.
+#define CT_HASH_CHUNK_SIZE 1048576 // Bytes hashed by each task before combining.
+
+typedef struct
+{
+	uint64_t key;
+	uint32_t value;
+} ct_sort_pair_t;
+
+// Sorting:
+int ct_parallel_sort_pairs(ct_sort_pair_t *pairs, size_t num_pairs, uint8_t key_bits,
+						char error[NM_MAX_ERROR_LENGTH]);
+
+// Scans:
+uint32_t ct_parallel_prefix_sum(uint32_t *values, uint32_t num_values);
+
+// Hashing:
+uint64_t ct_parallel_hash(void *data, size_t size, uint64_t seed);
+uint64_t ct_hash_bytes(void *data, size_t size, uint64_t seed);
+uint64_t ct_hash_round(uint64_t hash, uint64_t value);
+
+#endif
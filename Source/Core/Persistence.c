@@ -0,0 +1,445 @@
+#include "Persistence.h"
+
+/***********
+ * Queries *
+ ***********/
+
+/* The k most persistent maxima or minima, without building any trees. The vertices are
+ * sorted into sweep order and swept once with the disjoint set, as for a merge tree, but no
+ * arcs are written. When two components meet, the younger extremum (the one swept later) dies
+ * at the current vertex and the older one carries on, so each merge gives one extremum/saddle
+ * pair, and only the k most persistent are kept in a heap. The sort runs in place in the
+ * sweep order's own memory, so the query holds 16 bytes per vertex at most (the sweep order
+ * and the disjoint set), against the 28 bytes per node of each tree before any arcs. */
+
+int ct_persistence_query(ct_persistence_t *query, ct_mesh_t *mesh,
+				char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Set k, direction and axis first. The oldest extremum of each component never dies, and
+	 * is paired with no saddle at infinite persistence, so it always comes first: */
+	uint8_t grid = (!mesh->edges && mesh->volume.scalars);
+	uint64_t num_vertices = grid ? ct_volume_get_num_voxels(&(mesh->volume)) :
+									mesh->num_vertices;
+	if (!num_vertices || (num_vertices >= CT_TREE_NO_NODE) || (!grid && (query->axis > 2)))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Mesh \"%s\" has no vertices or no axis %u.", mesh->name, query->axis);
+		return -1;
+	}
+	if (!grid && !mesh->edges)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Mesh \"%s\" needs edges for a persistence query.", mesh->name);
+		return -1;
+	}
+
+	if (ct_persistence_init(query, num_vertices, error) ||
+		ct_persistence_sort(query, mesh, error))
+	{
+		ct_persistence_free(query);
+		return -1;
+	}
+
+	query->disjoint_set.num_elements = query->num_vertices;
+	if (ct_disjoint_set_allocate(&(query->disjoint_set), error))
+	{
+		ct_persistence_free(query);
+		return -1;
+	}
+
+	ct_persistence_sweep(query, mesh);
+	ct_persistence_add_oldest(query);
+	ct_persistence_heap_sort(query);
+	ct_persistence_free_sweep(query);
+	return 0;
+}
+
+int ct_persistence_init(ct_persistence_t *query, uint32_t num_vertices,
+				char error[NM_MAX_ERROR_LENGTH])
+{
+	ct_persistence_free(query);
+	query->num_vertices = num_vertices;
+	query->pairs = malloc((query->k ? query->k : 1) * sizeof(ct_persistence_pair_t));
+	query->order = malloc((size_t)num_vertices * 2 * sizeof(uint32_t));
+	if (!query->pairs || !query->order)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for persistence query.");
+		return -1;
+	}
+	query->steps = &(query->order[num_vertices]);
+
+	return 0;
+}
+
+void ct_persistence_free(ct_persistence_t *query)
+{
+	free(query->pairs);
+	query->pairs = NULL;
+	query->num_pairs = 0;
+	ct_persistence_free_sweep(query);
+}
+
+void ct_persistence_free_sweep(ct_persistence_t *query)
+{
+	free(query->order);
+	ct_disjoint_set_free(&(query->disjoint_set));
+	query->order = NULL;
+	query->steps = NULL;
+	query->num_vertices = 0;
+}
+
+/*********
+ * Sweep *
+ *********/
+
+int ct_persistence_sort(ct_persistence_t *query, ct_mesh_t *mesh,
+				char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Each vertex is sorted as its key and index together, so ties are broken by vertex
+	 * index as in the trees. The entries fill the sweep order and steps, and are read out in
+	 * index order, which never overtakes the writes: */
+	uint32_t *entries = query->order;
+	#pragma omp parallel for if (query->num_vertices > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < query->num_vertices; i++)
+	{
+		entries[2 * i] = ct_persistence_get_key(ct_region_get_value(mesh, i, query->axis));
+		entries[(2 * i) + 1] = i;
+	}
+
+	qsort(entries, query->num_vertices, 2 * sizeof(uint32_t),
+					ct_persistence_entry_qsort_compare);
+
+	for (uint32_t i = 0; i < query->num_vertices; i++) { query->order[i] = entries[(2 * i) + 1]; }
+	for (uint32_t i = 0; query->direction && (i < (query->num_vertices / 2)); i++)
+	{
+		uint32_t swap = query->order[i];
+		query->order[i] = query->order[query->num_vertices - 1 - i];
+		query->order[query->num_vertices - 1 - i] = swap;
+	}
+
+	#pragma omp parallel for if (query->num_vertices > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < query->num_vertices; i++) { query->steps[query->order[i]] = i; }
+
+	return 0;
+}
+
+int ct_persistence_entry_qsort_compare(const void *a, const void *b)
+{
+	// Key, then vertex:
+	uint32_t *left = (uint32_t *)a;
+	uint32_t *right = (uint32_t *)b;
+	if (left[0] != right[0]) { return (left[0] > right[0]) - (left[0] < right[0]); }
+	return (left[1] > right[1]) - (left[1] < right[1]);
+}
+
+uint32_t ct_persistence_get_key(float value)
+{
+	/* Flips the sign bit of positive values and every bit of negative ones, so keys sort as
+	 * the values do. Both zeros get the same key, as they compare equal: */
+	uint32_t bits;
+	if (value == 0.0f) { value = 0.0f; }
+	memcpy(&bits, &value, sizeof(bits));
+	return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+void ct_persistence_sweep(ct_persistence_t *query, ct_mesh_t *mesh)
+{
+	// Only neighbours already swept past are merged, as in the merge tree sweep:
+	uint32_t neighbours[CT_GRID_MAX_NEIGHBOURS];
+	for (uint32_t step = 0; step < query->num_vertices; step++)
+	{
+		uint32_t vertex = query->order[step];
+		uint32_t component = CT_TREE_NO_NODE; // Not yet joined to anything.
+		if (!mesh->edges && mesh->volume.scalars)
+		{
+			uint32_t num_neighbours = ct_volume_get_neighbours(&(mesh->volume), vertex,
+										neighbours);
+			for (uint32_t i = 0; i < num_neighbours; i++)
+			{
+				uint32_t adjacent_step = query->steps[neighbours[i]];
+				if (adjacent_step >= step) { continue; }
+				component = ct_persistence_merge(query, mesh, step, component,
+										adjacent_step);
+			}
+			continue;
+		}
+
+		uint32_t current_edge = mesh->first_edge[vertex];
+		uint32_t adjacent_vertex = vertex;
+		while (1)
+		{
+			uint32_t previous_adjacent_vertex = adjacent_vertex;
+			if (mesh->edges[current_edge].from == vertex)
+			{
+				adjacent_vertex = mesh->edges[current_edge].to;
+			}
+			else { adjacent_vertex = mesh->edges[current_edge].from; }
+
+			uint32_t adjacent_step = query->steps[adjacent_vertex];
+			if ((adjacent_vertex != previous_adjacent_vertex) && (adjacent_step < step))
+			{
+				component = ct_persistence_merge(query, mesh, step, component,
+										adjacent_step);
+			}
+
+			current_edge = ct_mesh_get_next_vertex_edge(mesh, vertex, current_edge);
+			if ((current_edge == UINT32_MAX) || (mesh->edges[current_edge].other_half ==
+									mesh->first_edge[vertex]))
+			{
+				break;
+			}
+		}
+	}
+}
+
+uint32_t ct_persistence_merge(ct_persistence_t *query, ct_mesh_t *mesh, uint32_t step,
+						uint32_t component, uint32_t adjacent_step)
+{
+	/* Joins the current step's component to that of an already swept neighbour, and returns
+	 * the root. A step joins its first component without a pair, as it is no extremum. After
+	 * that, each other component it meets makes the step a saddle, where the younger of the
+	 * two extrema dies: */
+	ct_disjoint_set_t *disjoint_set = &(query->disjoint_set);
+	uint32_t adjacent_component = ct_disjoint_set_find(adjacent_step, disjoint_set);
+	if (component == CT_TREE_NO_NODE)
+	{
+		uint32_t extremum = disjoint_set->extremum[adjacent_component];
+		component = ct_disjoint_set_link(step, adjacent_component, disjoint_set);
+		disjoint_set->extremum[component] = extremum;
+		return component;
+	}
+	if (adjacent_component == component) { return component; }
+
+	uint32_t older = disjoint_set->extremum[component];
+	uint32_t younger = disjoint_set->extremum[adjacent_component];
+	if (younger < older)
+	{
+		uint32_t swap = older;
+		older = younger;
+		younger = swap;
+	}
+
+	ct_persistence_pair_t pair;
+	pair.extremum = query->order[younger];
+	pair.saddle = query->order[step];
+	pair.persistence = fabsf(ct_region_get_value(mesh, pair.extremum, query->axis) -
+				ct_region_get_value(mesh, pair.saddle, query->axis));
+	ct_persistence_heap_push(query, &pair);
+
+	component = ct_disjoint_set_link(component, adjacent_component, disjoint_set);
+	disjoint_set->extremum[component] = older;
+	return component;
+}
+
+void ct_persistence_add_oldest(ct_persistence_t *query)
+{
+	// One per component. Their roots are the only steps that are still their own parent:
+	for (uint32_t i = 0; i < query->num_vertices; i++)
+	{
+		if (query->disjoint_set.parent[i] != i) { continue; }
+		ct_persistence_pair_t pair;
+		pair.extremum = query->order[query->disjoint_set.extremum[i]];
+		pair.saddle = CT_TREE_NO_NODE;
+		pair.persistence = INFINITY;
+		ct_persistence_heap_push(query, &pair);
+	}
+}
+
+/********
+ * Heap *
+ ********/
+
+int ct_persistence_pair_is_less(ct_persistence_t *query, ct_persistence_pair_t *pair,
+						ct_persistence_pair_t *other_pair)
+{
+	// Ties in persistence go to the extremum swept first, so results do not depend on k:
+	if (pair->persistence != other_pair->persistence)
+	{
+		return (pair->persistence < other_pair->persistence);
+	}
+	return (query->steps[pair->extremum] > query->steps[other_pair->extremum]);
+}
+
+void ct_persistence_heap_push(ct_persistence_t *query, ct_persistence_pair_t *pair)
+{
+	// The least persistent pair kept is at the top, to be replaced by anything better:
+	if (!query->k) { return; }
+	if (query->num_pairs == query->k)
+	{
+		if (!ct_persistence_pair_is_less(query, &(query->pairs[0]), pair)) { return; }
+		query->pairs[0] = *pair;
+		ct_persistence_heap_sift_down(query, 0, query->num_pairs);
+		return;
+	}
+
+	uint32_t index = query->num_pairs;
+	query->num_pairs++;
+	while (index > 0)
+	{
+		uint32_t parent = (index - 1) / 2;
+		if (!ct_persistence_pair_is_less(query, pair, &(query->pairs[parent]))) { break; }
+		query->pairs[index] = query->pairs[parent];
+		index = parent;
+	}
+	query->pairs[index] = *pair;
+}
+
+void ct_persistence_heap_sift_down(ct_persistence_t *query, uint32_t index, uint32_t num_pairs)
+{
+	ct_persistence_pair_t pair = query->pairs[index];
+	while (1)
+	{
+		uint32_t child = (2 * index) + 1;
+		if (child >= num_pairs) { break; }
+		if (((child + 1) < num_pairs) && ct_persistence_pair_is_less(query,
+				&(query->pairs[child + 1]), &(query->pairs[child])))
+		{
+			child++;
+		}
+		if (!ct_persistence_pair_is_less(query, &(query->pairs[child]), &pair)) { break; }
+		query->pairs[index] = query->pairs[child];
+		index = child;
+	}
+	query->pairs[index] = pair;
+}
+
+void ct_persistence_heap_sort(ct_persistence_t *query)
+{
+	// Taking the least off the top each time leaves the pairs most persistent first:
+	for (uint32_t i = query->num_pairs; i > 1; i--)
+	{
+		ct_persistence_pair_t pair = query->pairs[0];
+		query->pairs[0] = query->pairs[i - 1];
+		query->pairs[i - 1] = pair;
+		ct_persistence_heap_sift_down(query, 0, i - 1);
+	}
+}
+
+#ifdef CT_DEBUG
+int ct_persistence_benchmark(FILE *file, ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Times a top 16 query against building the merge tree it would otherwise be read from,
+	 * with the memory each holds at its peak. Then every pair, not just the top ones, is
+	 * checked against the elder rule run over the merge tree's arcs. Meshes use the y
+	 * coordinate, as the other benchmarks do: */
+	uint8_t grid = (!mesh->edges && mesh->volume.scalars);
+	char *names[2] = { "minima", "maxima" };
+	for (int direction = 1; direction >= 0; direction--)
+	{
+		ct_persistence_t query = {0};
+		ct_persistence_t all_pairs = {0};
+		ct_persistence_t tree_pairs = {0};
+		ct_tree_t merge_tree = {0};
+		query.k = 16;
+		query.direction = direction;
+		query.axis = 1;
+
+		double time = omp_get_wtime();
+		int status = ct_persistence_query(&query, mesh, error);
+		time = omp_get_wtime() - time;
+
+		double tree_time = omp_get_wtime();
+		status = status || (grid ? ct_tree_scalar_function_volume(&merge_tree, mesh, error) :
+				ct_tree_scalar_function_y(&merge_tree, mesh, error)) ||
+			ct_merge_tree_construct(&merge_tree, mesh, direction ?
+				(merge_tree.num_nodes - 1) : 0, error);
+		tree_time = omp_get_wtime() - tree_time;
+
+		all_pairs.k = merge_tree.num_nodes;
+		all_pairs.direction = direction;
+		all_pairs.axis = 1;
+		tree_pairs = all_pairs;
+		status = status || ct_persistence_query(&all_pairs, mesh, error) ||
+			ct_persistence_query_tree(&tree_pairs, &merge_tree, mesh, error);
+
+		uint32_t num_differences = 0;
+		if (!status)
+		{
+			num_differences = (all_pairs.num_pairs != tree_pairs.num_pairs) ||
+					(all_pairs.num_pairs < query.num_pairs);
+			for (uint32_t i = 0; (i < all_pairs.num_pairs) && !num_differences; i++)
+			{
+				num_differences += memcmp(&(all_pairs.pairs[i]), &(tree_pairs.pairs[i]),
+							sizeof(ct_persistence_pair_t)) != 0;
+			}
+			for (uint32_t i = 0; (i < query.num_pairs) && !num_differences; i++)
+			{
+				num_differences += memcmp(&(query.pairs[i]), &(all_pairs.pairs[i]),
+							sizeof(ct_persistence_pair_t)) != 0;
+			}
+
+			size_t query_bytes = ((size_t)merge_tree.num_nodes * 4 * sizeof(uint32_t)) +
+						(query.k * sizeof(ct_persistence_pair_t));
+			size_t tree_bytes = ((size_t)merge_tree.num_nodes * sizeof(ct_tree_node_t)) +
+				((size_t)ct_tree_get_num_arc_slots(&merge_tree) * sizeof(uint32_t));
+			fprintf(file, "Top %u of %u %s in %.3f ms (%.2f MB), merge tree %.3f ms "
+				"(%.2f MB), pairs %s the tree's. Next after the oldest: %.6f.\n",
+				query.num_pairs, all_pairs.num_pairs, names[direction], time * 1000.0,
+				query_bytes / 1048576.0, tree_time * 1000.0, tree_bytes / 1048576.0,
+				num_differences ? "differ from" : "match",
+				(query.num_pairs > 1) ? query.pairs[1].persistence : 0.0f);
+		}
+		if (!status && num_differences)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH,
+				"Persistence pairs of the %s differ from the merge tree's.", names[direction]);
+			status = -1;
+		}
+
+		ct_persistence_free(&query);
+		ct_persistence_free(&all_pairs);
+		ct_persistence_free(&tree_pairs);
+		ct_tree_free(&merge_tree);
+		if (status) { return -1; }
+	}
+
+	return 0;
+}
+
+int ct_persistence_query_tree(ct_persistence_t *query, ct_tree_t *merge_tree, ct_mesh_t *mesh,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	/* The same query with a merge tree of the same direction in place of the mesh. Its arcs
+	 * to nodes already swept join the same components the mesh edges do, so the pairs have
+	 * to come out identical: */
+	if (ct_persistence_init(query, merge_tree->num_nodes, error))
+	{
+		ct_persistence_free(query);
+		return -1;
+	}
+
+	for (uint32_t i = 0; i < merge_tree->num_nodes; i++)
+	{
+		uint32_t step = query->direction ? (merge_tree->num_nodes - 1 - i) : i;
+		query->order[step] = merge_tree->nodes[i].node_to_vertex;
+		query->steps[merge_tree->nodes[i].node_to_vertex] = step;
+	}
+
+	query->disjoint_set.num_elements = query->num_vertices;
+	if (ct_disjoint_set_allocate(&(query->disjoint_set), error))
+	{
+		ct_persistence_free(query);
+		return -1;
+	}
+
+	uint8_t arc_direction = !query->direction;
+	for (uint32_t step = 0; step < query->num_vertices; step++)
+	{
+		ct_tree_node_t *node = &(merge_tree->nodes[query->direction ?
+					(merge_tree->num_nodes - 1 - step) : step]);
+		uint32_t component = CT_TREE_NO_NODE;
+		for (uint32_t j = 0; j < node->degree[arc_direction]; j++)
+		{
+			ct_tree_node_t *adjacent_node = &(merge_tree->nodes[merge_tree->arcs[
+						node->first_arc[arc_direction] + j]]);
+			component = ct_persistence_merge(query, mesh, step, component,
+					query->steps[adjacent_node->node_to_vertex]);
+		}
+	}
+
+	ct_persistence_add_oldest(query);
+	ct_persistence_heap_sort(query);
+	ct_persistence_free_sweep(query);
+	return 0;
+}
+#endif
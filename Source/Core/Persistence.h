@@ -0,0 +1,75 @@
+#ifndef CT_PERSISTENCE_H
+#define CT_PERSISTENCE_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <omp.h>
+
+#include <NM-Config/Config.h>
+
+#include "Contour-Tree.h"
+#include "Mesh.h"
+#include "Parallel.h"
+#include "Region.h"
+
+// An extremum and the saddle where it merges into an older one, by the elder rule:
+typedef struct
+{
+	float persistence;	// Value difference, or INFINITY for the oldest extremum of a component.
+	uint32_t extremum;	// Vertices.
+	uint32_t saddle;	// CT_TREE_NO_NODE for the oldest extremum of a component.
+} ct_persistence_pair_t;
+
+typedef struct
+{
+	uint32_t k;
+	uint8_t direction;	// 1 for maxima (sweep high to low, as the join tree), 0 for minima.
+	uint8_t axis;	// As for ct_region_scalar_function.
+
+	// Most persistent first once the query is done. A bounded min-heap during the sweep:
+	uint32_t num_pairs;
+	ct_persistence_pair_t *pairs;
+
+	// Per vertex, only during the sweep:
+	uint32_t num_vertices;
+	uint32_t *order;	// Sweep step to vertex. Owns the allocation.
+	uint32_t *steps;	// Vertex to sweep step. Follows order.
+	ct_disjoint_set_t disjoint_set;	// On sweep steps. Extremum is the oldest step in the set.
+} ct_persistence_t;
+
+// Queries:
+int ct_persistence_query(ct_persistence_t *query, ct_mesh_t *mesh,
+				char error[NM_MAX_ERROR_LENGTH]);
+int ct_persistence_init(ct_persistence_t *query, uint32_t num_vertices,
+				char error[NM_MAX_ERROR_LENGTH]);
+void ct_persistence_free(ct_persistence_t *query);
+void ct_persistence_free_sweep(ct_persistence_t *query);
+
+// Sweep:
+int ct_persistence_sort(ct_persistence_t *query, ct_mesh_t *mesh,
+				char error[NM_MAX_ERROR_LENGTH]);
+int ct_persistence_entry_qsort_compare(const void *a, const void *b);
+uint32_t ct_persistence_get_key(float value);
+void ct_persistence_sweep(ct_persistence_t *query, ct_mesh_t *mesh);
+uint32_t ct_persistence_merge(ct_persistence_t *query, ct_mesh_t *mesh, uint32_t step,
+						uint32_t component, uint32_t adjacent_step);
+void ct_persistence_add_oldest(ct_persistence_t *query);
+
+// Heap:
+int ct_persistence_pair_is_less(ct_persistence_t *query, ct_persistence_pair_t *pair,
+						ct_persistence_pair_t *other_pair);
+void ct_persistence_heap_push(ct_persistence_t *query, ct_persistence_pair_t *pair);
+void ct_persistence_heap_sift_down(ct_persistence_t *query, uint32_t index, uint32_t num_pairs);
+void ct_persistence_heap_sort(ct_persistence_t *query);
+
+#ifdef CT_DEBUG
+int ct_persistence_benchmark(FILE *file, ct_mesh_t *mesh, char error[NM_MAX_ERROR_LENGTH]);
+int ct_persistence_query_tree(ct_persistence_t *query, ct_tree_t *merge_tree, ct_mesh_t *mesh,
+						char error[NM_MAX_ERROR_LENGTH]);
+#endif
+
+#endif
@@ -0,0 +1,924 @@
+#include "Region.h"
+
+/***********
+ * Regions *
+ ***********/
+
+/* Regions restrict trees to part of a mesh: the vertices inside a mask and every edge between
+ * two of them, so a region's boundary is simply where its edges stop. Trees on a region have
+ * one node per region vertex and never touch anything outside it, so sorting, sweeping and
+ * peeling cost the region's size (see ct_region_scalar_function and
+ * ct_merge_tree_construct_region). Grids find the voxels in a box or sphere from their
+ * coordinates directly. Meshes have no spatial index, so those masks test every vertex, in
+ * one pass that is cheap next to building the trees. Masks may be empty, but trees may not.
+ *
+ * Bands (see ct_region_from_band) are masks on value instead, for the topology within a range
+ * of values. Cutting the mesh there would split contours that meet again outside the range, so
+ * each connected piece below or above the band is kept as a single pseudo-node. Trees on the
+ * band are then those of the function clamped to the range, with each flat piece made one
+ * node. Finding the pieces takes one parallel pass over the edges outside the band, with no
+ * sorting, and from then on the trees only cost the band and the number of pieces. */
+
+int ct_region_from_box(ct_region_t *region, ct_mesh_t *mesh, float low[3], float high[3],
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	// Positions as ct_region_get_position gives them, bounds included:
+	return ct_region_from_range(region, mesh, low, high, NULL, 0.0f, error);
+}
+
+int ct_region_from_sphere(ct_region_t *region, ct_mesh_t *mesh, float centre[3], float radius,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	float low[3];
+	float high[3];
+	for (int i = 0; i < 3; i++)
+	{
+		low[i] = centre[i] - radius;
+		high[i] = centre[i] + radius;
+	}
+	return ct_region_from_range(region, mesh, low, high, centre, radius, error);
+}
+
+int ct_region_from_vertices(ct_region_t *region, ct_mesh_t *mesh, uint32_t *vertices,
+			uint32_t num_vertices, char error[NM_MAX_ERROR_LENGTH])
+{
+	// Any order, with repeats dropped:
+	uint8_t grid = (!mesh->edges && mesh->volume.scalars);
+	uint64_t num_mesh_vertices = grid ? ct_volume_get_num_voxels(&(mesh->volume)) :
+								mesh->num_vertices;
+	ct_region_free(region);
+	region->vertices = malloc((num_vertices ? num_vertices : 1) * sizeof(uint32_t));
+	if (!region->vertices)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for region.");
+		return -1;
+	}
+	memcpy(region->vertices, vertices, num_vertices * sizeof(uint32_t));
+	qsort(region->vertices, num_vertices, sizeof(uint32_t), ct_region_vertex_qsort_compare);
+
+	for (uint32_t i = 0; i < num_vertices; i++)
+	{
+		if (region->vertices[i] >= num_mesh_vertices)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH,
+				"Region vertex %u is not in mesh \"%s\".", region->vertices[i],
+									mesh->name);
+			ct_region_free(region);
+			return -1;
+		}
+		if (!region->num_vertices || (region->vertices[i] !=
+					region->vertices[region->num_vertices - 1]))
+		{
+			region->vertices[region->num_vertices] = region->vertices[i];
+			region->num_vertices++;
+		}
+	}
+
+	return 0;
+}
+
+int ct_region_from_range(ct_region_t *region, ct_mesh_t *mesh, float low[3], float high[3],
+		float *centre, float radius, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* The vertices within the box from low to high and, if there is a centre, also within the
+	 * radius of it. Candidates are every mesh vertex, or the voxels in the box for grids.
+	 * They are counted per chunk in parallel, and a prefix sum over the chunks gives each
+	 * chunk where its vertices start, so the fill runs in parallel and stays in order: */
+	uint8_t grid = (!mesh->edges && mesh->volume.scalars);
+	ct_volume_t *volume = &(mesh->volume);
+	uint32_t begin[3] = { 0, 0, 0 };
+	uint32_t end[3] = { mesh->num_vertices, 1, 1 };
+	if (grid)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			float spacing = (volume->spacing[i] > 0.0f) ? volume->spacing[i] : 1.0f;
+			float first = ceilf(low[i] / spacing);
+			float last = floorf(high[i] / spacing) + 1.0f;
+			begin[i] = (first > 0.0f) ? (uint32_t)fminf(first, volume->dimensions[i]) : 0;
+			end[i] = (last > 0.0f) ? (uint32_t)fminf(last, volume->dimensions[i]) : 0;
+			if (end[i] < begin[i]) { end[i] = begin[i]; }
+		}
+	}
+	// At most every voxel, so this fits as the volume does:
+	uint32_t num_candidates = (uint64_t)(end[0] - begin[0]) * (end[1] - begin[1]) *
+								(end[2] - begin[2]);
+
+	ct_region_free(region);
+	uint32_t num_chunks = ct_region_get_num_chunks(num_candidates);
+	uint32_t *chunk_starts = malloc(num_chunks * sizeof(uint32_t));
+	if (!chunk_starts)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for region.");
+		return -1;
+	}
+
+	#pragma omp parallel for if (num_chunks > 1)
+	for (uint32_t i = 0; i < num_chunks; i++)
+	{
+		uint32_t count = 0;
+		for (uint32_t j = ct_region_get_chunk_start(num_candidates, num_chunks, i);
+			j < ct_region_get_chunk_start(num_candidates, num_chunks, i + 1); j++)
+		{
+			count += ct_region_is_inside(mesh, ct_region_get_candidate(mesh, begin, end, j),
+								low, high, centre, radius);
+		}
+		chunk_starts[i] = count;
+	}
+	region->num_vertices = ct_parallel_prefix_sum(chunk_starts, num_chunks);
+
+	region->vertices = malloc((region->num_vertices ? region->num_vertices : 1) *
+								sizeof(uint32_t));
+	if (!region->vertices)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for region.");
+		free(chunk_starts);
+		ct_region_free(region);
+		return -1;
+	}
+
+	#pragma omp parallel for if (num_chunks > 1)
+	for (uint32_t i = 0; i < num_chunks; i++)
+	{
+		uint32_t index = chunk_starts[i];
+		for (uint32_t j = ct_region_get_chunk_start(num_candidates, num_chunks, i);
+			j < ct_region_get_chunk_start(num_candidates, num_chunks, i + 1); j++)
+		{
+			uint32_t vertex = ct_region_get_candidate(mesh, begin, end, j);
+			if (ct_region_is_inside(mesh, vertex, low, high, centre, radius))
+			{
+				region->vertices[index] = vertex;
+				index++;
+			}
+		}
+	}
+	free(chunk_starts);
+
+	return 0;
+}
+
+int ct_region_from_band(ct_region_t *region, ct_mesh_t *mesh, uint8_t axis, float low, float high,
+							char error[NM_MAX_ERROR_LENGTH])
+{
+	/* The vertices with values from low to high, as ct_region_scalar_function gives them for
+	 * the axis, and the pseudo-nodes for everything else. Every mesh vertex has a node, so
+	 * they are looked up directly instead of searched for. Each pass over the mesh runs in
+	 * parallel: vertices, like pseudo-nodes, are counted per chunk of the mesh, and a prefix
+	 * sum over the chunks gives each chunk the index its own begin at, so order is kept: */
+	uint8_t grid = (!mesh->edges && mesh->volume.scalars);
+	uint32_t num_mesh_vertices = grid ? ct_volume_get_num_voxels(&(mesh->volume)) :
+								mesh->num_vertices;
+	if (!grid && (axis > 2))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Mesh \"%s\" has no axis %u.", mesh->name, axis);
+		return -1;
+	}
+
+	ct_region_free(region);
+	uint32_t num_chunks = ct_region_get_num_chunks(num_mesh_vertices);
+	uint32_t *chunk_starts = malloc(num_chunks * sizeof(uint32_t));
+	region->vertex_to_node = malloc((num_mesh_vertices ? num_mesh_vertices : 1) *
+								sizeof(uint32_t));
+	if (!chunk_starts || !region->vertex_to_node)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for band.");
+		free(chunk_starts);
+		ct_region_free(region);
+		return -1;
+	}
+
+	#pragma omp parallel for if (num_chunks > 1)
+	for (uint32_t i = 0; i < num_chunks; i++)
+	{
+		uint32_t count = 0;
+		for (uint32_t j = ct_region_get_chunk_start(num_mesh_vertices, num_chunks, i);
+			j < ct_region_get_chunk_start(num_mesh_vertices, num_chunks, i + 1); j++)
+		{
+			count += (ct_region_get_band_side(ct_region_get_value(mesh, j, axis), low,
+										high) == 1);
+		}
+		chunk_starts[i] = count;
+	}
+	region->num_vertices = ct_parallel_prefix_sum(chunk_starts, num_chunks);
+
+	region->vertices = malloc((region->num_vertices ? region->num_vertices : 1) *
+								sizeof(uint32_t));
+	if (!region->vertices)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for band.");
+		free(chunk_starts);
+		ct_region_free(region);
+		return -1;
+	}
+
+	#pragma omp parallel for if (num_chunks > 1)
+	for (uint32_t i = 0; i < num_chunks; i++)
+	{
+		uint32_t index = chunk_starts[i];
+		for (uint32_t j = ct_region_get_chunk_start(num_mesh_vertices, num_chunks, i);
+			j < ct_region_get_chunk_start(num_mesh_vertices, num_chunks, i + 1); j++)
+		{
+			region->vertex_to_node[j] = CT_TREE_NO_NODE;
+			if (ct_region_get_band_side(ct_region_get_value(mesh, j, axis), low, high) == 1)
+			{
+				region->vertex_to_node[j] = index;
+				region->vertices[index] = j;
+				index++;
+			}
+		}
+	}
+	free(chunk_starts);
+
+	// Lowest vertex kept per piece, so pieces can be numbered in order of it:
+	ct_concurrent_set_t set = {0};
+	set.num_elements = num_mesh_vertices;
+	set.direction = 1;
+	int status = ct_concurrent_set_allocate(&set, error);
+	if (!status)
+	{
+		ct_region_join_outside(mesh, &set, axis, low, high);
+		status = ct_region_number_pseudo_nodes(region, mesh, &set, axis, low, high, error) ||
+			ct_region_connect_pseudo_nodes(region, mesh, axis, low, high, error);
+	}
+	ct_concurrent_set_free(&set);
+	if (status)
+	{
+		ct_region_free(region);
+		return -1;
+	}
+
+	return 0;
+}
+
+void ct_region_free(ct_region_t *region)
+{
+	free(region->vertices);
+	free(region->pseudo_vertices);
+	free(region->pseudo_offsets);
+	free(region->pseudo_neighbours);
+	free(region->vertex_to_node);
+	region->vertices = NULL;
+	region->pseudo_vertices = NULL;
+	region->pseudo_offsets = NULL;
+	region->pseudo_neighbours = NULL;
+	region->vertex_to_node = NULL;
+	region->num_vertices = 0;
+	region->num_pseudo_nodes = 0;
+}
+
+int ct_region_vertex_qsort_compare(const void *a, const void *b)
+{
+	uint32_t vertex_a = *((uint32_t *)a);
+	uint32_t vertex_b = *((uint32_t *)b);
+	return (vertex_a > vertex_b) - (vertex_a < vertex_b);
+}
+
+/*********
+ * Bands *
+ *********/
+
+uint8_t ct_region_get_band_side(float value, float low, float high)
+{
+	// 0 below the band, 1 in it and 2 above:
+	if (value < low) { return 0; }
+	if (value > high) { return 2; }
+	return 1;
+}
+
+uint32_t ct_region_get_num_chunks(uint32_t num_elements)
+{
+	// One chunk per thread for passes over a whole mesh or range, or one if it is small:
+	if (num_elements <= CT_PARALLEL_THRESHOLD) { return 1; }
+	return omp_get_max_threads();
+}
+
+uint32_t ct_region_get_chunk_start(uint32_t num_elements, uint32_t num_chunks, uint32_t chunk)
+{
+	return ((uint64_t)num_elements * chunk) / num_chunks;
+}
+
+void ct_region_join_outside(ct_mesh_t *mesh, ct_concurrent_set_t *set, uint8_t axis, float low,
+										float high)
+{
+	/* Joins the ends of every edge that stays on one side of the band, from any thread. Grid
+	 * edges are seen from both ends and boundary half-edges from one, which unions allow for: */
+	uint32_t num_sources = (!mesh->edges && mesh->volume.scalars) ? set->num_elements :
+									mesh->num_edges;
+	#pragma omp parallel for if (num_sources > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < num_sources; i++)
+	{
+		uint32_t vertex;
+		uint32_t neighbours[CT_GRID_MAX_NEIGHBOURS];
+		uint32_t num_neighbours = ct_region_get_mesh_edges(mesh, i, &vertex, neighbours);
+		if (!num_neighbours) { continue; }
+
+		uint8_t side = ct_region_get_band_side(ct_region_get_value(mesh, vertex, axis), low,
+										high);
+		if (side == 1) { continue; }
+		for (uint32_t j = 0; j < num_neighbours; j++)
+		{
+			if (ct_region_get_band_side(ct_region_get_value(mesh, neighbours[j], axis), low,
+										high) == side)
+			{
+				ct_concurrent_set_union(set, vertex, neighbours[j]);
+			}
+		}
+	}
+}
+
+int ct_region_number_pseudo_nodes(ct_region_t *region, ct_mesh_t *mesh, ct_concurrent_set_t *set,
+			uint8_t axis, float low, float high, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* A piece's pseudo-node comes after those of pieces with lower first vertices, so first
+	 * vertices are counted per chunk and numbered from a prefix sum. The other vertices then
+	 * take their piece's node. Its value is that of the vertex furthest from the band, the
+	 * lowest below it or the highest above, with ties broken as in the sweep so it is an
+	 * extremum of the trees: */
+	uint32_t num_elements = set->num_elements;
+	uint32_t num_chunks = ct_region_get_num_chunks(num_elements);
+	uint32_t *chunk_starts = malloc(num_chunks * sizeof(uint32_t));
+	if (!chunk_starts)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for pseudo-nodes.");
+		return -1;
+	}
+
+	#pragma omp parallel for if (num_chunks > 1)
+	for (uint32_t i = 0; i < num_chunks; i++)
+	{
+		uint32_t count = 0;
+		for (uint32_t j = ct_region_get_chunk_start(num_elements, num_chunks, i);
+			j < ct_region_get_chunk_start(num_elements, num_chunks, i + 1); j++)
+		{
+			count += ((region->vertex_to_node[j] == CT_TREE_NO_NODE) &&
+					(ct_concurrent_set_get_extremum(set, j) == j));
+		}
+		chunk_starts[i] = count;
+	}
+	region->num_pseudo_nodes = ct_parallel_prefix_sum(chunk_starts, num_chunks);
+
+	region->pseudo_vertices = malloc((region->num_pseudo_nodes ? region->num_pseudo_nodes :
+								1) * sizeof(uint32_t));
+	if (!region->pseudo_vertices)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for pseudo-nodes.");
+		free(chunk_starts);
+		return -1;
+	}
+
+	#pragma omp parallel for if (num_chunks > 1)
+	for (uint32_t i = 0; i < num_chunks; i++)
+	{
+		uint32_t index = chunk_starts[i];
+		for (uint32_t j = ct_region_get_chunk_start(num_elements, num_chunks, i);
+			j < ct_region_get_chunk_start(num_elements, num_chunks, i + 1); j++)
+		{
+			if ((region->vertex_to_node[j] == CT_TREE_NO_NODE) &&
+				(ct_concurrent_set_get_extremum(set, j) == j))
+			{
+				region->vertex_to_node[j] = region->num_vertices + index;
+				region->pseudo_vertices[index] = j;
+				index++;
+			}
+		}
+	}
+	free(chunk_starts);
+
+	// Outside the band only first vertices are numbered so far, and here they are only read:
+	#pragma omp parallel for if (num_elements > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < num_elements; i++)
+	{
+		if (region->vertex_to_node[i] != CT_TREE_NO_NODE) { continue; }
+		uint32_t node = region->vertex_to_node[ct_concurrent_set_get_extremum(set, i)];
+		region->vertex_to_node[i] = node;
+		ct_region_update_extreme(mesh, &(region->pseudo_vertices[node -
+					region->num_vertices]), i, axis, low);
+	}
+
+	return 0;
+}
+
+void ct_region_update_extreme(ct_mesh_t *mesh, uint32_t *extreme, uint32_t vertex, uint8_t axis,
+										float low)
+{
+	/* Moves a pseudo-node's vertex to this one if it is further from the band, from any
+	 * thread. Below the band that is lower in the sweep order (by value, then index), and
+	 * above it higher: */
+	float value = ct_region_get_value(mesh, vertex, axis);
+	uint8_t below = (value < low);
+	uint32_t current;
+	#pragma omp atomic read
+	current = *extreme;
+	while (1)
+	{
+		float current_value = ct_region_get_value(mesh, current, axis);
+		uint8_t lower = ((value < current_value) ||
+				((value == current_value) && (vertex < current)));
+		if ((vertex == current) || (below ? !lower : lower)) { return; }
+		if (__sync_bool_compare_and_swap(extreme, current, vertex)) { return; }
+		#pragma omp atomic read
+		current = *extreme;
+	}
+}
+
+int ct_region_connect_pseudo_nodes(ct_region_t *region, ct_mesh_t *mesh, uint8_t axis,
+				float low, float high, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* An edge from below the band straight to above it joins two pseudo-nodes. There are few
+	 * of them, so they are counted per chunk of the mesh, collected from a prefix sum over
+	 * the chunks, sorted with repeats dropped, and then kept both ways round. Every other
+	 * edge reaches the band, and ct_region_get_neighbours finds those from the band side: */
+	uint32_t num_sources = (!mesh->edges && mesh->volume.scalars) ?
+		ct_volume_get_num_voxels(&(mesh->volume)) : mesh->num_edges;
+	uint32_t num_chunks = ct_region_get_num_chunks(num_sources);
+	uint32_t *chunk_starts = malloc(num_chunks * sizeof(uint32_t));
+	region->pseudo_offsets = malloc((region->num_pseudo_nodes + 1) * sizeof(uint32_t));
+	if (!chunk_starts || !region->pseudo_offsets)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for pseudo-nodes.");
+		free(chunk_starts);
+		return -1;
+	}
+	memset(region->pseudo_offsets, 0, (region->num_pseudo_nodes + 1) * sizeof(uint32_t));
+
+	#pragma omp parallel for if (num_chunks > 1)
+	for (uint32_t i = 0; i < num_chunks; i++)
+	{
+		uint32_t count = 0;
+		uint64_t crossings[CT_GRID_MAX_NEIGHBOURS];
+		for (uint32_t j = ct_region_get_chunk_start(num_sources, num_chunks, i);
+			j < ct_region_get_chunk_start(num_sources, num_chunks, i + 1); j++)
+		{
+			count += ct_region_get_crossings(region, mesh, j, axis, low, high, crossings);
+		}
+		chunk_starts[i] = count;
+	}
+	uint32_t num_pairs = ct_parallel_prefix_sum(chunk_starts, num_chunks);
+
+	ct_sort_pair_t *pairs = malloc((num_pairs ? num_pairs : 1) * sizeof(ct_sort_pair_t));
+	if (!pairs)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for pseudo-nodes.");
+		free(chunk_starts);
+		return -1;
+	}
+
+	#pragma omp parallel for if (num_chunks > 1)
+	for (uint32_t i = 0; i < num_chunks; i++)
+	{
+		uint32_t index = chunk_starts[i];
+		uint64_t crossings[CT_GRID_MAX_NEIGHBOURS];
+		for (uint32_t j = ct_region_get_chunk_start(num_sources, num_chunks, i);
+			j < ct_region_get_chunk_start(num_sources, num_chunks, i + 1); j++)
+		{
+			uint32_t num_crossings = ct_region_get_crossings(region, mesh, j, axis, low,
+									high, crossings);
+			for (uint32_t k = 0; k < num_crossings; k++)
+			{
+				pairs[index].key = crossings[k];
+				pairs[index].value = 0;
+				index++;
+			}
+		}
+	}
+	free(chunk_starts);
+
+	if (ct_parallel_sort_pairs(pairs, num_pairs, 64, error))
+	{
+		free(pairs);
+		return -1;
+	}
+	uint32_t num_unique = 0;
+	for (uint32_t i = 0; i < num_pairs; i++)
+	{
+		if (num_unique && (pairs[i].key == pairs[num_unique - 1].key)) { continue; }
+		pairs[num_unique] = pairs[i];
+		num_unique++;
+		region->pseudo_offsets[(pairs[i].key >> 32) - region->num_vertices]++;
+		region->pseudo_offsets[(uint32_t)pairs[i].key - region->num_vertices]++;
+	}
+
+	ct_parallel_prefix_sum(region->pseudo_offsets, region->num_pseudo_nodes + 1);
+	region->pseudo_neighbours = malloc(((size_t)num_unique * 2 + 1) * sizeof(uint32_t));
+	if (!region->pseudo_neighbours)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for pseudo-nodes.");
+		free(pairs);
+		return -1;
+	}
+
+	// Each pseudo-node's offset moves along as it is filled, then back to where it starts:
+	for (uint32_t i = 0; i < num_unique; i++)
+	{
+		uint32_t below = (uint32_t)(pairs[i].key >> 32);
+		uint32_t above = (uint32_t)pairs[i].key;
+		region->pseudo_neighbours[region->pseudo_offsets[below - region->num_vertices]++] =
+											above;
+		region->pseudo_neighbours[region->pseudo_offsets[above - region->num_vertices]++] =
+											below;
+	}
+	for (uint32_t i = region->num_pseudo_nodes; i > 0; i--)
+	{
+		region->pseudo_offsets[i] = region->pseudo_offsets[i - 1];
+	}
+	region->pseudo_offsets[0] = 0;
+
+	free(pairs);
+	return 0;
+}
+
+uint32_t ct_region_get_crossings(ct_region_t *region, ct_mesh_t *mesh, uint32_t source,
+	uint8_t axis, float low, float high, uint64_t crossings[CT_GRID_MAX_NEIGHBOURS])
+{
+	/* Edges from the source (as for ct_region_get_mesh_edges) that cross the band without a
+	 * vertex in it, as the pseudo-node below shifted up 32 bits and the one above. Half-edges
+	 * on the boundary have no other half, so both ends are tried as below: */
+	uint32_t vertex;
+	uint32_t neighbours[CT_GRID_MAX_NEIGHBOURS];
+	uint32_t num_neighbours = ct_region_get_mesh_edges(mesh, source, &vertex, neighbours);
+	uint8_t side = num_neighbours ? ct_region_get_band_side(ct_region_get_value(mesh, vertex,
+								axis), low, high) : 1;
+	if (side == 1) { return 0; }
+
+	uint32_t num_crossings = 0;
+	for (uint32_t i = 0; i < num_neighbours; i++)
+	{
+		if (ct_region_get_band_side(ct_region_get_value(mesh, neighbours[i], axis), low,
+									high) != (2 - side))
+		{
+			continue;
+		}
+		uint32_t below = region->vertex_to_node[side ? neighbours[i] : vertex];
+		uint32_t above = region->vertex_to_node[side ? vertex : neighbours[i]];
+		crossings[num_crossings] = ((uint64_t)below << 32) | above;
+		num_crossings++;
+	}
+
+	return num_crossings;
+}
+
+/************
+ * Vertices *
+ ************/
+
+void ct_region_get_position(ct_mesh_t *mesh, uint32_t vertex, float position[3])
+{
+	// Voxels sit at their coordinates times the spacing:
+	if (!mesh->edges && mesh->volume.scalars)
+	{
+		uint32_t *dimensions = mesh->volume.dimensions;
+		position[0] = (vertex % dimensions[0]) * mesh->volume.spacing[0];
+		position[1] = ((vertex / dimensions[0]) % dimensions[1]) * mesh->volume.spacing[1];
+		position[2] = (vertex / ((uint64_t)dimensions[0] * dimensions[1])) *
+								mesh->volume.spacing[2];
+		return;
+	}
+
+	position[0] = mesh->vertices[vertex].x;
+	position[1] = mesh->vertices[vertex].y;
+	position[2] = mesh->vertices[vertex].z;
+}
+
+float ct_region_get_value(ct_mesh_t *mesh, uint32_t vertex, uint8_t axis)
+{
+	// Voxel values on grids, whatever the axis, or the coordinate along the axis on meshes:
+	if (!mesh->edges && mesh->volume.scalars)
+	{
+		return ct_volume_get_value(&(mesh->volume), vertex);
+	}
+
+	float position[3];
+	ct_region_get_position(mesh, vertex, position);
+	return position[axis];
+}
+
+uint32_t ct_region_get_vertex(ct_region_t *region, uint32_t node)
+{
+	// The mesh vertex for a region vertex, or whichever stands in for a pseudo-node:
+	if (node < region->num_vertices) { return region->vertices[node]; }
+	return region->pseudo_vertices[node - region->num_vertices];
+}
+
+uint32_t ct_region_get_mesh_edges(ct_mesh_t *mesh, uint32_t source, uint32_t *vertex,
+					uint32_t neighbours[CT_GRID_MAX_NEIGHBOURS])
+{
+	// Every edge of the mesh, from voxels to all their neighbours or from single half-edges:
+	if (!mesh->edges && mesh->volume.scalars)
+	{
+		*vertex = source;
+		return ct_volume_get_neighbours(&(mesh->volume), source, neighbours);
+	}
+
+	ct_edge_t *edge = &(mesh->edges[source]);
+	*vertex = edge->from;
+	neighbours[0] = edge->to;
+	return (edge->from != edge->to);
+}
+
+uint32_t ct_region_get_candidate(ct_mesh_t *mesh, uint32_t begin[3], uint32_t end[3],
+							uint64_t candidate)
+{
+	// Candidates run X fastest through the range, so voxels come out in index order:
+	uint32_t coordinates[3];
+	coordinates[0] = begin[0] + (candidate % (end[0] - begin[0]));
+	candidate /= (end[0] - begin[0]);
+	coordinates[1] = begin[1] + (candidate % (end[1] - begin[1]));
+	coordinates[2] = begin[2] + (candidate / (end[1] - begin[1]));
+	if (!mesh->edges && mesh->volume.scalars)
+	{
+		return ct_get_voxel_index(coordinates, mesh->volume.dimensions);
+	}
+	return coordinates[0];
+}
+
+int ct_region_is_inside(ct_mesh_t *mesh, uint32_t vertex, float low[3], float high[3],
+							float *centre, float radius)
+{
+	float position[3];
+	ct_region_get_position(mesh, vertex, position);
+	float distance = 0.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		if ((position[i] < low[i]) || (position[i] > high[i])) { return 0; }
+		if (centre) { distance += (position[i] - centre[i]) * (position[i] - centre[i]); }
+	}
+	return (!centre || (distance <= (radius * radius)));
+}
+
+uint32_t ct_region_find(ct_region_t *region, uint32_t vertex, uint32_t hint)
+{
+	/* Index of a mesh vertex in the region, or CT_TREE_NO_NODE if it is outside. Bands map
+	 * every vertex. Otherwise the search gallops out from the hint, a region index near the
+	 * answer, and then halves what is left, so neighbours are found close to it in memory: */
+	if (region->vertex_to_node) { return region->vertex_to_node[vertex]; }
+	uint32_t low = 0;
+	uint32_t high = region->num_vertices;
+	if (hint < region->num_vertices)
+	{
+		uint32_t step = 1;
+		if (region->vertices[hint] < vertex)
+		{
+			low = hint + 1;
+			while ((step < (region->num_vertices - hint)) &&
+					(region->vertices[hint + step] < vertex))
+			{
+				low = hint + step + 1;
+				step *= 2;
+			}
+			if (step < (region->num_vertices - hint)) { high = hint + step; }
+		}
+		else
+		{
+			high = hint;
+			while ((step <= hint) && (region->vertices[hint - step] >= vertex))
+			{
+				high = hint - step;
+				step *= 2;
+			}
+			if (step <= hint) { low = hint - step + 1; }
+		}
+	}
+
+	while (low < high)
+	{
+		uint32_t middle = low + ((high - low) / 2);
+		if (region->vertices[middle] < vertex) { low = middle + 1; }
+		else { high = middle; }
+	}
+
+	if ((low < region->num_vertices) && (region->vertices[low] == vertex)) { return low; }
+	return CT_TREE_NO_NODE;
+}
+
+uint32_t ct_region_get_neighbours(ct_region_t *region, ct_mesh_t *mesh, uint32_t vertex,
+		uint32_t *neighbours, uint32_t max_neighbours, uint8_t higher_only)
+{
+	/* Neighbours of a region vertex or pseudo-node that are also in the region, as region
+	 * nodes, and only those with higher indices if asked. Neighbours needs room for
+	 * ct_region_get_max_neighbours, since they are filtered in place: */
+	if (vertex >= region->num_vertices)
+	{
+		uint32_t pseudo_node = vertex - region->num_vertices;
+		uint32_t num_neighbours = 0;
+		for (uint32_t i = region->pseudo_offsets[pseudo_node];
+			i < region->pseudo_offsets[pseudo_node + 1]; i++)
+		{
+			if (higher_only && (region->pseudo_neighbours[i] < vertex)) { continue; }
+			neighbours[num_neighbours] = region->pseudo_neighbours[i];
+			num_neighbours++;
+		}
+		return num_neighbours;
+	}
+
+	uint32_t mesh_vertex = region->vertices[vertex];
+	uint32_t num_mesh_neighbours;
+	if (!mesh->edges && mesh->volume.scalars)
+	{
+		num_mesh_neighbours = ct_volume_get_neighbours(&(mesh->volume), mesh_vertex,
+										neighbours);
+	}
+	else
+	{
+		num_mesh_neighbours = ct_mesh_get_vertex_neighbours(mesh, mesh_vertex, neighbours,
+										max_neighbours);
+		if (num_mesh_neighbours > max_neighbours) { num_mesh_neighbours = max_neighbours; }
+	}
+
+	// Region indices follow mesh indices (pseudo-nodes come last), so the search can be skipped:
+	uint32_t num_neighbours = 0;
+	for (uint32_t i = 0; i < num_mesh_neighbours; i++)
+	{
+		if (higher_only && !region->vertex_to_node && (neighbours[i] < mesh_vertex)) { continue; }
+		uint32_t neighbour = ct_region_find(region, neighbours[i], vertex);
+		if ((neighbour == CT_TREE_NO_NODE) || (neighbour == vertex) ||
+			(higher_only && (neighbour < vertex)))
+		{
+			continue;
+		}
+		neighbours[num_neighbours] = neighbour;
+		num_neighbours++;
+	}
+
+	return num_neighbours;
+}
+
+uint32_t ct_region_get_max_neighbours(ct_region_t *region, ct_mesh_t *mesh)
+{
+	// Room needed by ct_region_get_neighbours for any vertex or pseudo-node of the region:
+	uint32_t max_neighbours = CT_GRID_MAX_NEIGHBOURS;
+	if (mesh->edges || !mesh->volume.scalars)
+	{
+		max_neighbours = 0;
+		#pragma omp parallel for reduction(max: max_neighbours) \
+			if (region->num_vertices > CT_PARALLEL_THRESHOLD)
+		for (uint32_t i = 0; i < region->num_vertices; i++)
+		{
+			uint32_t num_neighbours = ct_mesh_get_vertex_neighbours(mesh,
+							region->vertices[i], NULL, 0);
+			if (num_neighbours > max_neighbours) { max_neighbours = num_neighbours; }
+		}
+	}
+
+	for (uint32_t i = 0; i < region->num_pseudo_nodes; i++)
+	{
+		uint32_t num_neighbours = region->pseudo_offsets[i + 1] - region->pseudo_offsets[i];
+		if (num_neighbours > max_neighbours) { max_neighbours = num_neighbours; }
+	}
+
+	return max_neighbours;
+}
+
+/********************
+ * Scalar functions *
+ ********************/
+
+int ct_region_scalar_function(ct_tree_t *tree, ct_mesh_t *mesh, ct_region_t *region,
+					uint8_t axis, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* As ct_tree_scalar_function_<X> for the region only: the vertex coordinate along the axis
+	 * (0 for x, 1 for y, 2 for z) on meshes, or voxel values on grids, where the axis is not
+	 * used. Region vertices are ascending, so ties break as they would on the whole mesh.
+	 * Pseudo-nodes take the values of their vertices, so bands need the axis they used: */
+	uint8_t grid = (!mesh->edges && mesh->volume.scalars);
+	if (!(region->num_vertices + region->num_pseudo_nodes) || (!grid && (axis > 2)))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Region of mesh \"%s\" is empty or has no axis %u.", mesh->name, axis);
+		return -1;
+	}
+
+	ct_tree_free(tree);
+	tree->num_nodes = region->num_vertices + region->num_pseudo_nodes;
+	tree->nodes = malloc(tree->num_nodes * sizeof(ct_tree_node_t));
+	if (!tree->nodes)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for tree nodes.");
+		return -1;
+	}
+	memset(tree->nodes, 0, tree->num_nodes * sizeof(ct_tree_node_t));
+
+	#pragma omp parallel for if (tree->num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < tree->num_nodes; i++)
+	{
+		tree->nodes[i].node_to_vertex = i;
+		tree->nodes[i].value = ct_region_get_value(mesh, ct_region_get_vertex(region, i), axis);
+	}
+
+	qsort(tree->nodes, tree->num_nodes, sizeof(tree->nodes[0]), ct_tree_nodes_qsort_compare);
+
+	// Create 2-way mapping between vertices and nodes:
+	for (uint32_t i = 0; i < tree->num_nodes; i++)
+	{
+		tree->nodes[tree->nodes[i].node_to_vertex].vertex_to_node = i;
+	}
+
+	return 0;
+}
+
+
+/**********
+ * Checks *
+ **********/
+
+int ct_region_check_simply_connected(ct_region_t *region, ct_mesh_t *mesh, ct_tree_t *join_tree,
+							char error[NM_MAX_ERROR_LENGTH])
+{
+	/* A region cut from a surface can have holes, and then its level sets can split and join
+	 * up again, which a contour tree cannot show. Loops are counted from the Euler
+	 * characteristic of the vertices, edges and faces inside the region: each component adds
+	 * one, and one more if it is a closed surface (no face around it cut off by the mask or
+	 * missing from the mesh), and what the characteristic falls short of that is the number
+	 * of loops. Components come from the region's join tree, where parents are lower nodes.
+	 * Grids are not checked, as boxes and spheres of voxels have no holes, and neither are
+	 * bands, whose pseudo-nodes fill in what is outside the range: */
+	if ((!mesh->edges && mesh->volume.scalars) || region->num_pseudo_nodes) { return 0; }
+	if (!mesh->edges || !mesh->is_manifold)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Mesh \"%s\" needs manifold edges to check a region for loops.", mesh->name);
+		return -1;
+	}
+
+	uint32_t num_nodes = join_tree->num_nodes;
+	uint32_t *root = malloc(num_nodes * sizeof(uint32_t));
+	uint8_t *open = malloc(num_nodes * sizeof(uint8_t));
+	if (!root || !open)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for region check.");
+		free(root);
+		free(open);
+		return -1;
+	}
+	memset(open, 0, num_nodes * sizeof(uint8_t));
+
+	for (uint32_t i = 0; i < num_nodes; i++)
+	{
+		ct_tree_node_t *node = &(join_tree->nodes[i]);
+		root[i] = node->degree[1] ? root[join_tree->arcs[node->first_arc[1]]] : i;
+	}
+
+	// Each edge and face is counted at its lowest region vertex, from the faces around each:
+	int64_t characteristic = 0;
+	#pragma omp parallel for reduction(+: characteristic) \
+		if (region->num_vertices > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < region->num_vertices; i++)
+	{
+		uint32_t vertex = region->vertices[i];
+		uint32_t component = root[join_tree->nodes[i].vertex_to_node];
+		uint8_t cut = 0;
+		characteristic++;
+
+		uint32_t edge = mesh->first_edge[vertex];
+		while (1)
+		{
+			if (mesh->edges[edge].from == vertex)
+			{
+				// The face from this edge, and its edges out of and back into the vertex:
+				uint32_t next = mesh->edges[edge].next;
+				uint32_t back = mesh->edges[next].next;
+				uint32_t a = ct_region_find(region, mesh->edges[edge].to, i);
+				uint32_t b = ct_region_find(region, mesh->edges[next].to, i);
+				characteristic -= ((a != CT_TREE_NO_NODE) && (a > i));
+				if ((b != CT_TREE_NO_NODE) && (b > i) &&
+					(mesh->edges[back].other_half == UINT32_MAX))
+				{
+					characteristic--; // A mesh boundary edge, with no half out of here.
+				}
+				if ((a == CT_TREE_NO_NODE) || (b == CT_TREE_NO_NODE)) { cut = 1; }
+				else if ((a > i) && (b > i)) { characteristic++; }
+			}
+
+			edge = ct_mesh_get_next_vertex_edge(mesh, vertex, edge);
+			if (edge == UINT32_MAX)
+			{
+				cut = 1;
+				break;
+			}
+			if (mesh->edges[edge].other_half == mesh->first_edge[vertex]) { break; }
+		}
+
+		if (cut)
+		{
+			#pragma omp atomic write
+			open[component] = 1;
+		}
+	}
+
+	int64_t expected = join_tree->num_roots;
+	for (uint32_t i = 0; i < join_tree->num_roots; i++)
+	{
+		expected += !open[join_tree->roots[i]];
+	}
+	free(root);
+	free(open);
+
+	if (characteristic < expected)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Region of mesh \"%s\" is not simply connected, "
+			"so it has no contour tree. Loops: %u.", mesh->name,
+			(uint32_t)(expected - characteristic));
+		return -1;
+	}
+
+	return 0;
+}
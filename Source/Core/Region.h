@@ -0,0 +1,86 @@
+#ifndef CT_REGION_H
+#define CT_REGION_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <omp.h>
+
+#include <NM-Config/Config.h>
+
+#include "Concurrent-Set.h"
+#include "Contour-Tree.h"
+#include "Mesh.h"
+#include "Mesh-Loader.h"
+#include "Parallel.h"
+
+// A vertex mask, kept as the vertices (or voxels) inside it so that it costs its own size:
+typedef struct
+{
+	uint32_t num_vertices;
+	uint32_t *vertices;	// Ascending. Trees on the region use indices into this as vertices.
+
+	// Bands only. Each piece of the mesh outside the range is one node, after the vertices:
+	uint32_t num_pseudo_nodes;
+	uint32_t *pseudo_vertices;	// Per pseudo-node, its vertex furthest from the band.
+	uint32_t *pseudo_offsets;	// Into pseudo_neighbours, num_pseudo_nodes + 1 of them.
+	uint32_t *pseudo_neighbours;	// Pseudo-nodes joined by an edge straight across the band.
+	uint32_t *vertex_to_node;	// Per mesh vertex, its index in the region or its pseudo-node.
+} ct_region_t;
+
+// Regions:
+int ct_region_from_box(ct_region_t *region, ct_mesh_t *mesh, float low[3], float high[3],
+						char error[NM_MAX_ERROR_LENGTH]);
+int ct_region_from_sphere(ct_region_t *region, ct_mesh_t *mesh, float centre[3], float radius,
+						char error[NM_MAX_ERROR_LENGTH]);
+int ct_region_from_vertices(ct_region_t *region, ct_mesh_t *mesh, uint32_t *vertices,
+			uint32_t num_vertices, char error[NM_MAX_ERROR_LENGTH]);
+int ct_region_from_range(ct_region_t *region, ct_mesh_t *mesh, float low[3], float high[3],
+		float *centre, float radius, char error[NM_MAX_ERROR_LENGTH]);
+int ct_region_from_band(ct_region_t *region, ct_mesh_t *mesh, uint8_t axis, float low, float high,
+							char error[NM_MAX_ERROR_LENGTH]);
+void ct_region_free(ct_region_t *region);
+int ct_region_vertex_qsort_compare(const void *a, const void *b);
+
+// Bands:
+uint8_t ct_region_get_band_side(float value, float low, float high);
+uint32_t ct_region_get_num_chunks(uint32_t num_elements);
+uint32_t ct_region_get_chunk_start(uint32_t num_elements, uint32_t num_chunks, uint32_t chunk);
+void ct_region_join_outside(ct_mesh_t *mesh, ct_concurrent_set_t *set, uint8_t axis, float low,
+										float high);
+int ct_region_number_pseudo_nodes(ct_region_t *region, ct_mesh_t *mesh, ct_concurrent_set_t *set,
+			uint8_t axis, float low, float high, char error[NM_MAX_ERROR_LENGTH]);
+void ct_region_update_extreme(ct_mesh_t *mesh, uint32_t *extreme, uint32_t vertex, uint8_t axis,
+										float low);
+int ct_region_connect_pseudo_nodes(ct_region_t *region, ct_mesh_t *mesh, uint8_t axis,
+				float low, float high, char error[NM_MAX_ERROR_LENGTH]);
+uint32_t ct_region_get_crossings(ct_region_t *region, ct_mesh_t *mesh, uint32_t source,
+	uint8_t axis, float low, float high, uint64_t crossings[CT_GRID_MAX_NEIGHBOURS]);
+
+// Vertices:
+void ct_region_get_position(ct_mesh_t *mesh, uint32_t vertex, float position[3]);
+float ct_region_get_value(ct_mesh_t *mesh, uint32_t vertex, uint8_t axis);
+uint32_t ct_region_get_vertex(ct_region_t *region, uint32_t node);
+uint32_t ct_region_get_mesh_edges(ct_mesh_t *mesh, uint32_t source, uint32_t *vertex,
+					uint32_t neighbours[CT_GRID_MAX_NEIGHBOURS]);
+uint32_t ct_region_get_candidate(ct_mesh_t *mesh, uint32_t begin[3], uint32_t end[3],
+							uint64_t candidate);
+int ct_region_is_inside(ct_mesh_t *mesh, uint32_t vertex, float low[3], float high[3],
+							float *centre, float radius);
+uint32_t ct_region_find(ct_region_t *region, uint32_t vertex, uint32_t hint);
+uint32_t ct_region_get_neighbours(ct_region_t *region, ct_mesh_t *mesh, uint32_t vertex,
+		uint32_t *neighbours, uint32_t max_neighbours, uint8_t higher_only);
+uint32_t ct_region_get_max_neighbours(ct_region_t *region, ct_mesh_t *mesh);
+
+// Scalar functions:
+int ct_region_scalar_function(ct_tree_t *tree, ct_mesh_t *mesh, ct_region_t *region,
+					uint8_t axis, char error[NM_MAX_ERROR_LENGTH]);
+
+// Checks:
+int ct_region_check_simply_connected(ct_region_t *region, ct_mesh_t *mesh, ct_tree_t *join_tree,
+							char error[NM_MAX_ERROR_LENGTH]);
+
+#endif
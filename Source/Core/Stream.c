@@ -0,0 +1,320 @@
+#include "Stream.h"
+
+int ct_stream_open(ct_stream_t *stream, char *path, char error[NM_MAX_ERROR_LENGTH])
+{
+	memset(stream, 0, sizeof(*stream));
+	strncpy(stream->path, path, NM_MAX_PATH_LENGTH - 1);
+
+	stream->file = fopen(path, "rb");
+	if (!stream->file)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not open file \"%s\".", path);
+		return -1;
+	}
+
+	for (int i = 0; i < CT_STREAM_NUM_BLOCKS; i++)
+	{
+		stream->blocks[i] = malloc(CT_STREAM_BLOCK_SIZE);
+		if (!stream->blocks[i])
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH,
+				"Could not allocate decompression memory for \"%s\".", path);
+			ct_stream_close(stream);
+			return -1;
+		}
+	}
+
+	stream->mutex = SDL_CreateMutex();
+	stream->condition = SDL_CreateCondition();
+	if (!stream->mutex || !stream->condition)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Could not create decompression synchronisation for \"%s\".", path);
+		ct_stream_close(stream);
+		return -1;
+	}
+
+	stream->thread = SDL_CreateThread(ct_stream_thread, "CT decompression", stream);
+	if (!stream->thread)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Could not create decompression thread for \"%s\".", path);
+		ct_stream_close(stream);
+		return -1;
+	}
+
+	return 0;
+}
+
+void ct_stream_close(ct_stream_t *stream)
+{
+	if (stream->thread)
+	{
+		SDL_LockMutex(stream->mutex);
+		stream->stop = 1;
+		SDL_BroadcastCondition(stream->condition);
+		SDL_UnlockMutex(stream->mutex);
+		SDL_WaitThread(stream->thread, NULL);
+	}
+
+	if (stream->condition) { SDL_DestroyCondition(stream->condition); }
+	if (stream->mutex) { SDL_DestroyMutex(stream->mutex); }
+	for (int i = 0; i < CT_STREAM_NUM_BLOCKS; i++)
+	{
+		if (stream->blocks[i]) { free(stream->blocks[i]); }
+	}
+	if (stream->file) { fclose(stream->file); }
+
+	memset(stream, 0, sizeof(*stream));
+}
+
+int ct_stream_next_block(ct_stream_t *stream, uint8_t **data, size_t *size,
+					char error[NM_MAX_ERROR_LENGTH])
+{
+	// Hands over the rest of the current block, or the next one. A size of 0 means the end.
+	*data = NULL;
+	*size = 0;
+
+	SDL_LockMutex(stream->mutex);
+	if (stream->holding && (stream->offset == stream->block_sizes[stream->first_filled]))
+	{
+		// Release the finished block to the decompression thread:
+		stream->holding = 0;
+		stream->offset = 0;
+		stream->first_filled = (stream->first_filled + 1) % CT_STREAM_NUM_BLOCKS;
+		stream->num_filled--;
+		SDL_BroadcastCondition(stream->condition);
+	}
+	while (!stream->holding && !stream->num_filled && !stream->finished && !stream->failed)
+	{
+		SDL_WaitCondition(stream->condition, stream->mutex);
+	}
+	if (stream->failed)
+	{
+		strcpy(error, stream->error);
+		SDL_UnlockMutex(stream->mutex);
+		return -1;
+	}
+	if (stream->num_filled) { stream->holding = 1; }
+	SDL_UnlockMutex(stream->mutex);
+
+	if (stream->holding)
+	{
+		*data = &(stream->blocks[stream->first_filled][stream->offset]);
+		*size = stream->block_sizes[stream->first_filled] - stream->offset;
+		stream->offset = stream->block_sizes[stream->first_filled];
+	}
+
+	return 0;
+}
+
+int ct_stream_read(ct_stream_t *stream, void *destination, size_t size, size_t *size_read,
+					char error[NM_MAX_ERROR_LENGTH])
+{
+	// Copies the next size bytes (or skips them if destination is NULL):
+	*size_read = 0;
+	while (size)
+	{
+		if (!stream->holding || (stream->offset ==
+			stream->block_sizes[stream->first_filled]))
+		{
+			uint8_t *data;
+			size_t available;
+			if (ct_stream_next_block(stream, &data, &available, error)) { return -1; }
+			if (!available) { break; }
+			stream->offset -= available;
+		}
+
+		size_t available = stream->block_sizes[stream->first_filled] - stream->offset;
+		if (available > size) { available = size; }
+		if (destination)
+		{
+			memcpy((uint8_t *)destination + *size_read,
+				&(stream->blocks[stream->first_filled][stream->offset]), available);
+		}
+		stream->offset += available;
+		*size_read += available;
+		size -= available;
+	}
+
+	return 0;
+}
+
+int ct_stream_read_all(char *path, char **data, size_t *size, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* For consumers that need the whole file in one buffer. Allocated with SDL_malloc,
+	 * to match SDL_LoadFile. */
+	*data = NULL;
+	*size = 0;
+
+	ct_stream_t stream;
+	if (ct_stream_open(&stream, path, error)) { return -1; }
+
+	size_t capacity = 0;
+	uint8_t *block;
+	size_t block_size;
+	while (1)
+	{
+		if (ct_stream_next_block(&stream, &block, &block_size, error))
+		{
+			if (*data) { SDL_free(*data); }
+			*data = NULL;
+			ct_stream_close(&stream);
+			return -1;
+		}
+		if (!block_size) { break; }
+
+		if ((*size + block_size + 1) > capacity)
+		{
+			if (!capacity) { capacity = CT_STREAM_BLOCK_SIZE; }
+			while ((*size + block_size + 1) > capacity) { capacity *= 2; }
+			char *new_data = SDL_realloc(*data, capacity);
+			if (!new_data)
+			{
+				snprintf(error, NM_MAX_ERROR_LENGTH,
+					"Could not allocate memory for decompressed \"%s\".", path);
+				if (*data) { SDL_free(*data); }
+				*data = NULL;
+				ct_stream_close(&stream);
+				return -1;
+			}
+			*data = new_data;
+		}
+		memcpy(&((*data)[*size]), block, block_size);
+		*size += block_size;
+	}
+
+	ct_stream_close(&stream);
+	if (!*data)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "File \"%s\" is empty.", path);
+		return -1;
+	}
+	(*data)[*size] = '\0';
+	return 0;
+}
+
+int ct_stream_thread(void *data)
+{
+	ct_stream_t *stream = data;
+	char error[NM_MAX_ERROR_LENGTH] = "";
+
+	z_stream inflater;
+	memset(&inflater, 0, sizeof(inflater));
+	uint8_t *input = malloc(CT_STREAM_INPUT_SIZE);
+	if (!input)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Could not allocate input memory for \"%s\".", stream->path);
+	}
+	else if (inflateInit2(&inflater, 15 + 32) != Z_OK) // Detect gzip or zlib headers.
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Could not start decompression for \"%s\".", stream->path);
+		free(input);
+		input = NULL;
+	}
+
+	uint8_t input_finished = 0;
+	uint8_t done = (input == NULL);
+	while (!done)
+	{
+		// Wait for a free block:
+		SDL_LockMutex(stream->mutex);
+		while ((stream->num_filled == CT_STREAM_NUM_BLOCKS) && !stream->stop)
+		{
+			SDL_WaitCondition(stream->condition, stream->mutex);
+		}
+		uint8_t stop = stream->stop;
+		uint32_t index = (stream->first_filled + stream->num_filled) % CT_STREAM_NUM_BLOCKS;
+		SDL_UnlockMutex(stream->mutex);
+		if (stop) { break; }
+
+		inflater.next_out = stream->blocks[index];
+		inflater.avail_out = CT_STREAM_BLOCK_SIZE;
+		while (inflater.avail_out)
+		{
+			if (!inflater.avail_in && !input_finished)
+			{
+				inflater.avail_in = fread(input, 1, CT_STREAM_INPUT_SIZE, stream->file);
+				inflater.next_in = input;
+				if (inflater.avail_in < CT_STREAM_INPUT_SIZE)
+				{
+					if (ferror(stream->file))
+					{
+						snprintf(error, NM_MAX_ERROR_LENGTH,
+							"Could not read \"%s\".", stream->path);
+						done = 1;
+						break;
+					}
+					input_finished = 1;
+				}
+			}
+
+			int result = inflate(&inflater, Z_NO_FLUSH);
+			if (result == Z_STREAM_END)
+			{
+				// Concatenated gzip members carry on:
+				if (!inflater.avail_in && input_finished)
+				{
+					done = 1;
+					break;
+				}
+				inflateReset(&inflater);
+			}
+			else if ((result == Z_BUF_ERROR) && !inflater.avail_in && input_finished)
+			{
+				// Input ran out. Fine between members, truncated inside one:
+				if (inflater.total_in)
+				{
+					snprintf(error, NM_MAX_ERROR_LENGTH,
+						"Compressed file \"%s\" is truncated.", stream->path);
+				}
+				done = 1;
+				break;
+			}
+			else if (result != Z_OK)
+			{
+				snprintf(error, NM_MAX_ERROR_LENGTH,
+					"Compressed file \"%s\" is corrupt.", stream->path);
+				done = 1;
+				break;
+			}
+		}
+
+		SDL_LockMutex(stream->mutex);
+		if (!strcmp(error, "") && (inflater.avail_out < CT_STREAM_BLOCK_SIZE))
+		{
+			stream->block_sizes[index] = CT_STREAM_BLOCK_SIZE - inflater.avail_out;
+			stream->num_filled++;
+		}
+		SDL_BroadcastCondition(stream->condition);
+		SDL_UnlockMutex(stream->mutex);
+	}
+
+	if (input)
+	{
+		inflateEnd(&inflater);
+		free(input);
+	}
+
+	SDL_LockMutex(stream->mutex);
+	if (strcmp(error, ""))
+	{
+		strcpy(stream->error, error);
+		stream->failed = 1;
+	}
+	stream->finished = 1;
+	SDL_BroadcastCondition(stream->condition);
+	SDL_UnlockMutex(stream->mutex);
+
+	return 0;
+}
+
+int ct_path_is_compressed(const char *path)
+{
+	size_t length = strlen(path);
+	if (length < 3) { return 0; }
+	return ((path[length - 3] == '.') && (tolower(path[length - 2]) == 'g') &&
+					(tolower(path[length - 1]) == 'z'));
+}
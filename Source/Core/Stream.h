@@ -0,0 +1,58 @@
+#ifndef CT_STREAM_H
+#define CT_STREAM_H
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include <NM-Config/Config.h>
+#include <SDL3/SDL_mutex.h>
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_thread.h>
+
+#define CT_STREAM_BLOCK_SIZE	(4 * 1024 * 1024)
+#define CT_STREAM_NUM_BLOCKS	4
+#define CT_STREAM_INPUT_SIZE	(256 * 1024)
+
+/* Decompresses a gzip (or zlib) file on a background thread into a small ring of blocks,
+ * so reading, decompression and whatever consumes the blocks all overlap. Only
+ * CT_STREAM_NUM_BLOCKS blocks of decompressed data exist at any time. */
+typedef struct
+{
+	char path[NM_MAX_PATH_LENGTH];
+	FILE *file;
+
+	SDL_Thread *thread;
+	SDL_Mutex *mutex;
+	SDL_Condition *condition;
+
+	uint8_t *blocks[CT_STREAM_NUM_BLOCKS];
+	size_t block_sizes[CT_STREAM_NUM_BLOCKS];
+	uint32_t num_filled;
+	uint32_t first_filled;
+	uint8_t finished;
+	uint8_t failed;
+	uint8_t stop;
+
+	// Block currently held by the consumer:
+	uint8_t holding;
+	size_t offset;
+
+	char error[NM_MAX_ERROR_LENGTH];
+} ct_stream_t;
+
+int ct_stream_open(ct_stream_t *stream, char *path, char error[NM_MAX_ERROR_LENGTH]);
+void ct_stream_close(ct_stream_t *stream);
+int ct_stream_next_block(ct_stream_t *stream, uint8_t **data, size_t *size,
+					char error[NM_MAX_ERROR_LENGTH]);
+int ct_stream_read(ct_stream_t *stream, void *destination, size_t size, size_t *size_read,
+					char error[NM_MAX_ERROR_LENGTH]);
+int ct_stream_read_all(char *path, char **data, size_t *size, char error[NM_MAX_ERROR_LENGTH]);
+int ct_stream_thread(void *data);
+int ct_path_is_compressed(const char *path);
+
+#endif
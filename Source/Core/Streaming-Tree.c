@@ -0,0 +1,949 @@
+#include "Streaming-Tree.h"
+
+/*************
+ * Streaming *
+ *************/
+
+/* Join and split trees of a vertex-finalised streaming mesh, built without ever holding the
+ * whole mesh. Each tree is kept as "down" pointers from a node to the next node towards the
+ * root, and each edge merges the down paths of its two vertices like a zipper. Once a
+ * vertex is finalised (no more faces will use it), it is taken out of the tree as soon as
+ * that can't change the result: leaves are emitted with their arc, and regular nodes are
+ * spliced out. Memory is therefore bounded by the unfinalised vertices and the nodes that
+ * still connect them, not by the size of the mesh.
+ *
+ * Emitted arcs form each tree with regular nodes removed where possible. A regular node is
+ * only kept if one of its neighbours was emitted before it could be spliced. */
+
+int ct_streaming_tree_begin(ct_streaming_tree_t *streaming, uint8_t axis,
+	ct_streaming_arc_callback_t callback, void *user_data, char error[NM_MAX_ERROR_LENGTH])
+{
+	memset(streaming, 0, sizeof(*streaming));
+	if (axis > 2)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Invalid streaming tree axis %u.", axis);
+		return -1;
+	}
+	streaming->axis = axis;
+	streaming->callback = callback;
+	streaming->user_data = user_data;
+	streaming->first_free = CT_STREAMING_NONE;
+
+	streaming->node_capacity = 1024;
+	streaming->map_capacity = 2048;
+	streaming->pending_capacity = 64;
+	streaming->nodes = malloc(streaming->node_capacity * sizeof(ct_streaming_node_t));
+	streaming->map_keys = malloc(streaming->map_capacity * sizeof(uint64_t));
+	streaming->map_values = malloc(streaming->map_capacity * sizeof(uint32_t));
+	streaming->pending = malloc(streaming->pending_capacity * sizeof(uint64_t));
+	if (!streaming->nodes || !streaming->map_keys || !streaming->map_values ||
+		!streaming->pending)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for streaming tree.");
+		ct_streaming_tree_free(streaming);
+		return -1;
+	}
+	memset(streaming->map_keys, 0xFF, streaming->map_capacity * sizeof(uint64_t));
+
+	return 0;
+}
+
+int ct_streaming_tree_end(ct_streaming_tree_t *streaming, char error[NM_MAX_ERROR_LENGTH])
+{
+	// Anything not finalised yet is finalised now, which empties both trees:
+	for (uint32_t i = 0; i < streaming->num_nodes; i++)
+	{
+		ct_streaming_node_t *node = &(streaming->nodes[i]);
+		if ((node->alive[0] || node->alive[1]) && !node->finalised)
+		{
+			if (ct_streaming_tree_finalise_vertex(streaming, node->vertex, error))
+			{
+				return -1;
+			}
+		}
+	}
+
+	if (streaming->num_active)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Streaming tree still has %u nodes after the end of the stream.",
+			streaming->num_active);
+		return -1;
+	}
+
+	return 0;
+}
+
+void ct_streaming_tree_free(ct_streaming_tree_t *streaming)
+{
+	if (streaming->nodes) { free(streaming->nodes); }
+	if (streaming->map_keys) { free(streaming->map_keys); }
+	if (streaming->map_values) { free(streaming->map_values); }
+	if (streaming->pending) { free(streaming->pending); }
+	memset(streaming, 0, sizeof(*streaming));
+}
+
+int ct_streaming_tree_read(ct_streaming_tree_t *streaming, char *path,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Streaming mesh format (.sma, optionally gzip compressed as .sma.gz):
+	 * v x y z		Vertex, numbered from 1 in the order they appear.
+	 * f i j k ...		Face. An index written negative is the last use of that vertex.
+	 * x i			Finalises vertex i explicitly (e.g. if it has no faces).
+	 *
+	 * Anything else is ignored. Lines are processed as they are read, and vertices still
+	 * open at the end are finalised by ct_streaming_tree_end. */
+
+	uint8_t compressed = ct_path_is_compressed(path);
+	ct_stream_t stream;
+	FILE *file = NULL;
+	if (compressed)
+	{
+		if (ct_stream_open(&stream, path, error)) { return -1; }
+	}
+	else
+	{
+		file = fopen(path, "rb");
+		if (!file)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "Could not open file \"%s\".", path);
+			return -1;
+		}
+	}
+
+	char *text = malloc(CT_STREAM_BLOCK_SIZE + CT_STREAMING_MAX_LINE_LENGTH);
+	if (!text)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Could not allocate text memory for \"%s\".", path);
+		goto error;
+	}
+
+	size_t carry_size = 0;
+	size_t block_size;
+	do
+	{
+		if (compressed)
+		{
+			uint8_t *block;
+			if (ct_stream_next_block(&stream, &block, &block_size, error)) { goto error; }
+			if (block_size) { memcpy(&(text[carry_size]), block, block_size); }
+		}
+		else
+		{
+			block_size = fread(&(text[carry_size]), 1, CT_STREAM_BLOCK_SIZE, file);
+			if (ferror(file))
+			{
+				snprintf(error, NM_MAX_ERROR_LENGTH, "Could not read \"%s\".", path);
+				goto error;
+			}
+		}
+
+		char *line = text;
+		char *end = &(text[carry_size + block_size]);
+		char *line_end;
+		while (1)
+		{
+			line_end = memchr(line, '\n', end - line);
+			if (!line_end)
+			{
+				// At the end of the file the last line needs no newline:
+				if (block_size || (line == end)) { break; }
+				line_end = end;
+			}
+			if (ct_streaming_tree_parse_line(streaming, line, line_end, error))
+			{
+				goto error;
+			}
+			if (line_end == end)
+			{
+				line = end;
+				break;
+			}
+			line = line_end + 1;
+		}
+
+		carry_size = end - line;
+		if (carry_size >= CT_STREAMING_MAX_LINE_LENGTH)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "Line too long in \"%s\".", path);
+			goto error;
+		}
+		memmove(text, line, carry_size);
+	} while (block_size);
+
+	free(text);
+	if (compressed) { ct_stream_close(&stream); }
+	else { fclose(file); }
+	return 0;
+
+	error:
+	if (text) { free(text); }
+	if (compressed) { ct_stream_close(&stream); }
+	else { fclose(file); }
+	return -1;
+}
+
+int ct_streaming_tree_parse_line(ct_streaming_tree_t *streaming, char *line, char *end,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	while ((line < end) && isspace(*line)) { line++; }
+	if ((end - line) < 2) { return 0; }
+	if (!isspace(line[1])) { return 0; } // "vn", "vt", comments etc.
+
+	char type = line[0];
+	line++;
+	if (type == 'v')
+	{
+		float position[3];
+		for (int i = 0; i < 3; i++)
+		{
+			while ((line < end) && isspace(*line)) { line++; }
+			line = ct_parse_float(line, end, &(position[i]));
+			if (!line)
+			{
+				snprintf(error, NM_MAX_ERROR_LENGTH,
+					"Invalid position for vertex %llu in streaming mesh.",
+					(unsigned long long)streaming->num_vertices + 1);
+				return -1;
+			}
+		}
+		ct_vertex_t vertex = { position[0], position[1], position[2] };
+		return ct_streaming_tree_add_vertex(streaming, &vertex, error);
+	}
+	if ((type != 'f') && (type != 'x')) { return 0; }
+
+	// Indices, with any "/vt/vn" parts skipped:
+	uint64_t vertices[CT_STREAMING_MAX_FACE_SIZE];
+	uint8_t finalise[CT_STREAMING_MAX_FACE_SIZE];
+	uint32_t num_indices = 0;
+	while (1)
+	{
+		while ((line < end) && isspace(*line)) { line++; }
+		if (line >= end) { break; }
+
+		uint8_t negative = (*line == '-');
+		if (negative) { line++; }
+		uint64_t index = 0;
+		int num_digits = 0;
+		while ((line < end) && (*line >= '0') && (*line <= '9') && (num_digits < 19))
+		{
+			index = (index * 10) + (*line - '0');
+			num_digits++;
+			line++;
+		}
+		while ((line < end) && !isspace(*line)) { line++; }
+
+		if (!index || (index > streaming->num_vertices) ||
+			(num_indices == CT_STREAMING_MAX_FACE_SIZE))
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH,
+				"Invalid index in streaming mesh after vertex %llu.",
+				(unsigned long long)streaming->num_vertices);
+			return -1;
+		}
+		vertices[num_indices] = index - 1;
+		finalise[num_indices] = negative || (type == 'x');
+		num_indices++;
+	}
+
+	if ((type == 'f') && (num_indices >= 3))
+	{
+		if (ct_streaming_tree_add_face(streaming, vertices, num_indices, error))
+		{
+			return -1;
+		}
+	}
+	for (uint32_t i = 0; i < num_indices; i++)
+	{
+		if (!finalise[i]) { continue; }
+		if (ct_streaming_tree_finalise_vertex(streaming, vertices[i], error)) { return -1; }
+	}
+
+	return 0;
+}
+
+int ct_streaming_tree_add_vertex(ct_streaming_tree_t *streaming, ct_vertex_t *position,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	// Mesh vertices are numbered in stream order:
+	float value;
+	if (streaming->axis == 0) { value = position->x; }
+	else if (streaming->axis == 1) { value = position->y; }
+	else { value = position->z; }
+	return ct_streaming_tree_add_node(streaming, streaming->num_vertices, value, error);
+}
+
+int ct_streaming_tree_add_node(ct_streaming_tree_t *streaming, uint64_t vertex, float value,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	if (streaming->num_active == (CT_STREAMING_NONE - 1))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Streaming tree frontier is too large.");
+		return -1;
+	}
+
+	// Reuse a node if one is free:
+	uint32_t node = streaming->first_free;
+	if (node != CT_STREAMING_NONE)
+	{
+		streaming->first_free = streaming->nodes[node].next_sibling[0];
+	}
+	else
+	{
+		if (streaming->num_nodes == streaming->node_capacity)
+		{
+			ct_streaming_node_t *nodes = realloc(streaming->nodes,
+				(size_t)streaming->node_capacity * 2 * sizeof(ct_streaming_node_t));
+			if (!nodes)
+			{
+				snprintf(error, NM_MAX_ERROR_LENGTH,
+					"Could not allocate memory for streaming tree nodes.");
+				return -1;
+			}
+			streaming->nodes = nodes;
+			streaming->node_capacity *= 2;
+		}
+		node = streaming->num_nodes;
+		streaming->num_nodes++;
+	}
+
+	ct_streaming_node_t *new_node = &(streaming->nodes[node]);
+	memset(new_node, 0, sizeof(*new_node));
+	new_node->vertex = vertex;
+	new_node->value = value;
+	for (int i = 0; i < 2; i++)
+	{
+		new_node->alive[i] = 1;
+		new_node->down[i] = CT_STREAMING_NONE;
+		new_node->first_child[i] = CT_STREAMING_NONE;
+		new_node->next_sibling[i] = CT_STREAMING_NONE;
+		new_node->previous_sibling[i] = CT_STREAMING_NONE;
+	}
+
+	if (ct_streaming_map_insert(streaming, vertex, node, error))
+	{
+		new_node->alive[0] = new_node->alive[1] = 0;
+		new_node->next_sibling[0] = streaming->first_free;
+		streaming->first_free = node;
+		return -1;
+	}
+
+	streaming->num_vertices++;
+	streaming->num_active++;
+	if (streaming->num_active > streaming->max_active)
+	{
+		streaming->max_active = streaming->num_active;
+	}
+
+	return 0;
+}
+
+int ct_streaming_tree_add_face(ct_streaming_tree_t *streaming, uint64_t *vertices,
+				uint32_t num_vertices, char error[NM_MAX_ERROR_LENGTH])
+{
+	// Polygons are taken as fans, so every edge of the triangulation is added:
+	uint32_t nodes[CT_STREAMING_MAX_FACE_SIZE];
+	for (uint32_t i = 0; i < num_vertices; i++)
+	{
+		nodes[i] = ct_streaming_map_find(streaming, vertices[i]);
+		if ((nodes[i] == CT_STREAMING_NONE) || streaming->nodes[nodes[i]].finalised)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "Face uses vertex %llu after it was "
+				"finalised.", (unsigned long long)vertices[i] + 1);
+			return -1;
+		}
+	}
+
+	for (uint8_t tree = 0; tree < 2; tree++)
+	{
+		for (uint32_t i = 1; i < num_vertices; i++)
+		{
+			if (ct_streaming_tree_add_edge(streaming, tree, nodes[i - 1], nodes[i], error))
+			{
+				return -1;
+			}
+			if ((i > 1) && ct_streaming_tree_add_edge(streaming, tree, nodes[0], nodes[i],
+										error))
+			{
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+int ct_streaming_tree_finalise_vertex(ct_streaming_tree_t *streaming, uint64_t vertex,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	uint32_t node = ct_streaming_map_find(streaming, vertex);
+	if (node == CT_STREAMING_NONE) { return 0; } // Already finalised and gone.
+
+	streaming->nodes[node].finalised = 1;
+	ct_streaming_tree_prune(streaming, CT_STREAMING_JOIN, node);
+	ct_streaming_tree_prune(streaming, CT_STREAMING_SPLIT, node);
+	return 0;
+}
+
+void ct_streaming_tree_print_arc(void *user_data, uint8_t tree, uint64_t from,
+					float from_value, uint64_t to, float to_value)
+{
+	// Arc callback writing "join|split from to" (1-based vertices, "root" for roots):
+	FILE *file = user_data;
+	if (to == CT_STREAMING_NO_VERTEX)
+	{
+		fprintf(file, "%s %llu root\n", tree ? "split" : "join",
+					(unsigned long long)from + 1);
+	}
+	else
+	{
+		fprintf(file, "%s %llu %llu\n", tree ? "split" : "join",
+			(unsigned long long)from + 1, (unsigned long long)to + 1);
+	}
+}
+
+/**************
+ * Heightmaps *
+ **************/
+
+int ct_heightmap_open_volume(ct_heightmap_t *heightmap, char *path,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	// A binary volume (see ct_mesh_load_volume) with a Z dimension of 1:
+	memset(heightmap, 0, sizeof(*heightmap));
+	size_t data_size;
+	uint8_t *data = ct_file_map(path, &data_size, 0, error);
+	if (!data) { return -1; }
+
+	uint8_t big_endian;
+	uint32_t data_offset;
+	ct_volume_t *volume = &(heightmap->volume);
+	if (ct_volume_parse_header(data, data_size, volume, &big_endian, &data_offset, path,
+									error))
+	{
+		ct_file_unmap(data, data_size);
+		return -1;
+	}
+	volume->mapping = data;
+	volume->mapping_size = data_size;
+	volume->scalars = &(data[data_offset]);
+	heightmap->swap = (big_endian != ct_host_is_big_endian());
+
+	if (volume->dimensions[2] != 1)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Volume \"%s\" has a Z dimension of %u, not a heightmap.", path,
+			volume->dimensions[2]);
+		ct_heightmap_close(heightmap);
+		return -1;
+	}
+
+	return ct_heightmap_check(heightmap, path, data_offset, error);
+}
+
+int ct_heightmap_open_raw(ct_heightmap_t *heightmap, char *path, uint32_t width,
+		uint32_t height, uint8_t scalar_type, uint8_t big_endian,
+		char error[NM_MAX_ERROR_LENGTH])
+{
+	// Headerless row-major samples, as exported by most terrain tools:
+	memset(heightmap, 0, sizeof(*heightmap));
+	if ((scalar_type > CT_VOLUME_TYPE_FLOAT64) || !ct_volume_get_scalar_size(scalar_type))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Unknown scalar type %u for heightmap \"%s\".", scalar_type, path);
+		return -1;
+	}
+
+	size_t data_size;
+	uint8_t *data = ct_file_map(path, &data_size, 0, error);
+	if (!data) { return -1; }
+
+	ct_volume_t *volume = &(heightmap->volume);
+	volume->dimensions[0] = width;
+	volume->dimensions[1] = height;
+	volume->dimensions[2] = 1;
+	volume->spacing[0] = volume->spacing[1] = volume->spacing[2] = 1.f;
+	volume->scalar_type = scalar_type;
+	volume->mapping = data;
+	volume->mapping_size = data_size;
+	volume->scalars = data;
+	heightmap->swap = (big_endian != ct_host_is_big_endian());
+
+	return ct_heightmap_check(heightmap, path, 0, error);
+}
+
+int ct_heightmap_check(ct_heightmap_t *heightmap, char *path, uint64_t data_offset,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	ct_volume_t *volume = &(heightmap->volume);
+	uint8_t scalar_size = ct_volume_get_scalar_size(volume->scalar_type);
+	if (scalar_size == 1) { heightmap->swap = 0; }
+
+	if ((volume->dimensions[0] < 2) || (volume->dimensions[1] < 2))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Heightmap \"%s\" must be at least 2x2 samples.", path);
+		ct_heightmap_close(heightmap);
+		return -1;
+	}
+	if (volume->mapping_size < (data_offset + (ct_volume_get_num_voxels(volume) *
+								scalar_size)))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Heightmap \"%s\" has fewer than %ux%u samples.", path,
+			volume->dimensions[0], volume->dimensions[1]);
+		ct_heightmap_close(heightmap);
+		return -1;
+	}
+
+	return 0;
+}
+
+void ct_heightmap_close(ct_heightmap_t *heightmap)
+{
+	ct_volume_free(&(heightmap->volume));
+	heightmap->swap = 0;
+}
+
+float ct_heightmap_get_value(ct_heightmap_t *heightmap, uint64_t index)
+{
+	if (!heightmap->swap) { return ct_volume_get_value(&(heightmap->volume), index); }
+
+	// Swapped into a single-value volume, as the mapping is read-only:
+	uint8_t scalar_size = ct_volume_get_scalar_size(heightmap->volume.scalar_type);
+	uint8_t *bytes = &(((uint8_t *)heightmap->volume.scalars)[index * scalar_size]);
+	uint64_t value = 0;
+	uint8_t *swapped = (uint8_t *)&value;
+	for (uint8_t i = 0; i < scalar_size; i++) { swapped[i] = bytes[scalar_size - i - 1]; }
+
+	ct_volume_t single = heightmap->volume;
+	single.scalars = &value;
+	return ct_volume_get_value(&single, 0);
+}
+
+int ct_streaming_tree_read_heightmap(ct_streaming_tree_t *streaming,
+	ct_heightmap_t *heightmap, uint32_t tile_size, char error[NM_MAX_ERROR_LENGTH])
+{
+	/* The grid is triangulated implicitly: each cell (x, y) is split along the diagonal from
+	 * (x, y) to (x + 1, y + 1), and vertex y * width + x has the height as its value. Cells
+	 * are visited tile by tile, and row by row within a tile, so the file is read one tile
+	 * at a time. Each vertex is added at the first of its cells in that order and finalised
+	 * at the last, and components that cross tile boundaries are merged by the streaming
+	 * tree itself. The frontier is therefore about one row of tiles, whatever the height.
+	 * Mapped pages that have been read are clean, so the kernel can drop them as needed. */
+
+	if (!tile_size) { tile_size = CT_HEIGHTMAP_TILE_SIZE; }
+	uint32_t width = heightmap->volume.dimensions[0];
+	uint32_t height = heightmap->volume.dimensions[1];
+	uint32_t cells[2] = { width - 1, height - 1 };
+	uint32_t num_tiles[2];
+	for (int i = 0; i < 2; i++)
+	{
+		num_tiles[i] = (cells[i] / tile_size) + ((cells[i] % tile_size) != 0);
+	}
+
+	float *values = malloc((size_t)(tile_size + 1) * (tile_size + 1) * sizeof(float));
+	if (!values)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for heightmap tiles.");
+		return -1;
+	}
+
+	for (uint32_t tile_y = 0; tile_y < num_tiles[1]; tile_y++)
+	{
+		for (uint32_t tile_x = 0; tile_x < num_tiles[0]; tile_x++)
+		{
+			// Cells [x0, x1) x [y0, y1), so vertices up to x1 and y1:
+			uint32_t x0 = tile_x * tile_size;
+			uint32_t y0 = tile_y * tile_size;
+			uint32_t x1 = ((cells[0] - x0) > tile_size) ? x0 + tile_size : cells[0];
+			uint32_t y1 = ((cells[1] - y0) > tile_size) ? y0 + tile_size : cells[1];
+			uint32_t tile_width = x1 - x0 + 1;
+			uint32_t tile_height = y1 - y0 + 1;
+
+			#pragma omp parallel for if ((tile_width * tile_height) > CT_PARALLEL_THRESHOLD)
+			for (uint32_t j = 0; j < tile_height; j++)
+			{
+				uint64_t row = ((uint64_t)(y0 + j) * width) + x0;
+				for (uint32_t i = 0; i < tile_width; i++)
+				{
+					values[(j * tile_width) + i] =
+						ct_heightmap_get_value(heightmap, row + i);
+				}
+			}
+
+			for (uint32_t y = y0; y < y1; y++)
+			{
+				for (uint32_t x = x0; x < x1; x++)
+				{
+					if (ct_heightmap_add_cell(streaming, width, height, tile_size,
+						x, y, &(values[((y - y0) * tile_width) + x - x0]),
+						tile_width, error))
+					{
+						free(values);
+						return -1;
+					}
+				}
+			}
+		}
+	}
+
+	free(values);
+	return 0;
+}
+
+int ct_heightmap_add_cell(ct_streaming_tree_t *streaming, uint32_t width, uint32_t height,
+		uint32_t tile_size, uint32_t x, uint32_t y, float *values, uint32_t stride,
+		char error[NM_MAX_ERROR_LENGTH])
+{
+	// Corners a = (x, y), b = (x + 1, y), c = (x, y + 1), d = (x + 1, y + 1):
+	uint64_t corners[4];
+	uint64_t first[4];
+	uint64_t last[4];
+	uint64_t order = ct_heightmap_cell_order(width - 1, tile_size, x, y);
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		uint32_t corner_x = x + (i & 1);
+		uint32_t corner_y = y + (i >> 1);
+		corners[i] = ((uint64_t)corner_y * width) + corner_x;
+		ct_heightmap_vertex_cells(width, height, tile_size, corner_x, corner_y,
+							&(first[i]), &(last[i]));
+		if ((first[i] == order) && ct_streaming_tree_add_node(streaming, corners[i],
+				values[((i >> 1) * stride) + (i & 1)], error))
+		{
+			return -1;
+		}
+	}
+
+	/* Each cell adds its top, left and diagonal edges, so edges shared with the next cells
+	 * are added once. Only the last column and row add their right and bottom edges. */
+	uint64_t edges[5][2] = {
+		{ corners[0], corners[1] },
+		{ corners[0], corners[2] },
+		{ corners[0], corners[3] },
+		{ corners[1], corners[3] },
+		{ corners[2], corners[3] }
+	};
+	for (uint8_t i = 0; i < 5; i++)
+	{
+		if ((i == 3) && (x != (width - 2))) { continue; }
+		if ((i == 4) && (y != (height - 2))) { continue; }
+		if (ct_streaming_tree_add_face(streaming, edges[i], 2, error)) { return -1; }
+	}
+
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		if ((last[i] == order) &&
+			ct_streaming_tree_finalise_vertex(streaming, corners[i], error))
+		{
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void ct_heightmap_vertex_cells(uint32_t width, uint32_t height, uint32_t tile_size,
+			uint32_t x, uint32_t y, uint64_t *first, uint64_t *last)
+{
+	// First and last cell using a vertex, in the order cells are visited:
+	*first = UINT64_MAX;
+	*last = 0;
+	for (uint32_t cell_y = (y ? y - 1 : 0); (cell_y <= y) && (cell_y < (height - 1)); cell_y++)
+	{
+		for (uint32_t cell_x = (x ? x - 1 : 0); (cell_x <= x) && (cell_x < (width - 1));
+										cell_x++)
+		{
+			uint64_t order = ct_heightmap_cell_order(width - 1, tile_size, cell_x, cell_y);
+			if (order < *first) { *first = order; }
+			if (order > *last) { *last = order; }
+		}
+	}
+}
+
+uint64_t ct_heightmap_cell_order(uint32_t cells_x, uint32_t tile_size, uint32_t x, uint32_t y)
+{
+	uint64_t tiles_x = (cells_x / tile_size) + ((cells_x % tile_size) != 0);
+	uint64_t tile = (((uint64_t)(y / tile_size)) * tiles_x) + (x / tile_size);
+	return (tile * tile_size * tile_size) + ((uint64_t)(y % tile_size) * tile_size)
+								+ (x % tile_size);
+}
+
+/**************************
+ * Merge tree maintenance *
+ **************************/
+
+int ct_streaming_tree_add_edge(ct_streaming_tree_t *streaming, uint8_t tree, uint32_t a,
+					uint32_t b, char error[NM_MAX_ERROR_LENGTH])
+{
+	// Zipper merge of the down paths from a and b, always stepping down the higher one:
+	if (a == b) { return 0; }
+	uint32_t upper = a;
+	uint32_t lower = b;
+	if (ct_streaming_tree_is_below(streaming, tree, upper, lower))
+	{
+		upper = b;
+		lower = a;
+	}
+
+	streaming->num_pending = 0;
+	uint32_t down;
+	while (1)
+	{
+		down = streaming->nodes[upper].down[tree];
+		if (down == lower) { break; }
+		if ((down == CT_STREAMING_NONE) ||
+			ct_streaming_tree_is_below(streaming, tree, down, lower))
+		{
+			// Lower fits between upper and down:
+			if (down != CT_STREAMING_NONE)
+			{
+				if (streaming->num_pending == streaming->pending_capacity)
+				{
+					uint64_t *pending = realloc(streaming->pending,
+						streaming->pending_capacity * 2 * sizeof(uint64_t));
+					if (!pending)
+					{
+						snprintf(error, NM_MAX_ERROR_LENGTH, "Could not "
+							"allocate memory for streaming tree merge.");
+						return -1;
+					}
+					streaming->pending = pending;
+					streaming->pending_capacity *= 2;
+				}
+				streaming->pending[streaming->num_pending] =
+							streaming->nodes[down].vertex;
+				streaming->num_pending++;
+			}
+
+			ct_streaming_tree_set_down(streaming, tree, upper, lower);
+			if (down == CT_STREAMING_NONE) { break; }
+			upper = lower;
+			lower = down;
+		}
+		else { upper = down; }
+	}
+
+	// Finalised nodes that lost a child may now be leaves or regular:
+	for (uint32_t i = 0; i < streaming->num_pending; i++)
+	{
+		uint32_t node = ct_streaming_map_find(streaming, streaming->pending[i]);
+		if (node != CT_STREAMING_NONE) { ct_streaming_tree_prune(streaming, tree, node); }
+	}
+
+	return 0;
+}
+
+void ct_streaming_tree_prune(ct_streaming_tree_t *streaming, uint8_t tree, uint32_t node)
+{
+	while (node != CT_STREAMING_NONE)
+	{
+		ct_streaming_node_t *current = &(streaming->nodes[node]);
+		if (!current->finalised || !current->alive[tree]) { return; }
+
+		uint32_t down = current->down[tree];
+		if (!current->num_children[tree])
+		{
+			// Leaf, so its arc is final:
+			if (streaming->callback)
+			{
+				if (down == CT_STREAMING_NONE)
+				{
+					streaming->callback(streaming->user_data, tree, current->vertex,
+						current->value, CT_STREAMING_NO_VERTEX, current->value);
+				}
+				else
+				{
+					streaming->callback(streaming->user_data, tree, current->vertex,
+						current->value, streaming->nodes[down].vertex,
+						streaming->nodes[down].value);
+				}
+			}
+
+			if (down == CT_STREAMING_NONE) { streaming->num_roots[tree]++; }
+			else
+			{
+				streaming->num_arcs[tree]++;
+				ct_streaming_tree_unlink(streaming, tree, node);
+				streaming->nodes[down].emitted_child[tree] = 1;
+			}
+			ct_streaming_tree_kill(streaming, tree, node);
+			node = down;
+		}
+		else if ((current->num_children[tree] == 1) && (down != CT_STREAMING_NONE) &&
+								!current->emitted_child[tree])
+		{
+			// Regular, so splice it out:
+			uint32_t child = current->first_child[tree];
+			ct_streaming_tree_unlink(streaming, tree, node);
+			ct_streaming_tree_set_down(streaming, tree, child, down);
+			ct_streaming_tree_kill(streaming, tree, node);
+			return;
+		}
+		else { return; }
+	}
+}
+
+void ct_streaming_tree_set_down(ct_streaming_tree_t *streaming, uint8_t tree, uint32_t node,
+								uint32_t down)
+{
+	ct_streaming_tree_unlink(streaming, tree, node);
+
+	ct_streaming_node_t *current = &(streaming->nodes[node]);
+	ct_streaming_node_t *parent = &(streaming->nodes[down]);
+	current->down[tree] = down;
+	current->previous_sibling[tree] = CT_STREAMING_NONE;
+	current->next_sibling[tree] = parent->first_child[tree];
+	if (parent->first_child[tree] != CT_STREAMING_NONE)
+	{
+		streaming->nodes[parent->first_child[tree]].previous_sibling[tree] = node;
+	}
+	parent->first_child[tree] = node;
+	parent->num_children[tree]++;
+}
+
+void ct_streaming_tree_unlink(ct_streaming_tree_t *streaming, uint8_t tree, uint32_t node)
+{
+	// Detach node from its down node's children:
+	ct_streaming_node_t *current = &(streaming->nodes[node]);
+	if (current->down[tree] == CT_STREAMING_NONE) { return; }
+
+	ct_streaming_node_t *parent = &(streaming->nodes[current->down[tree]]);
+	if (current->previous_sibling[tree] != CT_STREAMING_NONE)
+	{
+		streaming->nodes[current->previous_sibling[tree]].next_sibling[tree] =
+							current->next_sibling[tree];
+	}
+	else { parent->first_child[tree] = current->next_sibling[tree]; }
+	if (current->next_sibling[tree] != CT_STREAMING_NONE)
+	{
+		streaming->nodes[current->next_sibling[tree]].previous_sibling[tree] =
+							current->previous_sibling[tree];
+	}
+	parent->num_children[tree]--;
+
+	current->down[tree] = CT_STREAMING_NONE;
+	current->next_sibling[tree] = CT_STREAMING_NONE;
+	current->previous_sibling[tree] = CT_STREAMING_NONE;
+}
+
+void ct_streaming_tree_kill(ct_streaming_tree_t *streaming, uint8_t tree, uint32_t node)
+{
+	// Removes node from one tree, and frees it once it has left both:
+	ct_streaming_node_t *current = &(streaming->nodes[node]);
+	current->alive[tree] = 0;
+	if (current->alive[!tree]) { return; }
+
+	ct_streaming_map_remove(streaming, current->vertex);
+	current->next_sibling[0] = streaming->first_free;
+	streaming->first_free = node;
+	streaming->num_active--;
+}
+
+int ct_streaming_tree_is_below(ct_streaming_tree_t *streaming, uint8_t tree, uint32_t a,
+								uint32_t b)
+{
+	// Nearer the root. Ties are broken by stream order, as by vertex index in ct_tree_t:
+	ct_streaming_node_t *left = &(streaming->nodes[a]);
+	ct_streaming_node_t *right = &(streaming->nodes[b]);
+	int lower;
+	if (left->value != right->value) { lower = (left->value < right->value); }
+	else { lower = (left->vertex < right->vertex); }
+	return (tree == CT_STREAMING_JOIN) ? lower : !lower;
+}
+
+/**************
+ * Vertex map *
+ **************/
+
+uint32_t ct_streaming_map_find(ct_streaming_tree_t *streaming, uint64_t vertex)
+{
+	uint32_t mask = streaming->map_capacity - 1;
+	uint32_t slot = ct_streaming_map_hash(vertex, streaming->map_capacity);
+	while (streaming->map_keys[slot] != CT_STREAMING_NO_VERTEX)
+	{
+		if (streaming->map_keys[slot] == vertex) { return streaming->map_values[slot]; }
+		slot = (slot + 1) & mask;
+	}
+	return CT_STREAMING_NONE;
+}
+
+int ct_streaming_map_insert(ct_streaming_tree_t *streaming, uint64_t vertex, uint32_t node,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	if (((streaming->map_size + 1) * 2) > streaming->map_capacity)
+	{
+		// Grow, keeping the load at most one half:
+		uint32_t old_capacity = streaming->map_capacity;
+		uint64_t *old_keys = streaming->map_keys;
+		uint32_t *old_values = streaming->map_values;
+		uint64_t *keys = malloc((size_t)old_capacity * 2 * sizeof(uint64_t));
+		uint32_t *values = malloc((size_t)old_capacity * 2 * sizeof(uint32_t));
+		if (!keys || !values)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH,
+				"Could not allocate memory for streaming vertex map.");
+			if (keys) { free(keys); }
+			if (values) { free(values); }
+			return -1;
+		}
+		memset(keys, 0xFF, (size_t)old_capacity * 2 * sizeof(uint64_t));
+
+		streaming->map_capacity = old_capacity * 2;
+		streaming->map_keys = keys;
+		streaming->map_values = values;
+		streaming->map_size = 0;
+		for (uint32_t i = 0; i < old_capacity; i++)
+		{
+			if (old_keys[i] == CT_STREAMING_NO_VERTEX) { continue; }
+			ct_streaming_map_insert(streaming, old_keys[i], old_values[i], error);
+		}
+		free(old_keys);
+		free(old_values);
+	}
+
+	uint32_t mask = streaming->map_capacity - 1;
+	uint32_t slot = ct_streaming_map_hash(vertex, streaming->map_capacity);
+	while (streaming->map_keys[slot] != CT_STREAMING_NO_VERTEX) { slot = (slot + 1) & mask; }
+	streaming->map_keys[slot] = vertex;
+	streaming->map_values[slot] = node;
+	streaming->map_size++;
+	return 0;
+}
+
+void ct_streaming_map_remove(ct_streaming_tree_t *streaming, uint64_t vertex)
+{
+	uint32_t mask = streaming->map_capacity - 1;
+	uint32_t slot = ct_streaming_map_hash(vertex, streaming->map_capacity);
+	while (streaming->map_keys[slot] != vertex)
+	{
+		if (streaming->map_keys[slot] == CT_STREAMING_NO_VERTEX) { return; }
+		slot = (slot + 1) & mask;
+	}
+
+	// Shift later entries back, so lookups never need tombstones:
+	uint32_t next = slot;
+	while (1)
+	{
+		next = (next + 1) & mask;
+		if (streaming->map_keys[next] == CT_STREAMING_NO_VERTEX) { break; }
+		uint32_t home = ct_streaming_map_hash(streaming->map_keys[next],
+							streaming->map_capacity);
+		if (((next - home) & mask) >= ((next - slot) & mask))
+		{
+			streaming->map_keys[slot] = streaming->map_keys[next];
+			streaming->map_values[slot] = streaming->map_values[next];
+			slot = next;
+		}
+	}
+	streaming->map_keys[slot] = CT_STREAMING_NO_VERTEX;
+	streaming->map_size--;
+}
+
+uint32_t ct_streaming_map_hash(uint64_t vertex, uint32_t capacity)
+{
+	return ((vertex * 0x9E3779B97F4A7C15ull) >> 32) & (capacity - 1);
+}
@@ -0,0 +1,139 @@
+#ifndef CT_STREAMING_TREE_H
+#define CT_STREAMING_TREE_H
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <NM-Config/Config.h>
+
+#include "Mesh.h"
+#include "Mesh-Loader.h"
+#include "Parallel.h"
+#include "Stream.h"
+
+#define CT_STREAMING_JOIN		0
+#define CT_STREAMING_SPLIT		1
+#define CT_STREAMING_NONE		UINT32_MAX	// No node.
+#define CT_STREAMING_NO_VERTEX		UINT64_MAX
+#define CT_STREAMING_MAX_LINE_LENGTH	4096
+#define CT_STREAMING_MAX_FACE_SIZE	64
+#define CT_HEIGHTMAP_TILE_SIZE		1024	// Cells per tile side by default.
+
+/* Called for each arc as soon as it is final. In the join tree arcs go from a node to the
+ * next node below it, in the split tree to the next node above. The root of each
+ * component is reported with to = CT_STREAMING_NO_VERTEX. Vertex ids are 64-bit, so
+ * inputs may have more than UINT32_MAX vertices. */
+typedef void (*ct_streaming_arc_callback_t)(void *user_data, uint8_t tree, uint64_t from,
+					float from_value, uint64_t to, float to_value);
+
+typedef struct
+{
+	uint64_t vertex;
+	float value;
+	uint8_t finalised;
+	uint8_t alive[2];		// Still in the join[0] / split[1] tree.
+	uint8_t emitted_child[2];	// Has emitted children, so must be emitted itself.
+	uint32_t down[2];		// Towards the root. Lower in join, higher in split.
+	uint32_t num_children[2];
+	uint32_t first_child[2];
+	uint32_t next_sibling[2];	// Also links the free list.
+	uint32_t previous_sibling[2];
+} ct_streaming_node_t;
+
+typedef struct
+{
+	uint8_t axis;			// Scalar function: 0 = x, 1 = y, 2 = z.
+	ct_streaming_arc_callback_t callback;
+	void *user_data;
+
+	uint64_t num_vertices;		// Seen so far.
+	uint64_t num_arcs[2];		// Emitted so far, roots not included.
+	uint64_t num_roots[2];
+
+	// Only vertices in the active frontier (or holding it together) have nodes:
+	uint32_t num_nodes;
+	uint32_t node_capacity;
+	uint32_t first_free;
+	uint32_t num_active;
+	uint32_t max_active;
+	ct_streaming_node_t *nodes;
+
+	// Vertex to node, open addressing:
+	uint32_t map_size;
+	uint32_t map_capacity;
+	uint64_t *map_keys;
+	uint32_t *map_values;
+
+	// Nodes that lost a child while merging, checked once the edge is done:
+	uint32_t num_pending;
+	uint32_t pending_capacity;
+	uint64_t *pending;		// Vertices, as nodes may be freed meanwhile.
+} ct_streaming_tree_t;
+
+typedef struct
+{
+	ct_volume_t volume;	// Z dimension is 1. Scalars always point into the file mapping.
+	uint8_t swap;		// Samples are stored in the other byte order.
+} ct_heightmap_t;
+
+// Streaming:
+int ct_streaming_tree_begin(ct_streaming_tree_t *streaming, uint8_t axis,
+	ct_streaming_arc_callback_t callback, void *user_data, char error[NM_MAX_ERROR_LENGTH]);
+int ct_streaming_tree_end(ct_streaming_tree_t *streaming, char error[NM_MAX_ERROR_LENGTH]);
+void ct_streaming_tree_free(ct_streaming_tree_t *streaming);
+int ct_streaming_tree_read(ct_streaming_tree_t *streaming, char *path,
+						char error[NM_MAX_ERROR_LENGTH]);
+int ct_streaming_tree_parse_line(ct_streaming_tree_t *streaming, char *line, char *end,
+						char error[NM_MAX_ERROR_LENGTH]);
+int ct_streaming_tree_add_vertex(ct_streaming_tree_t *streaming, ct_vertex_t *position,
+						char error[NM_MAX_ERROR_LENGTH]);
+int ct_streaming_tree_add_node(ct_streaming_tree_t *streaming, uint64_t vertex, float value,
+						char error[NM_MAX_ERROR_LENGTH]);
+int ct_streaming_tree_add_face(ct_streaming_tree_t *streaming, uint64_t *vertices,
+				uint32_t num_vertices, char error[NM_MAX_ERROR_LENGTH]);
+int ct_streaming_tree_finalise_vertex(ct_streaming_tree_t *streaming, uint64_t vertex,
+						char error[NM_MAX_ERROR_LENGTH]);
+void ct_streaming_tree_print_arc(void *user_data, uint8_t tree, uint64_t from,
+					float from_value, uint64_t to, float to_value);
+
+// Heightmaps:
+int ct_heightmap_open_volume(ct_heightmap_t *heightmap, char *path,
+						char error[NM_MAX_ERROR_LENGTH]);
+int ct_heightmap_open_raw(ct_heightmap_t *heightmap, char *path, uint32_t width,
+		uint32_t height, uint8_t scalar_type, uint8_t big_endian,
+		char error[NM_MAX_ERROR_LENGTH]);
+int ct_heightmap_check(ct_heightmap_t *heightmap, char *path, uint64_t data_offset,
+						char error[NM_MAX_ERROR_LENGTH]);
+void ct_heightmap_close(ct_heightmap_t *heightmap);
+float ct_heightmap_get_value(ct_heightmap_t *heightmap, uint64_t index);
+int ct_streaming_tree_read_heightmap(ct_streaming_tree_t *streaming,
+	ct_heightmap_t *heightmap, uint32_t tile_size, char error[NM_MAX_ERROR_LENGTH]);
+int ct_heightmap_add_cell(ct_streaming_tree_t *streaming, uint32_t width, uint32_t height,
+		uint32_t tile_size, uint32_t x, uint32_t y, float *values, uint32_t stride,
+		char error[NM_MAX_ERROR_LENGTH]);
+void ct_heightmap_vertex_cells(uint32_t width, uint32_t height, uint32_t tile_size,
+			uint32_t x, uint32_t y, uint64_t *first, uint64_t *last);
+uint64_t ct_heightmap_cell_order(uint32_t cells_x, uint32_t tile_size, uint32_t x, uint32_t y);
+
+// Merge tree maintenance:
+int ct_streaming_tree_add_edge(ct_streaming_tree_t *streaming, uint8_t tree, uint32_t a,
+					uint32_t b, char error[NM_MAX_ERROR_LENGTH]);
+void ct_streaming_tree_prune(ct_streaming_tree_t *streaming, uint8_t tree, uint32_t node);
+void ct_streaming_tree_set_down(ct_streaming_tree_t *streaming, uint8_t tree, uint32_t node,
+								uint32_t down);
+void ct_streaming_tree_unlink(ct_streaming_tree_t *streaming, uint8_t tree, uint32_t node);
+void ct_streaming_tree_kill(ct_streaming_tree_t *streaming, uint8_t tree, uint32_t node);
+int ct_streaming_tree_is_below(ct_streaming_tree_t *streaming, uint8_t tree, uint32_t a,
+								uint32_t b);
+
+// Vertex map:
+uint32_t ct_streaming_map_find(ct_streaming_tree_t *streaming, uint64_t vertex);
+int ct_streaming_map_insert(ct_streaming_tree_t *streaming, uint64_t vertex, uint32_t node,
+						char error[NM_MAX_ERROR_LENGTH]);
+void ct_streaming_map_remove(ct_streaming_tree_t *streaming, uint64_t vertex);
+uint32_t ct_streaming_map_hash(uint64_t vertex, uint32_t capacity);
+
+#endif
@@ -0,0 +1,201 @@
+#include "Task-Graph.h"
+
+/***************
+ * Task graphs *
+ ***************/
+
+/* A small dependency-driven scheduler. Tasks are added in an order where every dependency comes
+ * first, so the graph can never have a cycle. When the graph runs, each task is an OpenMP task,
+ * and a task that finishes launches every task that was only waiting on it, so independent
+ * stages overlap on the thread pool. Each task has its own error buffer, and a failure stops
+ * any further tasks from starting. */
+
+int ct_task_graph_add(ct_task_graph_t *graph, char *name,
+	int (*function)(void *data, char error[NM_MAX_ERROR_LENGTH]), void *data,
+	uint32_t num_dependencies, uint32_t *dependencies, char error[NM_MAX_ERROR_LENGTH])
+{
+	if (graph->num_tasks >= CT_TASK_GRAPH_MAX_TASKS)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Task graph is full.");
+		return -1;
+	}
+	if (num_dependencies > CT_TASK_MAX_DEPENDENCIES)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Task \"%s\" has too many dependencies.", name);
+		return -1;
+	}
+	for (uint32_t i = 0; i < num_dependencies; i++)
+	{
+		if (dependencies[i] >= graph->num_tasks)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH,
+				"Task \"%s\" depends on a task that was not added before it.", name);
+			return -1;
+		}
+	}
+
+	ct_task_t *task = &(graph->tasks[graph->num_tasks]);
+	memset(task, 0, sizeof(*task));
+	snprintf(task->name, NM_MAX_NAME_LENGTH, "%s", name);
+	task->function = function;
+	task->data = data;
+	task->num_dependencies = num_dependencies;
+	if (num_dependencies)
+	{
+		memcpy(task->dependencies, dependencies, num_dependencies * sizeof(uint32_t));
+	}
+	graph->num_tasks++;
+
+	return 0;
+}
+
+int ct_task_graph_run(ct_task_graph_t *graph, char error[NM_MAX_ERROR_LENGTH])
+{
+	for (uint32_t i = 0; i < graph->num_tasks; i++)
+	{
+		ct_task_t *task = &(graph->tasks[i]);
+		task->num_waiting = task->num_dependencies;
+		task->status = 0;
+		task->finished = 0;
+		task->start = task->end = task->path = 0.0;
+		task->path_previous = CT_TASK_NONE;
+		strcpy(task->error, "");
+	}
+	graph->failed = 0;
+
+	// Nesting is allowed while the graph runs, so parallel loops inside a task get threads:
+	int max_active_levels = omp_get_max_active_levels();
+	omp_set_max_active_levels(2);
+	int num_threads = graph->num_threads ? (int)graph->num_threads : omp_get_max_threads();
+
+	graph->start = omp_get_wtime();
+	#pragma omp parallel num_threads(num_threads)
+	#pragma omp single
+	{
+		for (uint32_t i = 0; i < graph->num_tasks; i++)
+		{
+			if (!graph->tasks[i].num_dependencies)
+			{
+				#pragma omp task firstprivate(i)
+				ct_task_graph_run_task(graph, i);
+			}
+		}
+	}
+	graph->time = omp_get_wtime() - graph->start;
+	omp_set_max_active_levels(max_active_levels);
+
+	for (uint32_t i = 0; i < graph->num_tasks; i++)
+	{
+		if (graph->tasks[i].status)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "%s", graph->tasks[i].error);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void ct_task_graph_run_task(ct_task_graph_t *graph, uint32_t task)
+{
+	// Runs one task, then launches each task that was only waiting on this one:
+	ct_task_t *current = &(graph->tasks[task]);
+	uint8_t failed;
+	#pragma omp atomic read
+	failed = graph->failed;
+	if (failed) { return; }
+
+	current->start = omp_get_wtime() - graph->start;
+	current->status = current->function(current->data, current->error);
+	current->end = omp_get_wtime() - graph->start;
+	if (current->status)
+	{
+		#pragma omp atomic write
+		graph->failed = 1;
+		return;
+	}
+	current->finished = 1;
+
+	for (uint32_t i = task + 1; i < graph->num_tasks; i++)
+	{
+		for (uint32_t j = 0; j < graph->tasks[i].num_dependencies; j++)
+		{
+			if (graph->tasks[i].dependencies[j] != task) { continue; }
+
+			uint32_t num_waiting;
+			#pragma omp atomic capture
+			num_waiting = --(graph->tasks[i].num_waiting);
+			if (!num_waiting)
+			{
+				#pragma omp task firstprivate(i)
+				ct_task_graph_run_task(graph, i);
+			}
+		}
+	}
+}
+
+uint32_t ct_task_graph_get_critical_path(ct_task_graph_t *graph)
+{
+	/* Longest chain of task durations through the dependencies, which bounds the run time
+	 * however many threads there are. Returns the last task on the chain (follow
+	 * path_previous back from it), or CT_TASK_NONE if nothing finished. */
+	uint32_t last = CT_TASK_NONE;
+	for (uint32_t i = 0; i < graph->num_tasks; i++)
+	{
+		ct_task_t *task = &(graph->tasks[i]);
+		task->path = 0.0;
+		task->path_previous = CT_TASK_NONE;
+		if (!task->finished) { continue; }
+
+		for (uint32_t j = 0; j < task->num_dependencies; j++)
+		{
+			uint32_t dependency = task->dependencies[j];
+			if ((task->path_previous == CT_TASK_NONE) ||
+				(graph->tasks[dependency].path > task->path))
+			{
+				task->path = graph->tasks[dependency].path;
+				task->path_previous = dependency;
+			}
+		}
+		task->path += task->end - task->start;
+
+		if ((last == CT_TASK_NONE) || (task->path > graph->tasks[last].path)) { last = i; }
+	}
+
+	return last;
+}
+
+void ct_task_graph_print(FILE *file, ct_task_graph_t *graph)
+{
+	for (uint32_t i = 0; i < graph->num_tasks; i++)
+	{
+		ct_task_t *task = &(graph->tasks[i]);
+		// Padded with tabs to line up with the other timings:
+		int column = fprintf(file, "Time taken (%s):", task->name);
+		for (; column < 48; column = ((column / 8) + 1) * 8) { fprintf(file, "\t"); }
+		if (task->finished)
+		{
+			fprintf(file, "%f seconds, from %f\n", task->end - task->start, task->start);
+		}
+		else if (task->status) { fprintf(file, "failed\n"); }
+		else { fprintf(file, "not run\n"); }
+	}
+
+	uint32_t last = ct_task_graph_get_critical_path(graph);
+	if (last == CT_TASK_NONE) { return; }
+
+	uint32_t num_path = 0;
+	uint32_t path[CT_TASK_GRAPH_MAX_TASKS];
+	for (uint32_t i = last; i != CT_TASK_NONE; i = graph->tasks[i].path_previous)
+	{
+		path[num_path] = i;
+		num_path++;
+	}
+
+	fprintf(file, "Critical path %f of %f seconds:", graph->tasks[last].path, graph->time);
+	for (uint32_t i = num_path; i > 0; i--)
+	{
+		fprintf(file, "%s %s", (i == num_path) ? "" : " ->", graph->tasks[path[i - 1]].name);
+	}
+	fprintf(file, "\n");
+}
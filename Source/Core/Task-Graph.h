@@ -0,0 +1,55 @@
+#ifndef CT_TASK_GRAPH_H
+#define CT_TASK_GRAPH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <omp.h>
+
+#include <NM-Config/Config.h>
+
+#define CT_TASK_GRAPH_MAX_TASKS		32
+#define CT_TASK_MAX_DEPENDENCIES	8
+#define CT_TASK_NONE			UINT32_MAX
+
+typedef struct
+{
+	char name[NM_MAX_NAME_LENGTH];
+	int (*function)(void *data, char error[NM_MAX_ERROR_LENGTH]);
+	void *data;
+
+	uint32_t num_dependencies;
+	uint32_t dependencies[CT_TASK_MAX_DEPENDENCIES]; // Indices of earlier tasks.
+	uint32_t num_waiting;	// Dependencies not yet finished, while running.
+
+	int status;		// -1 if the task failed.
+	uint8_t finished;	// Set once the task has run successfully.
+	double start;		// Seconds since the start of the run.
+	double end;
+	double path;		// Longest chain of durations ending with this task.
+	uint32_t path_previous;	// Dependency on that chain, or CT_TASK_NONE.
+	char error[NM_MAX_ERROR_LENGTH];
+} ct_task_t;
+
+typedef struct
+{
+	uint32_t num_tasks;
+	ct_task_t tasks[CT_TASK_GRAPH_MAX_TASKS];
+	uint32_t num_threads;	// 0 to use omp_get_max_threads.
+	uint8_t failed;
+	double start;
+	double time;		// Wall time of the last run.
+} ct_task_graph_t;
+
+// Task graphs:
+int ct_task_graph_add(ct_task_graph_t *graph, char *name,
+	int (*function)(void *data, char error[NM_MAX_ERROR_LENGTH]), void *data,
+	uint32_t num_dependencies, uint32_t *dependencies, char error[NM_MAX_ERROR_LENGTH]);
+int ct_task_graph_run(ct_task_graph_t *graph, char error[NM_MAX_ERROR_LENGTH]);
+void ct_task_graph_run_task(ct_task_graph_t *graph, uint32_t task);
+uint32_t ct_task_graph_get_critical_path(ct_task_graph_t *graph);
+void ct_task_graph_print(FILE *file, ct_task_graph_t *graph);
+
+#endif
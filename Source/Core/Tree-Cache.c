@@ -0,0 +1,295 @@
+#include "Tree-Cache.h"
+
+/*********
+ * Cache *
+ *********/
+
+/* Computed trees keyed by the mesh and scalar function they came from. Each entry holds the
+ * reduced join and split trees, the contour tree, and the scalar value of every vertex (so
+ * nothing needs sorting on a hit). Recently used entries are kept in memory, and if a
+ * directory is given every entry is also written there as tree files (see ct_tree_write)
+ * plus a .vol of the values, which are mapped back in on a later hit. */
+
+int ct_tree_cache_init(ct_tree_cache_t *cache, char *directory, uint32_t num_entries,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	memset(cache, 0, sizeof(*cache));
+	if (directory)
+	{
+		// Room is left for the longest file name, so no two entries can share a path:
+		if ((strlen(directory) + CT_TREE_CACHE_NAME_LENGTH) >= NM_MAX_PATH_LENGTH)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "Tree cache directory path is too long.");
+			return -1;
+		}
+		strcpy(cache->directory, directory);
+	}
+
+	cache->num_entries = num_entries ? num_entries : CT_TREE_CACHE_ENTRIES;
+	cache->entries = malloc(cache->num_entries * sizeof(ct_tree_cache_entry_t));
+	if (!cache->entries)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for tree cache.");
+		return -1;
+	}
+	memset(cache->entries, 0, cache->num_entries * sizeof(ct_tree_cache_entry_t));
+
+	return 0;
+}
+
+void ct_tree_cache_free(ct_tree_cache_t *cache)
+{
+	if (cache->entries)
+	{
+		for (uint32_t i = 0; i < cache->num_entries; i++)
+		{
+			ct_tree_cache_entry_free(&(cache->entries[i]));
+		}
+		free(cache->entries);
+	}
+	memset(cache, 0, sizeof(*cache));
+}
+
+uint64_t ct_tree_cache_get_key(ct_mesh_t *mesh, char *function_name)
+{
+	// Everything the trees depend on. Each hash seeds the next, so order matters:
+	uint64_t key = ct_parallel_hash(function_name, strlen(function_name), 0);
+	key = ct_parallel_hash(mesh->vertices, (size_t)mesh->num_vertices * sizeof(ct_vertex_t),
+									key);
+	key = ct_parallel_hash(mesh->faces, (size_t)mesh->num_faces * sizeof(ct_face_t), key);
+	if (mesh->volume.scalars)
+	{
+		// The same bytes are a different field in another shape, type or neighbourhood:
+		uint32_t layout[5] = { mesh->volume.dimensions[0], mesh->volume.dimensions[1],
+			mesh->volume.dimensions[2], mesh->volume.scalar_type,
+			mesh->volume.connectivity };
+		key = ct_parallel_hash(layout, sizeof(layout), key);
+		key = ct_parallel_hash(mesh->volume.scalars, ct_volume_get_num_voxels(&(mesh->volume))
+			* ct_volume_get_scalar_size(mesh->volume.scalar_type), key);
+	}
+	return key;
+}
+
+int ct_tree_cache_find(ct_tree_cache_t *cache, uint64_t key, uint32_t num_vertices,
+	float *values, ct_tree_t *join_tree, ct_tree_t *split_tree, ct_tree_t *contour_tree,
+	char error[NM_MAX_ERROR_LENGTH])
+{
+	// Returns 1 and copies out the trees and values on a hit, 0 on a miss, -1 on error:
+	ct_tree_cache_entry_t *entry = NULL;
+	for (uint32_t i = 0; i < cache->num_entries; i++)
+	{
+		if (cache->entries[i].last_used && (cache->entries[i].key == key) &&
+			(cache->entries[i].values.dimensions[0] == num_vertices))
+		{
+			entry = &(cache->entries[i]);
+			break;
+		}
+	}
+
+	if (!entry && strcmp(cache->directory, ""))
+	{
+		ct_tree_cache_entry_t loaded;
+		if (ct_tree_cache_read_entry(cache, key, num_vertices, &loaded))
+		{
+			entry = ct_tree_cache_get_free_entry(cache);
+			*entry = loaded;
+		}
+	}
+
+	if (!entry)
+	{
+		cache->num_misses++;
+		return 0;
+	}
+
+	cache->clock++;
+	entry->last_used = cache->clock;
+	memcpy(values, entry->values.scalars, (size_t)num_vertices * sizeof(float));
+	if (ct_tree_copy(&(entry->join_tree), join_tree, error)) { return -1; }
+	if (ct_tree_copy(&(entry->split_tree), split_tree, error)) { return -1; }
+	if (ct_tree_copy(&(entry->contour_tree), contour_tree, error)) { return -1; }
+
+	cache->num_hits++;
+	return 1;
+}
+
+int ct_tree_cache_insert(ct_tree_cache_t *cache, uint64_t key, uint32_t num_vertices,
+	float *values, ct_tree_t *join_tree, ct_tree_t *split_tree, ct_tree_t *contour_tree,
+	char error[NM_MAX_ERROR_LENGTH])
+{
+	// Copies are stored, so the caller keeps its own trees and values:
+	ct_tree_cache_entry_t *entry = NULL;
+	for (uint32_t i = 0; i < cache->num_entries; i++)
+	{
+		if (cache->entries[i].last_used && (cache->entries[i].key == key))
+		{
+			entry = &(cache->entries[i]);
+			ct_tree_cache_entry_free(entry);
+			break;
+		}
+	}
+	if (!entry) { entry = ct_tree_cache_get_free_entry(cache); }
+
+	entry->key = key;
+	entry->values.dimensions[0] = num_vertices;
+	entry->values.dimensions[1] = entry->values.dimensions[2] = 1;
+	entry->values.spacing[0] = entry->values.spacing[1] = entry->values.spacing[2] = 1.f;
+	entry->values.scalar_type = CT_VOLUME_TYPE_FLOAT32;
+	entry->values.scalars = malloc((size_t)num_vertices * sizeof(float));
+	if (!entry->values.scalars)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for cached values.");
+		ct_tree_cache_entry_free(entry);
+		return -1;
+	}
+	memcpy(entry->values.scalars, values, (size_t)num_vertices * sizeof(float));
+
+	if (ct_tree_copy(join_tree, &(entry->join_tree), error) ||
+		ct_tree_copy(split_tree, &(entry->split_tree), error) ||
+		ct_tree_copy(contour_tree, &(entry->contour_tree), error))
+	{
+		ct_tree_cache_entry_free(entry);
+		return -1;
+	}
+
+	cache->clock++;
+	entry->last_used = cache->clock;
+
+	return ct_tree_cache_write_entry(cache, entry, error);
+}
+
+/***********
+ * Entries *
+ ***********/
+
+ct_tree_cache_entry_t *ct_tree_cache_get_free_entry(ct_tree_cache_t *cache)
+{
+	// An empty entry if there is one, otherwise the least recently used is evicted:
+	ct_tree_cache_entry_t *entry = &(cache->entries[0]);
+	for (uint32_t i = 0; i < cache->num_entries; i++)
+	{
+		if (cache->entries[i].last_used < entry->last_used) { entry = &(cache->entries[i]); }
+	}
+
+	ct_tree_cache_entry_free(entry);
+	return entry;
+}
+
+void ct_tree_cache_entry_free(ct_tree_cache_entry_t *entry)
+{
+	ct_volume_free(&(entry->values));
+	ct_tree_free(&(entry->join_tree));
+	ct_tree_free(&(entry->split_tree));
+	ct_tree_free(&(entry->contour_tree));
+	memset(entry, 0, sizeof(*entry));
+}
+
+int ct_tree_cache_read_entry(ct_tree_cache_t *cache, uint64_t key, uint32_t num_vertices,
+						ct_tree_cache_entry_t *entry)
+{
+	/* Anything missing, not matching or failing ct_tree_check is a miss, so a damaged cache
+	 * only costs a rebuild. */
+	char path[NM_MAX_PATH_LENGTH];
+	char error[NM_MAX_ERROR_LENGTH];
+	memset(entry, 0, sizeof(*entry));
+
+	size_t data_size;
+	ct_tree_cache_get_path(cache, key, "values.vol", path);
+	uint8_t *data = ct_file_map(path, &data_size, 0, error);
+	if (!data) { return 0; }
+
+	uint8_t big_endian;
+	uint32_t data_offset;
+	ct_volume_t *volume = &(entry->values);
+	if (ct_volume_parse_header(data, data_size, volume, &big_endian, &data_offset, path,
+		error) || (volume->dimensions[0] != num_vertices) || (volume->dimensions[1] != 1) ||
+		(volume->dimensions[2] != 1) || (volume->scalar_type != CT_VOLUME_TYPE_FLOAT32) ||
+		(big_endian != ct_host_is_big_endian()) ||
+		(data_size < (data_offset + ((uint64_t)num_vertices * sizeof(float)))))
+	{
+		ct_file_unmap(data, data_size);
+		memset(entry, 0, sizeof(*entry));
+		return 0;
+	}
+	volume->mapping = data;
+	volume->mapping_size = data_size;
+	volume->scalars = &(data[data_offset]);
+
+	ct_tree_t *trees[3] = { &(entry->join_tree), &(entry->split_tree),
+						&(entry->contour_tree) };
+	char *parts[3] = { "join.ctt", "split.ctt", "contour.ctt" };
+	for (int i = 0; i < 3; i++)
+	{
+		ct_tree_cache_get_path(cache, key, parts[i], path);
+		if (ct_tree_load(trees[i], path, num_vertices, error))
+		{
+			ct_tree_cache_entry_free(entry);
+			return 0;
+		}
+	}
+
+	entry->key = key;
+	return 1;
+}
+
+int ct_tree_cache_write_entry(ct_tree_cache_t *cache, ct_tree_cache_entry_t *entry,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	if (!strcmp(cache->directory, "")) { return 0; }
+
+	// Values first, so a complete set of trees always has values to go with it:
+	char path[NM_MAX_PATH_LENGTH];
+	ct_tree_cache_get_path(cache, entry->key, "values.vol", path);
+	if (ct_tree_cache_write_file(path, NULL, &(entry->values), error)) { return -1; }
+
+	ct_tree_t *trees[3] = { &(entry->join_tree), &(entry->split_tree),
+						&(entry->contour_tree) };
+	char *parts[3] = { "join.ctt", "split.ctt", "contour.ctt" };
+	for (int i = 0; i < 3; i++)
+	{
+		ct_tree_cache_get_path(cache, entry->key, parts[i], path);
+		if (ct_tree_cache_write_file(path, trees[i], NULL, error)) { return -1; }
+	}
+
+	return 0;
+}
+
+int ct_tree_cache_write_file(char *path, ct_tree_t *tree, ct_volume_t *values,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	// Written under a temporary name and renamed, so readers never see a partial file:
+	char temporary_path[NM_MAX_PATH_LENGTH + 4];
+	snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path);
+
+	FILE *file = fopen(temporary_path, "wb");
+	if (!file)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not open \"%s\" for writing.",
+								temporary_path);
+		return -1;
+	}
+
+	int status;
+	if (tree) { status = ct_tree_write(file, tree, 0, 0, error); }
+	else { status = ct_mesh_write_volume(file, values, error); }
+	if (fclose(file) && !status)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not write \"%s\".", temporary_path);
+		status = -1;
+	}
+	if (!status && rename(temporary_path, path))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not rename \"%s\".", temporary_path);
+		status = -1;
+	}
+
+	if (status) { remove(temporary_path); }
+	return status;
+}
+
+void ct_tree_cache_get_path(ct_tree_cache_t *cache, uint64_t key, char *part,
+						char path[NM_MAX_PATH_LENGTH])
+{
+	snprintf(path, NM_MAX_PATH_LENGTH, "%s/%016llx-%s", cache->directory,
+						(unsigned long long)key, part);
+}
@@ -0,0 +1,64 @@
+#ifndef CT_TREE_CACHE_H
+#define CT_TREE_CACHE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <NM-Config/Config.h>
+
+#include "Contour-Tree.h"
+#include "Mesh.h"
+#include "Mesh-Loader.h"
+#include "Parallel.h"
+#include "Tree-File.h"
+
+#define CT_TREE_CACHE_ENTRIES 8 // Default number of entries kept in memory.
+#define CT_TREE_CACHE_NAME_LENGTH 29 // "/", 16 hex digits, "-" and "contour.ctt".
+
+typedef struct
+{
+	uint64_t key;
+	uint64_t last_used;	// Higher is more recent, 0 if the entry is empty.
+	ct_volume_t values;	// Scalar value per vertex. X dimension is the number of vertices.
+	ct_tree_t join_tree;	// Reduced to critical nodes.
+	ct_tree_t split_tree;	// Reduced to critical nodes.
+	ct_tree_t contour_tree;
+} ct_tree_cache_entry_t;
+
+typedef struct
+{
+	char directory[NM_MAX_PATH_LENGTH]; // On-disk cache. Empty to keep entries in memory only.
+	uint64_t clock;
+	uint64_t num_hits;
+	uint64_t num_misses;
+	uint32_t num_entries;
+	ct_tree_cache_entry_t *entries;
+} ct_tree_cache_t;
+
+// Cache:
+int ct_tree_cache_init(ct_tree_cache_t *cache, char *directory, uint32_t num_entries,
+						char error[NM_MAX_ERROR_LENGTH]);
+void ct_tree_cache_free(ct_tree_cache_t *cache);
+uint64_t ct_tree_cache_get_key(ct_mesh_t *mesh, char *function_name);
+int ct_tree_cache_find(ct_tree_cache_t *cache, uint64_t key, uint32_t num_vertices,
+	float *values, ct_tree_t *join_tree, ct_tree_t *split_tree, ct_tree_t *contour_tree,
+	char error[NM_MAX_ERROR_LENGTH]);
+int ct_tree_cache_insert(ct_tree_cache_t *cache, uint64_t key, uint32_t num_vertices,
+	float *values, ct_tree_t *join_tree, ct_tree_t *split_tree, ct_tree_t *contour_tree,
+	char error[NM_MAX_ERROR_LENGTH]);
+
+// Entries:
+ct_tree_cache_entry_t *ct_tree_cache_get_free_entry(ct_tree_cache_t *cache);
+void ct_tree_cache_entry_free(ct_tree_cache_entry_t *entry);
+int ct_tree_cache_read_entry(ct_tree_cache_t *cache, uint64_t key, uint32_t num_vertices,
+						ct_tree_cache_entry_t *entry);
+int ct_tree_cache_write_entry(ct_tree_cache_t *cache, ct_tree_cache_entry_t *entry,
+						char error[NM_MAX_ERROR_LENGTH]);
+int ct_tree_cache_write_file(char *path, ct_tree_t *tree, ct_volume_t *values,
+						char error[NM_MAX_ERROR_LENGTH]);
+void ct_tree_cache_get_path(ct_tree_cache_t *cache, uint64_t key, char *part,
+						char path[NM_MAX_PATH_LENGTH]);
+
+#endif
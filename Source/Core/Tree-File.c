@@ -0,0 +1,589 @@
+#include "Tree-File.h"
+
+/*********
+ * Trees *
+ *********/
+
+int ct_tree_write(FILE *file, ct_tree_t *tree, uint32_t num_vertices, uint8_t compressed,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Header (64 bytes, little-endian):
+	 * 0	"CTT1"
+	 * 4	uint32 flags (CT_TREE_FLAG_<X>)
+	 * 8	uint32 number of nodes
+	 * 12	uint32 number of arc slots (length of the arc array)
+	 * 16	uint32 number of arcs
+	 * 20	uint32 number of roots
+	 * 24	uint32 number of vertices in the vertex map (0 if there is none)
+	 * 28	reserved
+	 * 32	uint64 offsets of the nodes, arcs, roots and vertex map (CT_TREE_SECTION_<X>)
+	 *
+	 * Sections are arrays of little-endian 32-bit words, each starting on 8 bytes. A node is
+	 * 7 words in the order of ct_tree_node_t (value bits, node to vertex, vertex to node, up
+	 * and down degree, up and down first arc), so on little-endian hosts ct_tree_load points
+	 * the tree straight into the file mapping with nothing to parse.
+	 *
+	 * Compressed files store each word as an LEB128 varint instead, with everything but
+	 * the degrees written as a zigzag delta. Values, vertices and arcs change little from
+	 * one entry to the next, and first arcs are taken relative to where the previous node's
+	 * arcs end, which is almost always exactly where they begin. These are smaller, but
+	 * have to be decoded into memory. */
+
+	if (!tree->num_nodes || !tree->nodes)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Tree has no nodes to write.");
+		return -1;
+	}
+	if (sizeof(ct_tree_node_t) != (CT_TREE_NODE_WORDS * sizeof(uint32_t)))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Tree nodes are padded, so can't be written.");
+		return -1;
+	}
+
+	uint32_t num_arc_slots = ct_tree_get_num_arc_slots(tree);
+	uint32_t *vertex_map = NULL;
+	if (num_vertices)
+	{
+		vertex_map = ct_tree_get_vertex_map(tree, num_vertices, error);
+		if (!vertex_map) { return -1; }
+	}
+
+	uint64_t offsets[4];
+	ct_tree_writer_t writer;
+	if (compressed)
+	{
+		// Sized first, so the header can give every offset up front:
+		memset(&writer, 0, sizeof(writer));
+		if (ct_tree_write_compressed(&writer, tree, num_arc_slots, vertex_map, num_vertices,
+								offsets, error))
+		{
+			goto error;
+		}
+	}
+	else
+	{
+		uint64_t sizes[3] = { (uint64_t)tree->num_nodes * CT_TREE_NODE_WORDS,
+				num_arc_slots, tree->num_roots };
+		offsets[0] = CT_TREE_HEADER_SIZE;
+		for (int i = 0; i < 3; i++)
+		{
+			offsets[i + 1] = offsets[i] + (sizes[i] * sizeof(uint32_t));
+			offsets[i + 1] += (8 - (offsets[i + 1] % 8)) % 8;
+		}
+	}
+
+	uint8_t header[CT_TREE_HEADER_SIZE] = {0};
+	memcpy(header, CT_TREE_MAGIC, 4);
+	ct_write_u32_le(&(header[4]), compressed ? CT_TREE_FLAG_COMPRESSED : 0);
+	ct_write_u32_le(&(header[8]), tree->num_nodes);
+	ct_write_u32_le(&(header[12]), num_arc_slots);
+	ct_write_u32_le(&(header[16]), tree->num_arcs);
+	ct_write_u32_le(&(header[20]), tree->num_roots);
+	ct_write_u32_le(&(header[24]), num_vertices);
+	for (int i = 0; i < 4; i++) { ct_write_u64_le(&(header[32 + (i * 8)]), offsets[i]); }
+	if (fwrite(header, 1, CT_TREE_HEADER_SIZE, file) != CT_TREE_HEADER_SIZE)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not write tree header.");
+		goto error;
+	}
+
+	if (compressed)
+	{
+		memset(&writer, 0, sizeof(writer));
+		writer.file = file;
+		if (ct_tree_write_compressed(&writer, tree, num_arc_slots, vertex_map, num_vertices,
+								offsets, error))
+		{
+			goto error;
+		}
+	}
+	else
+	{
+		if (ct_tree_write_words(file, (uint32_t *)tree->nodes,
+			(uint64_t)tree->num_nodes * CT_TREE_NODE_WORDS,
+			offsets[1] - offsets[0] - ((uint64_t)tree->num_nodes * sizeof(ct_tree_node_t)),
+			error) ||
+			ct_tree_write_words(file, tree->arcs, num_arc_slots, offsets[2] - offsets[1] -
+				((uint64_t)num_arc_slots * sizeof(uint32_t)), error) ||
+			ct_tree_write_words(file, tree->roots, tree->num_roots, offsets[3] - offsets[2] -
+				((uint64_t)tree->num_roots * sizeof(uint32_t)), error) ||
+			ct_tree_write_words(file, vertex_map, num_vertices, 0, error))
+		{
+			goto error;
+		}
+	}
+
+	if (vertex_map && (vertex_map != tree->vertex_map)) { free(vertex_map); }
+	return 0;
+
+	error:
+	if (vertex_map && (vertex_map != tree->vertex_map)) { free(vertex_map); }
+	return -1;
+}
+
+int ct_tree_load(ct_tree_t *tree, char *path, uint32_t num_vertices,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Uncompressed files are mapped copy-on-write and used in place, so loading costs the
+	 * same whatever the size of the tree, and pages are only read in as they are touched.
+	 * The tree can still be changed (e.g. by ct_merge_trees_reduce_to_critical) without
+	 * changing the file. Arcs are always checked (see ct_tree_check), which touches every
+	 * page, and nodes are checked to be on vertices too if num_vertices is given. */
+
+	if (sizeof(ct_tree_node_t) != (CT_TREE_NODE_WORDS * sizeof(uint32_t)))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Tree nodes are padded, so can't be loaded.");
+		return -1;
+	}
+
+	size_t data_size;
+	uint8_t *data = ct_file_map(path, &data_size, 1, error);
+	if (!data) { return -1; }
+
+	ct_tree_t loaded = {0};
+	uint32_t flags;
+	uint32_t num_arc_slots;
+	uint64_t offsets[4];
+	if (ct_tree_parse_header(data, data_size, &loaded, &flags, &num_arc_slots, offsets, path,
+									error))
+	{
+		ct_file_unmap(data, data_size);
+		return -1;
+	}
+
+	if (flags & CT_TREE_FLAG_COMPRESSED)
+	{
+		int status = ct_tree_read_compressed(&loaded, data, data_size, num_arc_slots,
+									offsets, error);
+		ct_file_unmap(data, data_size);
+		if (status) { return -1; }
+	}
+	else
+	{
+		uint64_t sizes[4] = { (uint64_t)loaded.num_nodes * CT_TREE_NODE_WORDS,
+				num_arc_slots, loaded.num_roots, loaded.num_vertices };
+		for (int i = 0; i < 4; i++)
+		{
+			if ((offsets[i] % sizeof(uint32_t)) || (offsets[i] > data_size) ||
+				(sizes[i] > ((data_size - offsets[i]) / sizeof(uint32_t))))
+			{
+				snprintf(error, NM_MAX_ERROR_LENGTH,
+					"Tree file \"%s\" is truncated.", path);
+				ct_file_unmap(data, data_size);
+				return -1;
+			}
+			if (ct_host_is_big_endian())
+			{
+				ct_swap_byte_order(&(data[offsets[i]]), &(data[offsets[i]]),
+							sizes[i], sizeof(uint32_t));
+			}
+		}
+
+		loaded.mapping = data;
+		loaded.mapping_size = data_size;
+		loaded.nodes = (ct_tree_node_t *)&(data[offsets[CT_TREE_SECTION_NODES]]);
+		if (num_arc_slots)
+		{
+			loaded.arcs = (uint32_t *)&(data[offsets[CT_TREE_SECTION_ARCS]]);
+		}
+		if (loaded.num_roots)
+		{
+			loaded.roots = (uint32_t *)&(data[offsets[CT_TREE_SECTION_ROOTS]]);
+		}
+		if (loaded.num_vertices)
+		{
+			loaded.vertex_map = (uint32_t *)&(data[offsets[CT_TREE_SECTION_VERTEX_MAP]]);
+		}
+	}
+
+	for (uint32_t i = 0; i < loaded.num_roots; i++)
+	{
+		if (loaded.roots[i] >= loaded.num_nodes)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH,
+				"Tree file \"%s\" has an invalid root.", path);
+			ct_tree_free(&loaded);
+			return -1;
+		}
+	}
+
+	if (ct_tree_check(&loaded, num_arc_slots, num_vertices, path, error))
+	{
+		ct_tree_free(&loaded);
+		return -1;
+	}
+
+	ct_tree_free(tree);
+	*tree = loaded;
+	return 0;
+}
+
+int ct_tree_parse_header(uint8_t *header, size_t size, ct_tree_t *tree, uint32_t *flags,
+		uint32_t *num_arc_slots, uint64_t offsets[4], char *path,
+		char error[NM_MAX_ERROR_LENGTH])
+{
+	// Fills in the tree's counts (but none of its arrays), checking they make sense.
+	if ((size < CT_TREE_HEADER_SIZE) || memcmp(header, CT_TREE_MAGIC, 4))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "File \"%s\" is not a tree file.", path);
+		return -1;
+	}
+
+	*flags = ct_read_u32_le(&(header[4]));
+	tree->num_nodes = ct_read_u32_le(&(header[8]));
+	*num_arc_slots = ct_read_u32_le(&(header[12]));
+	tree->num_arcs = ct_read_u32_le(&(header[16]));
+	tree->num_roots = ct_read_u32_le(&(header[20]));
+	tree->num_vertices = ct_read_u32_le(&(header[24]));
+	for (int i = 0; i < 4; i++) { offsets[i] = ct_read_u64_le(&(header[32 + (i * 8)])); }
+
+	if (*flags & ~CT_TREE_FLAG_COMPRESSED)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Tree file \"%s\" has unknown flags 0x%x.", path, *flags);
+		return -1;
+	}
+	if (!tree->num_nodes || (tree->num_arcs > *num_arc_slots) ||
+		(tree->num_roots > tree->num_nodes))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Tree file \"%s\" has invalid node, arc or root counts.", path);
+		return -1;
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		if ((offsets[i] < CT_TREE_HEADER_SIZE) || (offsets[i] > size))
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH,
+				"Tree file \"%s\" has an invalid section offset.", path);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int ct_tree_check(ct_tree_t *tree, uint32_t num_arc_slots, uint32_t num_vertices, char *path,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	/* Everything a loaded tree is indexed with: each node's arcs lie inside the arc section
+	 * and lead to nodes, each node is on a vertex of the mesh (if num_vertices is given), and
+	 * the vertex map (if any) leads to nodes. Values and ordering are not checked, as any
+	 * bytes there are safe to use, and a tree that is wrong only in those is no worse than a
+	 * stale one. */
+	uint32_t num_invalid = 0;
+	#pragma omp parallel for reduction(+: num_invalid) if (tree->num_nodes > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < tree->num_nodes; i++)
+	{
+		ct_tree_node_t *node = &(tree->nodes[i]);
+		num_invalid += (num_vertices && (node->node_to_vertex >= num_vertices));
+		for (int direction = 0; direction < 2; direction++)
+		{
+			if (!node->degree[direction]) { continue; }
+			if (((uint64_t)node->first_arc[direction] + node->degree[direction]) >
+									num_arc_slots)
+			{
+				num_invalid++;
+				continue;
+			}
+			for (uint32_t j = 0; j < node->degree[direction]; j++)
+			{
+				num_invalid += (tree->arcs[node->first_arc[direction] + j] >=
+									tree->num_nodes);
+			}
+		}
+	}
+
+	#pragma omp parallel for reduction(+: num_invalid) \
+		if (tree->num_vertices > CT_PARALLEL_THRESHOLD)
+	for (uint32_t i = 0; i < tree->num_vertices; i++)
+	{
+		num_invalid += ((tree->vertex_map[i] != CT_TREE_NO_NODE) &&
+				(tree->vertex_map[i] >= tree->num_nodes));
+	}
+
+	if (num_invalid)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH,
+			"Tree file \"%s\" has %u invalid arcs, vertices or map entries.",
+								path, num_invalid);
+		return -1;
+	}
+
+	return 0;
+}
+
+uint32_t *ct_tree_get_vertex_map(ct_tree_t *tree, uint32_t num_vertices,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	// The tree's own map if it has one this size, otherwise one made from node_to_vertex:
+	if (tree->vertex_map && (tree->num_vertices == num_vertices)) { return tree->vertex_map; }
+
+	uint32_t *vertex_map = malloc((size_t)num_vertices * sizeof(uint32_t));
+	if (!vertex_map)
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for vertex map.");
+		return NULL;
+	}
+	memset(vertex_map, 0xFF, (size_t)num_vertices * sizeof(uint32_t));
+
+	for (uint32_t i = 0; i < tree->num_nodes; i++)
+	{
+		if (tree->nodes[i].node_to_vertex >= num_vertices)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH,
+				"Tree node %u has vertex %u, but there are only %u vertices.",
+				i, tree->nodes[i].node_to_vertex, num_vertices);
+			free(vertex_map);
+			return NULL;
+		}
+		vertex_map[tree->nodes[i].node_to_vertex] = i;
+	}
+
+	return vertex_map;
+}
+
+/************************
+ * Fixed-width sections *
+ ************************/
+
+int ct_tree_write_words(FILE *file, uint32_t *words, uint64_t num_words, uint64_t padding,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	// Written as they are on little-endian hosts, otherwise swapped a chunk at a time:
+	if (!ct_host_is_big_endian())
+	{
+		if (num_words && (fwrite(words, sizeof(uint32_t), num_words, file) != num_words))
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "Could not write tree section.");
+			return -1;
+		}
+	}
+	else
+	{
+		uint32_t chunk[CT_TREE_WRITE_BUFFER_SIZE / sizeof(uint32_t)];
+		uint64_t chunk_size = CT_TREE_WRITE_BUFFER_SIZE / sizeof(uint32_t);
+		for (uint64_t i = 0; i < num_words; i += chunk_size)
+		{
+			uint64_t count = ((num_words - i) < chunk_size) ? (num_words - i) : chunk_size;
+			ct_swap_byte_order(chunk, &(words[i]), count, sizeof(uint32_t));
+			if (fwrite(chunk, sizeof(uint32_t), count, file) != count)
+			{
+				snprintf(error, NM_MAX_ERROR_LENGTH, "Could not write tree section.");
+				return -1;
+			}
+		}
+	}
+
+	uint8_t zeros[8] = {0};
+	if (padding && (fwrite(zeros, 1, padding, file) != padding))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not write tree section padding.");
+		return -1;
+	}
+
+	return 0;
+}
+
+/***********************
+ * Compressed sections *
+ ***********************/
+
+int ct_tree_write_compressed(ct_tree_writer_t *writer, ct_tree_t *tree,
+	uint32_t num_arc_slots, uint32_t *vertex_map, uint32_t num_vertices,
+	uint64_t offsets[4], char error[NM_MAX_ERROR_LENGTH])
+{
+	// Nodes:
+	offsets[CT_TREE_SECTION_NODES] = CT_TREE_HEADER_SIZE + writer->size;
+	uint32_t previous[CT_TREE_NODE_WORDS] = {0};
+	uint32_t arcs_end[2] = { 0, 0 };
+	uint32_t words[CT_TREE_NODE_WORDS];
+	for (uint32_t i = 0; i < tree->num_nodes; i++)
+	{
+		memcpy(words, &(tree->nodes[i]), sizeof(words));
+		if (ct_tree_writer_put_delta(writer, words[0], previous[0], error) ||
+			ct_tree_writer_put_delta(writer, words[1], previous[1], error) ||
+			ct_tree_writer_put_delta(writer, words[2], previous[2], error) ||
+			ct_tree_writer_put(writer, words[3], error) ||
+			ct_tree_writer_put(writer, words[4], error) ||
+			ct_tree_writer_put_delta(writer, words[5], arcs_end[0], error) ||
+			ct_tree_writer_put_delta(writer, words[6], arcs_end[1], error))
+		{
+			return -1;
+		}
+		arcs_end[0] = words[5] + words[3];
+		arcs_end[1] = words[6] + words[4];
+		memcpy(previous, words, sizeof(words));
+	}
+
+	// Arcs, roots and vertex map:
+	uint32_t *sections[3] = { tree->arcs, tree->roots, vertex_map };
+	uint32_t sizes[3] = { num_arc_slots, tree->num_roots, num_vertices };
+	for (int i = 0; i < 3; i++)
+	{
+		offsets[i + 1] = CT_TREE_HEADER_SIZE + writer->size;
+		uint32_t previous_word = 0;
+		for (uint32_t j = 0; j < sizes[i]; j++)
+		{
+			if (ct_tree_writer_put_delta(writer, sections[i][j], previous_word, error))
+			{
+				return -1;
+			}
+			previous_word = sections[i][j];
+		}
+	}
+
+	return ct_tree_writer_flush(writer, error);
+}
+
+int ct_tree_read_compressed(ct_tree_t *tree, uint8_t *data, size_t size,
+	uint32_t num_arc_slots, uint64_t offsets[4], char error[NM_MAX_ERROR_LENGTH])
+{
+	uint8_t *end = &(data[size]);
+	tree->nodes = malloc((size_t)tree->num_nodes * sizeof(ct_tree_node_t));
+	if (num_arc_slots) { tree->arcs = malloc((size_t)num_arc_slots * sizeof(uint32_t)); }
+	if (tree->num_roots) { tree->roots = malloc((size_t)tree->num_roots * sizeof(uint32_t)); }
+	if (tree->num_vertices)
+	{
+		tree->vertex_map = malloc((size_t)tree->num_vertices * sizeof(uint32_t));
+	}
+	if (!tree->nodes || (num_arc_slots && !tree->arcs) || (tree->num_roots && !tree->roots) ||
+		(tree->num_vertices && !tree->vertex_map))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not allocate memory for tree.");
+		ct_tree_free(tree);
+		return -1;
+	}
+
+	// Nodes:
+	uint8_t *position = &(data[offsets[CT_TREE_SECTION_NODES]]);
+	uint32_t previous[CT_TREE_NODE_WORDS] = {0};
+	uint32_t arcs_end[2] = { 0, 0 };
+	uint32_t words[CT_TREE_NODE_WORDS];
+	uint64_t degree = 0;
+	for (uint32_t i = 0; i < tree->num_nodes; i++)
+	{
+		position = ct_tree_read_delta(position, end, previous[0], &(words[0]));
+		position = ct_tree_read_delta(position, end, previous[1], &(words[1]));
+		position = ct_tree_read_delta(position, end, previous[2], &(words[2]));
+		for (int j = 3; j < 5; j++)
+		{
+			position = ct_tree_read_varint(position, end, &degree);
+			if (degree > UINT32_MAX) { position = NULL; }
+			words[j] = degree;
+		}
+		position = ct_tree_read_delta(position, end, arcs_end[0], &(words[5]));
+		position = ct_tree_read_delta(position, end, arcs_end[1], &(words[6]));
+		if (!position)
+		{
+			snprintf(error, NM_MAX_ERROR_LENGTH, "Compressed tree nodes are corrupt.");
+			ct_tree_free(tree);
+			return -1;
+		}
+		memcpy(&(tree->nodes[i]), words, sizeof(words));
+		arcs_end[0] = words[5] + words[3];
+		arcs_end[1] = words[6] + words[4];
+		memcpy(previous, words, sizeof(words));
+	}
+
+	// Arcs, roots and vertex map:
+	uint32_t *sections[3] = { tree->arcs, tree->roots, tree->vertex_map };
+	uint32_t sizes[3] = { num_arc_slots, tree->num_roots, tree->num_vertices };
+	for (int i = 0; i < 3; i++)
+	{
+		position = &(data[offsets[i + 1]]);
+		uint32_t previous_word = 0;
+		for (uint32_t j = 0; j < sizes[i]; j++)
+		{
+			position = ct_tree_read_delta(position, end, previous_word, &(sections[i][j]));
+			if (!position)
+			{
+				snprintf(error, NM_MAX_ERROR_LENGTH,
+					"Compressed tree section %d is corrupt.", i + 1);
+				ct_tree_free(tree);
+				return -1;
+			}
+			previous_word = sections[i][j];
+		}
+	}
+
+	return 0;
+}
+
+int ct_tree_writer_put(ct_tree_writer_t *writer, uint64_t value,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	// LEB128: 7 bits at a time, low first, with the top bit set on all but the last byte.
+	if (((writer->num_buffered + 10) > CT_TREE_WRITE_BUFFER_SIZE) &&
+		ct_tree_writer_flush(writer, error))
+	{
+		return -1;
+	}
+
+	do
+	{
+		uint8_t byte = value & 0x7F;
+		value >>= 7;
+		if (value) { byte |= 0x80; }
+		writer->buffer[writer->num_buffered] = byte;
+		writer->num_buffered++;
+		writer->size++;
+	} while (value);
+
+	return 0;
+}
+
+int ct_tree_writer_put_delta(ct_tree_writer_t *writer, uint32_t value, uint32_t previous,
+						char error[NM_MAX_ERROR_LENGTH])
+{
+	// Zigzag, so small negative differences stay small: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+	int64_t delta = (int64_t)value - previous;
+	uint64_t zigzag = (delta < 0) ? (((uint64_t)(-delta) * 2) - 1) : ((uint64_t)delta * 2);
+	return ct_tree_writer_put(writer, zigzag, error);
+}
+
+int ct_tree_writer_flush(ct_tree_writer_t *writer, char error[NM_MAX_ERROR_LENGTH])
+{
+	if (writer->file && writer->num_buffered &&
+		(fwrite(writer->buffer, 1, writer->num_buffered, writer->file) !=
+								writer->num_buffered))
+	{
+		snprintf(error, NM_MAX_ERROR_LENGTH, "Could not write compressed tree section.");
+		return -1;
+	}
+	writer->num_buffered = 0;
+	return 0;
+}
+
+uint8_t *ct_tree_read_varint(uint8_t *position, uint8_t *end, uint64_t *value)
+{
+	// Returns the position after the varint, or NULL if it is cut off or too long:
+	if (!position) { return NULL; }
+
+	*value = 0;
+	for (uint8_t shift = 0; (shift < 64) && (position < end); shift += 7)
+	{
+		*value |= (uint64_t)(*position & 0x7F) << shift;
+		if (!(*(position++) & 0x80)) { return position; }
+	}
+	return NULL;
+}
+
+uint8_t *ct_tree_read_delta(uint8_t *position, uint8_t *end, uint32_t previous,
+								uint32_t *value)
+{
+	uint64_t zigzag;
+	position = ct_tree_read_varint(position, end, &zigzag);
+	if (!position) { return NULL; }
+
+	int64_t result = (int64_t)previous;
+	if (zigzag & 1) { result -= (int64_t)((zigzag >> 1) + 1); }
+	else { result += (int64_t)(zigzag >> 1); }
+	if ((zigzag > ((uint64_t)UINT32_MAX * 2)) || (result < 0) || (result > UINT32_MAX))
+	{
+		return NULL;
+	}
+
+	*value = result;
+	return position;
+}
@@ -0,0 +1,67 @@
+#ifndef CT_TREE_FILE_H
+#define CT_TREE_FILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <omp.h>
+
+#include <NM-Config/Config.h>
+
+#include "Contour-Tree.h"
+#include "Mesh-Loader.h"
+#include "Parallel.h"
+
+#define CT_TREE_MAGIC			"CTT1"
+#define CT_TREE_HEADER_SIZE		64
+#define CT_TREE_FLAG_COMPRESSED		1
+#define CT_TREE_NODE_WORDS		7	// 32-bit words per node, as in ct_tree_node_t.
+#define CT_TREE_WRITE_BUFFER_SIZE	65536
+#define CT_TREE_SECTION_NODES		0
+#define CT_TREE_SECTION_ARCS		1
+#define CT_TREE_SECTION_ROOTS		2
+#define CT_TREE_SECTION_VERTEX_MAP	3
+
+typedef struct
+{
+	FILE *file;		// NULL to only count the bytes that would be written.
+	uint64_t size;		// Bytes written so far.
+	uint32_t num_buffered;
+	uint8_t buffer[CT_TREE_WRITE_BUFFER_SIZE];
+} ct_tree_writer_t;
+
+// Trees:
+int ct_tree_write(FILE *file, ct_tree_t *tree, uint32_t num_vertices, uint8_t compressed,
+						char error[NM_MAX_ERROR_LENGTH]);
+int ct_tree_load(ct_tree_t *tree, char *path, uint32_t num_vertices,
+						char error[NM_MAX_ERROR_LENGTH]);
+int ct_tree_parse_header(uint8_t *header, size_t size, ct_tree_t *tree, uint32_t *flags,
+		uint32_t *num_arc_slots, uint64_t offsets[4], char *path,
+		char error[NM_MAX_ERROR_LENGTH]);
+int ct_tree_check(ct_tree_t *tree, uint32_t num_arc_slots, uint32_t num_vertices, char *path,
+						char error[NM_MAX_ERROR_LENGTH]);
+uint32_t *ct_tree_get_vertex_map(ct_tree_t *tree, uint32_t num_vertices,
+						char error[NM_MAX_ERROR_LENGTH]);
+
+// Fixed-width sections:
+int ct_tree_write_words(FILE *file, uint32_t *words, uint64_t num_words, uint64_t padding,
+						char error[NM_MAX_ERROR_LENGTH]);
+
+// Compressed sections:
+int ct_tree_write_compressed(ct_tree_writer_t *writer, ct_tree_t *tree,
+	uint32_t num_arc_slots, uint32_t *vertex_map, uint32_t num_vertices,
+	uint64_t offsets[4], char error[NM_MAX_ERROR_LENGTH]);
+int ct_tree_read_compressed(ct_tree_t *tree, uint8_t *data, size_t size,
+	uint32_t num_arc_slots, uint64_t offsets[4], char error[NM_MAX_ERROR_LENGTH]);
+int ct_tree_writer_put(ct_tree_writer_t *writer, uint64_t value,
+						char error[NM_MAX_ERROR_LENGTH]);
+int ct_tree_writer_put_delta(ct_tree_writer_t *writer, uint32_t value, uint32_t previous,
+						char error[NM_MAX_ERROR_LENGTH]);
+int ct_tree_writer_flush(ct_tree_writer_t *writer, char error[NM_MAX_ERROR_LENGTH]);
+uint8_t *ct_tree_read_varint(uint8_t *position, uint8_t *end, uint64_t *value);
+uint8_t *ct_tree_read_delta(uint8_t *position, uint8_t *end, uint32_t previous,
+								uint32_t *value);
+
+#endif